@@ -4,6 +4,8 @@
 const API_BASE = '';
 const UPDATE_INTERVAL = 2000; // 2 segundos
 const MAX_LOG_ENTRIES = 20;
+// MessagePack nas APIs de stats e dispositivos (abra com ?msgpack)
+const USE_MSGPACK = new URLSearchParams(window.location.search).has('msgpack');
 
 // Estado da aplicacao
 let isConnected = false;
@@ -96,10 +98,7 @@ function startUpdates() {
 // Busca estatisticas do gateway
 async function fetchStats() {
     try {
-        const response = await fetch(API_BASE + '/api/stats');
-        if (!response.ok) throw new Error('Erro HTTP: ' + response.status);
-
-        const data = await response.json();
+        const data = await fetchApi('/api/stats');
         updateStats(data);
         setConnectionStatus(true);
     } catch (error) {
@@ -111,10 +110,7 @@ async function fetchStats() {
 // Busca lista de dispositivos
 async function fetchDevices() {
     try {
-        const response = await fetch(API_BASE + '/api/devices');
-        if (!response.ok) throw new Error('Erro HTTP: ' + response.status);
-
-        const data = await response.json();
+        const data = await fetchApi('/api/devices');
         updateDevicesTable(data.devices || [], data.uptime_ms || 0);
         updatePacketsLog(data.lastPackets || [], data.uptime_ms || 0, data.time_synced, data.boot_time || 0);
     } catch (error) {
@@ -122,6 +118,82 @@ async function fetchDevices() {
     }
 }
 
+// GET na API do gateway: JSON ou, com USE_MSGPACK, MessagePack
+async function fetchApi(path) {
+    const headers = USE_MSGPACK ? { 'Accept': 'application/msgpack, application/json' } : {};
+    const response = await fetch(API_BASE + path, { headers });
+    if (!response.ok) throw new Error('Erro HTTP: ' + response.status);
+
+    const type = response.headers.get('Content-Type') || '';
+    if (type.startsWith('application/msgpack')) {
+        return decodeMsgPack(await response.arrayBuffer());
+    }
+    return response.json();
+}
+
+// Decodificador MessagePack (tipos gerados pelo ArduinoJson)
+function decodeMsgPack(buffer) {
+    const view = new DataView(buffer);
+    const bytes = new Uint8Array(buffer);
+    const utf8 = new TextDecoder();
+    let pos = 0;
+
+    function str(length) {
+        const value = utf8.decode(bytes.subarray(pos, pos + length));
+        pos += length;
+        return value;
+    }
+    function array(length) {
+        const value = [];
+        for (let i = 0; i < length; i++) value.push(next());
+        return value;
+    }
+    function map(length) {
+        const value = {};
+        for (let i = 0; i < length; i++) {
+            const key = next();
+            value[key] = next();
+        }
+        return value;
+    }
+    function next() {
+        const type = bytes[pos++];
+        let value;
+
+        if (type <= 0x7f) return type;
+        if (type >= 0xe0) return type - 0x100;
+        if ((type & 0xe0) === 0xa0) return str(type & 0x1f);
+        if ((type & 0xf0) === 0x90) return array(type & 0x0f);
+        if ((type & 0xf0) === 0x80) return map(type & 0x0f);
+
+        switch (type) {
+            case 0xc0: return null;
+            case 0xc2: return false;
+            case 0xc3: return true;
+            case 0xca: value = view.getFloat32(pos); pos += 4; return value;
+            case 0xcb: value = view.getFloat64(pos); pos += 8; return value;
+            case 0xcc: return bytes[pos++];
+            case 0xcd: value = view.getUint16(pos); pos += 2; return value;
+            case 0xce: value = view.getUint32(pos); pos += 4; return value;
+            case 0xcf: value = Number(view.getBigUint64(pos)); pos += 8; return value;
+            case 0xd0: value = view.getInt8(pos); pos += 1; return value;
+            case 0xd1: value = view.getInt16(pos); pos += 2; return value;
+            case 0xd2: value = view.getInt32(pos); pos += 4; return value;
+            case 0xd3: value = Number(view.getBigInt64(pos)); pos += 8; return value;
+            case 0xd9: return str(bytes[pos++]);
+            case 0xda: value = view.getUint16(pos); pos += 2; return str(value);
+            case 0xdb: value = view.getUint32(pos); pos += 4; return str(value);
+            case 0xdc: value = view.getUint16(pos); pos += 2; return array(value);
+            case 0xdd: value = view.getUint32(pos); pos += 4; return array(value);
+            case 0xde: value = view.getUint16(pos); pos += 2; return map(value);
+            case 0xdf: value = view.getUint32(pos); pos += 4; return map(value);
+        }
+        throw new Error('MessagePack: tipo 0x' + type.toString(16) + ' nao suportado');
+    }
+
+    return next();
+}
+
 // Atualiza status de conexao
 function setConnectionStatus(connected) {
     isConnected = connected;
@@ -219,7 +291,7 @@ function updateDevicesTable(devices, uptimeMs) {
 
     if (devices.length === 0) {
         elements.devicesTableBody.innerHTML =
-            '<tr><td colspan="6" class="no-data">Nenhum dispositivo detectado</td></tr>';
+            '<tr><td colspan="7" class="no-data">Nenhum dispositivo detectado</td></tr>';
         return;
     }
 
@@ -229,6 +301,10 @@ function updateDevicesTable(devices, uptimeMs) {
         // Calcula diferenca em segundos entre uptime atual e ultimo contato
         const diffSeconds = Math.floor((uptimeMs - device.last_seen_ms) / 1000);
         const lastSeen = formatTimeDiff(diffSeconds);
+        // Perda nas ultimas sequencias (enlace degradado em destaque)
+        const link = device.link || {};
+        const lossClass = link.degraded ? 'rssi-poor' : '';
+        const loss = link.loss_pct !== undefined ? link.loss_pct.toFixed(1) + '%' : '-';
 
         html += `
             <tr>
@@ -237,6 +313,7 @@ function updateDevicesTable(devices, uptimeMs) {
                 <td class="${rssiClass}">${device.rssi} dBm</td>
                 <td>${device.snr.toFixed(1)} dB</td>
                 <td>${device.packets}</td>
+                <td class="${lossClass}" title="Jitter: ${link.jitter_ms || 0} ms, erro freq.: ${link.freq_err_hz || 0} Hz">${loss}</td>
                 <td>${lastSeen}</td>
             </tr>
         `;
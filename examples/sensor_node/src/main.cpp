@@ -108,6 +108,11 @@ uint8_t temprature_sens_read();
 #ifndef LORA_CR
 #define LORA_CR 5
 #endif
+// Preambulo: aumente (ex.: 32) se o gateway varrer varios SFs por CAD,
+// para que o preambulo dure mais que um ciclo completo de varredura
+#ifndef LORA_PREAMBLE_LENGTH
+#define LORA_PREAMBLE_LENGTH 8
+#endif
 
 // ID da maquina (ajuste para cada dispositivo)
 #ifndef MACHINE_ID
@@ -118,11 +123,30 @@ uint8_t temprature_sens_read();
 #define LORA_SYNC_WORD 0x20
 
 // Intervalo de transmissao periodica (ms)
-#define TX_INTERVAL 30000  // 30 segundos
+#define TX_INTERVAL 30000  // 30 segundos (padrao; alteravel por comando)
 
 // Debounce para deteccao de eventos (ms)
 #define DEBOUNCE_TIME 50
 
+// Janela de escuta do ACK apos cada envio (ms)
+// O gateway responde ACK_DELAY_MS (50 ms) apos receber o quadro; com ACK
+// agregado espera ate mais ACK_AGG_WINDOW_MS (100 ms) juntando outros nos
+#define ACK_WAIT_MS 400
+// Alem disso, ~80 simbolos (ACK JSON com comando) no SF atual
+#define ACK_WAIT_SYMBOLS 80
+
+// ADR: o gateway ajusta SF e potencia com o comando "set_radio". Sem ACK
+// nos primeiros envios apos um ajuste, volta a configuracao anterior; sem
+// ACK por muito tempo, volta a configuracao inicial
+#define ADR_REVERT_MISSED_ACKS 3
+#define ADR_FALLBACK_MISSED_ACKS 8
+
+// ACK agregado do gateway (binario): marcador, hash do gateway, N e
+// N entradas de {hash16 do id do no, seq & 0xFFFF}, big-endian
+#define ACK_AGG_MARKER 0xA5
+#define ACK_AGG_HEADER_SIZE 4
+#define ACK_AGG_ENTRY_SIZE 4
+
 // ============================================
 // OBJETOS GLOBAIS
 // ============================================
@@ -146,8 +170,23 @@ bool lastDI4 = false;
 
 // Ultimo envio e estados anteriores para deteccao de eventos
 unsigned long lastTxTime = 0;
+unsigned long txInterval = TX_INTERVAL;
 bool inputChanged = false;
 
+// Comandos de downlink: ultimo executado (reenvio do gateway nao repete)
+uint32_t lastCommandId = 0;
+bool lastCommandOk = false;
+uint32_t lastCommandExecMs = 0;
+bool sendRequested = false;
+
+// Configuracao de radio atual (ADR) e anterior (para reverter)
+uint8_t radioSf = LORA_SF;
+int radioPower = LORA_TX_POWER;
+uint8_t prevRadioSf = LORA_SF;
+int prevRadioPower = LORA_TX_POWER;
+bool radioProbing = false;
+uint8_t missedAcks = 0;
+
 // MAC Address
 String macAddress = "";
 
@@ -162,7 +201,16 @@ void initInputs();
 String getMacAddress();
 void sendMachineData(const char* trigger);
 String createPacket(const char* trigger);
-void checkForAck();
+bool checkForAck();
+bool parseAggregatedAck(const uint8_t* frame, int length);
+uint16_t hashNodeId(const char* id);
+void handleCommand(JsonObject cmd);
+bool executeCommand(const char* name, JsonObject params);
+void sendCommandAck(uint32_t id, bool ok, uint32_t execMs);
+void applyRadioSettings(uint8_t sf, int power);
+void trackAckResult(bool acked);
+unsigned long ackWaitMs();
+bool waitForAck(unsigned long timeoutMs);
 float readInternalTemperature();
 bool readDigitalInputs(bool &di1, bool &di2, bool &di3, bool &di4);
 void readAnalogInputs(uint16_t &ai1, uint16_t &ai2);
@@ -254,7 +302,7 @@ void loop() {
     bool eventTriggered = checkInputChanges();
 
     // Verifica se e hora da transmissao periodica
-    bool periodicTrigger = (millis() - lastTxTime >= TX_INTERVAL);
+    bool periodicTrigger = (millis() - lastTxTime >= txInterval);
 
     // Le estado atual das entradas
     bool di1, di2, di3, di4;
@@ -273,6 +321,11 @@ void loop() {
         Serial.println(">>> EVENTO: Mudanca detectada nas entradas!");
         sendMachineData("event");
         lastTxTime = millis();
+    } else if (sendRequested) {
+        Serial.println(">>> TX Solicitado por comando");
+        sendRequested = false;
+        sendMachineData("periodic");
+        lastTxTime = millis();
     } else if (periodicTrigger) {
         Serial.println(">>> TX Periodico");
         sendMachineData("periodic");
@@ -331,6 +384,7 @@ bool initLoRa() {
     LoRa.setSpreadingFactor(LORA_SF);
     LoRa.setSignalBandwidth(LORA_BW);
     LoRa.setCodingRate4(LORA_CR);
+    LoRa.setPreambleLength(LORA_PREAMBLE_LENGTH);
     LoRa.setTxPower(LORA_TX_POWER);
     LoRa.setSyncWord(LORA_SYNC_WORD);
     LoRa.enableCrc();
@@ -469,6 +523,10 @@ void sendMachineData(const char* trigger) {
 
     // Volta para modo de recepcao (para ACK)
     LoRa.receive();
+
+    if (result) {
+        trackAckResult(waitForAck(ackWaitMs()));
+    }
 }
 
 String createPacket(const char* trigger) {
@@ -516,16 +574,81 @@ String createPacket(const char* trigger) {
     return output;
 }
 
-void checkForAck() {
+bool waitForAck(unsigned long timeoutMs) {
+    // Consulta o radio continuamente durante a janela do ACK
+    unsigned long start = millis();
+    while (millis() - start < timeoutMs) {
+        if (checkForAck()) {
+            return true;
+        }
+        delay(1);
+    }
+    return false;
+}
+
+unsigned long ackWaitMs() {
+    // SF maior = ACK mais longo no ar
+    return ACK_WAIT_MS + (unsigned long)((ACK_WAIT_SYMBOLS << radioSf) * 1000.0 / LORA_BW);
+}
+
+void trackAckResult(bool acked) {
+    if (acked) {
+        missedAcks = 0;
+        radioProbing = false;
+        return;
+    }
+
+    missedAcks++;
+
+    // Ajuste recente do ADR sem nenhum ACK: desfaz
+    if (radioProbing && missedAcks >= ADR_REVERT_MISSED_ACKS) {
+        Serial.println("[ADR] Sem ACK apos o ajuste, revertendo");
+        radioProbing = false;
+        missedAcks = 0;
+        applyRadioSettings(prevRadioSf, prevRadioPower);
+        return;
+    }
+
+    // Sem ACK ha muito tempo: configuracao inicial (que o gateway sempre escuta)
+    if (missedAcks >= ADR_FALLBACK_MISSED_ACKS &&
+        (radioSf != LORA_SF || radioPower != LORA_TX_POWER)) {
+        Serial.println("[ADR] Sem ACK, voltando a configuracao inicial");
+        missedAcks = 0;
+        applyRadioSettings(LORA_SF, LORA_TX_POWER);
+    }
+}
+
+void applyRadioSettings(uint8_t sf, int power) {
+    LoRa.setSpreadingFactor(sf);
+    LoRa.setTxPower(power);
+    radioSf = sf;
+    radioPower = power;
+    Serial.printf("[ADR] Radio: SF%d, %d dBm\n", sf, power);
+}
+
+bool checkForAck() {
     int packetSize = LoRa.parsePacket();
     if (packetSize > 0) {
-        String received = "";
-        while (LoRa.available()) {
-            received += (char)LoRa.read();
+        uint8_t frame[256];
+        int length = 0;
+        while (LoRa.available() && length < (int)sizeof(frame)) {
+            frame[length++] = LoRa.read();
         }
 
         lastRssi = LoRa.packetRssi();
 
+        // ACK agregado (binario) confirmando varios nos de uma vez
+        if (length >= ACK_AGG_HEADER_SIZE && frame[0] == ACK_AGG_MARKER) {
+            Serial.printf("[ACK] Agregado recebido: %d bytes, RSSI: %d dBm\n",
+                          length, lastRssi);
+            return parseAggregatedAck(frame, length);
+        }
+
+        String received = "";
+        for (int i = 0; i < length; i++) {
+            received += (char)frame[i];
+        }
+
         Serial.printf("[ACK] Recebido: %s\n", received.c_str());
         Serial.printf("[ACK] RSSI: %d dBm, SNR: %.2f dB\n",
                       lastRssi, LoRa.packetSnr());
@@ -549,9 +672,151 @@ void checkForAck() {
                 } else {
                     Serial.printf("[ACK] Gateway reportou erro para seq %d\n", seq);
                 }
+
+                // Comando de downlink embutido no ACK
+                if (doc["cmd"].is<JsonObject>()) {
+                    handleCommand(doc["cmd"]);
+                }
+                return true;
+            }
+
+            // Comando em quadro proprio (gateway com ACK fim-a-fim)
+            if (type == "cmd" && to == MACHINE_ID && doc["cmd"].is<JsonObject>()) {
+                handleCommand(doc["cmd"]);
             }
         }
     }
+
+    return false;
+}
+
+bool parseAggregatedAck(const uint8_t* frame, int length) {
+    uint8_t count = frame[3];
+    if (length < ACK_AGG_HEADER_SIZE + count * ACK_AGG_ENTRY_SIZE) {
+        Serial.println("[ACK] Agregado truncado, ignorando");
+        return false;
+    }
+
+    // Ultima sequencia enviada (packetSequence ja foi incrementado)
+    uint16_t myHash = hashNodeId(MACHINE_ID);
+    uint16_t lastSeq = (packetSequence - 1) & 0xFFFF;
+
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t* entry = frame + ACK_AGG_HEADER_SIZE + i * ACK_AGG_ENTRY_SIZE;
+        uint16_t hash = (entry[0] << 8) | entry[1];
+        uint16_t seq = (entry[2] << 8) | entry[3];
+
+        if (hash == myHash && seq == lastSeq) {
+            Serial.printf("[ACK] Confirmacao agregada para seq %d (%d nos no quadro)\n",
+                          packetSequence - 1, count);
+            packetsAcked++;
+            blinkLED(1, 50);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void handleCommand(JsonObject cmd) {
+    uint32_t id = cmd["id"] | 0;
+    const char* name = cmd["c"] | "";
+
+    // Reenvio de um comando ja executado: apenas confirma de novo
+    if (id != 0 && id == lastCommandId) {
+        Serial.printf("[CMD] Comando %d repetido, reenviando confirmacao\n", id);
+        sendCommandAck(id, lastCommandOk, lastCommandExecMs);
+        return;
+    }
+
+    Serial.printf("[CMD] Executando comando %d: %s\n", id, name);
+
+    unsigned long start = millis();
+    bool ok = executeCommand(name, cmd["p"]);
+    uint32_t execMs = millis() - start;
+
+    lastCommandId = id;
+    lastCommandOk = ok;
+    lastCommandExecMs = execMs;
+
+    sendCommandAck(id, ok, execMs);
+}
+
+bool executeCommand(const char* name, JsonObject params) {
+    if (strcmp(name, "set_interval") == 0) {
+        uint32_t seconds = params["interval_s"] | 0;
+        if (seconds < 5 || seconds > 3600) {
+            Serial.printf("[CMD] Intervalo invalido: %d s\n", seconds);
+            return false;
+        }
+        txInterval = seconds * 1000UL;
+        Serial.printf("[CMD] Intervalo periodico alterado para %d s\n", seconds);
+        return true;
+    }
+
+    if (strcmp(name, "set_radio") == 0) {
+        int sf = params["sf"] | radioSf;
+        int power = params["pwr"] | radioPower;
+        if (sf < 7 || sf > 12 || power < 2 || power > 20) {
+            Serial.printf("[CMD] Radio invalido: SF%d, %d dBm\n", sf, power);
+            return false;
+        }
+
+        // A confirmacao ja sai na nova configuracao (testa o enlace)
+        prevRadioSf = radioSf;
+        prevRadioPower = radioPower;
+        radioProbing = true;
+        missedAcks = 0;
+        applyRadioSettings(sf, power);
+        return true;
+    }
+
+    if (strcmp(name, "blink") == 0) {
+        int times = params["times"] | 3;
+        blinkLED(times > 10 ? 10 : times, 100);
+        return true;
+    }
+
+    if (strcmp(name, "send_now") == 0) {
+        sendRequested = true;
+        return true;
+    }
+
+    Serial.printf("[CMD] Comando desconhecido: %s\n", name);
+    return false;
+}
+
+void sendCommandAck(uint32_t id, bool ok, uint32_t execMs) {
+    JsonDocument doc;
+    doc["id"] = MACHINE_ID;
+    doc["type"] = "cmd_ack";
+
+    JsonObject data = doc["data"].to<JsonObject>();
+    data["cmd"] = id;
+    data["ok"] = ok;
+    data["exec_ms"] = execMs;
+
+    String packet;
+    serializeJson(doc, packet);
+
+    LoRa.beginPacket();
+    LoRa.print(packet);
+    LoRa.endPacket();
+
+    // Volta a escutar
+    LoRa.receive();
+
+    Serial.printf("[CMD] Confirmacao enviada: %s\n", packet.c_str());
+}
+
+uint16_t hashNodeId(const char* id) {
+    // FNV-1a 32 bits dobrado em 16 (igual ao Protocol::hashNodeId do gateway)
+    uint32_t hash = 2166136261UL;
+    while (*id) {
+        hash ^= (uint8_t)*id++;
+        hash *= 16777619UL;
+    }
+    return (uint16_t)((hash >> 16) ^ (hash & 0xFFFF));
 }
 
 // ============================================
@@ -0,0 +1,99 @@
+#ifndef ACK_SCHEDULER_H
+#define ACK_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "fixed_string.h"
+#include "lora_handler.h"
+#include "protocol.h"
+
+// ============================================
+// AGENDAMENTO DE ACKS PARA OS NOS
+// ============================================
+//
+// Politicas de ACK (ACK_POLICY em config.h):
+// - ACK_POLICY_ON_ENQUEUE: ACK assim que a leitura entra na fila local,
+//   enviado ACK_DELAY_MS apos a recepcao (o no ainda esta escutando).
+// - ACK_POLICY_END_TO_END: ACK somente apos o servidor confirmar o POST.
+//
+// O ACK e entregue a fila de transmissao do LoRaHandler com o horario
+// alvo; o tempo de resposta (recepcao -> TxDone) e medido no callback.
+//
+// Com ACK_AGGREGATION, ACKs positivos sao reunidos por ate
+// ACK_AGG_WINDOW_MS (ou ACK_AGG_MAX_ENTRIES) e enviados em um unico
+// quadro binario (Protocol::createAggregatedAck). O tempo no ar gasto
+// e comparado com o que os ACKs JSON individuais teriam custado.
+// ACKs que levam um comando de downlink sempre vao em JSON individual.
+//
+// Com varredura multi-SF, cada ACK sai no SF em que o uplink chegou; o
+// lote agregado e fechado quando chega um ACK de outro SF. O lote guarda o
+// id completo de cada no: dois nos com o mesmo hash16 nunca dividem um
+// quadro (o segundo fecha o lote do primeiro).
+
+class AckScheduler {
+public:
+    AckScheduler(LoRaHandler& lora, Protocol& protocol);
+
+    // Agenda um ACK (opcionalmente com um comando embutido);
+    // retorna false se nao houver espaco
+    bool schedule(StringView nodeId, uint32_t sequence, bool success,
+                  unsigned long rxTime, unsigned long dueTime,
+                  const DownlinkCommand* command = nullptr, uint8_t sf = 0);
+
+    // Envia o ACK agregado quando a janela fecha (chamar no loop)
+    void poll();
+
+    // Tempo ate a janela do lote fechar (UINT32_MAX = sem lote)
+    uint32_t msUntilFlush(unsigned long now) const;
+
+    // Ha ACK (ou outro downlink) pendente no radio ou no lote?
+    bool hasPending() const { return _batchCount > 0 || _lora.hasPendingTx(); }
+
+    // Chamado no TxDone de um quadro com tag LORA_TX_TAG_ACK
+    void recordSent(const LoRaTxResult& result);
+
+    // Estatisticas de turnaround (ms)
+    uint32_t getSentCount() const { return _sentCount; }
+    uint32_t getAverageTurnaround() const;
+    uint32_t getMaxTurnaround() const { return _maxTurnaround; }
+    uint32_t getLastTurnaround() const { return _lastTurnaround; }
+    uint32_t getDropped() const { return _dropped; }
+
+    // Leituras confirmadas e tempo no ar real x ACKs JSON individuais
+    uint32_t getAckedReadings() const { return _ackedReadings; }
+    uint32_t getAirtimeMs() const { return (uint32_t)(_airtimeUs / 1000); }
+    uint32_t getSingleAirtimeMs() const { return (uint32_t)(_singleAirtimeUs / 1000); }
+
+private:
+    LoRaHandler& _lora;
+    Protocol& _protocol;
+
+    uint32_t _sentCount;
+    uint64_t _totalTurnaround;
+    uint32_t _maxTurnaround;
+    uint32_t _lastTurnaround;
+    uint32_t _dropped;
+
+    // Lote do ACK agregado
+    AckEntry _batch[ACK_AGG_MAX_ENTRIES];
+    NodeId _batchNodes[ACK_AGG_MAX_ENTRIES];   // Id completo (o quadro so leva o hash)
+    uint8_t _batchCount;
+    unsigned long _batchFlushAt;
+    unsigned long _batchRefTime;     // Recepcao mais antiga do lote
+    unsigned long _batchDueTime;     // Prazo mais tardio do lote (todos ja em RX)
+    uint8_t _batchSf;                // SF de todos os nos do lote (0 = padrao)
+    uint64_t _batchSingleUs;         // Custo dos ACKs individuais do lote
+
+    uint32_t _ackedReadings;
+    uint64_t _airtimeUs;
+    uint64_t _singleAirtimeUs;
+
+    bool enqueueSingle(StringView nodeId, uint32_t sequence, bool success,
+                       unsigned long rxTime, unsigned long dueTime,
+                       const DownlinkCommand* command, uint8_t sf);
+    void addToBatch(StringView nodeId, uint32_t sequence,
+                    unsigned long rxTime, unsigned long dueTime, uint32_t singleUs, uint8_t sf);
+    void flushBatch();
+};
+
+#endif // ACK_SCHEDULER_H
@@ -0,0 +1,100 @@
+#ifndef ADR_ENGINE_H
+#define ADR_ENGINE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "fixed_string.h"
+#include "downlink_queue.h"
+#include "node_sequence.h"
+
+// ============================================
+// ADR: SF E POTENCIA DE TX POR NO
+// ============================================
+//
+// Guarda o SNR/RSSI dos ultimos ADR_HISTORY_SIZE quadros de cada no e,
+// com ADR_MIN_SAMPLES quadros na configuracao atual, compara o melhor
+// SNR com o minimo de demodulacao do SF (margem = SNR - minimo -
+// ADR_MARGIN_DB). Cada ADR_STEP_DB de margem sobrando reduz um SF (entre
+// os de LORA_SCAN_SF_MASK) e depois a potencia; margem negativa sobe a
+// potencia e depois o SF.
+//
+// O ajuste vai ao no como comando local "set_radio" {"sf","pwr"} na
+// DownlinkQueue (junto do ACK do uplink atual) e so vale apos o cmd_ack.
+// Limites: um ajuste por no a cada ADR_MIN_INTERVAL_MS e um comando
+// pendente por vez. Se o no perder ADR_REVERT_LOSS quadros (lacunas de
+// sequencia) logo apos um ajuste, a configuracao anterior e reenviada e
+// o no fica ADR_REVERT_HOLD_MS sem ajustes menos robustos.
+
+class AdrEngine {
+public:
+    AdrEngine();
+
+    // Registra um uplink (nao duplicado); retorna true se enfileirou um ajuste
+    bool update(StringView nodeId, uint32_t sequence, float snr, int rssi, uint8_t sf,
+                unsigned long now, DownlinkQueue& downlinks);
+
+    // cmd_ack de um comando local
+    void confirm(StringView nodeId, uint32_t commandId, bool success, unsigned long now);
+
+    static bool isLocalCommand(uint32_t commandId) { return commandId >= ADR_COMMAND_ID_BASE; }
+
+    // SNR minimo de demodulacao (dB) do SX1276 por SF
+    static float requiredSnr(uint8_t sf);
+
+    // Estatisticas
+    uint32_t getAdjustments() const { return _adjustments; }
+    uint32_t getReverts() const { return _reverts; }
+
+    // Adiciona contadores e estado do enlace por no ao objeto
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    struct NodeLink {
+        NodeId nodeId;
+        float snr[ADR_HISTORY_SIZE];
+        int16_t rssi[ADR_HISTORY_SIZE];
+        uint8_t count;               // Amostras na configuracao atual
+        uint8_t head;
+        uint32_t lastSeq;
+        uint32_t lost;               // Quadros perdidos (lacunas de sequencia)
+
+        uint8_t sf;                  // Configuracao atual do no
+        uint8_t power;
+        uint8_t prevSf;              // Configuracao antes do ultimo ajuste
+        uint8_t prevPower;
+
+        bool probing;                // Ajuste recente sob observacao
+        uint8_t probeFrames;
+        uint8_t probeLoss;
+
+        uint32_t pendingId;          // Comando aguardando cmd_ack (0 = nenhum)
+        uint8_t pendingSf;
+        uint8_t pendingPower;
+        bool pendingRevert;
+        unsigned long pendingAt;
+
+        unsigned long lastChange;
+        unsigned long holdUntil;
+        unsigned long lastSeen;
+        bool used;
+    };
+
+    NodeLink _nodes[ADR_MAX_NODES];
+    uint32_t _nextCommandId;
+    uint32_t _adjustments;
+    uint32_t _reverts;
+
+    int findNode(StringView nodeId) const;
+    int allocNode(unsigned long now);
+    void resetNode(NodeLink& link, uint8_t sf, uint8_t power, unsigned long now);
+    void applyPending(NodeLink& link, unsigned long now);
+    bool computeTarget(const NodeLink& link, uint8_t& sf, uint8_t& power) const;
+    bool queueChange(NodeLink& link, uint8_t sf, uint8_t power, bool revert,
+                     unsigned long now, DownlinkQueue& downlinks);
+    float maxSnr(const NodeLink& link) const;
+    static uint8_t lowerSf(uint8_t sf);
+    static uint8_t higherSf(uint8_t sf);
+};
+
+#endif // ADR_ENGINE_H
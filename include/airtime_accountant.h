@@ -0,0 +1,78 @@
+#ifndef AIRTIME_ACCOUNTANT_H
+#define AIRTIME_ACCOUNTANT_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "fixed_string.h"
+
+// ============================================
+// CONTABILIDADE DE TEMPO NO AR (DUTY CYCLE)
+// ============================================
+//
+// Soma o tempo no ar (calculado por lora_airtime.h) em uma janela
+// deslizante de AIRTIME_WINDOW_MS dividida em AIRTIME_BUCKETS baldes:
+// - RX do canal (todos os quadros) e RX por no;
+// - TX do gateway, limitado a LORA_TX_DUTY_CYCLE_PERMILLE da janela.
+//
+// Cada balde guarda a epoca (millis / tamanho do balde) em que foi
+// escrito; baldes de epocas fora da janela sao ignorados na leitura,
+// entao as consultas nao alteram o estado (podem vir da task web).
+
+class AirtimeWindow {
+public:
+    AirtimeWindow();
+
+    void add(uint32_t airtimeUs, unsigned long now);
+    uint64_t totalUs(unsigned long now) const;
+    void clear();
+
+private:
+    uint32_t _buckets[AIRTIME_BUCKETS];  // Tempo no ar (us) por balde
+    uint32_t _epochs[AIRTIME_BUCKETS];   // Epoca de cada balde
+};
+
+class AirtimeAccountant {
+public:
+    AirtimeAccountant();
+
+    // Registro (chamado pelo LoRaHandler e pelo main.cpp)
+    void recordChannelRx(uint32_t airtimeUs, unsigned long now);
+    void recordNodeRx(StringView nodeId, uint32_t airtimeUs, unsigned long now);
+    void recordTx(uint32_t airtimeUs, unsigned long now);
+
+    // O quadro cabe no orcamento de TX da janela atual?
+    bool canTransmit(uint32_t airtimeUs, unsigned long now) const;
+    void countBlocked() { _txBlocked++; }
+
+    // Estatisticas (tempo em ms, utilizacao em permil da janela decorrida)
+    uint32_t getRxAirtimeMs(unsigned long now) const;
+    uint32_t getTxAirtimeMs(unsigned long now) const;
+    uint32_t getTxBudgetMs() const;
+    uint16_t getRxUtilization(unsigned long now) const;
+    uint16_t getTxUtilization(unsigned long now) const;
+    uint32_t getTxBlocked() const { return _txBlocked; }
+
+    // Adiciona janela, utilizacao e tempo de RX por no ao objeto
+    void appendTelemetry(JsonObject obj, unsigned long now) const;
+
+private:
+    struct NodeEntry {
+        NodeId nodeId;
+        AirtimeWindow rx;
+        uint32_t frames;
+        unsigned long lastSeen;
+        bool used;
+    };
+
+    AirtimeWindow _rx;
+    AirtimeWindow _tx;
+    NodeEntry _nodes[AIRTIME_MAX_NODES];
+    uint32_t _txBlocked;
+
+    int findNode(StringView nodeId) const;
+    int allocNode(unsigned long now);
+    uint16_t utilization(uint64_t airtimeUs, unsigned long now) const;
+};
+
+#endif // AIRTIME_ACCOUNTANT_H
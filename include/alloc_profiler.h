@@ -0,0 +1,96 @@
+#ifndef ALLOC_PROFILER_H
+#define ALLOC_PROFILER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ============================================
+// PERFIL DE ALOCACAO DE HEAP
+// ============================================
+//
+// Com ALLOC_PROFILE=1 (env jvtech_mij_alloc_profile) o linker redireciona
+// malloc/free/calloc/realloc para os wrappers de alloc_profiler.cpp, que
+// contam alocacoes e bytes pela etiqueta ativa na task (AllocTagScope).
+// A etiqueta e por task (thread-local): a task web e o loop nao se
+// misturam. Sem o perfil, AllocTagScope nao gera codigo.
+//
+// Por pacote: beginPacket()/endPacket() no loop contam as alocacoes da
+// propria task durante o processamento de um quadro recebido.
+
+enum AllocTag {
+    ALLOC_TAG_OTHER = 0,
+    ALLOC_TAG_RADIO,
+    ALLOC_TAG_PROTOCOL,
+    ALLOC_TAG_WEB,
+    ALLOC_TAG_WIFI,
+    ALLOC_TAG_COUNT
+};
+
+#if ALLOC_PROFILE
+
+struct AllocTagStats {
+    uint32_t allocs;
+    uint32_t bytes;          // Bytes pedidos (acumulado)
+    uint32_t failed;         // malloc que retornou NULL
+};
+
+class AllocProfiler {
+public:
+    static void setTag(uint8_t tag);
+    static uint8_t getTag();
+
+    static void beginPacket();
+    static void endPacket();
+
+    static void record(size_t size, bool ok);
+    static void recordFree();
+
+    static const AllocTagStats& getStats(uint8_t tag) { return _tags[tag]; }
+    static uint32_t getLastPacketAllocs() { return _packetLast; }
+
+    static void appendTelemetry(JsonObject obj);
+
+private:
+    static AllocTagStats _tags[ALLOC_TAG_COUNT];
+    static uint32_t _frees;
+    static uint32_t _packets;
+    static uint32_t _packetLast;
+    static uint32_t _packetMax;
+    static uint64_t _packetTotal;
+};
+
+// Etiqueta as alocacoes da task ate o fim do escopo
+class AllocTagScope {
+public:
+    explicit AllocTagScope(uint8_t tag) : _previous(AllocProfiler::getTag()) {
+        AllocProfiler::setTag(tag);
+    }
+    ~AllocTagScope() { AllocProfiler::setTag(_previous); }
+
+private:
+    uint8_t _previous;
+};
+
+// Conta as alocacoes da task durante o processamento de um pacote
+class AllocPacketScope {
+public:
+    AllocPacketScope() { AllocProfiler::beginPacket(); }
+    ~AllocPacketScope() { AllocProfiler::endPacket(); }
+};
+
+#else
+
+class AllocTagScope {
+public:
+    explicit AllocTagScope(uint8_t) {}
+};
+
+class AllocPacketScope {
+public:
+    AllocPacketScope() {}
+};
+
+#endif // ALLOC_PROFILE
+
+#endif // ALLOC_PROFILER_H
@@ -0,0 +1,88 @@
+#ifndef BATCH_CONTROLLER_H
+#define BATCH_CONTROLLER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ============================================
+// CONTROLE ADAPTATIVO DOS LOTES HTTP (AIMD)
+// ============================================
+//
+// Decide quantas leituras vao em cada POST (tamanho do lote) e quanto
+// tempo um lote incompleto espera por mais leituras (intervalo de envio).
+// As entradas sao o que o WiFiHandler ve em cada POST (codigo HTTP e
+// tempo ate a resposta) e a profundidade da fila de uplink.
+//
+// Aumento aditivo, reducao multiplicativa:
+// - POST sem resposta, 5xx ou 429: lote pela metade e intervalo dobrado;
+// - RTT acima de UPLINK_AIMD_RTT_FACTOR x o menor RTT recente: so o
+//   intervalo dobra (o backend esta lento, nao recusando);
+// - POST normal: o intervalo cai UPLINK_AIMD_INTERVAL_STEP_MS e, se
+//   ficaram leituras na fila, o lote cresce uma leitura.
+// Em noite calma o intervalo fica em 0 e cada leitura sai sozinha; numa
+// troca de turno a fila acumula e o lote cresce.
+//
+// Um lote incompleto sai quando a leitura mais antiga espera o intervalo
+// ou, havendo evento, quando o evento espera UPLINK_EVENT_LATENCY_BUDGET_MS
+// (o que vier primeiro).
+
+enum BatchFlushReason {
+    BATCH_FLUSH_WAIT,           // Lote incompleto dentro do prazo
+    BATCH_FLUSH_FULL,           // Lote completo
+    BATCH_FLUSH_INTERVAL,       // Leitura mais antiga esperou o intervalo
+    BATCH_FLUSH_EVENT           // Evento esgotou o orcamento de latencia
+};
+
+class BatchController {
+public:
+    BatchController();
+
+    // Leituras no proximo POST
+    uint8_t getBatchSize() const { return _batchSize; }
+
+    // Envia agora ou espera (BATCH_FLUSH_WAIT, prazo em getFlushDeadline);
+    // oldestRx/eventRx: recepcao da leitura e do evento mais antigos
+    BatchFlushReason decide(unsigned long now, uint8_t pending, unsigned long oldestRx,
+                            bool hasEvent, unsigned long eventRx);
+    bool isHolding() const { return _holding; }
+    unsigned long getFlushDeadline() const { return _flushDeadline; }
+
+    // Resultado do POST (codigo e RTT do WiFiHandler); backlog = leituras
+    // que ficaram na fila
+    void recordResult(int httpStatus, uint32_t rttMs, uint8_t backlog);
+
+    // Estatisticas
+    uint32_t getFlushIntervalMs() const { return _flushIntervalMs; }
+    uint32_t getRttMs() const { return _rttMs; }
+    uint32_t getRttBaseMs() const { return _rttBaseMs; }
+    uint16_t getErrorRate() const { return _errorRate; }
+    uint32_t getMaxEventWaitMs() const { return _maxEventWaitMs; }
+
+    // Medidores de /metrics (um controle por servidor: so o primeiro publica)
+    void setPublishGauges(bool enabled) { _publishGauges = enabled; }
+
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    bool _publishGauges;
+    uint8_t _batchSize;
+    uint32_t _flushIntervalMs;
+    bool _holding;
+    unsigned long _flushDeadline;
+
+    uint32_t _rttMs;            // Media movel do RTT (1/8)
+    uint32_t _rttBaseMs;        // Menor RTT recente (sobe devagar)
+    uint16_t _errorRate;        // Por mil, media movel (1/8)
+
+    // Decisoes
+    uint32_t _increases;
+    uint32_t _decreases;
+    uint32_t _flushes[BATCH_FLUSH_EVENT + 1];
+    uint32_t _maxEventWaitMs;   // Maior espera de um evento por um lote
+
+    void decrease(bool shrinkBatch);
+    void publish() const;
+};
+
+#endif // BATCH_CONTROLLER_H
@@ -17,6 +17,17 @@
 #define SERVER_ENDPOINT "/api/sensor-data"
 #define HTTP_TIMEOUT_MS 5000
 
+// --- HTTPS (SERVER_TLS) ---
+// POST/GET ao servidor por TLS, com o CA do servidor em TLS_CA_FILE no
+// LittleFS (pio run -t uploadfs). A conexao fica aberta entre requisicoes
+// e as reconexoes retomam a sessao TLS (ticket ou ID de sessao).
+#ifndef SERVER_TLS
+#define SERVER_TLS 0
+#endif
+#define TLS_CA_FILE "/ca.pem"
+#define TLS_CA_MAX_SIZE 8192             // PEM do CA (cadeia) lido no boot
+#define TLS_HANDSHAKE_TIMEOUT_MS 10000   // TCP + handshake completo
+
 // --- Configuracao LoRa (pinos JVtech MIJ) ---
 // Conforme documentacao: SPI para comunicacao com chip LoRa
 #ifndef LORA_SCK
@@ -57,24 +68,290 @@
 #ifndef LORA_CR
 #define LORA_CR 5             // Coding Rate: 4/5
 #endif
-#define LORA_PREAMBLE_LENGTH 8
+#ifndef LORA_PREAMBLE_LENGTH
+#define LORA_PREAMBLE_LENGTH 8   // Igual ao dos nos (maior na varredura multi-SF)
+#endif
+
+// --- Recepcao multi-SF por CAD (um unico SX1276) ---
+// Bit n = SF n. Com mais de um SF o radio alterna CAD entre eles e trava
+// em RX no SF que detectar preambulo. Com um so SF (padrao) fica em RX
+// continuo como antes. Um ciclo de CAD leva ~2 simbolos por SF, entao
+// os nos de SF baixo precisam de preambulo maior que o ciclo completo
+// para nao serem perdidos (ex.: SF7+SF9+SF12 ~ 80 ms).
+#ifndef LORA_SCAN_SF_MASK
+#define LORA_SCAN_SF_MASK (1 << LORA_SF)
+#endif
+#define LORA_CAD_TIMEOUT_MS 150          // Sem CadDone apos isso = reinicia CAD
 #define LORA_SYNC_WORD 0x20   // Sync word privado (evita LoRaWAN)
 
+// --- Transmissao LoRa (downlink nao bloqueante) ---
+#define LORA_TX_QUEUE_SIZE 8           // Quadros aguardando transmissao
+#define LORA_TX_MAX_ATTEMPTS 1         // Tentativas padrao por quadro
+#define LORA_TX_RETRY_BACKOFF_MS 100   // Backoff linear entre tentativas
+#define LORA_TX_TIMEOUT_MARGIN_MS 500  // Sem TxDone apos ToA + margem = falha
+
+// --- Tempo no ar / duty cycle ---
+#define AIRTIME_WINDOW_MS 3600000UL    // Janela deslizante (1 h)
+#define AIRTIME_BUCKETS 12             // Baldes da janela (5 min cada)
+#define AIRTIME_MAX_NODES 32           // Nos com tempo de RX rastreado
+#ifndef LORA_TX_DUTY_CYCLE_PERMILLE
+#define LORA_TX_DUTY_CYCLE_PERMILLE 100  // Orcamento de TX: 10% da janela
+#endif
+
 // --- Configuracao do Gateway ---
 #define GATEWAY_ID "GW001"
 #define MAX_PACKET_SIZE 255
+#define NODE_ID_MAX_LEN 24            // Tamanho maximo do ID do no
+#define NODE_TYPE_MAX_LEN 16          // Tamanho maximo do tipo do no
+#define UPLINK_PAYLOAD_MAX_LEN 512    // Tamanho maximo do JSON para o servidor
 #define PACKET_QUEUE_SIZE 10
 #define LED_PIN 25            // LED RGB na placa base (GPIO25)
 #define BUTTON_PIN 0          // Botao de uso geral (GPIO0)
 
+// --- Fila de uplink ---
+#define UPLINK_RETRY_INTERVAL_MS 2000    // Espera apos a primeira falha (dobra a cada falha)
+#define UPLINK_RETRY_MAX_MS 60000        // Espera maxima entre tentativas
+#define UPLINK_MAX_ATTEMPTS 3            // Tentativas antes de passar a outro servidor ou
+                                         // descartar (so leituras ainda sem ACK ao no)
+
+// Classes de prioridade (UplinkClass em uplink_queue.h): a fila envia
+// eventos, depois leituras sem regra e por ultimo as periodicas.
+// X(campo, valor, classe): vale a primeira regra que casar; o campo "type"
+// e o tipo do no, os demais sao procurados em "data" (texto).
+#define UPLINK_PRIORITY_RULES(X) \
+    X("trigger", "event",    UPLINK_CLASS_EVENT) \
+    X("trigger", "periodic", UPLINK_CLASS_PERIODIC)
+#define UPLINK_COALESCE_DEPTH (PACKET_QUEUE_SIZE / 2)  // A partir daqui, periodica substitui a do mesmo no
+
+// --- Transporte do uplink (gateway -> servidor) ---
+#define UPLINK_TRANSPORT_HTTP 0          // POST de lotes de leituras (padrao)
+#define UPLINK_TRANSPORT_MQTT 1          // Sessao MQTT persistente, QoS1 em pipeline
+#define UPLINK_TRANSPORT_SEMTECH 2       // Packet forwarder UDP da Semtech (rxpk/stat)
+#define UPLINK_TRANSPORT_SERIAL 3        // Registros binarios COBS pela UART (sem WiFi)
+#ifndef UPLINK_TRANSPORT
+#define UPLINK_TRANSPORT UPLINK_TRANSPORT_HTTP
+#endif
+#define UPLINK_POLL_INTERVAL_MS 20       // MQTT/UDP/serial: leitura de confirmacoes e downlinks
+
+// --- Lotes e compressao do uplink HTTP (UPLINK_TRANSPORT_HTTP) ---
+// As leituras prontas na frente da fila vao juntas em um POST (array JSON
+// com o mesmo objeto de SERVER_ENDPOINT); com a fila em dia o lote tem uma
+// leitura so. O corpo do lote vai comprimido (zlib, Content-Encoding:
+// deflate) quando compensa o tempo de CPU. Sem compressao o corpo vai em
+// fluxo para o socket, sem buffer do lote (uplink_body.h).
+#define SERVER_BATCH_ENDPOINT "/api/sensor-data/batch"
+#define UPLINK_HTTP_BATCH_MAX 8          // Leituras por POST
+#define UPLINK_BATCH_BUFFER_SIZE (UPLINK_HTTP_BATCH_MAX * (UPLINK_PAYLOAD_MAX_LEN + 1) + 2)
+#ifndef UPLINK_COMPRESSION
+#define UPLINK_COMPRESSION 1
+#endif
+#define UPLINK_COMPRESS_MIN_BYTES 256    // Corpos menores vao sem compressao
+#define UPLINK_COMPRESS_HASH_BITS 10     // Tabela de hash do LZ77 (2^n entradas)
+#define UPLINK_COMPRESS_EXPLORE_EVERY 16 // Lotes entre testes de um nivel vizinho
+#define UPLINK_COMPRESS_TX_US_PER_BYTE 8 // Custo de envio por byte ate a primeira medida
+#define UPLINK_COMPRESS_MIN_SPREAD 64    // Desvio minimo (bytes) dos corpos para medir o envio
+
+// Formato das leituras negociado por servidor: JSON ate a resposta anunciar
+// MessagePack (Accept-Post: application/msgpack); 415 volta ao JSON
+#ifndef UPLINK_MSGPACK
+#define UPLINK_MSGPACK 1
+#endif
+#define MSGPACK_CONTENT_TYPE "application/msgpack"
+
+// Tamanho do lote e espera por um lote completo ajustados pelo RTT, erros
+// e profundidade da fila (AIMD, batch_controller.h)
+#define UPLINK_AIMD_INITIAL_BATCH (UPLINK_HTTP_BATCH_MAX / 2)
+#define UPLINK_AIMD_INTERVAL_STEP_MS 250   // Reducao aditiva da espera por POST normal
+#define UPLINK_AIMD_MAX_INTERVAL_MS 30000  // Espera maxima de um lote incompleto
+#define UPLINK_AIMD_RTT_FACTOR 2           // RTT acima de n x o menor recente = backend lento
+#define UPLINK_AIMD_RTT_SLACK_MS 50        // Folga para RTTs pequenos (ruido do WiFi)
+#define UPLINK_EVENT_LATENCY_BUDGET_MS 1000 // Espera maxima de um evento por um lote
+
+// --- Varios servidores (UPLINK_TRANSPORT_HTTP, uplink_router.h) ---
+// O primeiro e o servidor da configuracao (SERVER_HOST ou /api/config);
+// X(host, porta) acrescenta os demais, na ordem de preferencia, ex.:
+//   #define UPLINK_EXTRA_ENDPOINTS(X) X("192.168.1.101", 5000)
+#ifndef UPLINK_EXTRA_ENDPOINTS
+#define UPLINK_EXTRA_ENDPOINTS(X)
+#endif
+#define UPLINK_POLICY_FAILOVER 0         // Primeiro servidor disponivel (padrao)
+#define UPLINK_POLICY_ROUND_ROBIN 1      // Alterna entre os disponiveis
+#define UPLINK_POLICY_MIRROR 2           // Todos recebem; o de melhor nota confirma
+#ifndef UPLINK_POLICY
+#define UPLINK_POLICY UPLINK_POLICY_FAILOVER
+#endif
+#define UPLINK_BREAKER_FAILURES 3        // Falhas seguidas que abrem o disjuntor
+#define UPLINK_BREAKER_OPEN_MS 30000     // Tempo aberto ate a requisicao de teste
+#define UPLINK_HEALTH_ERROR_WEIGHT_MS 2000 // Peso de 100% de erros na nota do servidor
+
+// --- MQTT (UPLINK_TRANSPORT_MQTT) ---
+// O host e o mesmo do servidor (SERVER_HOST ou /api/config); so a porta muda.
+// Topicos: <prefixo>/<gateway>/up/<no>, .../down (comandos), .../status
+// e .../cmd_status (resultado dos comandos).
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+#define MQTT_TOPIC_PREFIX "lora"
+#define MQTT_TOPIC_MAX_LEN 96
+#define MQTT_KEEPALIVE_S 30              // PINGREQ apos metade disso sem TX
+#define MQTT_MAX_INFLIGHT 8              // PUBLISH QoS1 aguardando PUBACK
+#define MQTT_ACK_TIMEOUT_MS 10000        // PUBACK atrasado = sessao derrubada e reenvio
+#define MQTT_CONNECT_TIMEOUT_MS 3000     // TCP + CONNACK
+#define MQTT_RECONNECT_INTERVAL_MS 5000  // Espera entre tentativas de conexao
+#define MQTT_RX_BUFFER_SIZE 1024         // Maior pacote recebido (comandos)
+#define MQTT_TX_BUFFER_SIZE (UPLINK_PAYLOAD_MAX_LEN + MQTT_TOPIC_MAX_LEN + 16)  // Maior = dois write()
+#define MQTT_RATE_WINDOW_MS 10000        // Janela da vazao (msg/s confirmadas)
+
+// --- Packet forwarder Semtech (UPLINK_TRANSPORT_SEMTECH) ---
+// PUSH_DATA (rxpk/stat) e PULL_DATA vao para o host do servidor na porta
+// SEMTECH_UDP_PORT. O EUI do gateway vem do MAC (MAC[0..2] FFFE MAC[3..5]).
+#ifndef SEMTECH_UDP_PORT
+#define SEMTECH_UDP_PORT 1700
+#endif
+#define SEMTECH_LOCAL_PORT 1700          // Porta local (PUSH_ACK, PULL_ACK, PULL_RESP)
+#define SEMTECH_PULL_INTERVAL_MS 10000   // PULL_DATA (mantem o caminho de downlink aberto)
+#define SEMTECH_PUSH_TIMEOUT_MS 2000     // Sem PUSH_ACK = leituras reenviadas
+#define SEMTECH_MAX_INFLIGHT 4           // PUSH_DATA aguardando PUSH_ACK
+#define SEMTECH_MAX_RXPK 8               // Leituras por PUSH_DATA
+#define SEMTECH_DATAGRAM_MAX 1400        // Abaixo do MTU (sem fragmentacao IP)
+#define SEMTECH_TX_MAX_AHEAD_MS 10000    // txpk mais adiantado que isso = TOO_EARLY
+
+// --- Uplink serial (UPLINK_TRANSPORT_SERIAL) ---
+// Leituras e status vao como registros binarios (CRC-16, COBS) pela UART
+// do debug para a ponte no host (tools/serial_bridge.cpp); o WiFi nao e
+// usado. Texto de debug continua saindo entre os quadros.
+#ifndef SERIAL_LINK_BAUD
+#define SERIAL_LINK_BAUD 921600
+#endif
+#ifndef SERIAL_LINK_CTS_PIN
+#define SERIAL_LINK_CTS_PIN -1           // Controle de fluxo por hardware (-1 = desligado)
+#endif
+#ifndef SERIAL_LINK_RTS_PIN
+#define SERIAL_LINK_RTS_PIN -1
+#endif
+#define SERIAL_LINK_TX_BUFFER 4096       // Buffer de TX do driver da UART
+#define SERIAL_LINK_RX_BUFFER 512        // Buffer de RX do driver (ACKs da ponte)
+#define SERIAL_LINK_RECORD_MAX 384       // Maior registro antes do COBS
+#define SERIAL_LINK_RING_SIZE 8          // Quadros prontos aguardando espaco na UART
+#define SERIAL_LINK_MAX_INFLIGHT 8       // Leituras aguardando ACK da ponte
+#define SERIAL_LINK_ACK_TIMEOUT_MS 2000  // Sem ACK = leitura reenviada
+
+// --- Politica de ACK ---
+#define ACK_POLICY_ON_ENQUEUE 0          // ACK ao aceitar na fila local
+#define ACK_POLICY_END_TO_END 1          // ACK apos confirmacao do servidor
+#ifndef ACK_POLICY
+#define ACK_POLICY ACK_POLICY_ON_ENQUEUE
+#endif
+#define ACK_DELAY_MS 50                  // Atraso fixo do ACK apos a recepcao
+
+// --- ACK agregado (varios nos em um unico quadro binario) ---
+#ifndef ACK_AGGREGATION
+#define ACK_AGGREGATION 1                // 0 = um ACK JSON por leitura
+#endif
+#define ACK_AGG_WINDOW_MS 100            // Coleta ACKs por ate 100 ms
+#define ACK_AGG_MAX_ENTRIES 16           // Entradas por quadro (4 bytes cada)
+
+// --- Comandos de downlink (servidor -> no) ---
+#define COMMANDS_ENDPOINT "/api/commands"
+#define DOWNLINK_QUEUE_SIZE 8            // Comandos aguardando entrega (todos os nos)
+#define DOWNLINK_POLL_INTERVAL_MS 10000  // Consulta de novos comandos no servidor
+#define DOWNLINK_MAX_ATTEMPTS 3          // Envios sem confirmacao antes de desistir
+#define DOWNLINK_TTL_MS 600000           // Falha se nao confirmado em 10 min
+#define DOWNLINK_CMD_NAME_LEN 16         // Nome do comando
+#define DOWNLINK_CMD_PARAMS_LEN 96       // Parametros (JSON serializado)
+
+// --- ADR: SF e potencia de TX por no (via comando "set_radio") ---
+// Os SFs escolhidos ficam restritos a LORA_SCAN_SF_MASK (o gateway precisa
+// conseguir ouvir o no depois do ajuste); com um so SF, ajusta so a potencia.
+#ifndef ADR_ENABLED
+#define ADR_ENABLED 1
+#endif
+#define ADR_MAX_NODES 16                 // Nos com historico de enlace
+#define ADR_HISTORY_SIZE 20              // Ultimos quadros por no
+#define ADR_MIN_SAMPLES 10               // Quadros no SF/potencia atual antes de decidir
+#define ADR_MARGIN_DB 10                 // Margem sobre o SNR minimo de demodulacao
+#define ADR_STEP_DB 3                    // Margem equivalente a um passo de SF ou potencia
+#define ADR_POWER_MIN 2                  // dBm
+#define ADR_POWER_MAX 20                 // dBm (potencia inicial dos nos)
+#define ADR_MIN_INTERVAL_MS 600000UL     // Entre ajustes do mesmo no (10 min)
+#define ADR_REVERT_LOSS 3                // Quadros perdidos apos um ajuste = reverte
+#define ADR_REVERT_HOLD_MS 3600000UL     // Apos reverter, so ajustes mais robustos (1 h)
+#define ADR_COMMAND_ID_BASE 0x80000000UL // IDs dos comandos locais (fora da faixa do servidor)
+
+// --- Deduplicacao de quadros (retransmissoes / multi-caminho) ---
+#define DEDUP_MAX_NODES 32               // Nos rastreados simultaneamente
+#define DEDUP_SEQ_WINDOW 32              // Sequencias lembradas por no (bits)
+#define DEDUP_WINDOW_MS 600000           // Esquece o no apos 10 min sem quadros
+
+// --- Qualidade de enlace por no (sequencia e RF) ---
+#define LINK_LOSS_WINDOW 64              // Sequencias na janela de perda (bits)
+#define LINK_REORDER_WINDOW 16           // Atraso maximo tratado como reordenacao
+#define LINK_EWMA_ALPHA 0.125f           // Peso da amostra nas medias moveis
+#define LINK_DEGRADED_LOSS_PCT 10        // Perda na janela que marca enlace ruim
+
+// --- Arenas JSON (bytes por etapa do pipeline) ---
+#ifndef JSON_ARENA_RX_SIZE
+#define JSON_ARENA_RX_SIZE 6144       // validate + parse + SensorData
+#endif
+#ifndef JSON_ARENA_UPLINK_SIZE
+#define JSON_ARENA_UPLINK_SIZE 4096   // Payload para o servidor
+#endif
+#ifndef JSON_ARENA_ACK_SIZE
+#define JSON_ARENA_ACK_SIZE 2048      // ACK para o no
+#endif
+#ifndef JSON_ARENA_DOWNLINK_SIZE
+#define JSON_ARENA_DOWNLINK_SIZE 2048 // Comandos do servidor e relatorios
+#endif
+#ifndef JSON_ARENA_STATUS_SIZE
+#if ALLOC_PROFILE
+#define JSON_ARENA_STATUS_SIZE 3072   // Status + perfil de alocacao (2 pools de slots)
+#else
+#define JSON_ARENA_STATUS_SIZE 2048   // Status do gateway
+#endif
+#endif
+#ifndef JSON_ARENA_WEB_SIZE
+#define JSON_ARENA_WEB_SIZE 16384     // Respostas da API do dashboard
+#endif
+
+// --- Perfil de alocacao (env jvtech_mij_alloc_profile) ---
+// 1 = conta malloc/free por etiqueta (exige -Wl,--wrap=malloc,free,calloc,realloc)
+#ifndef ALLOC_PROFILE
+#define ALLOC_PROFILE 0
+#endif
+
+// --- Configuracao em tempo de execucao (NVS + /api/config) ---
+// Os valores acima sao o padrao de fabrica; alteracoes pela API valem sem
+// reboot e so sao gravadas na NVS depois do periodo de observacao.
+#define RUNTIME_CONFIG_NAMESPACE "gwcfg"     // Namespace NVS (Preferences)
+#define RUNTIME_CONFIG_VERSION 1             // Muda quando GatewayConfig muda
+#define CONFIG_HOST_MAX_LEN 63               // Host do servidor
+#define CONFIG_MAX_BODY 512                  // Corpo do POST /api/config
+#define CONFIG_FREQ_MIN 902000000UL          // Faixa permitida (AU915)
+#define CONFIG_FREQ_MAX 928000000UL
+#define CONFIG_PROBATION_MS 300000UL         // Observa a recepcao apos uma mudanca (5 min)
+#define CONFIG_BASELINE_MIN_MS 300000UL      // Referencia minima antes da mudanca
+#define CONFIG_BASELINE_MIN_PACKETS 5        // Pacotes minimos na referencia
+#define CONFIG_ROLLBACK_RATIO_PCT 25         // Recepcao < isso da referencia = rollback
+
 // --- Intervalo de Status ---
 #define STATUS_REPORT_INTERVAL_MS 60000  // Reportar status a cada 1 min
 #define RSSI_THRESHOLD -120              // Limite minimo de RSSI aceitavel
 
+// --- Escalonador cooperativo (loop principal) ---
+#define SCHEDULER_MAX_TASKS 12           // Tarefas registradas
+#define SCHEDULER_MAX_SLEEP_MS 1000      // Sono maximo sem prazo nem evento
+#define SCHEDULER_BUSY_RETRY_MS 10       // Nova tentativa quando o radio esta ocupado
+#define STATS_UPDATE_INTERVAL_MS 1000    // Estatisticas do dashboard
+#define WIFI_CHECK_INTERVAL_MS 1000      // Verificacao da conexao WiFi
+#define CONFIG_POLL_INTERVAL_MS 1000     // Mudanca de configuracao pendente
+#define LED_PULSE_MS 50                  // Pulso do LED por pacote recebido
+
 // --- Debug ---
 #define DEBUG_SERIAL Serial
 #define DEBUG_BAUD 115200
+#ifndef ENABLE_DEBUG
 #define ENABLE_DEBUG 1
+#endif
 
 #if ENABLE_DEBUG
 #define DEBUG_PRINT(x) DEBUG_SERIAL.print(x)
@@ -0,0 +1,72 @@
+#ifndef DEDUP_CACHE_H
+#define DEDUP_CACHE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "fixed_string.h"
+#include "node_sequence.h"
+
+// ============================================
+// CACHE DE DEDUPLICACAO (NO, SEQ)
+// ============================================
+//
+// Para cada no guarda a maior sequencia aceita e um bitmap das
+// DEDUP_SEQ_WINDOW sequencias anteriores (bit i = seq maior - i).
+// Um quadro e duplicado se sua sequencia ja esta marcada no bitmap e
+// o no foi visto ha menos de DEDUP_WINDOW_MS. Uma sequencia que volta para
+// 0/1, ou mais que a janela para tras, e reinicio do no (isSequenceReset)
+// e nunca duplicada. Memoria fixa: DEDUP_MAX_NODES entradas; quando
+// cheio, substitui a mais antiga.
+//
+// A leitura entra na janela ao ser enfileirada, nas duas politicas de ACK.
+// Com ACK fim-a-fim ela fica "em voo" ate o servidor confirmar: a
+// retransmissao e suprimida sem re-ACK (isInFlight) e, se o gateway
+// desistir da leitura (release), a proxima retransmissao entra de novo.
+
+class DedupCache {
+public:
+    DedupCache();
+
+    // Consulta logo apos o decode (nao altera o estado)
+    bool isDuplicate(StringView nodeId, uint32_t sequence);
+
+    // Registra um quadro aceito (enfileirado); inFlight: ACK so apos o servidor
+    void markAccepted(StringView nodeId, uint32_t sequence, bool inFlight = false);
+
+    // Duplicado ainda sem confirmacao do servidor (nao re-ACK)
+    bool isInFlight(StringView nodeId, uint32_t sequence);
+
+    // Servidor confirmou a leitura: duplicados passam a receber re-ACK
+    void markDelivered(StringView nodeId, uint32_t sequence);
+
+    // Leitura descartada sem entrega: a retransmissao volta a ser aceita
+    void release(StringView nodeId, uint32_t sequence);
+
+    // Contabiliza um duplicado suprimido
+    void countSuppressed() { _suppressed++; }
+
+    // Estatisticas
+    uint32_t getSuppressed() const { return _suppressed; }
+    uint8_t getNodeCount() const;
+
+private:
+    struct Entry {
+        NodeId nodeId;
+        uint32_t lastSeq;        // Maior sequencia aceita
+        uint32_t window;         // Bit i: sequencia (lastSeq - i) aceita
+        uint32_t inFlight;       // Bit i: aceita e aguardando o servidor
+        unsigned long lastSeen;  // millis() do ultimo quadro aceito
+        bool used;
+    };
+
+    Entry _entries[DEDUP_MAX_NODES];
+    uint32_t _suppressed;
+
+    int findEntry(StringView nodeId);
+    // Bit da sequencia na janela do no (0 se fora da janela ou expirado)
+    uint32_t seqBit(int idx, uint32_t sequence) const;
+    int allocEntry();
+    bool isExpired(const Entry& entry, unsigned long now) const;
+};
+
+#endif // DEDUP_CACHE_H
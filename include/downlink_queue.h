@@ -0,0 +1,91 @@
+#ifndef DOWNLINK_QUEUE_H
+#define DOWNLINK_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "fixed_string.h"
+
+// ============================================
+// FILA DE COMANDOS DE DOWNLINK (SERVIDOR -> NO)
+// ============================================
+//
+// Os comandos sao buscados no servidor (GET /api/commands/pending) e
+// ficam aqui ate o proximo uplink do no de destino: logo apos a
+// recepcao o no esta escutando, entao o comando vai junto com o ACK
+// (ou em quadro proprio, na politica ACK_POLICY_END_TO_END).
+//
+// O no confirma a execucao com um quadro "cmd_ack". Se o no fizer
+// outro uplink sem confirmar, o comando e reenviado (ate
+// DOWNLINK_MAX_ATTEMPTS); sem confirmacao em DOWNLINK_TTL_MS, falha.
+// Comandos concluidos aguardam o relatorio ao servidor antes de liberar
+// o slot. Latencia = chegada ao gateway -> confirmacao de execucao.
+// Comandos locais (gerados no gateway, ex.: ADR) liberam o slot ao
+// concluir, sem relatorio.
+
+enum DownlinkState {
+    DOWNLINK_FREE = 0,
+    DOWNLINK_PENDING,    // Aguardando o proximo uplink do no
+    DOWNLINK_SENT,       // Enviado, aguardando cmd_ack
+    DOWNLINK_DONE        // Concluido (ok ou falha), aguardando relatorio
+};
+
+struct DownlinkCommand {
+    uint32_t id;                 // ID atribuido pelo servidor
+    NodeId nodeId;
+    CommandName name;
+    CommandParams params;        // JSON serializado ("{}" se vazio)
+    unsigned long fetchedAt;     // millis() da chegada ao gateway
+    unsigned long sentAt;        // millis() do ultimo envio
+    unsigned long doneAt;        // millis() da confirmacao / falha
+    uint32_t execMs;             // Tempo de execucao informado pelo no
+    uint8_t attempts;
+    uint8_t state;
+    bool success;
+    bool local;                  // Gerado no gateway: sem relatorio ao servidor
+};
+
+class DownlinkQueue {
+public:
+    DownlinkQueue();
+
+    // Novo comando (do servidor ou local); ignora IDs ja presentes
+    bool add(uint32_t id, StringView nodeId, StringView name, StringView params,
+             unsigned long now, bool local = false);
+
+    // Comando a enviar no uplink atual do no (nullptr se nenhum)
+    DownlinkCommand* nextFor(StringView nodeId, unsigned long now);
+    void markSent(DownlinkCommand* command, unsigned long now);
+
+    // Confirmacao recebida do no (cmd_ack)
+    bool confirm(StringView nodeId, uint32_t id, bool success, uint32_t execMs,
+                 unsigned long now);
+
+    // Falha comandos vencidos (TTL)
+    void expire(unsigned long now);
+
+    // Comando concluido aguardando relatorio; release() libera o slot
+    DownlinkCommand* nextReport();
+    void release(DownlinkCommand* command);
+
+    // Estado
+    uint8_t freeSlots() const;
+    uint8_t getPending() const;
+
+    // Estatisticas
+    uint32_t getDelivered() const { return _delivered; }
+    uint32_t getFailed() const { return _failed; }
+    uint32_t getAverageLatency() const;
+    uint32_t getMaxLatency() const { return _maxLatency; }
+
+private:
+    DownlinkCommand _commands[DOWNLINK_QUEUE_SIZE];
+    uint32_t _delivered;
+    uint32_t _failed;
+    uint64_t _totalLatency;
+    uint32_t _maxLatency;
+
+    int findById(uint32_t id) const;
+    void finish(DownlinkCommand& command, bool success, unsigned long now);
+};
+
+#endif // DOWNLINK_QUEUE_H
@@ -0,0 +1,112 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// STRINGS DE CAPACIDADE FIXA (SEM HEAP)
+// ============================================
+//
+// FixedString<N> guarda ate N caracteres em um buffer interno (N + 1
+// com o terminador), entao copiar entre estruturas nunca aloca heap.
+// Conteudo que nao cabe e truncado e o metodo de escrita retorna false.
+//
+// StringView e uma referencia nao-proprietaria (ponteiro + tamanho) usada
+// nos parametros de funcoes; aceita const char*, String e FixedString.
+
+class StringView {
+public:
+    StringView() : _data(""), _length(0) {}
+    StringView(const char* str) : _data(str ? str : ""), _length(str ? strlen(str) : 0) {}
+    StringView(const char* str, size_t length) : _data(str), _length(length) {}
+    StringView(const String& str) : _data(str.c_str()), _length(str.length()) {}
+
+    const char* data() const { return _data; }
+    size_t length() const { return _length; }
+    bool isEmpty() const { return _length == 0; }
+
+    bool equals(StringView other) const {
+        return _length == other._length && memcmp(_data, other._data, _length) == 0;
+    }
+
+    bool operator==(StringView other) const { return equals(other); }
+    bool operator!=(StringView other) const { return !equals(other); }
+
+private:
+    const char* _data;
+    size_t _length;
+};
+
+template <size_t N>
+class FixedString {
+public:
+    FixedString() : _length(0) { _buffer[0] = '\0'; }
+    FixedString(StringView str) : _length(0) { assign(str); }
+
+    // Substitui o conteudo; retorna false se precisou truncar
+    bool assign(StringView str) {
+        _length = 0;
+        _buffer[0] = '\0';
+        return append(str);
+    }
+
+    bool assign(const char* str, size_t length) {
+        return assign(StringView(str, length));
+    }
+
+    bool append(StringView str) {
+        size_t room = N - _length;
+        size_t count = str.length() < room ? str.length() : room;
+        memcpy(_buffer + _length, str.data(), count);
+        _length += count;
+        _buffer[_length] = '\0';
+        return count == str.length();
+    }
+
+    bool append(char c) {
+        if (_length >= N) {
+            return false;
+        }
+        _buffer[_length++] = c;
+        _buffer[_length] = '\0';
+        return true;
+    }
+
+    void clear() {
+        _length = 0;
+        _buffer[0] = '\0';
+    }
+
+    // Acesso direto ao buffer (ex.: serializeJson) seguido de resize()
+    char* data() { return _buffer; }
+    void resize(size_t length) {
+        _length = length < N ? length : N;
+        _buffer[_length] = '\0';
+    }
+
+    const char* c_str() const { return _buffer; }
+    size_t length() const { return _length; }
+    bool isEmpty() const { return _length == 0; }
+    static size_t capacity() { return N; }
+
+    operator StringView() const { return StringView(_buffer, _length); }
+
+    bool operator==(StringView other) const { return StringView(*this).equals(other); }
+    bool operator!=(StringView other) const { return !(*this == other); }
+
+private:
+    char _buffer[N + 1];
+    size_t _length;
+};
+
+// Tipos usados no caminho de pacotes
+typedef FixedString<NODE_ID_MAX_LEN> NodeId;
+typedef FixedString<NODE_TYPE_MAX_LEN> NodeType;
+typedef FixedString<MAX_PACKET_SIZE> LoRaPayload;
+typedef FixedString<UPLINK_PAYLOAD_MAX_LEN> UplinkPayload;
+typedef FixedString<DOWNLINK_CMD_NAME_LEN> CommandName;
+typedef FixedString<DOWNLINK_CMD_PARAMS_LEN> CommandParams;
+typedef FixedString<CONFIG_HOST_MAX_LEN> HostName;
+
+#endif // FIXED_STRING_H
@@ -0,0 +1,62 @@
+#ifndef GATEWAY_STATS_H
+#define GATEWAY_STATS_H
+
+#include <Arduino.h>
+
+// ============================================
+// ESTATISTICAS AGREGADAS DO GATEWAY
+// ============================================
+// Montada pelo main.cpp e consumida pelo status enviado ao servidor
+// (Protocol::createGatewayStatus) e pela API do dashboard (/api/stats).
+
+struct GatewayStats {
+    // Pacotes
+    uint32_t packetsReceived;
+    uint32_t packetsForwarded;
+    uint32_t packetsError;
+    uint32_t packetsDuplicate;
+
+    // Fila de uplink
+    uint8_t queueDepth;
+    uint32_t queueRejected;
+
+    // ACKs (turnaround = recepcao -> envio do ACK)
+    uint8_t ackPolicy;
+    uint32_t acksSent;
+    uint32_t ackAvgMs;
+    uint32_t ackMaxMs;
+    uint32_t ackedReadings;
+    uint32_t ackAirtimeMs;        // Tempo no ar gasto com ACKs
+    uint32_t ackSingleAirtimeMs;  // O que ACKs JSON individuais custariam
+
+    // Comandos de downlink (latencia = chegada ao gateway -> execucao)
+    uint8_t cmdPending;
+    uint32_t cmdDelivered;
+    uint32_t cmdFailed;
+    uint32_t cmdAvgLatencyMs;
+    uint32_t cmdMaxLatencyMs;
+
+    // Tempo no ar na janela de AIRTIME_WINDOW_MS (utilizacao em permil)
+    uint32_t rxAirtimeMs;
+    uint32_t txAirtimeMs;
+    uint16_t rxUtilization;
+    uint16_t txUtilization;
+    uint32_t txBlocked;
+
+    // ADR (ajustes de SF/potencia confirmados e reversoes)
+    uint32_t adrAdjustments;
+    uint32_t adrReverts;
+
+    // Nos com perda na janela >= LINK_DEGRADED_LOSS_PCT
+    uint8_t linksDegraded;
+
+    // Configuracao em tempo de execucao (mudancas aplicadas e revertidas)
+    uint32_t configApplied;
+    uint32_t configRollbacks;
+
+    // Sistema
+    int wifiRssi;
+    unsigned long uptimeMs;
+};
+
+#endif // GATEWAY_STATS_H
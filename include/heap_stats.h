@@ -0,0 +1,24 @@
+#ifndef HEAP_STATS_H
+#define HEAP_STATS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ============================================
+// TELEMETRIA DE HEAP E FRAGMENTACAO
+// ============================================
+
+struct HeapStats {
+    uint32_t freeHeap;          // Bytes livres
+    uint32_t largestFreeBlock;  // Maior bloco contiguo alocavel
+    uint32_t minFreeHeap;       // Menor heap livre desde o boot
+    uint8_t fragmentation;      // 0-100%: 100 - maior_bloco/livre
+};
+
+HeapStats getHeapStats();
+
+// Adiciona heap e uso das arenas JSON ao objeto informado
+void appendHeapTelemetry(JsonObject obj);
+
+#endif // HEAP_STATS_H
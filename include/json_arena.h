@@ -0,0 +1,84 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ============================================
+// ALOCADOR EM ARENA PARA DOCUMENTOS ARDUINOJSON
+// ============================================
+//
+// Cada etapa do pipeline (recepcao, uplink, ACK, status, web) usa
+// uma arena estatica propria. As alocacoes do JsonDocument sao feitas
+// por incremento de ponteiro dentro do buffer fixo e a arena inteira
+// e liberada em O(1) ao final de cada pacote/requisicao, sem tocar no
+// heap. Se a arena estourar, a alocacao cai para o heap (malloc) e o
+// evento e contabilizado em overflows.
+//
+// Uso tipico (o escopo deve ser declarado ANTES do documento, para que
+// o documento seja destruido antes do reset):
+//
+//   JsonArenaScope scope(jsonArenaRx);
+//   JsonDocument doc(&jsonArenaRx);
+
+class JsonArena : public ArduinoJson::Allocator {
+public:
+    JsonArena(const char* name, uint8_t* buffer, size_t capacity);
+
+    // Interface ArduinoJson::Allocator
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+    // Libera toda a arena em O(1)
+    void reset();
+
+    // Estatisticas
+    const char* getName() const { return _name; }
+    size_t getCapacity() const { return _capacity; }
+    size_t getUsed() const { return _top; }
+    size_t getHighWater() const { return _highWater; }
+    uint32_t getOverflows() const { return _overflows; }
+    uint32_t getResets() const { return _resets; }
+
+private:
+    const char* _name;
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _top;         // Proximo byte livre
+    size_t _lastBlock;   // Offset do ultimo bloco (permite realloc in-place)
+    size_t _liveBlocks;  // Blocos ainda nao desalocados
+    size_t _highWater;
+    uint32_t _overflows;
+    uint32_t _resets;
+
+    bool owns(const void* ptr) const;
+    size_t blockSize(const void* ptr) const;
+};
+
+// Reseta a arena ao sair do escopo
+class JsonArenaScope {
+public:
+    explicit JsonArenaScope(JsonArena& arena) : _arena(arena) {}
+    ~JsonArenaScope() { _arena.reset(); }
+
+private:
+    JsonArena& _arena;
+    JsonArenaScope(const JsonArenaScope&);
+    JsonArenaScope& operator=(const JsonArenaScope&);
+};
+
+// Arenas por etapa do pipeline
+extern JsonArena jsonArenaRx;      // validatePacket / parseLoRaPacket / SensorData
+extern JsonArena jsonArenaUplink;  // createServerPayload
+extern JsonArena jsonArenaAck;     // createAck
+extern JsonArena jsonArenaStatus;  // createGatewayStatus
+extern JsonArena jsonArenaDownlink;  // Comandos do servidor (parse/relatorio)
+extern JsonArena jsonArenaWeb;     // Handlers do servidor web (task AsyncTCP)
+
+// Lista para telemetria
+extern JsonArena* const jsonArenas[];
+extern const size_t JSON_ARENA_COUNT;
+
+#endif // JSON_ARENA_H
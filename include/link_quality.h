@@ -0,0 +1,74 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "node_sequence.h"
+
+// ============================================
+// QUALIDADE DE ENLACE POR NO
+// ============================================
+//
+// Estatisticas continuas de um no com memoria fixa:
+// - Perda pelas lacunas de sequencia, total e nas ultimas
+//   LINK_LOSS_WINDOW sequencias (bitmap: bit n = maior sequencia - n);
+// - Reordenacao: sequencia atrasada ate LINK_REORDER_WINDOW preenche a
+//   lacuna (deixa de contar como perda);
+// - Reinicio do no: mesma regra do DedupCache (isSequenceReset), volta
+//   para 0/1 ou DEDUP_SEQ_WINDOW ou mais para tras;
+// - RSSI/SNR: media movel exponencial (LINK_EWMA_ALPHA), minimo e maximo;
+// - Intervalo entre quadros por sequencia e jitter (media movel do desvio);
+// - Erro de frequencia do receptor (LoRa.packetFrequencyError).
+//
+// Quadros duplicados devem ser filtrados antes (DedupCache).
+
+class LinkQuality {
+public:
+    LinkQuality();
+
+    void reset();
+    void update(uint32_t sequence, int rssi, float snr, long freqError, unsigned long now);
+
+    // Perda nas ultimas LINK_LOSS_WINDOW sequencias (permil)
+    uint16_t getWindowLoss() const;
+    bool isDegraded() const { return getWindowLoss() >= LINK_DEGRADED_LOSS_PCT * 10; }
+
+    uint32_t getReceived() const { return _received; }
+    uint32_t getLost() const { return _lost; }
+    float getRssiAvg() const { return _rssiAvg; }
+    float getSnrAvg() const { return _snrAvg; }
+    uint32_t getJitterMs() const { return (uint32_t)_jitterMs; }
+
+    // Objeto completo (dashboard)
+    void appendTelemetry(JsonObject obj) const;
+    // Resumo que acompanha cada leitura enviada ao servidor
+    void appendSummary(JsonObject obj) const;
+
+private:
+    uint64_t _window;            // Sequencias recebidas (bit 0 = _lastSeq)
+    uint8_t _windowFill;         // Bits validos da janela
+    uint32_t _lastSeq;           // Maior sequencia vista
+    bool _started;
+
+    uint32_t _received;
+    uint32_t _lost;
+    uint32_t _reordered;
+    uint32_t _resets;
+
+    float _rssiAvg;
+    int16_t _rssiMin;
+    int16_t _rssiMax;
+    float _snrAvg;
+    float _snrMin;
+    float _snrMax;
+
+    long _freqErrLast;
+    float _freqErrAvg;
+
+    unsigned long _lastRx;
+    float _intervalMs;           // Media do intervalo por sequencia
+    float _jitterMs;
+};
+
+#endif // LINK_QUALITY_H
@@ -0,0 +1,64 @@
+#ifndef LORA_AIRTIME_H
+#define LORA_AIRTIME_H
+
+#include <stdint.h>
+
+// ============================================
+// CALCULO DE TIME-ON-AIR (SX1276)
+// ============================================
+//
+// Conforme Semtech AN1200.13 / datasheet SX1276 secao 4.1.1.7:
+//
+//   Tsym     = 2^SF / BW
+//   Tpream   = (Npreamble + 4.25) * Tsym
+//   Npayload = 8 + max(ceil((8*PL - 4*SF + 28 + 16*CRC - 20*IH)
+//                           / (4*(SF - 2*DE))) * (CR + 4), 0)
+//   ToA      = Tpream + Npayload * Tsym
+//
+// DE (low data rate optimize) e ligado quando Tsym > 16 ms, igual ao que a
+// biblioteca LoRa faz em setLdoFlag(). Todas as funcoes sao constexpr
+// (C++11) e trabalham em microssegundos inteiros.
+//
+// Parametros: sf 6-12, bw em Hz, cr = denominador (5-8 para 4/5 a 4/8).
+
+constexpr uint32_t loraSymbolTimeUs(uint8_t sf, uint32_t bw) {
+    return (uint32_t)((((uint64_t)1) << sf) * 1000000ULL / bw);
+}
+
+constexpr bool loraLowDataRateOptimize(uint8_t sf, uint32_t bw) {
+    return loraSymbolTimeUs(sf, bw) > 16000;
+}
+
+constexpr int32_t loraCeilDivPositive(int32_t num, int32_t den) {
+    return num <= 0 ? 0 : (num + den - 1) / den;
+}
+
+constexpr uint32_t loraPayloadSymbols(uint8_t payloadLen, uint8_t sf, uint32_t bw, uint8_t cr,
+                                      bool crc = true, bool implicitHeader = false) {
+    return 8 + (uint32_t)loraCeilDivPositive(
+                   8 * (int32_t)payloadLen - 4 * (int32_t)sf + 28 +
+                       (crc ? 16 : 0) - (implicitHeader ? 20 : 0),
+                   4 * ((int32_t)sf - (loraLowDataRateOptimize(sf, bw) ? 2 : 0))) *
+                   cr;
+}
+
+// Preambulo em quartos de simbolo para manter a conta inteira (+4.25)
+constexpr uint32_t loraPreambleTimeUs(uint8_t sf, uint32_t bw, uint16_t preambleLen) {
+    return (uint32_t)(((uint64_t)(preambleLen * 4 + 17)) * (((uint64_t)1) << sf) * 1000000ULL /
+                      (4ULL * bw));
+}
+
+constexpr uint32_t loraTimeOnAirUs(uint8_t payloadLen, uint8_t sf, uint32_t bw, uint8_t cr,
+                                   uint16_t preambleLen, bool crc = true,
+                                   bool implicitHeader = false) {
+    return loraPreambleTimeUs(sf, bw, preambleLen) +
+           (uint32_t)((uint64_t)loraPayloadSymbols(payloadLen, sf, bw, cr, crc, implicitHeader) *
+                      (((uint64_t)1) << sf) * 1000000ULL / bw);
+}
+
+// Verificacoes em tempo de compilacao (valores de referencia do
+// LoRa Calculator da Semtech, preambulo 8, CRC ligado, header explicito)
+static_assert(loraTimeOnAirUs(10, 7, 125000, 5, 8) / 1000 == 41, "ToA SF7 10 bytes");
+static_assert(loraTimeOnAirUs(51, 12, 125000, 5, 8) / 1000 == 2465, "ToA SF12 51 bytes (LDRO)");
+
+#endif // LORA_AIRTIME_H
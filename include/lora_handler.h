@@ -4,16 +4,77 @@
 #include <Arduino.h>
 #include <LoRa.h>
 #include "config.h"
+#include "fixed_string.h"
+#include "lora_airtime.h"
+#include "airtime_accountant.h"
 
 // Estrutura para pacote LoRa recebido
 struct LoRaPacket {
-    String payload;
+    LoRaPayload payload;
     int rssi;
     float snr;
+    long freqError;          // Erro de frequencia estimado pelo receptor (Hz)
     unsigned long timestamp;
+    uint32_t airtimeUs;      // Tempo no ar calculado com os parametros atuais
+    uint8_t sf;              // SF em que o quadro foi recebido
     bool valid;
 };
 
+// Parametros de radio alteraveis em tempo de execucao
+struct RadioConfig {
+    uint32_t frequency;      // Hz
+    uint32_t bandwidth;      // Hz
+    uint8_t sf;              // SF padrao (RX sem varredura e downlinks sem SF)
+    uint8_t codingRate;      // 5-8 (4/5 a 4/8)
+    int8_t txPower;          // dBm
+    uint8_t syncWord;
+    uint16_t preambleLength; // Simbolos
+};
+
+// Estatisticas por SF do modo de varredura (CAD)
+struct LoRaSfStats {
+    uint32_t cadRuns;        // CADs executados
+    uint32_t detections;     // CADs com preambulo detectado
+    uint32_t received;       // Quadros completos recebidos
+    uint32_t missed;         // Deteccao sem quadro valido (ruido/CRC/header)
+};
+
+#define LORA_SF_MIN 7
+#define LORA_SF_MAX 12
+#define LORA_SF_COUNT (LORA_SF_MAX - LORA_SF_MIN + 1)
+
+// Identifica a origem de um quadro de downlink (repassado no callback)
+enum LoRaTxTag {
+    LORA_TX_TAG_DATA = 0,
+    LORA_TX_TAG_ACK,
+    LORA_TX_TAG_COMMAND
+};
+
+// Resultado de um quadro transmitido (ou descartado apos as tentativas)
+struct LoRaTxResult {
+    uint8_t tag;
+    unsigned long refTime;   // Referencia informada no enqueue (ex.: RX do quadro original)
+    unsigned long doneTime;  // millis() do TxDone (ou do descarte)
+    uint8_t attempts;
+    bool success;
+};
+
+// ============================================
+// TRANSMISSAO NAO BLOQUEANTE
+// ============================================
+// Os quadros de downlink entram em uma fila com horario alvo de envio.
+// poll() (chamado no loop) inicia a transmissao e retorna imediatamente;
+// o TxDone no DIO0 devolve o radio para recepcao continua. Falhas
+// (timeout sem TxDone) sao reagendadas por temporizador, sem delay().
+// Com um AirtimeAccountant associado, quadros que estourariam o
+// orcamento de duty cycle sao descartados antes de ir ao ar.
+//
+// VARREDURA MULTI-SF: com LORA_SCAN_SF_MASK contendo mais de um SF,
+// poll() alterna CAD (Channel Activity Detection) entre os SFs. Ao
+// detectar preambulo o radio trava em RX naquele SF; se nao chegar
+// header valido ou o RxDone no tempo esperado, conta como perda e volta
+// a varrer. Downlinks saem no SF informado no enqueue (o do no).
+
 class LoRaHandler {
 public:
     LoRaHandler();
@@ -26,11 +87,40 @@ public:
     LoRaPacket receive();
     LoRaPacket receivePacket();  // Le pacote sem chamar parsePacket novamente
 
-    // Transmissao (para ACK ou comandos)
-    bool send(const String& data);
-    bool sendWithRetry(const String& data, int maxRetries = 3);
+    // Transmissao (para ACK ou comandos) - apenas enfileira
+    bool send(StringView data);
+    bool sendWithRetry(StringView data, int maxRetries = 3);
+    bool sendAt(StringView data, unsigned long sendAt, uint8_t tag = LORA_TX_TAG_DATA,
+                unsigned long refTime = 0, uint8_t maxAttempts = LORA_TX_MAX_ATTEMPTS,
+                uint8_t sf = 0);
+
+    // Processa TxDone/timeouts, varredura CAD e inicia o proximo quadro vencido
+    void poll();
+
+    // Callback chamado quando um quadro termina (sucesso ou descarte)
+    void setTxDoneCallback(void (*callback)(const LoRaTxResult& result));
+
+    // Funcao chamada pela ISR do DIO0 (deve estar em IRAM e ser ISR-safe)
+    void setIrqHook(void (*hook)());
+
+    // Tempo ate o proximo prazo de poll() (0 = ja; UINT32_MAX = so por DIO0)
+    uint32_t msUntilNextPoll(unsigned long now) const;
+
+    // Contabilidade de tempo no ar (RX do canal, TX e duty cycle)
+    void setAirtimeAccountant(AirtimeAccountant* accountant);
+
+    // Tempo no ar de um quadro (sf = 0: SF padrao configurado)
+    uint32_t timeOnAirUs(size_t payloadLen, uint8_t sf = 0) const;
 
     // Configuracao em tempo de execucao
+    // applyRadioConfig troca todos os parametros de uma vez, entre quadros;
+    // retorna false (sem alterar nada) se o radio estiver ocupado.
+    // Antes do begin() apenas guarda a configuracao inicial.
+    bool applyRadioConfig(const RadioConfig& config);
+    bool canReconfigure() const;
+    const RadioConfig& getRadioConfig() const { return _radio; }
+    static RadioConfig defaultRadioConfig();
+
     void setFrequency(long frequency);
     void setSpreadingFactor(int sf);
     void setBandwidth(long bw);
@@ -41,6 +131,18 @@ public:
     int getLastRSSI();
     float getLastSNR();
     bool isInitialized();
+    bool isTransmitting() const { return _txBusy; }
+    bool hasPendingTx() const { return _txBusy || _txCount > 0; }
+    uint8_t getTxQueueSize() const { return _txCount; }
+    uint32_t getTxDone() const { return _txDone; }
+    uint32_t getTxFailed() const { return _txFailed; }
+    uint32_t getTxTimeouts() const { return _txTimeouts; }
+
+    // Varredura multi-SF
+    bool isScanning() const { return _scanCount > 1; }
+    uint8_t getDefaultSF() const { return _radio.sf; }
+    const LoRaSfStats& getSfStats(uint8_t sf) const { return _sfStats[sf - LORA_SF_MIN]; }
+    uint32_t getScanCycleMs() const { return _scanCycleMs; }
 
     // Modo de operacao
     void enableReceiveMode();
@@ -48,11 +150,72 @@ public:
     void idle();
 
 private:
+    struct TxFrame {
+        LoRaPayload data;
+        unsigned long sendAt;    // millis() alvo do envio
+        unsigned long refTime;
+        uint8_t tag;
+        uint8_t attempts;        // Tentativas ja feitas
+        uint8_t maxAttempts;
+        uint8_t sf;              // SF do envio (0 = padrao)
+    };
+
+    enum ScanState {
+        SCAN_IDLE = 0,           // Sem varredura (SF unico ou transmitindo)
+        SCAN_CAD,                // CAD em andamento em _radioSf
+        SCAN_RX                  // Preambulo detectado, aguardando quadro
+    };
+
     bool _initialized;
     int _lastRSSI;
     float _lastSNR;
 
+    // Parametros atuais (tambem usados no calculo de tempo no ar)
+    RadioConfig _radio;
+    uint8_t _radioSf;            // SF programado no radio neste momento
+
+    // Varredura multi-SF
+    uint8_t _scanSfs[LORA_SF_COUNT];
+    uint8_t _scanCount;
+    uint8_t _scanIndex;
+    uint8_t _scanState;
+    bool _scanHeaderSeen;
+    unsigned long _scanStart;    // Inicio do CAD / RX atual
+    unsigned long _scanDeadline; // Limite para header / RxDone
+    unsigned long _cycleStart;
+    uint32_t _scanCycleMs;       // Duracao do ultimo ciclo completo
+    LoRaSfStats _sfStats[LORA_SF_COUNT];
+
+    // Fila de transmissao
+    TxFrame _txQueue[LORA_TX_QUEUE_SIZE];
+    uint8_t _txCount;
+    int8_t _txActive;            // Indice do quadro em transmissao
+    bool _txBusy;
+    unsigned long _txStart;
+    unsigned long _txTimeout;    // ToA do quadro + LORA_TX_TIMEOUT_MARGIN_MS
+    uint32_t _txDone;
+    uint32_t _txFailed;
+    uint32_t _txTimeouts;
+    void (*_txDoneCallback)(const LoRaTxResult& result);
+    AirtimeAccountant* _airtime;
+
     void configureRadio();
+    void resumeReceive();
+    void setRadioSF(uint8_t sf);
+    void startCad();
+    void pollScan(unsigned long now);
+    static uint32_t remainingMs(unsigned long deadline, unsigned long now);
+    void abortScanRx(unsigned long now);
+    void startTransmit(int index);
+    void finishTransmit(bool success);
+    void dropTxFrame(int index, unsigned long now);
+    void notifyTxDone(const TxFrame& frame, unsigned long now, bool success);
+    void removeTxFrame(int index);
+    int findDueFrame(unsigned long now);
+
+    // Acesso direto aos registradores do SX1276
+    uint8_t readRegister(uint8_t address);
+    void writeRegister(uint8_t address, uint8_t value);
 };
 
 #endif // LORA_HANDLER_H
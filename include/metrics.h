@@ -0,0 +1,176 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// REGISTRO DE METRICAS (FORMATO PROMETHEUS)
+// ============================================
+//
+// Contadores, medidores e histogramas declarados nas listas abaixo
+// (X-macros): os valores ficam em arrays estaticos, sem alocacao, e sao
+// escritos com operacoes atomicas, sem trava, de qualquer task (32 bits;
+// as somas dos histogramas em 64 bits, para nao dar a volta).
+// GET /metrics renderiza o texto Prometheus sob demanda, em pedacos
+// (renderChunk), sem montar a resposta inteira na memoria.
+//
+// Contadores que ja existem em outros modulos (TX, ACKs) sao copiados com
+// set() pela tarefa de estatisticas; os demais sao incrementados no ponto
+// em que o evento acontece.
+
+// X(id, nome, ajuda)
+#define METRICS_COUNTERS(X) \
+    X(RX_PACKETS,       "gateway_lora_rx_packets_total",        "Quadros LoRa recebidos com CRC valido") \
+    X(RX_DUPLICATES,    "gateway_lora_rx_duplicates_total",     "Retransmissoes suprimidas pelo cache de duplicados") \
+    X(DECODE_ERRORS,    "gateway_decode_errors_total",          "Quadros com JSON invalido ou campos faltando") \
+    X(PACKET_ERRORS,    "gateway_packet_errors_total",          "Quadros invalidos e leituras descartadas") \
+    X(TX_FRAMES,        "gateway_lora_tx_frames_total",         "Downlinks transmitidos com TxDone") \
+    X(TX_FAILED,        "gateway_lora_tx_failed_total",         "Downlinks descartados apos todas as tentativas") \
+    X(TX_BLOCKED,       "gateway_lora_tx_duty_blocked_total",   "Downlinks descartados pelo duty cycle") \
+    X(ACKS_SENT,        "gateway_acks_sent_total",              "ACKs transmitidos") \
+    X(UPLINK_FORWARDED, "gateway_uplink_forwarded_total",       "Leituras aceitas pelo servidor") \
+    X(UPLINK_ERRORS,    "gateway_uplink_errors_total",          "Envios de leitura ao servidor com falha") \
+    X(UPLINK_REJECTED,  "gateway_uplink_queue_rejected_total",  "Leituras recusadas com a fila de uplink cheia") \
+    X(UPLINK_COALESCED, "gateway_uplink_coalesced_total",       "Periodicas substituidas por uma mais nova do mesmo no") \
+    X(UPLINK_SHED,      "gateway_uplink_shed_total",            "Periodicas descartadas para dar lugar a outra leitura") \
+    X(UPLINK_EVICTED,   "gateway_uplink_evicted_total",         "Leituras ja confirmadas ao no removidas da fila sem entrega") \
+    X(UPLINK_BODY_BYTES, "gateway_uplink_body_bytes_total",     "Bytes dos lotes de uplink antes da compressao") \
+    X(UPLINK_SENT_BYTES, "gateway_uplink_sent_bytes_total",     "Bytes dos lotes de uplink enviados (comprimidos ou nao)") \
+    X(UPLINK_JSON_BYTES, "gateway_uplink_json_bytes_total",     "Bytes de leituras serializadas em JSON") \
+    X(UPLINK_MSGPACK_BYTES, "gateway_uplink_msgpack_bytes_total", "Bytes de leituras serializadas em MessagePack") \
+    X(UPLINK_BATCH_INCREASES, "gateway_uplink_batch_increases_total", "Aumentos aditivos do ritmo ou do lote HTTP") \
+    X(UPLINK_BATCH_DECREASES, "gateway_uplink_batch_decreases_total", "Reducoes multiplicativas do ritmo ou do lote HTTP") \
+    X(UPLINK_FLUSH_FULL, "gateway_uplink_flush_full_total",     "Lotes HTTP enviados completos") \
+    X(UPLINK_FLUSH_TIMER, "gateway_uplink_flush_interval_total", "Lotes HTTP enviados incompletos apos o intervalo") \
+    X(UPLINK_FLUSH_EVENT, "gateway_uplink_flush_event_total",   "Lotes HTTP antecipados pelo orcamento de latencia de um evento") \
+    X(UPLINK_BREAKER_OPENS, "gateway_uplink_breaker_opens_total", "Disjuntores de servidor de uplink abertos") \
+    X(UPLINK_REROUTED,  "gateway_uplink_rerouted_total",        "Leituras passadas a outro servidor de uplink") \
+    X(UPLINK_MIRRORED,  "gateway_uplink_mirrored_total",        "Copias de leituras enfileiradas para os demais servidores") \
+    X(WEB_REQUESTS,     "gateway_web_requests_total",           "Requisicoes atendidas pela API local") \
+    X(WIFI_RECONNECTS,  "gateway_wifi_reconnects_total",        "Tentativas de reconexao WiFi") \
+    X(MQTT_CONNECTS,    "gateway_mqtt_connects_total",          "Sessoes MQTT aceitas pelo broker") \
+    X(MQTT_PUBLISHED,   "gateway_mqtt_published_total",         "PUBLISH enviados ao broker") \
+    X(MQTT_PUBACKS,     "gateway_mqtt_pubacks_total",           "PUBACKs recebidos do broker") \
+    X(SEMTECH_PUSH_DATA, "gateway_semtech_push_data_total",     "PUSH_DATA enviados (rxpk e stat)") \
+    X(SEMTECH_PUSH_ACKS, "gateway_semtech_push_acks_total",     "PUSH_ACKs de leituras recebidos") \
+    X(SEMTECH_PULL_RESP, "gateway_semtech_pull_resp_total",     "Downlinks (PULL_RESP) recebidos") \
+    X(SEMTECH_TX_REJECTED, "gateway_semtech_tx_rejected_total", "txpk recusados no TX_ACK") \
+    X(SERIAL_FRAMES,    "gateway_serial_frames_sent_total",     "Quadros COBS escritos na UART") \
+    X(SERIAL_ACKS,      "gateway_serial_acks_total",            "Leituras confirmadas pela ponte serial") \
+    X(SERIAL_BAD_FRAMES, "gateway_serial_bad_frames_total",     "Quadros recebidos com COBS ou CRC invalido") \
+    X(TLS_HANDSHAKES,   "gateway_tls_full_handshakes_total",    "Handshakes TLS completos (certificado verificado)") \
+    X(TLS_RESUMED,      "gateway_tls_resumed_handshakes_total", "Handshakes TLS com sessao retomada") \
+    X(TLS_FAILURES,     "gateway_tls_failures_total",           "Conexoes TLS recusadas ou sem resposta")
+
+#define METRICS_GAUGES(X) \
+    X(UPTIME,           "gateway_uptime_seconds",               "Tempo desde o boot") \
+    X(UPLINK_QUEUE,     "gateway_uplink_queue_depth",           "Leituras aguardando envio ao servidor") \
+    X(DOWNLINK_PENDING, "gateway_downlink_pending",             "Comandos aguardando entrega aos nos") \
+    X(CHANNEL_UTIL,     "gateway_channel_utilization_permille", "Ocupacao do canal por RX na janela de duty cycle") \
+    X(TX_UTIL,          "gateway_tx_utilization_permille",      "Tempo de TX na janela de duty cycle") \
+    X(LINKS_DEGRADED,   "gateway_links_degraded",               "Nos com perda acima de LINK_DEGRADED_LOSS_PCT") \
+    X(HEAP_FREE,        "gateway_heap_free_bytes",              "Heap livre") \
+    X(HEAP_MIN_FREE,    "gateway_heap_min_free_bytes",          "Menor heap livre desde o boot") \
+    X(HEAP_LARGEST,     "gateway_heap_largest_block_bytes",     "Maior bloco de heap alocavel") \
+    X(WIFI_CONNECTED,   "gateway_wifi_connected",               "1 se o WiFi estiver conectado") \
+    X(WIFI_RSSI,        "gateway_wifi_rssi_dbm",                "RSSI do WiFi") \
+    X(MQTT_INFLIGHT,    "gateway_mqtt_inflight",                "PUBLISH QoS1 aguardando PUBACK") \
+    X(UPLINK_BATCH_SIZE, "gateway_uplink_batch_size",           "Leituras por POST decididas pelo controle AIMD (primeiro servidor)") \
+    X(UPLINK_FLUSH_INTERVAL, "gateway_uplink_flush_interval_ms", "Espera maxima de um lote HTTP incompleto (primeiro servidor)") \
+    X(UPLINK_RTT,       "gateway_uplink_rtt_ms",                "RTT medio dos POSTs de uplink (primeiro servidor)") \
+    X(UPLINK_ERROR_RATE, "gateway_uplink_error_rate_permille",  "Taxa de POSTs de uplink com falha (primeiro servidor)") \
+    X(UPLINK_ENDPOINTS_UP, "gateway_uplink_endpoints_up",       "Servidores de uplink com o disjuntor fechado")
+
+// X(id, nome, ajuda, limites superiores dos baldes...)
+#define METRICS_HISTOGRAMS(X) \
+    X(RX_RSSI,          "gateway_lora_rx_rssi_dbm",             "RSSI dos quadros recebidos", \
+      -120, -110, -100, -90, -80, -70, -60) \
+    X(RX_SNR,           "gateway_lora_rx_snr_db",               "SNR dos quadros recebidos", \
+      -15, -10, -5, 0, 5, 10) \
+    X(ACK_TURNAROUND,   "gateway_ack_turnaround_ms",            "Tempo entre a recepcao e o fim do ACK", \
+      50, 100, 200, 500, 1000, 2000) \
+    X(UPLINK_HTTP,      "gateway_uplink_http_duration_ms",      "Duracao do POST de um lote de leituras", \
+      50, 100, 250, 500, 1000, 2500, 5000) \
+    X(UPLINK_LATENCY_EVENT, "gateway_uplink_latency_event_ms",  "Recepcao ate a entrega ao servidor (eventos)", \
+      100, 250, 1000, 5000, 30000, 120000, 600000) \
+    X(UPLINK_LATENCY_NORMAL, "gateway_uplink_latency_normal_ms", "Recepcao ate a entrega ao servidor (sem classe)", \
+      100, 250, 1000, 5000, 30000, 120000, 600000) \
+    X(UPLINK_LATENCY_PERIODIC, "gateway_uplink_latency_periodic_ms", "Recepcao ate a entrega ao servidor (periodicas)", \
+      100, 250, 1000, 5000, 30000, 120000, 600000) \
+    X(UPLINK_COMPRESS,  "gateway_uplink_compress_us_per_kb",    "Tempo de compressao por KB do lote", \
+      250, 500, 1000, 2000, 4000, 8000, 16000) \
+    X(UPLINK_SERIALIZE_JSON, "gateway_uplink_serialize_json_us", "Serializacao de uma leitura em JSON", \
+      25, 50, 100, 200, 400, 800, 1600) \
+    X(UPLINK_SERIALIZE_MSGPACK, "gateway_uplink_serialize_msgpack_us", "Serializacao de uma leitura em MessagePack", \
+      25, 50, 100, 200, 400, 800, 1600) \
+    X(MQTT_PUBACK,      "gateway_mqtt_puback_latency_ms",       "Tempo entre o PUBLISH QoS1 e o PUBACK", \
+      5, 10, 25, 50, 100, 250, 1000) \
+    X(SEMTECH_PUSH_RTT, "gateway_semtech_push_ack_rtt_ms",      "Tempo entre o PUSH_DATA e o PUSH_ACK", \
+      5, 10, 25, 50, 100, 250, 1000) \
+    X(SERIAL_HANDOFF,   "gateway_serial_handoff_us",            "Montagem do registro ate a escrita na UART", \
+      50, 100, 250, 500, 1000, 5000) \
+    X(SERIAL_ACK_RTT,   "gateway_serial_ack_rtt_ms",            "Tempo entre o quadro da leitura e o ACK da ponte", \
+      2, 5, 10, 25, 100, 500, 2000) \
+    X(TLS_HANDSHAKE,    "gateway_tls_handshake_ms",             "Duracao do handshake TLS (completo ou retomado)", \
+      50, 100, 250, 500, 1000, 2500, 5000) \
+    X(TLS_CRYPTO,       "gateway_tls_crypto_us",                "Tempo de cripto TLS por requisicao HTTPS", \
+      500, 1000, 5000, 25000, 100000, 500000, 2000000)
+
+#define METRICS_MAX_BUCKETS 8
+#define METRICS_LINE_MAX 192
+
+#define METRIC_ENUM_ENTRY(id, ...) METRIC_##id,
+enum MetricId {
+    METRICS_COUNTERS(METRIC_ENUM_ENTRY)
+    METRICS_GAUGES(METRIC_ENUM_ENTRY)
+    METRIC_COUNT
+};
+
+#define HISTOGRAM_ENUM_ENTRY(id, ...) HISTOGRAM_##id,
+enum HistogramId {
+    METRICS_HISTOGRAMS(HISTOGRAM_ENUM_ENTRY)
+    HISTOGRAM_COUNT
+};
+
+// Posicao da renderizacao entre pedacos da resposta chunked
+struct MetricsCursor {
+    uint16_t family;     // Contadores, medidores e depois histogramas
+    uint16_t line;       // Proxima linha dentro da familia
+
+    // Linha ja formatada que nao coube inteira: o resto sai no proximo
+    // pedaco, com os mesmos valores
+    char pending[METRICS_LINE_MAX];
+    uint8_t pendingLen;
+    uint8_t pendingPos;
+};
+
+class Metrics {
+public:
+    // Escrita (qualquer task, sem trava)
+    static void inc(MetricId id, uint32_t amount = 1) {
+        __atomic_fetch_add(&_values[id], (int32_t)amount, __ATOMIC_RELAXED);
+    }
+    static void set(MetricId id, int32_t value) {
+        __atomic_store_n(&_values[id], value, __ATOMIC_RELAXED);
+    }
+    static void observe(HistogramId id, int32_t value);
+
+    static int32_t get(MetricId id) {
+        return __atomic_load_n(&_values[id], __ATOMIC_RELAXED);
+    }
+
+    // Escreve linhas inteiras ate encher o buffer (uma linha maior que o
+    // buffer vai em partes); 0 = terminou
+    static size_t renderChunk(MetricsCursor& cursor, char* buffer, size_t maxLen);
+
+private:
+    static int32_t _values[METRIC_COUNT];
+    static uint32_t _buckets[HISTOGRAM_COUNT][METRICS_MAX_BUCKETS + 1];
+    static uint64_t _sums[HISTOGRAM_COUNT];     // Complemento de 2 (valores negativos)
+
+    static int formatLine(const MetricsCursor& cursor, char* line, size_t size);
+    static int formatHistogramLine(uint16_t id, uint16_t line, char* out, size_t size);
+};
+
+#endif // METRICS_H
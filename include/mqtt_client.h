@@ -0,0 +1,123 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "fixed_string.h"
+
+// ============================================
+// CLIENTE MQTT 3.1.1 (UPLINK_TRANSPORT_MQTT)
+// ============================================
+//
+// Sessao persistente sobre um unico WiFiClient, sem biblioteca externa
+// (PubSubClient so publica QoS0). Ate MQTT_MAX_INFLIGHT PUBLISH QoS1
+// ficam em voo ao mesmo tempo; cada PUBACK libera uma vaga e chama o
+// callback com o id do pacote e a latencia publish -> PUBACK.
+//
+// Nada bloqueia alem do connect() TCP (limitado a MQTT_CONNECT_TIMEOUT_MS):
+// poll() le o socket, trata CONNACK/PUBACK/PUBLISH/PINGRESP, manda o
+// PINGREQ e derruba a sessao se um PUBACK atrasar. A sessao e limpa
+// (clean session): apos reconectar, quem publicou reenvia o que estava
+// em voo (o callback de conexao avisa).
+
+enum MqttState {
+    MQTT_STATE_DISCONNECTED,
+    MQTT_STATE_CONNECTING,       // TCP aberto, aguardando CONNACK
+    MQTT_STATE_CONNECTED
+};
+
+struct MqttInflight {
+    uint16_t packetId;           // 0 = vaga livre
+    unsigned long sentAt;        // millis() do PUBLISH
+};
+
+typedef void (*MqttMessageCallback)(StringView topic, StringView payload);
+typedef void (*MqttAckCallback)(uint16_t packetId, uint32_t latencyMs);
+typedef void (*MqttConnectedCallback)();
+
+class MqttClient {
+public:
+    MqttClient();
+
+    void begin(const char* clientId);
+    void setServer(const char* host, uint16_t port);
+
+    void setMessageCallback(MqttMessageCallback callback) { _messageCallback = callback; }
+    void setAckCallback(MqttAckCallback callback) { _ackCallback = callback; }
+    void setConnectedCallback(MqttConnectedCallback callback) { _connectedCallback = callback; }
+
+    // Conexao, leitura do socket, keepalive e timeout de PUBACK
+    void poll(unsigned long now);
+    void disconnect();
+
+    bool isConnected() const { return _state == MQTT_STATE_CONNECTED; }
+    bool canPublish() const { return isConnected() && _inflightCount < MQTT_MAX_INFLIGHT; }
+    uint8_t getInflight() const { return _inflightCount; }
+
+    // QoS1: retorna o id do pacote (0 = sem conexao, janela cheia ou erro).
+    // QoS0: retorna 1 se escrito no socket.
+    uint16_t publish(const char* topic, StringView payload, uint8_t qos);
+    bool subscribe(const char* topic, uint8_t qos);
+
+    // Estatisticas
+    uint32_t getPublished() const { return _published; }
+    uint32_t getAcked() const { return _acked; }
+    uint32_t getConnects() const { return _connects; }
+    uint32_t getAvgLatencyMs() const { return _acked > 0 ? (uint32_t)(_latencyTotal / _acked) : 0; }
+    uint32_t getMaxLatencyMs() const { return _latencyMax; }
+    float getThroughput() const { return _throughput; }
+
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    WiFiClient _client;
+    MqttState _state;
+    HostName _host;
+    uint16_t _port;
+    FixedString<32> _clientId;
+
+    MqttInflight _inflight[MQTT_MAX_INFLIGHT];
+    uint8_t _inflightCount;
+    uint16_t _nextPacketId;
+
+    uint8_t _tx[MQTT_TX_BUFFER_SIZE];
+    uint8_t _rx[MQTT_RX_BUFFER_SIZE];
+    size_t _rxLength;
+    size_t _rxDiscard;           // Resto de um pacote maior que o buffer
+
+    unsigned long _connectStartedAt;
+    unsigned long _lastConnectAttempt;
+    unsigned long _lastTx;
+    unsigned long _lastRx;
+
+    MqttMessageCallback _messageCallback;
+    MqttAckCallback _ackCallback;
+    MqttConnectedCallback _connectedCallback;
+
+    // Estatisticas
+    uint32_t _published;
+    uint32_t _acked;
+    uint32_t _connects;
+    uint32_t _timeouts;
+    uint32_t _oversized;
+    uint64_t _latencyTotal;
+    uint32_t _latencyMax;
+    uint32_t _latencyLast;
+    float _throughput;           // PUBACKs por segundo na ultima janela
+    uint32_t _rateAcked;
+    unsigned long _rateStartedAt;
+
+    void startConnect(unsigned long now);
+    void readSocket(unsigned long now);
+    void handlePacket(const uint8_t* packet, size_t headerLength, size_t length, unsigned long now);
+    void handlePubAck(uint16_t packetId, unsigned long now);
+    void handlePublish(uint8_t flags, const uint8_t* body, size_t length);
+    void checkTimeouts(unsigned long now);
+    bool send(size_t headerLength, StringView payload = StringView());
+    void drop(const char* reason);
+    uint16_t takePacketId();
+};
+
+#endif // MQTT_CLIENT_H
@@ -0,0 +1,21 @@
+#ifndef NODE_SEQUENCE_H
+#define NODE_SEQUENCE_H
+
+#include <stdint.h>
+
+// ============================================
+// REINICIO DO CONTADOR DE SEQUENCIA DO NO
+// ============================================
+//
+// Um no que reinicia (queda de energia, reset) volta a contar de 0 ou 1.
+// Sem detectar isso, as primeiras leituras depois do reset caem dentro da
+// janela da sequencia antiga e passam por duplicadas (ou atrasadas).
+//
+// Regra unica para o cache de duplicados e a qualidade de enlace: a
+// sequencia voltou para tras e e 0/1, ou voltou window ou mais.
+
+constexpr bool isSequenceReset(uint32_t lastSeq, uint32_t sequence, uint32_t window) {
+    return sequence < lastSeq && (sequence <= 1 || lastSeq - sequence >= window);
+}
+
+#endif // NODE_SEQUENCE_H
@@ -4,6 +4,11 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include "config.h"
+#include "json_arena.h"
+#include "fixed_string.h"
+#include "gateway_stats.h"
+#include "downlink_queue.h"
+#include "link_quality.h"
 
 // ============================================
 // PROTOCOLO DE COMUNICACAO JSON PARA LORA
@@ -36,6 +41,22 @@
 //     "snr": 9.5
 //   }
 // }
+//
+// ACK agregado enviado pelo gateway (binario, 4 + 4*N bytes):
+//   [0]     0xA5                  marcador (nunca '{', nao conflita com JSON)
+//   [1..2]  hash16(GATEWAY_ID)    big-endian
+//   [3]     N                     quantidade de entradas
+//   [4..]   N x { hash16(id do no), seq & 0xFFFF }, ambos big-endian
+// hash16 = FNV-1a de 32 bits dobrado em 16 (metade alta XOR metade baixa).
+// Colisoes de hash exigem tambem a mesma seq baixa para confirmar errado.
+//
+// Comando de downlink (junto do ACK JSON ou em quadro "cmd" proprio):
+// { "type": "ack", "to": "NODE001", "seq": 123, "ok": true, "gw": "GW001",
+//   "cmd": { "id": 42, "c": "set_interval", "p": { "interval_s": 60 } } }
+//
+// Confirmacao de execucao enviada pelo no:
+// { "id": "NODE001", "type": "cmd_ack",
+//   "data": { "cmd": 42, "ok": true, "exec_ms": 12 } }
 
 // Tipos de mensagem
 enum MessageType {
@@ -47,10 +68,24 @@ enum MessageType {
     MSG_TYPE_CONFIG
 };
 
+#define ACK_AGG_MARKER 0xA5
+#define ACK_AGG_HEADER_SIZE 4
+#define ACK_AGG_ENTRY_SIZE 4
+
+// Entrada do ACK agregado
+struct AckEntry {
+    uint16_t nodeHash;
+    uint16_t sequence;  // 16 bits baixos da sequencia
+};
+
 // Estrutura de dados do sensor
+// O documento "data" vive na arena de recepcao (jsonArenaRx), que e
+// resetada ao final do processamento de cada pacote.
 struct SensorData {
-    String nodeId;
-    String nodeType;
+    SensorData() : sequence(0), data(&jsonArenaRx), valid(false) {}
+
+    NodeId nodeId;
+    NodeType nodeType;
     uint32_t sequence;
     JsonDocument data;
     bool valid;
@@ -58,38 +93,66 @@ struct SensorData {
 
 // Estrutura de pacote para o servidor
 struct ServerPacket {
-    String gatewayId;
+    NodeId gatewayId;
     unsigned long timestamp;
     SensorData node;
     int rssi;
     float snr;
 };
 
+// Formato do payload do servidor e das respostas da API local
+enum PayloadFormat {
+    PAYLOAD_FORMAT_JSON,
+    PAYLOAD_FORMAT_MSGPACK
+};
+
 class Protocol {
 public:
     Protocol();
 
     // Parsing de dados recebidos via LoRa
-    SensorData parseLoRaPacket(const String& payload);
+    SensorData parseLoRaPacket(StringView payload);
 
-    // Criacao de pacote para enviar ao servidor
-    String createServerPayload(const SensorData& sensorData, int rssi, float snr);
+    // Criacao de pacote para enviar ao servidor (vazio se nao couber)
+    // (com o resumo da qualidade de enlace do no, se informado)
+    UplinkPayload createServerPayload(const SensorData& sensorData, int rssi, float snr,
+                                      unsigned long rxTimeMs, long freqError = 0,
+                                      const LinkQuality* link = nullptr);
+    // O mesmo payload escrito direto em out, sem terminador (out = nullptr
+    // so mede), em JSON ou MessagePack; retorna o tamanho ou 0 se passar de
+    // UPLINK_PAYLOAD_MAX_LEN ou de capacity
+    size_t writeServerPayload(const SensorData& sensorData, int rssi, float snr,
+                              unsigned long rxTimeMs, long freqError, const LinkQuality* link,
+                              char* out, size_t capacity,
+                              uint8_t format = PAYLOAD_FORMAT_JSON);
 
     // Criacao de ACK para enviar ao no
-    String createAck(const String& nodeId, uint32_t sequence, bool success);
+    // (com o comando pendente do no embutido, se informado)
+    LoRaPayload createAck(StringView nodeId, uint32_t sequence, bool success,
+                          const DownlinkCommand* command = nullptr);
+
+    // Comandos de downlink: quadro proprio, busca e relatorio ao servidor
+    LoRaPayload createCommand(const DownlinkCommand& command);
+    uint8_t parseServerCommands(StringView body, DownlinkQueue& queue, unsigned long now);
+    String createCommandStatus(const DownlinkCommand& command);
+
+    // ACK agregado (binario) confirmando varios nos de uma vez
+    LoRaPayload createAggregatedAck(const AckEntry* entries, uint8_t count);
+    static uint16_t hashNodeId(StringView nodeId);
 
     // Criacao de mensagem de status do gateway
-    String createGatewayStatus(int wifiRssi, uint32_t packetsReceived,
-                               uint32_t packetsForwarded, unsigned long uptime);
+    String createGatewayStatus(const GatewayStats& gatewayStats);
 
     // Validacao de pacote
-    bool validatePacket(const String& payload);
+    bool validatePacket(StringView payload);
 
     // Utilitarios
-    MessageType getMessageType(const String& payload);
+    MessageType getMessageType(StringView payload);
 
 private:
     static const size_t JSON_DOC_SIZE = 1024;
+
+    void appendCommand(JsonObject obj, const DownlinkCommand& command);
 };
 
 #endif // PROTOCOL_H
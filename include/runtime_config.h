@@ -0,0 +1,110 @@
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "fixed_string.h"
+#include "lora_handler.h"
+
+// ============================================
+// CONFIGURACAO EM TEMPO DE EXECUCAO (NVS)
+// ============================================
+//
+// Parametros de radio e de rede alteraveis sem recompilar. O padrao de
+// fabrica vem das macros de config.h; a ultima configuracao aprovada fica
+// na NVS (namespace RUNTIME_CONFIG_NAMESPACE).
+//
+// Fluxo de uma mudanca (POST /api/config):
+// 1. request(): mescla o JSON parcial sobre a configuracao ativa e valida
+//    tudo; invalida = nada muda. Uma mudanca por vez.
+// 2. poll() (loop principal): aplica pelo callback quando o radio estiver
+//    entre quadros (o callback retorna false para tentar de novo).
+// 3. Observacao por CONFIG_PROBATION_MS: se a recepcao cair abaixo de
+//    CONFIG_ROLLBACK_RATIO_PCT da taxa anterior, volta a configuracao
+//    anterior; senao grava na NVS. Reboot durante a observacao = volta a
+//    configuracao gravada.
+//
+// Formato (GET e POST /api/config; no POST todos os campos sao opcionais):
+// {
+//   "radio": {"frequency": 915000000, "sf": 7, "bandwidth": 125000,
+//             "coding_rate": 5, "tx_power": 20, "sync_word": 32, "preamble": 8},
+//   "server": {"host": "192.168.1.100", "port": 8080},
+//   "status_interval_s": 60
+// }
+
+struct GatewayConfig {
+    RadioConfig radio;
+    HostName serverHost;
+    uint16_t serverPort;
+    uint32_t statusIntervalMs;
+};
+
+enum RuntimeConfigState {
+    CONFIG_STABLE = 0,
+    CONFIG_STAGED,       // Validada, aguardando o radio ficar livre
+    CONFIG_PROBATION,    // Aplicada, observando a recepcao
+    CONFIG_ROLLBACK      // Recepcao caiu, voltando a anterior
+};
+
+class RuntimeConfig {
+public:
+    RuntimeConfig();
+
+    // Carrega da NVS (ou padrao de fabrica)
+    void begin();
+
+    const GatewayConfig& get() const { return _active; }
+    bool isChanging() const { return _state != CONFIG_STABLE; }
+    static GatewayConfig defaults();
+
+    // Chamado pela API (task do servidor web); false + erro se rejeitada
+    bool request(JsonObjectConst changes, String& error);
+    bool requestDefaults(String& error);
+
+    // Loop principal: aplica a mudanca agendada e vigia a recepcao
+    void poll(unsigned long now, uint32_t packetsReceived);
+
+    // Aplica a configuracao no radio/rede; false = radio ocupado
+    void setApplyCallback(bool (*callback)(const GatewayConfig& config));
+
+    static void toJson(const GatewayConfig& config, JsonObject obj);
+    static bool validate(const GatewayConfig& config, String& error);
+
+    // Configuracao ativa + estado da mudanca em andamento
+    void appendTelemetry(JsonObject obj, unsigned long now) const;
+
+    uint32_t getApplied() const { return _applied; }
+    uint32_t getRollbacks() const { return _rollbacks; }
+
+private:
+    GatewayConfig _active;
+    GatewayConfig _previous;
+    GatewayConfig _staged;
+    volatile uint8_t _state;
+    mutable portMUX_TYPE _lock;
+    bool _fromNvs;
+
+    // Referencia de recepcao: pacotes desde a ultima mudanca
+    unsigned long _activeSince;
+    uint32_t _packetsAtActive;
+    unsigned long _baselineMs;
+    uint32_t _baselinePackets;
+
+    unsigned long _probationStart;
+    uint32_t _probationPackets;
+
+    uint32_t _applied;
+    uint32_t _rollbacks;
+    const char* _lastResult;
+
+    bool (*_applyCallback)(const GatewayConfig& config);
+
+    bool stage(const GatewayConfig& config, String& error);
+    void finishProbation(unsigned long now, uint32_t packetsReceived);
+    bool load(GatewayConfig& config);
+    bool save(const GatewayConfig& config);
+    static bool merge(JsonObjectConst changes, GatewayConfig& config, String& error);
+};
+
+#endif // RUNTIME_CONFIG_H
@@ -0,0 +1,90 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ============================================
+// ESCALONADOR COOPERATIVO DO LOOP PRINCIPAL
+// ============================================
+//
+// Substitui o loop() com delay(10) fixo: cada subsistema registra uma
+// tarefa com intervalo e/ou mascara de eventos. run() executa as tarefas
+// vencidas (na ordem de registro) e dorme na notificacao da task ate o
+// proximo prazo ou ate um evento (ex.: DIO0 do radio pela ISR).
+//
+// Uma tarefa pode antecipar a propria execucao com wakeAt() (prazo
+// dinamico, ex.: proximo quadro de TX) ou mudar o intervalo com
+// setInterval(). As tarefas nao podem bloquear por muito tempo: o
+// tempo de cada uma e a latencia ate o inicio aparecem na telemetria.
+
+// Eventos (bit por fonte)
+#define SCHED_EVENT_RADIO  (1UL << 0)    // DIO0 (RxDone, TxDone, CadDone)
+#define SCHED_EVENT_UPLINK (1UL << 1)    // Leitura nova na fila de uplink
+
+typedef void (*SchedulerTaskFn)(unsigned long now);
+
+struct SchedulerTask {
+    const char* name;
+    SchedulerTaskFn fn;
+    uint32_t intervalMs;         // 0 = so por evento / wakeAt
+    uint32_t events;             // Eventos que disparam a tarefa
+    unsigned long nextRun;       // millis() do proximo prazo
+    bool armed;                  // Tem prazo valido
+
+    // Estatisticas
+    uint32_t runs;
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint32_t maxLateMs;          // Atraso do inicio em relacao ao prazo
+};
+
+class Scheduler {
+public:
+    Scheduler();
+
+    // Registra a task atual (a do loop) como a que dorme
+    void begin();
+
+    // Retorna o id da tarefa (-1 se a tabela estiver cheia)
+    int add(const char* name, SchedulerTaskFn fn, uint32_t intervalMs, uint32_t events = 0);
+
+    // Antecipa a proxima execucao (nunca adia um prazo ja marcado)
+    void wakeAt(int id, unsigned long when);
+    void setInterval(int id, uint32_t intervalMs);
+
+    // Sinaliza eventos: da propria task, de outra task ou de ISR
+    void signal(uint32_t events);
+    static void IRAM_ATTR signalFromIsr(uint32_t events);
+
+    // Uma iteracao: executa o que venceu e dorme ate o proximo prazo/evento
+    void run();
+
+    uint32_t getMaxEventLatencyUs() const { return _maxEventLatencyUs; }
+    uint32_t getMaxIterationUs() const { return _maxIterationUs; }
+    uint32_t getWakeups() const { return _wakeups; }
+
+    // Tempo por tarefa, latencia maxima e ocupacao do loop
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    SchedulerTask _tasks[SCHEDULER_MAX_TASKS];
+    uint8_t _taskCount;
+
+    uint32_t _wakeups;
+    uint32_t _maxEventLatencyUs;     // Evento da ISR -> inicio da tarefa
+    uint32_t _maxIterationUs;        // Pior iteracao (todas as tarefas)
+    uint64_t _busyUs;                // Tempo executando tarefas
+    unsigned long _startedAt;
+
+    // Compartilhados com a ISR
+    static volatile uint32_t _pendingEvents;
+    static volatile uint32_t _eventAtUs;     // micros() do primeiro evento pendente
+    static TaskHandle_t _loopTask;
+
+    uint32_t takeEvents(uint32_t& eventAtUs);
+    uint32_t msUntilNextDeadline(unsigned long now) const;
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,133 @@
+#ifndef SEMTECH_FORWARDER_H
+#define SEMTECH_FORWARDER_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "fixed_string.h"
+#include "lora_handler.h"
+#include "uplink_queue.h"
+
+// ============================================
+// PACKET FORWARDER UDP SEMTECH (UPLINK_TRANSPORT_SEMTECH)
+// ============================================
+//
+// Protocolo GWMP v2 do packet forwarder da Semtech: cada PUSH_DATA leva
+// ate SEMTECH_MAX_RXPK leituras ("rxpk": quadro original em base64, RSSI,
+// SNR, SF e tmst) e o status periodico vira um PUSH_DATA "stat". O
+// PULL_DATA periodico mantem aberto o caminho de volta: o servidor
+// responde com PULL_RESP ("txpk"), que e repassado ao callback de TX e
+// confirmado com TX_ACK.
+//
+// tmst e o contador de microssegundos do gateway (millis() * 1000, com
+// volta em 32 bits); um txpk agendado usa a mesma base. Um PUSH_DATA sem
+// PUSH_ACK em SEMTECH_PUSH_TIMEOUT_MS volta para quem enviou (callback
+// com acked = false) para ser reenviado.
+
+struct SemtechTxRequest {
+    LoRaPayload data;
+    bool immediate;             // "imme": transmite assim que possivel
+    uint32_t tmst;              // Contador us do gateway (mesma base do rxpk)
+    uint32_t frequency;         // Hz
+    uint32_t bandwidth;         // Hz
+    uint8_t sf;
+};
+
+struct SemtechInflight {
+    uint16_t token;             // 0 = vaga livre
+    unsigned long sentAt;
+};
+
+// Retorna o codigo do TX_ACK ("NONE" = aceito, "TOO_LATE", "TX_FREQ", ...)
+typedef const char* (*SemtechTxCallback)(const SemtechTxRequest& request);
+typedef void (*SemtechAckCallback)(uint16_t token, bool acked);
+
+class SemtechForwarder {
+public:
+    SemtechForwarder();
+
+    // Abre a porta local e monta o EUI a partir do MAC
+    void begin();
+    void setServer(const char* host, uint16_t port);
+
+    void setAckCallback(SemtechAckCallback callback) { _ackCallback = callback; }
+    void setTxCallback(SemtechTxCallback callback) { _txCallback = callback; }
+
+    // Datagramas recebidos, PULL_DATA periodico e timeout de PUSH_ACK
+    void poll(unsigned long now);
+
+    bool canPush() const { return _started && _inflightCount < SEMTECH_MAX_INFLIGHT; }
+
+    // PUSH_DATA com as primeiras leituras que couberem no datagrama;
+    // retorna quantas foram incluidas (0 = nada enviado)
+    uint8_t pushRxpk(UplinkEntry* const* entries, uint8_t count, const RadioConfig& radio,
+                     uint16_t& token);
+
+    // PUSH_DATA "stat" (contadores desde o stat anterior)
+    bool pushStat(uint32_t rxTotal);
+
+    // Downlink do PULL_RESP transmitido (TxDone)
+    void countTx() { _txDone++; }
+
+    // Contador us do gateway no instante millis() = ms
+    static uint32_t toTmst(unsigned long ms) { return (uint32_t)(ms * 1000UL); }
+
+    // Estatisticas
+    uint32_t getPushSent() const { return _pushSent; }
+    uint32_t getPushAcked() const { return _pushAcked; }
+    uint32_t getPullResp() const { return _pullResp; }
+    uint32_t getAvgRttMs() const { return _pushAcked > 0 ? (uint32_t)(_rttTotal / _pushAcked) : 0; }
+
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    WiFiUDP _udp;
+    bool _started;
+    HostName _host;
+    uint16_t _port;
+    uint8_t _eui[8];
+
+    SemtechInflight _inflight[SEMTECH_MAX_INFLIGHT];
+    uint8_t _inflightCount;
+    uint16_t _nextToken;
+    uint16_t _statToken;
+    unsigned long _lastPull;
+    unsigned long _lastPullAck;
+
+    uint8_t _buffer[SEMTECH_DATAGRAM_MAX + 1];
+
+    SemtechAckCallback _ackCallback;
+    SemtechTxCallback _txCallback;
+
+    // Estatisticas (acumuladas)
+    uint32_t _pushSent;
+    uint32_t _pushAcked;
+    uint32_t _pushTimeouts;
+    uint32_t _pullSent;
+    uint32_t _pullAcked;
+    uint32_t _pullResp;
+    uint32_t _txRejected;
+    uint32_t _txDone;
+    uint32_t _rxForwarded;
+    uint64_t _rttTotal;
+    uint32_t _rttMax;
+
+    // Valores no stat anterior (o stat relata o intervalo)
+    uint32_t _statRx;
+    uint32_t _statRxForwarded;
+    uint32_t _statPushSent;
+    uint32_t _statPushAcked;
+    uint32_t _statPullResp;
+    uint32_t _statTxDone;
+
+    void readDatagrams(unsigned long now);
+    void handlePushAck(uint16_t token, unsigned long now);
+    void handlePullResp(uint16_t token, const char* json, size_t length);
+    void checkTimeouts(unsigned long now);
+    size_t writeHeader(uint8_t type, uint16_t token);
+    bool sendDatagram(size_t length);
+    uint16_t takeToken();
+};
+
+#endif // SEMTECH_FORWARDER_H
@@ -0,0 +1,187 @@
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "protocol.h"
+#include "gateway_stats.h"
+#include "uplink_queue.h"
+
+// ============================================
+// UPLINK SERIAL BINARIO (UPLINK_TRANSPORT_SERIAL)
+// ============================================
+//
+// Para gateways ao lado de um PC industrial, sem WiFi: leituras
+// decodificadas e status saem como registros binarios pela UART do debug,
+// lidos pela ponte no host (tools/serial_bridge.cpp), que repassa ao
+// servidor e confirma cada leitura com um ACK.
+//
+// Quadro na linha: 0x00, COBS(registro + CRC), 0x00. O COBS tira todos os
+// zeros do registro, entao o 0x00 so aparece como delimitador: a ponte
+// ressincroniza no proximo zero e o texto de debug entre dois quadros
+// vira um segmento sem CRC valido (mostrado como log).
+//
+// Registro (little-endian):
+//   [0]     tipo
+//   [1..2]  seq do registro (ACK devolve o mesmo seq)
+//   [3..]   corpo
+//   [fim]   CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) de tipo..corpo
+//
+// SERIAL_RECORD_READING (confirmado pela ponte):
+//   u32 rx_ms, u32 seq do no, i16 rssi, i16 snr * 10, i32 freq_err (Hz),
+//   u8 sf, u8 len + id do no, u8 len + tipo do no, u16 len + "data" (JSON)
+// SERIAL_RECORD_STATUS (sem ACK):
+//   u8 len + id do gateway, u8 N, N x u32 na ordem de SerialStatusField
+// SERIAL_RECORD_HELLO (no boot, sem ACK):
+//   u8 versao, u8 len + id do gateway
+// SERIAL_RECORD_ACK (ponte -> gateway): sem corpo, seq = leitura confirmada
+//
+// Leitura sem ACK no prazo volta com o mesmo seq do primeiro envio: a
+// ponte reconhece a repeticao (tambem pelo no, seq do no e rx_ms) e so
+// confirma de novo, sem repassar a leitura ao servidor outra vez.
+//
+// Cada quadro pronto vai para um anel de SERIAL_LINK_RING_SIZE posicoes e
+// so e escrito inteiro, quando o driver da UART tem espaco para ele
+// (availableForWrite); com CTS/RTS configurados o driver tambem respeita o
+// controle de fluxo do host. Nada bloqueia: sem espaco, o quadro espera o
+// proximo poll().
+
+#define SERIAL_LINK_VERSION 1
+
+#define SERIAL_RECORD_READING 0x01
+#define SERIAL_RECORD_STATUS  0x02
+#define SERIAL_RECORD_HELLO   0x03
+#define SERIAL_RECORD_ACK     0x81
+
+// Registro + CRC com o pior caso do COBS (1 byte a cada 254) e delimitadores
+#define SERIAL_LINK_FRAME_MAX (SERIAL_LINK_RECORD_MAX + 2 + (SERIAL_LINK_RECORD_MAX + 2) / 254 + 3)
+#define SERIAL_LINK_RX_FRAME_MAX 32      // Quadros da ponte (so ACKs)
+
+// Campos u32 do SERIAL_RECORD_STATUS (novos campos so no fim)
+enum SerialStatusField {
+    SERIAL_STATUS_UPTIME_S,
+    SERIAL_STATUS_PACKETS_RX,
+    SERIAL_STATUS_PACKETS_FWD,
+    SERIAL_STATUS_PACKETS_ERR,
+    SERIAL_STATUS_PACKETS_DUP,
+    SERIAL_STATUS_QUEUE_DEPTH,
+    SERIAL_STATUS_QUEUE_REJECTED,
+    SERIAL_STATUS_ACK_AVG_MS,
+    SERIAL_STATUS_ACK_MAX_MS,
+    SERIAL_STATUS_ACK_AIRTIME_MS,
+    SERIAL_STATUS_ACK_AIRTIME_SINGLE_MS,
+    SERIAL_STATUS_CMD_DELIVERED,
+    SERIAL_STATUS_CMD_FAILED,
+    SERIAL_STATUS_CMD_AVG_LATENCY_MS,
+    SERIAL_STATUS_CHANNEL_UTIL_PERMILLE,
+    SERIAL_STATUS_TX_UTIL_PERMILLE,
+    SERIAL_STATUS_TX_BLOCKED,
+    SERIAL_STATUS_ADR_ADJUSTMENTS,
+    SERIAL_STATUS_ADR_REVERTS,
+    SERIAL_STATUS_LINKS_DEGRADED,
+    SERIAL_STATUS_CONFIG_APPLIED,
+    SERIAL_STATUS_CONFIG_ROLLBACKS,
+    SERIAL_STATUS_FREE_HEAP,
+    SERIAL_STATUS_MIN_FREE_HEAP,
+    SERIAL_STATUS_LARGEST_FREE_BLOCK,
+    SERIAL_STATUS_LINK_FRAMES,
+    SERIAL_STATUS_LINK_ACKS,
+    SERIAL_STATUS_LINK_TIMEOUTS,
+    SERIAL_STATUS_LINK_BAD_FRAMES,
+    SERIAL_STATUS_LINK_TX_STALLS,
+    SERIAL_STATUS_LINK_ACK_RTT_MS,
+    SERIAL_STATUS_LINK_HANDOFF_US,
+    SERIAL_STATUS_LINK_HANDOFF_MAX_US,
+    SERIAL_STATUS_FIELD_COUNT
+};
+
+struct SerialFrame {
+    uint16_t length;
+    uint32_t queuedAtUs;        // micros() da montagem (handoff)
+    uint8_t data[SERIAL_LINK_FRAME_MAX];
+};
+
+struct SerialInflight {
+    uint16_t seq;               // 0 = vaga livre
+    unsigned long sentAt;
+};
+
+typedef void (*SerialAckCallback)(uint16_t seq, bool acked);
+
+class SerialLink {
+public:
+    SerialLink();
+
+    // Configura a UART (velocidade, buffers, CTS/RTS) e envia o HELLO
+    void begin(HardwareSerial& serial);
+
+    void setAckCallback(SerialAckCallback callback) { _ackCallback = callback; }
+
+    // Escreve os quadros que cabem na UART, le ACKs e vence timeouts
+    void poll(unsigned long now);
+
+    bool canSend() const {
+        return _serial && _ringCount < SERIAL_LINK_RING_SIZE && _inflightCount < SERIAL_LINK_MAX_INFLIGHT;
+    }
+
+    // Registro da leitura decodificada; retorna o seq (0 = nao coube).
+    // Reenvio (entry.linkSeq) repete o seq do primeiro envio
+    uint16_t sendReading(const UplinkEntry& entry, const SensorData& sensorData);
+
+    // Status periodico (sem ACK; descartado se o anel estiver cheio)
+    bool sendStatus(const GatewayStats& gatewayStats);
+
+    // Estatisticas
+    uint32_t getFramesSent() const { return _framesSent; }
+    uint32_t getAcked() const { return _acked; }
+    uint8_t getInflight() const { return _inflightCount; }
+    uint32_t getAvgRttMs() const { return _acked > 0 ? (uint32_t)(_rttTotal / _acked) : 0; }
+    uint32_t getAvgHandoffUs() const {
+        return _framesSent > 0 ? (uint32_t)(_handoffTotalUs / _framesSent) : 0;
+    }
+    uint32_t getMaxHandoffUs() const { return _handoffMaxUs; }
+
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    HardwareSerial* _serial;
+
+    SerialFrame _ring[SERIAL_LINK_RING_SIZE];
+    uint8_t _ringHead;
+    uint8_t _ringCount;
+
+    SerialInflight _inflight[SERIAL_LINK_MAX_INFLIGHT];
+    uint8_t _inflightCount;
+    uint16_t _nextSeq;
+
+    uint8_t _record[SERIAL_LINK_RECORD_MAX + 2];
+    uint8_t _rx[SERIAL_LINK_RX_FRAME_MAX];
+    size_t _rxLength;
+    bool _rxOverflow;
+
+    SerialAckCallback _ackCallback;
+
+    // Estatisticas
+    uint32_t _framesSent;
+    uint32_t _bytesSent;
+    uint32_t _acked;
+    uint32_t _timeouts;
+    uint32_t _badFrames;
+    uint32_t _txStalls;         // poll() com quadro pronto e UART sem espaco
+    uint32_t _ringFull;         // Status descartados com o anel cheio
+    uint64_t _rttTotal;
+    uint32_t _rttMax;
+    uint64_t _handoffTotalUs;
+    uint32_t _handoffMaxUs;
+
+    void drainRing();
+    void readFrames(unsigned long now);
+    void handleFrame(const uint8_t* frame, size_t length, unsigned long now);
+    void handleAck(uint16_t seq, unsigned long now);
+    void checkTimeouts(unsigned long now);
+    bool enqueue(size_t recordLength);
+    uint16_t takeSeq();
+};
+
+#endif // SERIAL_LINK_H
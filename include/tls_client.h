@@ -0,0 +1,138 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <ArduinoJson.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/x509_crt.h>
+#include "config.h"
+#include "fixed_string.h"
+
+// ============================================
+// CLIENTE TLS COM RETOMADA DE SESSAO (SERVER_TLS)
+// ============================================
+//
+// WiFiClient com TLS (mbedTLS direto) para o HTTPClient, no lugar do
+// WiFiClientSecure, que refaz o handshake completo a cada conexao e
+// reinterpreta o certificado a cada begin().
+//
+// Tudo que e caro e feito uma vez em begin(): o CA (TLS_CA_FILE no
+// LittleFS) e interpretado, o DRBG e semeado e a mbedtls_ssl_config e o
+// contexto SSL (com os buffers de registro) sao montados. Cada conexao so
+// faz session_reset no mesmo contexto.
+//
+// Apos cada handshake a sessao (ID e, se o servidor emitir, ticket) e
+// guardada; a proxima conexao ao mesmo host:porta a oferece e, se o
+// servidor aceitar, o handshake abreviado pula o certificado e a troca de
+// chaves. A conexao fica aberta entre requisicoes (HTTPClient com
+// setReuse), entao a retomada so entra depois de o servidor fechar.
+//
+// Tempo de cripto = tempo dentro das chamadas mbedtls menos o tempo de
+// E/S no socket (callbacks de BIO); somado por requisicao entre
+// beginRequest() e endRequest().
+
+class TlsClient : public WiFiClient {
+public:
+    TlsClient();
+    ~TlsClient();
+
+    // Carrega o CA e monta a configuracao TLS (uma vez, no boot)
+    bool begin();
+    bool isReady() const { return _ready; }
+
+    // Client: TCP + handshake TLS
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeout) override;
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeout) override;
+
+    // Client: dados da aplicacao (decifrados)
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+
+    // Conexao aberta com este servidor (varios servidores de uplink)
+    bool isConnectedTo(const char* host, uint16_t port);
+
+    // Contabilidade por requisicao HTTP (reuso da conexao, tempo de cripto)
+    void beginRequest();
+    void endRequest();
+
+    // Estatisticas
+    uint32_t getFullHandshakes() const { return _fullHandshakes; }
+    uint32_t getResumedHandshakes() const { return _resumedHandshakes; }
+    uint32_t getFailures() const { return _failures; }
+    uint8_t getResumptionRate() const {
+        uint32_t total = _fullHandshakes + _resumedHandshakes;
+        return total > 0 ? (uint8_t)(_resumedHandshakes * 100 / total) : 0;
+    }
+    uint32_t getReusedRequests() const { return _reusedRequests; }
+    uint32_t getRequests() const { return _requests; }
+    uint32_t getAvgCryptoUs() const {
+        return _requests > 0 ? (uint32_t)(_cryptoTotalUs / _requests) : 0;
+    }
+    uint32_t getMaxCryptoUs() const { return _cryptoMaxUs; }
+
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    bool _ready;
+    bool _tlsConnected;
+    int _peeked;                // Byte lido por peek() (-1 = nenhum)
+
+    mbedtls_ssl_context _ssl;
+    mbedtls_ssl_config _conf;
+    mbedtls_x509_crt _ca;
+    mbedtls_entropy_context _entropy;
+    mbedtls_ctr_drbg_context _drbg;
+
+    // Sessao do ultimo handshake (oferecida na proxima conexao)
+    mbedtls_ssl_session _session;
+    bool _hasSession;
+    HostName _sessionHost;
+    uint16_t _sessionPort;
+
+    // Servidor da conexao atual
+    HostName _peerHost;
+    uint16_t _peerPort;
+
+    uint32_t _verifyCalls;      // Zero apos o handshake = sessao retomada
+    uint32_t _ioUs;             // Tempo nos callbacks de BIO (descontado)
+    uint32_t _requestCryptoUs;
+    bool _requestReused;
+
+    // Estatisticas
+    uint32_t _fullHandshakes;
+    uint32_t _resumedHandshakes;
+    uint32_t _failures;
+    uint64_t _fullHandshakeTotalMs;
+    uint64_t _resumedHandshakeTotalMs;
+    uint32_t _requests;
+    uint32_t _reusedRequests;
+    uint64_t _cryptoTotalUs;
+    uint32_t _cryptoMaxUs;
+    int _lastError;
+
+    bool handshake(const char* host, uint16_t port);
+    void saveSession(const char* host, uint16_t port);
+    void clearSession();
+    void logError(const char* step, int ret);
+
+    uint32_t cryptoStart() const { return micros() - _ioUs; }
+    void cryptoEnd(uint32_t start) { _requestCryptoUs += (micros() - _ioUs) - start; }
+
+    static int bioSend(void* ctx, const unsigned char* buf, size_t len);
+    static int bioRecv(void* ctx, unsigned char* buf, size_t len);
+    static int verifyCallback(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
+};
+
+#endif // TLS_CLIENT_H
@@ -0,0 +1,73 @@
+#ifndef UPLINK_BODY_H
+#define UPLINK_BODY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "uplink_queue.h"
+#include "protocol.h"
+
+// ============================================
+// CORPO DO LOTE HTTP EM FLUXO (UPLINK_COMPRESSION = 0)
+// ============================================
+//
+// Sem compressao o corpo do POST nunca existe inteiro na memoria. O
+// Content-Length e a soma dos tamanhos medidos (measureJson) de cada
+// leitura; o HTTPClient le este Stream em blocos e escreve cada bloco
+// direto no socket. Cada leitura so e montada quando o HTTPClient chega
+// nela, em um buffer do tamanho de uma leitura.
+//
+// Em MessagePack o lote e um fixarray (ate 15 leituras) sem separadores.
+//
+// Entre medir e enviar uma leitura pode mudar (resumo de enlace
+// atualizado pela recepcao): menor, em JSON, e completada com espacos;
+// maior, ou menor em MessagePack (sem espaco em branco), o envio e
+// abortado (available() = -1) e o POST falha como qualquer outro.
+
+static_assert(UPLINK_HTTP_BATCH_MAX <= 15, "Lote maior que um fixarray do MessagePack");
+
+// Escreve o payload da leitura em out, sem terminador (out = nullptr so
+// mede); retorna o tamanho ou 0 se nao montar ou nao couber em capacity
+typedef size_t (*UplinkRenderFn)(const UplinkEntry& entry, uint8_t format, char* out,
+                                 size_t capacity);
+
+class UplinkBodyStream : public Stream {
+public:
+    explicit UplinkBodyStream(UplinkRenderFn render);
+
+    // Novo lote: [leitura, leitura, ...] (PayloadFormat)
+    void clear(uint8_t format = PAYLOAD_FORMAT_JSON);
+    // Mede e inclui a leitura; false se ela nao montar (fica de fora)
+    bool add(UplinkEntry* entry);
+
+    uint8_t getCount() const { return _count; }
+    size_t getLength() const { return _length; }    // Content-Length
+    bool failed() const { return _failed; }
+
+    // Stream (somente leitura)
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    size_t write(uint8_t) override { return 0; }
+    void flush() override {}
+
+private:
+    UplinkRenderFn _render;
+    uint8_t _format;
+    UplinkEntry* _entries[UPLINK_HTTP_BATCH_MAX];
+    uint16_t _lengths[UPLINK_HTTP_BATCH_MAX];
+    uint8_t _count;
+    size_t _length;
+
+    // Posicao da leitura: separador + uma leitura por vez
+    char _chunk[UPLINK_PAYLOAD_MAX_LEN + 1];
+    uint16_t _chunkPos;
+    uint16_t _chunkLen;
+    uint8_t _next;              // Proxima leitura a montar (_count = fim)
+    size_t _sent;
+    bool _failed;
+
+    bool refill();
+};
+
+#endif // UPLINK_BODY_H
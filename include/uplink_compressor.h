@@ -0,0 +1,106 @@
+#ifndef UPLINK_COMPRESSOR_H
+#define UPLINK_COMPRESSOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ============================================
+// COMPRESSAO DOS LOTES DE UPLINK (UPLINK_COMPRESSION)
+// ============================================
+//
+// Os lotes de leituras repetem as mesmas chaves, ids de no e de gateway;
+// o corpo do POST vai comprimido como zlib (Content-Encoding: deflate),
+// que o servidor abre com zlib.decompress.
+//
+// Compressor proprio, sem alocacao: LZ77 sobre o corpo inteiro (o lote
+// cabe na janela de 32 KB) e um unico bloco com os codigos Huffman fixos
+// do deflate. A tabela de hash e as cadeias usam ~10 KB estaticos; o
+// miniz do ROM so traz o descompressor.
+//
+// Niveis: 0 = sem compressao, 1..3 = ate 1, 4 ou 32 candidatos por
+// posicao. O nivel de cada lote e o de menor custo estimado:
+//   custo(n) = us de CPU por byte(n) * tamanho
+//            + tamanho * razao(n) * us de envio por byte
+// com CPU e razao medidas por nivel (media movel) e o custo de envio por
+// byte medido nos POSTs: inclinacao da duracao em funcao do tamanho do
+// corpo (regressao linear com medias moveis), que separa o RTT fixo do
+// tempo de transmissao.
+// Niveis sem amostra sao testados primeiro e um vizinho do melhor e
+// testado a cada UPLINK_COMPRESS_EXPLORE_EVERY lotes.
+
+#define UPLINK_COMPRESS_LEVELS 4
+
+struct CompressionLevelStats {
+    uint32_t samples;
+    float usPerByte;            // CPU por byte de entrada
+    float ratio;                // Bytes comprimidos / bytes de entrada
+};
+
+class UplinkCompressor {
+public:
+    UplinkCompressor();
+
+    // Comprime o corpo; retorna o tamanho em output() ou 0 para enviar
+    // sem compressao (corpo pequeno, nivel 0 ou sem ganho)
+    size_t compress(const uint8_t* data, size_t length);
+    const uint8_t* output() const { return _out; }
+
+    // POST concluido com bytes no corpo (mede o custo de envio por byte)
+    void recordTransfer(size_t bytes, uint32_t durationUs);
+
+    // Estatisticas
+    uint8_t getLastLevel() const { return _lastLevel; }
+    uint32_t getBytesIn() const { return _bytesIn; }
+    uint32_t getBytesOut() const { return _bytesOut; }
+    float getRatio() const { return _bytesOut > 0 ? (float)_bytesIn / _bytesOut : 1.0f; }
+    uint32_t getUsPerKb() const {
+        return _compressedIn > 0 ? (uint32_t)(_compressUsTotal * 1024 / _compressedIn) : 0;
+    }
+    float getTxUsPerByte() const { return _txUsPerByte; }
+
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    uint8_t _out[UPLINK_BATCH_BUFFER_SIZE];
+    uint16_t _head[1 << UPLINK_COMPRESS_HASH_BITS];
+    uint16_t _prev[UPLINK_BATCH_BUFFER_SIZE];
+
+    // Escrita de bits (LSB primeiro, como o deflate)
+    uint8_t* _pos;
+    uint8_t* _end;
+    uint32_t _bitBuffer;
+    uint8_t _bitCount;
+    bool _overflow;
+
+    CompressionLevelStats _levels[UPLINK_COMPRESS_LEVELS];
+    uint32_t _batches;
+    uint8_t _lastLevel;
+    bool _exploreUp;
+
+    // Regressao duracao x tamanho dos POSTs (medias moveis)
+    float _txUsPerByte;
+    float _txMeanBytes;
+    float _txMeanUs;
+    float _txVarBytes;
+    float _txCovBytesUs;
+    uint32_t _transfers;
+
+    // Estatisticas
+    uint32_t _bytesIn;
+    uint32_t _bytesOut;
+    uint64_t _compressUsTotal;
+    uint64_t _compressedIn;     // Bytes de entrada que passaram pelo compressor
+
+    uint8_t chooseLevel(size_t length);
+    float estimateCost(uint8_t level, size_t length) const;
+    size_t deflate(const uint8_t* data, size_t length, uint8_t level);
+
+    void putBits(uint32_t value, uint8_t count);
+    void putCode(uint16_t code, uint8_t count);
+    void putSymbol(uint16_t symbol);
+    void putMatch(size_t length, size_t distance);
+    void putByte(uint8_t value);
+};
+
+#endif // UPLINK_COMPRESSOR_H
@@ -0,0 +1,146 @@
+#ifndef UPLINK_QUEUE_H
+#define UPLINK_QUEUE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "fixed_string.h"
+#include "protocol.h"
+
+// ============================================
+// FILA LOCAL DE UPLINK (GATEWAY -> SERVIDOR)
+// ============================================
+//
+// Fila de tamanho fixo (PACKET_QUEUE_SIZE) com as leituras aceitas e
+// ainda nao entregues ao servidor. Guarda o quadro LoRa original e os
+// metadados de RF; o payload do servidor e montado apenas no momento do
+// envio.
+//
+// Cada leitura tem uma classe de prioridade (UPLINK_PRIORITY_RULES) e a
+// ordem da fila (front/at) e por classe e, dentro dela, por chegada: um
+// evento que chega depois de uma queda passa na frente do acumulado de
+// leituras periodicas. As entradas ficam em posicoes fixas (ponteiros
+// continuam validos) e so a ordem e reorganizada.
+//
+// Sob pressao, as periodicas cedem lugar:
+// - a partir de UPLINK_COALESCE_DEPTH leituras, uma periodica nova
+//   substitui as periodicas ainda nao enviadas do mesmo no (so a mais
+//   recente fica);
+// - com a fila cheia, a periodica mais antiga ainda nao enviada e
+//   descartada para aceitar a nova leitura.
+// Sem periodica para ceder, a leitura nova e recusada (e o no nao recebe
+// ACK, entao retransmite).
+//
+// Falhas de envio nao descartam uma leitura ja confirmada ao no (ACK na
+// recepcao, ACK_POLICY_ON_ENQUEUE): ela tenta de novo com espera crescente
+// (retryDelay) ate ser entregue ou despejada pela pressao da fila acima
+// (METRIC_UPLINK_EVICTED). So as leituras sem ACK (fim-a-fim, ou copias
+// para outro servidor) desistem apos UPLINK_MAX_ATTEMPTS.
+
+enum UplinkClass {
+    UPLINK_CLASS_EVENT,         // Mudanca de estado (DI, alarme)
+    UPLINK_CLASS_NORMAL,        // Sem regra especifica
+    UPLINK_CLASS_PERIODIC,      // Telemetria periodica (pode ser descartada)
+    UPLINK_CLASS_COUNT
+};
+
+struct UplinkEntry {
+    LoRaPayload payload;        // Quadro LoRa original (JSON do no)
+    NodeId nodeId;
+    uint32_t sequence;
+    int rssi;
+    float snr;
+    long freqError;             // Erro de frequencia do quadro (Hz)
+    uint8_t sf;                 // SF em que o quadro chegou (ACK vai no mesmo)
+    uint8_t priority;           // UplinkClass
+    unsigned long rxTime;       // millis() da recepcao
+    unsigned long nextAttempt;  // millis() da proxima tentativa de envio
+    uint8_t attempts;
+    uint16_t sendId;            // Envio aguardando confirmacao (0 = nao enviado):
+                                // packet id MQTT ou token do PUSH_DATA
+    uint16_t linkSeq;           // Seq do registro serial (reenvio usa o mesmo; 0 = nenhum)
+    bool completed;             // Entregue (ou descartada) fora da ordem da fila
+    bool mirror;                // Copia para outro servidor (UPLINK_POLICY_MIRROR): sem ACK
+};
+
+struct UplinkClassStats {
+    uint8_t depth;
+    uint32_t enqueued;
+    uint32_t delivered;
+    uint32_t coalesced;         // Substituidas por uma leitura mais nova do mesmo no
+    uint32_t shed;              // Descartadas com a fila cheia
+    uint32_t evicted;           // Ja confirmadas ao no e removidas sem entrega
+    uint64_t latencyTotalMs;    // Recepcao ate a confirmacao do servidor
+    uint32_t latencyMaxMs;
+};
+
+// Leitura ainda nao confirmada ao no removida pela pressao da fila
+typedef void (*UplinkDropCallback)(const UplinkEntry& entry);
+
+class UplinkQueue {
+public:
+    UplinkQueue();
+
+    // Comum a todas as filas (uma por servidor no HTTP)
+    static void setDropCallback(UplinkDropCallback callback) { _dropCallback = callback; }
+
+    // Classe da leitura pela primeira regra que casar (UPLINK_PRIORITY_RULES)
+    static uint8_t classify(const SensorData& sensorData);
+
+    // Leitura ja confirmada ao no: nunca desiste por numero de tentativas
+    static bool isAcked(const UplinkEntry& entry);
+    // Espera ate a proxima tentativa apos attempts falhas
+    static unsigned long retryDelay(uint8_t attempts);
+
+    // Enfileira na posicao da classe; retorna false se nao houver lugar
+    bool push(const UplinkEntry& entry);
+
+    // Entrada de maior prioridade (nullptr se vazia)
+    UplinkEntry* front();
+    const UplinkEntry* front() const;
+    void pop();
+
+    // Entrada na posicao index na ordem de envio (prioridade, chegada)
+    UplinkEntry* at(uint8_t index);
+    const UplinkEntry* at(uint8_t index) const;
+
+    // Remove as entradas ja marcadas como completed (em qualquer posicao)
+    void popCompleted();
+
+    // Leitura confirmada pelo servidor (latencia por classe)
+    void recordDelivered(const UplinkEntry& entry, unsigned long now);
+
+    // Estado
+    uint8_t size() const { return _count; }
+    bool isEmpty() const { return _count == 0; }
+    bool isFull() const { return _count >= PACKET_QUEUE_SIZE; }
+
+    // Estatisticas
+    uint32_t getRejected() const { return _rejected; }
+    uint8_t getHighWater() const { return _highWater; }
+    const UplinkClassStats& getClassStats(uint8_t priority) const { return _classes[priority]; }
+    static const char* className(uint8_t priority);
+
+    void appendTelemetry(JsonArray classes) const;
+
+private:
+    UplinkEntry _entries[PACKET_QUEUE_SIZE];
+    uint8_t _order[PACKET_QUEUE_SIZE];  // Posicoes em _entries, na ordem de envio
+    uint8_t _count;
+    uint8_t _highWater;
+    uint32_t _rejected;
+
+    UplinkClassStats _classes[UPLINK_CLASS_COUNT];
+
+    static UplinkDropCallback _dropCallback;
+
+    // Indice em _order da periodica ainda nao enviada (mesmo no, ou a mais
+    // antiga com nodeId nullptr); -1 se nao houver
+    int findPeriodic(const NodeId* nodeId) const;
+    void removeAt(uint8_t index);
+    // Remocao pela pressao da fila (substituida ou descartada)
+    void evictAt(uint8_t index);
+    uint8_t freeSlot() const;
+};
+
+#endif // UPLINK_QUEUE_H
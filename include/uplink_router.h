@@ -0,0 +1,118 @@
+#ifndef UPLINK_ROUTER_H
+#define UPLINK_ROUTER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "fixed_string.h"
+#include "uplink_queue.h"
+#include "batch_controller.h"
+#include "protocol.h"
+
+// ============================================
+// VARIOS SERVIDORES DE UPLINK (UPLINK_TRANSPORT_HTTP)
+// ============================================
+//
+// O servidor da configuracao (SERVER_HOST ou /api/config) e o primeiro da
+// lista; UPLINK_EXTRA_ENDPOINTS acrescenta os demais. Cada servidor tem a
+// propria fila, o proprio controle de lotes (AIMD) e um disjuntor: um
+// servidor lento ou fora do ar nao segura a fila dos outros.
+//
+// Nota de saude = RTT medio + taxa de erros x UPLINK_HEALTH_ERROR_WEIGHT_MS
+// (menor e melhor). O disjuntor abre apos UPLINK_BREAKER_FAILURES falhas
+// seguidas; depois de UPLINK_BREAKER_OPEN_MS, uma requisicao de teste
+// (meio aberto) fecha ou reabre.
+//
+// Politicas (UPLINK_POLICY):
+// - FAILOVER: cada leitura vai ao primeiro servidor disponivel na ordem da
+//   lista; quando um disjuntor abre, as leituras da fila dele passam ao
+//   proximo;
+// - ROUND_ROBIN: as leituras se alternam entre os servidores disponiveis;
+// - MIRROR: cada leitura vai a todos os servidores. A copia do servidor de
+//   melhor nota e a que confirma a leitura (ACK); as demais sao copias
+//   (mirror) que so entregam.
+// Uma leitura que esgota as tentativas em um servidor passa a outro
+// disponivel; sem outro, fica na fila (UplinkQueue::isAcked) ou e
+// descartada (sem ACK ao no).
+//
+// Formato (UPLINK_MSGPACK): cada servidor recebe JSON ate responder com
+// Accept-Post contendo application/msgpack; um 415 volta ao JSON.
+
+#define UPLINK_ENDPOINT_COUNT_ENTRY(endpointHost, endpointPort) + 1
+#define UPLINK_ENDPOINT_COUNT (1 UPLINK_EXTRA_ENDPOINTS(UPLINK_ENDPOINT_COUNT_ENTRY))
+
+enum BreakerState {
+    BREAKER_CLOSED,
+    BREAKER_OPEN,               // Sem envios ate openUntil
+    BREAKER_HALF_OPEN           // Uma requisicao de teste
+};
+
+struct UplinkEndpoint {
+    HostName host;
+    uint16_t port;
+    UplinkQueue queue;
+    BatchController batcher;
+
+    uint8_t format;             // PayloadFormat negociado
+    uint8_t breaker;            // BreakerState
+    uint8_t failures;           // Falhas seguidas
+    unsigned long openUntil;
+
+    // Estatisticas
+    uint32_t breakerOpens;
+    uint32_t delivered;         // Leituras aceitas (inclui copias)
+    uint32_t rerouted;          // Leituras passadas a outro servidor
+};
+
+class UplinkRouter {
+public:
+    UplinkRouter();
+
+    // Primeiro servidor (configuracao em tempo de execucao)
+    void setPrimary(const char* host, uint16_t port);
+
+    uint8_t getCount() const { return UPLINK_ENDPOINT_COUNT; }
+    UplinkEndpoint& getEndpoint(uint8_t index) { return _endpoints[index]; }
+    const UplinkEndpoint& getEndpoint(uint8_t index) const { return _endpoints[index]; }
+
+    // Enfileira pela politica; false se nenhum servidor aceitou a leitura
+    bool push(const UplinkEntry& entry, unsigned long now);
+
+    // Disjuntor fechado ou hora da requisicao de teste
+    bool canSend(uint8_t index, unsigned long now);
+
+    // Resultado do POST (alimenta o disjuntor e o controle de lotes)
+    void recordResult(uint8_t index, int httpStatus, uint32_t rttMs, uint8_t backlog,
+                      unsigned long now);
+
+    // Formato dos proximos lotes pela resposta (2xx ou 415) do servidor
+    void recordFormat(uint8_t index, int httpStatus, bool acceptsMsgPack);
+
+    // Passa a leitura a outro servidor disponivel; false se nao houver
+    bool reroute(uint8_t from, const UplinkEntry& entry, unsigned long now);
+
+    // Proximo prazo entre as filas (retentativa, lote ou teste do disjuntor)
+    bool nextWake(unsigned long& wakeAt) const;
+
+    // Estado
+    uint8_t size() const;
+    uint32_t getRejected() const { return _rejected; }
+    uint32_t getScore(uint8_t index) const;
+    static const char* breakerName(uint8_t state);
+
+    void appendTelemetry(JsonObject obj) const;
+
+private:
+    UplinkEndpoint _endpoints[UPLINK_ENDPOINT_COUNT];
+    uint8_t _next;              // Proximo servidor do round-robin
+    uint32_t _rejected;
+
+    bool isAvailable(uint8_t index, unsigned long now) const;
+    // Servidor para uma leitura nova (fora exclude); -1 se nenhum disponivel
+    int pick(unsigned long now, int exclude);
+    bool pushTo(uint8_t index, const UplinkEntry& entry);
+    void drain(uint8_t from, unsigned long now);
+    void publish() const;
+};
+
+#endif // UPLINK_ROUTER_H
@@ -6,6 +6,21 @@
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include "config.h"
+#include "json_arena.h"
+#include "fixed_string.h"
+#include "gateway_stats.h"
+#include "airtime_accountant.h"
+#include "lora_handler.h"
+#include "adr_engine.h"
+#include "link_quality.h"
+#include "runtime_config.h"
+#include "scheduler.h"
+#include "mqtt_client.h"
+#include "semtech_forwarder.h"
+#include "tls_client.h"
+#include "uplink_compressor.h"
+#include "uplink_queue.h"
+#include "uplink_router.h"
 
 // ============================================
 // SERVIDOR WEB PARA DASHBOARD DO GATEWAY LORA
@@ -17,24 +32,29 @@
 // Numero maximo de pacotes no historico
 #define MAX_PACKET_HISTORY 30
 
+// Tamanho do JSON serializado de cada pacote no historico
+#define PACKET_LOG_DATA_SIZE 192
+
 // Tempo para considerar dispositivo offline (ms)
 #define DEVICE_TIMEOUT_MS 300000  // 5 minutos
 
 // Estrutura para informacoes de dispositivo LoRa
 struct DeviceInfo {
-    String id;
-    String type;
+    NodeId id;
+    NodeType type;
     int rssi;
     float snr;
     uint32_t packets;
     unsigned long lastSeen;  // millis() do ultimo contato
+    LinkQuality link;        // Perda, RSSI/SNR, jitter e erro de frequencia
     bool active;
 };
 
 // Estrutura para historico de pacotes
+// Os dados ficam serializados em buffer fixo para nao alocar heap a cada pacote
 struct PacketLogEntry {
-    String nodeId;
-    JsonDocument data;
+    NodeId nodeId;
+    char data[PACKET_LOG_DATA_SIZE];
     int rssi;
     float snr;
     unsigned long timestamp;
@@ -48,16 +68,52 @@ public:
     bool begin();
 
     // Atualiza estatisticas (chamar do main.cpp)
-    void updateStats(uint32_t packetsRx, uint32_t packetsFwd, uint32_t packetsErr,
-                     int wifiRssi, unsigned long uptimeMs);
+    void updateStats(const GatewayStats& gatewayStats);
+
+    // Fonte do tempo no ar por no exibido em /api/stats
+    void setAirtimeAccountant(const AirtimeAccountant* accountant) { airtime = accountant; }
+
+    // Fonte das estatisticas da varredura multi-SF
+    void setLoRaHandler(const LoRaHandler* handler) { lora = handler; }
+
+    // Fonte do estado do ADR por no
+    void setAdrEngine(const AdrEngine* engine) { adr = engine; }
+
+    // Configuracao em tempo de execucao (GET/POST /api/config)
+    void setRuntimeConfig(RuntimeConfig* config) { runtimeConfig = config; }
+
+    // Tempo por tarefa e latencia do loop principal
+    void setScheduler(const Scheduler* loopScheduler) { scheduler = loopScheduler; }
+
+    // Sessao MQTT do uplink (UPLINK_TRANSPORT_MQTT)
+    void setMqttClient(const MqttClient* client) { mqtt = client; }
+
+    // Packet forwarder Semtech (UPLINK_TRANSPORT_SEMTECH)
+    void setSemtechForwarder(const SemtechForwarder* udpForwarder) { forwarder = udpForwarder; }
+
+    // Conexao HTTPS com o servidor (SERVER_TLS)
+    void setTlsClient(const TlsClient* client) { tls = client; }
+
+    // Compressao dos lotes de uplink HTTP (UPLINK_COMPRESSION)
+    void setUplinkCompressor(const UplinkCompressor* uplinkCompressor) { compressor = uplinkCompressor; }
+
+    // Servidores de uplink HTTP: filas, lotes e disjuntores (UPLINK_TRANSPORT_HTTP)
+    void setUplinkRouter(const UplinkRouter* router) { uplinkRouter = router; }
+
+    // Fila de uplink (profundidade e latencia por classe de prioridade)
+    void setUplinkQueue(const UplinkQueue* queue) { uplinkQueue = queue; }
 
     // Sincronizacao de tempo
     bool isTimeSynced() const { return timeSynced; }
     time_t getBootTime() const { return bootTime; }
 
     // Registra pacote recebido
-    void logPacket(const String& nodeId, const String& nodeType,
-                   const JsonDocument& data, int rssi, float snr);
+    void logPacket(StringView nodeId, StringView nodeType, uint32_t sequence,
+                   const JsonDocument& data, int rssi, float snr, long freqError);
+
+    // Qualidade de enlace do no (nullptr se desconhecido)
+    const LinkQuality* getLinkQuality(StringView nodeId) const;
+    uint8_t getDegradedLinks() const;
 
     // Getters para estatisticas
     uint32_t getDeviceCount() const;
@@ -68,11 +124,18 @@ private:
     uint16_t serverPort;
 
     // Estatisticas do gateway
-    uint32_t packetsReceived;
-    uint32_t packetsForwarded;
-    uint32_t packetsError;
-    int wifiRssi;
-    unsigned long uptimeMs;
+    GatewayStats stats;
+    const AirtimeAccountant* airtime;
+    const LoRaHandler* lora;
+    const AdrEngine* adr;
+    RuntimeConfig* runtimeConfig;
+    const Scheduler* scheduler;
+    const MqttClient* mqtt;
+    const SemtechForwarder* forwarder;
+    const TlsClient* tls;
+    const UplinkCompressor* compressor;
+    const UplinkQueue* uplinkQueue;
+    const UplinkRouter* uplinkRouter;
 
     // Lista de dispositivos
     DeviceInfo devices[MAX_DEVICES];
@@ -91,6 +154,11 @@ private:
     void handleStats(AsyncWebServerRequest* request);
     void handleDevices(AsyncWebServerRequest* request);
     void handleTimeSync(AsyncWebServerRequest* request);
+    void handleConfigGet(AsyncWebServerRequest* request);
+    void handleConfigBody(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                          size_t index, size_t total);
+    void handleConfigReset(AsyncWebServerRequest* request);
+    void handleMetrics(AsyncWebServerRequest* request);
     void handleNotFound(AsyncWebServerRequest* request);
 
     // Sincronizacao de tempo
@@ -98,9 +166,10 @@ private:
     time_t bootTime;  // Timestamp Unix do momento do boot
 
     // Utilitarios
-    int findDeviceIndex(const String& nodeId);
-    void updateDevice(const String& nodeId, const String& nodeType, int rssi, float snr);
-    void addPacketToHistory(const String& nodeId, const JsonDocument& data, int rssi, float snr);
+    int findDeviceIndex(StringView nodeId) const;
+    void updateDevice(StringView nodeId, StringView nodeType, uint32_t sequence,
+                      int rssi, float snr, long freqError);
+    void addPacketToHistory(StringView nodeId, const JsonDocument& data, int rssi, float snr);
     void cleanupInactiveDevices();
 };
 
@@ -5,6 +5,10 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include "config.h"
+#include "fixed_string.h"
+#if SERVER_TLS
+#include "tls_client.h"
+#endif
 
 // Estados da conexao WiFi
 enum WiFiState {
@@ -34,9 +38,33 @@ public:
     void checkConnection();
     void reconnect();
 
-    // Envio de dados HTTP
-    bool sendHTTPPost(const String& endpoint, const String& jsonPayload);
-    bool sendHTTPGet(const String& endpoint, String& response);
+    // Envio de dados HTTP (contentEncoding: corpo comprimido, ex. "deflate")
+    bool sendHTTPPost(const char* endpoint, StringView jsonPayload,
+                      const char* contentEncoding = nullptr);
+    // POST para outro servidor (varios servidores de uplink); contentType
+    // padrao application/json
+    bool sendHTTPPost(const char* host, uint16_t port, const char* endpoint,
+                      StringView jsonPayload, const char* contentEncoding = nullptr,
+                      const char* contentType = nullptr);
+    // Corpo lido de um Stream em blocos direto para o socket (Content-Length)
+    bool sendHTTPPost(const char* host, uint16_t port, const char* endpoint, Stream& body,
+                      size_t length, const char* contentType = nullptr);
+    bool sendHTTPGet(const char* endpoint, String& response);
+
+    // Ultima requisicao: codigo HTTP (<= 0 = sem resposta, erro do
+    // HTTPClient) e tempo do envio ate a resposta lida (ms)
+    int getLastHttpStatus() const { return _lastHttpStatus; }
+    uint32_t getLastRequestMs() const { return _lastRequestMs; }
+    // Resposta ao ultimo POST anunciou MessagePack (Accept-Post)
+    bool getLastAcceptsMsgPack() const { return _lastAcceptsMsgPack; }
+
+    // Servidor de destino (padrao SERVER_HOST:SERVER_PORT)
+    void setServer(const char* host, uint16_t port);
+
+#if SERVER_TLS
+    // Conexao HTTPS persistente (handshakes, retomadas, tempo de cripto)
+    const TlsClient* getTlsClient() const { return &_tls; }
+#endif
 
     // Callback para eventos (opcional)
     void setConnectedCallback(void (*callback)());
@@ -47,11 +75,26 @@ private:
     unsigned long _lastReconnectAttempt;
     String _ssid;
     String _password;
+    String _serverHost;
+    uint16_t _serverPort;
+    int _lastHttpStatus;
+    uint32_t _lastRequestMs;
+    bool _lastAcceptsMsgPack;
+
+#if SERVER_TLS
+    // Cliente e conexao reaproveitados entre requisicoes (keep-alive)
+    TlsClient _tls;
+    HTTPClient _http;
+#endif
 
     void (*_connectedCallback)();
     void (*_disconnectedCallback)();
 
     void updateState(WiFiState newState);
+    // data ou stream como corpo
+    bool post(const char* host, uint16_t port, const char* endpoint, const uint8_t* data,
+              Stream* stream, size_t length, const char* contentEncoding,
+              const char* contentType);
 };
 
 #endif // WIFI_HANDLER_H
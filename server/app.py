@@ -6,13 +6,22 @@ Compativel com Windows e Linux - Self Contained
 
 from flask import Flask, request, jsonify, render_template
 from flask_cors import CORS
+from werkzeug.serving import WSGIRequestHandler
 from datetime import datetime
 from tinydb import TinyDB, Query
 from tinydb.table import Document
 import threading
 import json
 import os
+import ssl
 import sys
+import zlib
+
+try:
+    import msgpack
+except ImportError:
+    # Sem o pacote msgpack o servidor so aceita JSON (e nao anuncia MessagePack)
+    msgpack = None
 
 # Obtem diretorio base da aplicacao
 if getattr(sys, 'frozen', False):
@@ -31,11 +40,26 @@ DATABASE_FILE = os.path.join(DATABASE_DIR, 'lora_data.json')
 HOST = '0.0.0.0'
 PORT = 8081
 
+# HTTPS opcional (gateway com SERVER_TLS=1): certificado e chave do servidor,
+# ex.: gerados por tools/make_dev_ca.sh
+TLS_CERT = os.environ.get('SERVER_TLS_CERT')
+TLS_KEY = os.environ.get('SERVER_TLS_KEY')
+
 # Banco de dados TinyDB
 db = None
 readings_table = None
 devices_table = None
 gateway_status_table = None
+commands_table = None
+
+# Leituras em MessagePack (Content-Type) quando o pacote msgpack existe; o
+# gateway passa a usar o formato ao ver Accept-Post nas respostas
+MSGPACK_TYPE = 'application/msgpack'
+ACCEPT_POST = 'application/json, ' + MSGPACK_TYPE if msgpack else 'application/json'
+
+# Comando despachado e nao relatado volta a ser entregue apos esse tempo
+# (ex.: gateway reiniciou e perdeu a fila)
+COMMAND_REDISPATCH_S = 900
 
 # Lock para acesso thread-safe ao banco de dados
 db_lock = threading.Lock()
@@ -43,7 +67,7 @@ db_lock = threading.Lock()
 
 def init_db():
     """Inicializa o banco de dados TinyDB"""
-    global db, readings_table, devices_table, gateway_status_table
+    global db, readings_table, devices_table, gateway_status_table, commands_table
 
     # Cria diretorio de dados se nao existir
     if not os.path.exists(DATABASE_DIR):
@@ -64,6 +88,7 @@ def init_db():
     readings_table = db.table('sensor_readings')
     devices_table = db.table('devices')
     gateway_status_table = db.table('gateway_status')
+    commands_table = db.table('commands')
 
     print(f"[DB] Banco de dados inicializado: {DATABASE_FILE}")
 
@@ -118,6 +143,102 @@ def safe_db_update(table, data, query):
             return None
 
 
+def is_msgpack_body():
+    """Corpo da requisicao em MessagePack (Content-Type)"""
+    return request.mimetype == MSGPACK_TYPE
+
+
+def read_json_body():
+    """
+    JSON (ou MessagePack) do corpo da requisicao, aceitando corpo comprimido
+    (Content-Encoding: deflate ou gzip, usado nos lotes do gateway)
+    """
+    encoding = request.headers.get('Content-Encoding', '').lower()
+    body = request.get_data()
+    if encoding in ('deflate', 'gzip'):
+        # wbits 47: detecta o cabecalho zlib ou gzip
+        body = zlib.decompress(body, 47)
+    if is_msgpack_body():
+        return msgpack.unpackb(body)
+    if encoding in ('deflate', 'gzip'):
+        return json.loads(body)
+    return request.get_json(silent=True)
+
+
+@app.before_request
+def reject_unsupported_body():
+    """MessagePack sem o pacote msgpack: 415 (o gateway volta ao JSON)"""
+    if request.method == 'POST' and is_msgpack_body() and msgpack is None:
+        return jsonify({"error": "MessagePack indisponivel (pip install msgpack)"}), 415
+    return None
+
+
+@app.after_request
+def advertise_formats(response):
+    """Anuncia os formatos aceitos nas leituras (negociacao do gateway)"""
+    if request.method == 'POST' and request.path.startswith('/api/sensor-data'):
+        response.headers['Accept-Post'] = ACCEPT_POST
+    return response
+
+
+def store_reading(data):
+    """Grava uma leitura encaminhada pelo gateway e atualiza o dispositivo"""
+    gateway_id = data.get('gateway_id', 'unknown')
+    node = data.get('node', {})
+    rf = data.get('rf', {})
+
+    node_id = node.get('id', 'unknown')
+    node_type = node.get('type', 'sensor')
+    sequence = node.get('seq', 0)
+    sensor_data = node.get('data', {})
+    rssi = rf.get('rssi', 0)
+    snr = rf.get('snr', 0.0)
+
+    now = datetime.now().isoformat()
+
+    # Insere leitura
+    safe_db_insert(readings_table, {
+        'gateway_id': gateway_id,
+        'node_id': node_id,
+        'node_type': node_type,
+        'sequence': sequence,
+        'data': sensor_data,
+        'rssi': rssi,
+        'snr': snr,
+        'freq_err': rf.get('freq_err', 0),
+        'link': rf.get('link', {}),
+        'received_at': now
+    })
+
+    # Atualiza ou insere dispositivo
+    Device = Query()
+    existing = safe_db_get(devices_table, Device.node_id == node_id)
+
+    if existing:
+        safe_db_update(devices_table, {
+            'node_type': node_type,
+            'gateway_id': gateway_id,
+            'last_seen': now,
+            'total_packets': existing.get('total_packets', 0) + 1,
+            'link': rf.get('link', {})
+        }, Device.node_id == node_id)
+    else:
+        safe_db_insert(devices_table, {
+            'node_id': node_id,
+            'node_type': node_type,
+            'gateway_id': gateway_id,
+            'first_seen': now,
+            'last_seen': now,
+            'total_packets': 1
+        })
+
+    # Log no console
+    print(f"[{datetime.now().strftime('%H:%M:%S')}] "
+          f"Gateway: {gateway_id} | Node: {node_id} | "
+          f"RSSI: {rssi} dBm | SNR: {snr} dB")
+    print(f"    Data: {json.dumps(sensor_data)}")
+
+
 @app.route('/api/sensor-data', methods=['POST'])
 def receive_sensor_data():
     """
@@ -139,65 +260,49 @@ def receive_sensor_data():
     }
     """
     try:
-        data = request.json
+        data = read_json_body()
 
         if not data:
             return jsonify({"error": "JSON invalido"}), 400
 
-        gateway_id = data.get('gateway_id', 'unknown')
-        node = data.get('node', {})
-        rf = data.get('rf', {})
+        store_reading(data)
 
-        node_id = node.get('id', 'unknown')
-        node_type = node.get('type', 'sensor')
-        sequence = node.get('seq', 0)
-        sensor_data = node.get('data', {})
-        rssi = rf.get('rssi', 0)
-        snr = rf.get('snr', 0.0)
+        return jsonify({"status": "ok", "message": "Dados recebidos"}), 200
 
-        now = datetime.now().isoformat()
+    except Exception as e:
+        print(f"[ERRO] {str(e)}")
+        return jsonify({"error": str(e)}), 500
 
-        # Insere leitura
-        safe_db_insert(readings_table, {
-            'gateway_id': gateway_id,
-            'node_id': node_id,
-            'node_type': node_type,
-            'sequence': sequence,
-            'data': sensor_data,
-            'rssi': rssi,
-            'snr': snr,
-            'received_at': now
-        })
 
-        # Atualiza ou insere dispositivo
-        Device = Query()
-        existing = safe_db_get(devices_table, Device.node_id == node_id)
+@app.route('/api/sensor-data/batch', methods=['POST'])
+def receive_sensor_data_batch():
+    """
+    Lote de leituras do gateway: lista de objetos no formato de
+    /api/sensor-data, normalmente comprimida (Content-Encoding: deflate)
+    """
+    try:
+        raw_size = request.content_length or 0
+        readings = read_json_body()
+
+        if not isinstance(readings, list):
+            return jsonify({"error": "Lote invalido (esperada uma lista)"}), 400
 
-        if existing:
-            safe_db_update(devices_table, {
-                'node_type': node_type,
-                'gateway_id': gateway_id,
-                'last_seen': now,
-                'total_packets': existing.get('total_packets', 0) + 1
-            }, Device.node_id == node_id)
-        else:
-            safe_db_insert(devices_table, {
-                'node_id': node_id,
-                'node_type': node_type,
-                'gateway_id': gateway_id,
-                'first_seen': now,
-                'last_seen': now,
-                'total_packets': 1
-            })
+        for data in readings:
+            store_reading(data)
 
-        # Log no console
-        print(f"[{datetime.now().strftime('%H:%M:%S')}] "
-              f"Gateway: {gateway_id} | Node: {node_id} | "
-              f"RSSI: {rssi} dBm | SNR: {snr} dB")
-        print(f"    Data: {json.dumps(sensor_data)}")
+        encoding = request.headers.get('Content-Encoding')
+        if encoding or is_msgpack_body():
+            plain_size = len(json.dumps(readings, separators=(',', ':')))
+            body_format = ' '.join(f for f in (request.mimetype, encoding) if f)
+            print(f"    Lote: {len(readings)} leituras, {raw_size} bytes {body_format} "
+                  f"(~{plain_size} em JSON sem compressao)")
 
-        return jsonify({"status": "ok", "message": "Dados recebidos"}), 200
+        return jsonify({"status": "ok", "received": len(readings)}), 200
 
+    except (zlib.error, ValueError) as e:
+        # msgpack.unpackb tambem levanta ValueError em corpo invalido
+        print(f"[ERRO] Lote ilegivel: {str(e)}")
+        return jsonify({"error": "Corpo ilegivel"}), 400
     except Exception as e:
         print(f"[ERRO] {str(e)}")
         return jsonify({"error": str(e)}), 500
@@ -220,8 +325,27 @@ def receive_gateway_status():
             'uptime_s': stats.get('uptime_s', 0),
             'packets_rx': stats.get('packets_rx', 0),
             'packets_fwd': stats.get('packets_fwd', 0),
+            'packets_err': stats.get('packets_err', 0),
+            'packets_dup': stats.get('packets_dup', 0),
+            'queue_depth': stats.get('queue_depth', 0),
+            'ack_avg_ms': stats.get('ack_avg_ms', 0),
+            'ack_airtime_ms': stats.get('ack_airtime_ms', 0),
+            'ack_airtime_single_ms': stats.get('ack_airtime_single_ms', 0),
+            'cmd_delivered': stats.get('cmd_delivered', 0),
+            'cmd_failed': stats.get('cmd_failed', 0),
+            'cmd_avg_latency_ms': stats.get('cmd_avg_latency_ms', 0),
+            'channel_util_pct': stats.get('channel_util_pct', 0),
+            'tx_util_pct': stats.get('tx_util_pct', 0),
+            'adr_adjustments': stats.get('adr_adjustments', 0),
+            'adr_reverts': stats.get('adr_reverts', 0),
+            'links_degraded': stats.get('links_degraded', 0),
+            'config_applied': stats.get('config_applied', 0),
+            'config_rollbacks': stats.get('config_rollbacks', 0),
             'wifi_rssi': stats.get('wifi_rssi', 0),
             'free_heap': stats.get('free_heap', 0),
+            'largest_free_block': stats.get('largest_free_block', 0),
+            'min_free_heap': stats.get('min_free_heap', 0),
+            'heap_frag_pct': stats.get('heap_frag_pct', 0),
             'received_at': datetime.now().isoformat()
         })
 
@@ -237,6 +361,170 @@ def receive_gateway_status():
         return jsonify({"error": str(e)}), 500
 
 
+@app.route('/api/commands', methods=['POST'])
+def create_command():
+    """
+    Enfileira um comando de downlink para um no
+    Formato esperado:
+    {
+        "node_id": "M001",
+        "cmd": "set_interval",
+        "params": { "interval_s": 60 }
+    }
+    """
+    try:
+        data = request.json
+
+        if not data or not data.get('node_id') or not data.get('cmd'):
+            return jsonify({"error": "Campos obrigatorios: node_id, cmd"}), 400
+
+        params = data.get('params', {})
+        if not isinstance(params, dict):
+            return jsonify({"error": "params deve ser um objeto"}), 400
+
+        command_id = safe_db_insert(commands_table, {
+            'node_id': data['node_id'],
+            'cmd': data['cmd'],
+            'params': params,
+            'status': 'pending',
+            'created_at': datetime.now().isoformat()
+        })
+
+        print(f"[{datetime.now().strftime('%H:%M:%S')}] "
+              f"Comando {command_id} ({data['cmd']}) para {data['node_id']}")
+
+        return jsonify({"status": "ok", "id": command_id}), 201
+
+    except Exception as e:
+        print(f"[ERRO] {str(e)}")
+        return jsonify({"error": str(e)}), 500
+
+
+@app.route('/api/commands', methods=['GET'])
+def get_commands():
+    """Lista comandos (params: node_id, status, limit)"""
+    node_id = request.args.get('node_id')
+    status = request.args.get('status')
+    limit = request.args.get('limit', 50, type=int)
+
+    commands = safe_db_read(commands_table)
+    if node_id:
+        commands = [c for c in commands if c.get('node_id') == node_id]
+    if status:
+        commands = [c for c in commands if c.get('status') == status]
+
+    commands.sort(key=lambda x: x.get('created_at', ''), reverse=True)
+
+    result = [dict(c, id=c.doc_id) for c in commands[:limit]]
+
+    return jsonify({
+        'count': len(result),
+        'commands': result
+    })
+
+
+@app.route('/api/commands/pending', methods=['GET'])
+def get_pending_commands():
+    """
+    Entrega comandos pendentes ao gateway (params: gateway_id, max)
+    Os comandos retornados passam para "dispatched".
+    """
+    gateway_id = request.args.get('gateway_id', 'unknown')
+    limit = request.args.get('max', 8, type=int)
+
+    now = datetime.now()
+    commands = []
+
+    for c in safe_db_read(commands_table):
+        status = c.get('status')
+        if status == 'dispatched':
+            try:
+                dispatched = datetime.fromisoformat(c.get('dispatched_at', ''))
+                if (now - dispatched).total_seconds() < COMMAND_REDISPATCH_S:
+                    continue
+            except ValueError:
+                pass
+        elif status != 'pending':
+            continue
+        commands.append(c)
+
+    commands.sort(key=lambda x: x.get('created_at', ''))
+    commands = commands[:max(limit, 0)]
+
+    if commands:
+        with db_lock:
+            commands_table.update({
+                'status': 'dispatched',
+                'gateway_id': gateway_id,
+                'dispatched_at': now.isoformat()
+            }, doc_ids=[c.doc_id for c in commands])
+
+    return jsonify({
+        'count': len(commands),
+        'commands': [{
+            'id': c.doc_id,
+            'node_id': c.get('node_id'),
+            'cmd': c.get('cmd'),
+            'params': c.get('params', {})
+        } for c in commands]
+    })
+
+
+@app.route('/api/commands/<int:command_id>/status', methods=['POST'])
+def report_command_status(command_id):
+    """
+    Recebe do gateway o resultado de um comando
+    Formato esperado:
+    {
+        "gateway_id": "GW001",
+        "node_id": "M001",
+        "status": "executed",   // ou "failed"
+        "attempts": 1,
+        "latency_ms": 31250,    // chegada ao gateway -> execucao
+        "exec_ms": 12           // tempo de execucao no no
+    }
+    """
+    try:
+        data = request.json
+
+        if not data:
+            return jsonify({"error": "JSON invalido"}), 400
+
+        with db_lock:
+            command = commands_table.get(doc_id=command_id)
+
+        if not command:
+            return jsonify({"error": "Comando nao encontrado"}), 404
+
+        now = datetime.now()
+        total_latency_ms = None
+        try:
+            created = datetime.fromisoformat(command.get('created_at', ''))
+            total_latency_ms = int((now - created).total_seconds() * 1000)
+        except ValueError:
+            pass
+
+        with db_lock:
+            commands_table.update({
+                'status': data.get('status', 'failed'),
+                'attempts': data.get('attempts', 0),
+                'gateway_latency_ms': data.get('latency_ms', 0),
+                'exec_ms': data.get('exec_ms', 0),
+                'total_latency_ms': total_latency_ms,
+                'completed_at': now.isoformat()
+            }, doc_ids=[command_id])
+
+        print(f"[{now.strftime('%H:%M:%S')}] "
+              f"Comando {command_id} para {command.get('node_id')}: "
+              f"{data.get('status')} | Latencia total: {total_latency_ms} ms")
+
+        return jsonify({"status": "ok"}), 200
+
+    except Exception as e:
+        print(f"[ERRO] {str(e)}")
+        return jsonify({"error": str(e)}), 500
+
+
 @app.route('/api/readings', methods=['GET'])
 def get_readings():
     """
@@ -392,11 +680,16 @@ def api_info():
         'database': 'TinyDB (JSON)',
         'endpoints': {
             'POST /api/sensor-data': 'Recebe dados dos sensores',
+            'POST /api/sensor-data/batch': 'Lote de leituras (JSON ou MessagePack; aceita Content-Encoding deflate/gzip)',
             'POST /api/gateway-status': 'Recebe status do gateway',
             'GET /api/readings': 'Lista leituras (params: node_id, gateway_id, limit)',
             'GET /api/devices': 'Lista dispositivos conhecidos',
             'GET /api/stats': 'Estatisticas gerais',
-            'GET /api/node/<node_id>/readings': 'Leituras de um no especifico'
+            'GET /api/node/<node_id>/readings': 'Leituras de um no especifico',
+            'POST /api/commands': 'Enfileira comando de downlink (node_id, cmd, params)',
+            'GET /api/commands': 'Lista comandos (params: node_id, status, limit)',
+            'GET /api/commands/pending': 'Comandos para o gateway (params: gateway_id, max)',
+            'POST /api/commands/<id>/status': 'Resultado do comando relatado pelo gateway'
         }
     })
 
@@ -416,13 +709,25 @@ def main():
     # Inicializa banco de dados
     init_db()
 
-    print(f"\n[SERVER] Iniciando em http://{HOST}:{PORT}")
-    print(f"[SERVER] Interface Web: http://localhost:{PORT}")
+    # HTTP/1.1: o gateway mantem a conexao aberta entre os POSTs (keep-alive)
+    WSGIRequestHandler.protocol_version = 'HTTP/1.1'
+
+    ssl_context = None
+    scheme = 'http'
+    if TLS_CERT and TLS_KEY:
+        # Tickets e cache de sessao do OpenSSL ficam ligados (padrao), entao
+        # as reconexoes do gateway retomam a sessao sem handshake completo
+        ssl_context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        ssl_context.load_cert_chain(TLS_CERT, TLS_KEY)
+        scheme = 'https'
+
+    print(f"\n[SERVER] Iniciando em {scheme}://{HOST}:{PORT}")
+    print(f"[SERVER] Interface Web: {scheme}://localhost:{PORT}")
     print(f"[SERVER] API endpoint: POST /api/sensor-data")
     print(f"[SERVER] Dados salvos em: {DATABASE_FILE}")
     print(f"[SERVER] Pressione Ctrl+C para parar\n")
 
-    app.run(host=HOST, port=PORT, debug=False, threaded=True)
+    app.run(host=HOST, port=PORT, debug=False, threaded=True, ssl_context=ssl_context)
 
 
 if __name__ == '__main__':
@@ -0,0 +1,163 @@
+#include "ack_scheduler.h"
+
+AckScheduler::AckScheduler(LoRaHandler& lora, Protocol& protocol)
+    : _lora(lora), _protocol(protocol),
+      _sentCount(0), _totalTurnaround(0),
+      _maxTurnaround(0), _lastTurnaround(0), _dropped(0),
+      _batchCount(0), _batchFlushAt(0), _batchRefTime(0), _batchDueTime(0), _batchSf(0), _batchSingleUs(0),
+      _ackedReadings(0), _airtimeUs(0), _singleAirtimeUs(0) {
+}
+
+bool AckScheduler::schedule(StringView nodeId, uint32_t sequence, bool success,
+                            unsigned long rxTime, unsigned long dueTime,
+                            const DownlinkCommand* command, uint8_t sf) {
+#if ACK_AGGREGATION
+    // Apenas ACKs positivos sem comando entram no quadro agregado
+    if (success && !command) {
+        LoRaPayload single = _protocol.createAck(nodeId, sequence, success);
+        addToBatch(nodeId, sequence, rxTime, dueTime, _lora.timeOnAirUs(single.length(), sf), sf);
+        return true;
+    }
+#endif
+
+    return enqueueSingle(nodeId, sequence, success, rxTime, dueTime, command, sf);
+}
+
+void AckScheduler::poll() {
+    if (_batchCount == 0) {
+        return;
+    }
+
+    if (_batchCount >= ACK_AGG_MAX_ENTRIES || (long)(millis() - _batchFlushAt) >= 0) {
+        flushBatch();
+    }
+}
+
+uint32_t AckScheduler::msUntilFlush(unsigned long now) const {
+    if (_batchCount == 0) {
+        return UINT32_MAX;
+    }
+
+    long remaining = (long)(_batchFlushAt - now);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+bool AckScheduler::enqueueSingle(StringView nodeId, uint32_t sequence, bool success,
+                                 unsigned long rxTime, unsigned long dueTime,
+                                 const DownlinkCommand* command, uint8_t sf) {
+    LoRaPayload frame = _protocol.createAck(nodeId, sequence, success, command);
+
+    if (!_lora.sendAt(frame, dueTime, LORA_TX_TAG_ACK, rxTime, LORA_TX_MAX_ATTEMPTS, sf)) {
+        _dropped++;
+        DEBUG_PRINTLN("[ACK] ERRO: Nao foi possivel agendar o ACK!");
+        return false;
+    }
+
+    uint32_t airtimeUs = _lora.timeOnAirUs(frame.length(), sf);
+    _ackedReadings++;
+    _airtimeUs += airtimeUs;
+    _singleAirtimeUs += airtimeUs;
+
+    return true;
+}
+
+void AckScheduler::addToBatch(StringView nodeId, uint32_t sequence,
+                              unsigned long rxTime, unsigned long dueTime, uint32_t singleUs,
+                              uint8_t sf) {
+    uint16_t hash = Protocol::hashNodeId(nodeId);
+
+    // Nos de outro SF nao escutam o quadro do lote atual
+    if (_batchCount > 0 && sf != _batchSf) {
+        flushBatch();
+    }
+
+    for (uint8_t i = 0; i < _batchCount; i++) {
+        if (_batch[i].nodeHash != hash) {
+            continue;
+        }
+
+        // Mesmo no ja no lote (retransmissao): confirma a sequencia mais recente
+        if (_batchNodes[i] == nodeId) {
+            _batch[i].sequence = sequence & 0xFFFF;
+            if ((long)(dueTime - _batchDueTime) > 0) {
+                _batchDueTime = dueTime;
+            }
+            return;
+        }
+
+        // Outro no com o mesmo hash16: no mesmo quadro um confirmaria a
+        // sequencia do outro; o lote atual sai e este comeca outro
+        DEBUG_PRINTF("[ACK] Colisao de hash %04X (%s x %.*s), enviando lote\n", hash,
+                     _batchNodes[i].c_str(), (int)nodeId.length(), nodeId.data());
+        flushBatch();
+        break;
+    }
+
+    if (_batchCount == 0) {
+        _batchFlushAt = dueTime + ACK_AGG_WINDOW_MS;
+        _batchRefTime = rxTime;
+        _batchDueTime = dueTime;
+        _batchSf = sf;
+        _batchSingleUs = 0;
+    }
+
+    _batchNodes[_batchCount].assign(nodeId);
+    AckEntry& entry = _batch[_batchCount++];
+    entry.nodeHash = hash;
+    entry.sequence = sequence & 0xFFFF;
+    _batchSingleUs += singleUs;
+    if ((long)(dueTime - _batchDueTime) > 0) {
+        _batchDueTime = dueTime;
+    }
+
+    if (_batchCount >= ACK_AGG_MAX_ENTRIES) {
+        flushBatch();
+    }
+}
+
+void AckScheduler::flushBatch() {
+    LoRaPayload frame = _protocol.createAggregatedAck(_batch, _batchCount);
+    uint8_t count = _batchCount;
+    _batchCount = 0;
+
+    // Flush antecipado (lote cheio, colisao, troca de SF): o ultimo no pode
+    // ainda nao estar em RX; o quadro espera o prazo mais tardio do lote
+    if (!_lora.sendAt(frame, _batchDueTime, LORA_TX_TAG_ACK, _batchRefTime, LORA_TX_MAX_ATTEMPTS, _batchSf)) {
+        _dropped++;
+        DEBUG_PRINTLN("[ACK] ERRO: Nao foi possivel agendar o ACK agregado!");
+        return;
+    }
+
+    uint32_t airtimeUs = _lora.timeOnAirUs(frame.length(), _batchSf);
+    _ackedReadings += count;
+    _airtimeUs += airtimeUs;
+    _singleAirtimeUs += _batchSingleUs;
+
+    DEBUG_PRINTF("[ACK] Agregado: %d nos, %u bytes, %lu us no ar (individuais: %lu us)\n",
+                 count, (unsigned)frame.length(), (unsigned long)airtimeUs, (unsigned long)_batchSingleUs);
+}
+
+void AckScheduler::recordSent(const LoRaTxResult& result) {
+    if (!result.success) {
+        _dropped++;
+        return;
+    }
+
+    uint32_t turnaround = result.doneTime - result.refTime;
+
+    _sentCount++;
+    _totalTurnaround += turnaround;
+    _lastTurnaround = turnaround;
+    if (turnaround > _maxTurnaround) {
+        _maxTurnaround = turnaround;
+    }
+
+    DEBUG_PRINTF("[ACK] Enviado %lu ms apos a recepcao\n", (unsigned long)turnaround);
+}
+
+uint32_t AckScheduler::getAverageTurnaround() const {
+    if (_sentCount == 0) {
+        return 0;
+    }
+    return (uint32_t)(_totalTurnaround / _sentCount);
+}
@@ -0,0 +1,305 @@
+#include "adr_engine.h"
+#include "lora_handler.h"
+
+AdrEngine::AdrEngine()
+    : _nextCommandId(ADR_COMMAND_ID_BASE), _adjustments(0), _reverts(0) {
+    for (int i = 0; i < ADR_MAX_NODES; i++) {
+        _nodes[i].used = false;
+    }
+}
+
+bool AdrEngine::update(StringView nodeId, uint32_t sequence, float snr, int rssi, uint8_t sf,
+                       unsigned long now, DownlinkQueue& downlinks) {
+    int idx = findNode(nodeId);
+
+    if (idx < 0) {
+        idx = allocNode(now);
+        NodeLink& link = _nodes[idx];
+        link.nodeId.assign(nodeId);
+        link.lost = 0;
+        link.pendingId = 0;
+        link.holdUntil = now;
+        link.used = true;
+        resetNode(link, sf, ADR_POWER_MAX, now);
+        link.lastSeq = sequence;
+    }
+
+    NodeLink& link = _nodes[idx];
+    link.lastSeen = now;
+
+    // Comando sem cmd_ack dentro do TTL da fila: desiste
+    if (link.pendingId && now - link.pendingAt > DOWNLINK_TTL_MS) {
+        DEBUG_PRINTF("[ADR] %s: ajuste %lu sem confirmacao\n",
+                     link.nodeId.c_str(), (unsigned long)link.pendingId);
+        link.pendingId = 0;
+        link.lastChange = now;
+    }
+
+    if (sf != link.sf) {
+        if (link.pendingId && sf == link.pendingSf) {
+            // Ajuste aplicado, mas o cmd_ack se perdeu
+            applyPending(link, now);
+        } else {
+            // O no reverteu sozinho (sem ACKs) ou voltou ao padrao
+            DEBUG_PRINTF("[ADR] %s: no mudou para SF%d por conta propria\n",
+                         link.nodeId.c_str(), sf);
+            resetNode(link, sf, sf == link.prevSf ? link.prevPower : ADR_POWER_MAX, now);
+            link.holdUntil = now + ADR_REVERT_HOLD_MS;
+            _reverts++;
+        }
+    }
+
+    // O no reiniciou com a configuracao padrao (mesma regra do cache de
+    // duplicados); quadro atrasado dentro da janela ja foi contado
+    if (isSequenceReset(link.lastSeq, sequence, DEDUP_SEQ_WINDOW)) {
+        resetNode(link, sf, ADR_POWER_MAX, now);
+    } else if (sequence < link.lastSeq || (sequence == link.lastSeq && link.count > 0)) {
+        return false;
+    }
+
+    uint32_t gap = sequence > link.lastSeq ? sequence - link.lastSeq - 1 : 0;
+    link.lastSeq = sequence;
+    link.lost += gap;
+
+    // Perdas logo apos um ajuste: volta a configuracao anterior
+    if (link.probing) {
+        link.probeLoss += gap >= ADR_REVERT_LOSS ? ADR_REVERT_LOSS : gap;
+        link.probeFrames++;
+
+        if (link.probeLoss >= ADR_REVERT_LOSS && !link.pendingId) {
+            DEBUG_PRINTF("[ADR] %s: %d quadros perdidos apos o ajuste, revertendo para SF%d/%d dBm\n",
+                         link.nodeId.c_str(), link.probeLoss, link.prevSf, link.prevPower);
+            link.probing = false;
+            link.holdUntil = now + ADR_REVERT_HOLD_MS;
+            _reverts++;
+            return queueChange(link, link.prevSf, link.prevPower, true, now, downlinks);
+        }
+
+        if (link.probeFrames >= ADR_HISTORY_SIZE) {
+            link.probing = false;
+        }
+    }
+
+    link.snr[link.head] = snr;
+    link.rssi[link.head] = rssi;
+    link.head = (link.head + 1) % ADR_HISTORY_SIZE;
+    if (link.count < ADR_HISTORY_SIZE) {
+        link.count++;
+    }
+
+    // Limites de taxa: um comando por vez, intervalo minimo e amostras suficientes
+    if (link.pendingId || link.count < ADR_MIN_SAMPLES ||
+        now - link.lastChange < ADR_MIN_INTERVAL_MS) {
+        return false;
+    }
+
+    uint8_t targetSf = link.sf;
+    uint8_t targetPower = link.power;
+    if (!computeTarget(link, targetSf, targetPower)) {
+        return false;
+    }
+
+    // Apos reverter, so aceita configuracoes mais robustas
+    bool lessRobust = targetSf < link.sf || targetPower < link.power;
+    if (lessRobust && (long)(now - link.holdUntil) < 0) {
+        return false;
+    }
+
+    DEBUG_PRINTF("[ADR] %s: SNR max %.1f dB em SF%d/%d dBm -> SF%d/%d dBm\n",
+                 link.nodeId.c_str(), maxSnr(link), link.sf, link.power, targetSf, targetPower);
+    return queueChange(link, targetSf, targetPower, false, now, downlinks);
+}
+
+void AdrEngine::confirm(StringView nodeId, uint32_t commandId, bool success, unsigned long now) {
+    int idx = findNode(nodeId);
+    if (idx < 0 || _nodes[idx].pendingId != commandId) {
+        return;
+    }
+
+    NodeLink& link = _nodes[idx];
+    if (!success) {
+        // No recusou (parametros fora da faixa dele): espera o proximo intervalo
+        DEBUG_PRINTF("[ADR] %s: ajuste recusado pelo no\n", link.nodeId.c_str());
+        link.pendingId = 0;
+        link.lastChange = now;
+        return;
+    }
+
+    applyPending(link, now);
+}
+
+float AdrEngine::requiredSnr(uint8_t sf) {
+    // SF7 = -7.5 dB, 2.5 dB a menos por SF (datasheet SX1276)
+    return -7.5f - 2.5f * (sf - LORA_SF_MIN);
+}
+
+void AdrEngine::appendTelemetry(JsonObject obj) const {
+    obj["enabled"] = (bool)ADR_ENABLED;
+    obj["adjustments"] = _adjustments;
+    obj["reverts"] = _reverts;
+
+    JsonArray nodes = obj["nodes"].to<JsonArray>();
+    for (int i = 0; i < ADR_MAX_NODES; i++) {
+        const NodeLink& link = _nodes[i];
+        if (!link.used) {
+            continue;
+        }
+
+        JsonObject node = nodes.add<JsonObject>();
+        node["id"] = link.nodeId.c_str();
+        node["sf"] = link.sf;
+        node["tx_power"] = link.power;
+        node["samples"] = link.count;
+        node["lost"] = link.lost;
+        node["pending"] = link.pendingId != 0;
+
+        if (link.count > 0) {
+            float snrSum = 0;
+            int32_t rssiSum = 0;
+            for (uint8_t n = 0; n < link.count; n++) {
+                snrSum += link.snr[n];
+                rssiSum += link.rssi[n];
+            }
+            float snrMax = maxSnr(link);
+            node["snr_max"] = snrMax;
+            node["snr_avg"] = snrSum / link.count;
+            node["rssi_avg"] = rssiSum / link.count;
+            node["margin_db"] = snrMax - requiredSnr(link.sf) - ADR_MARGIN_DB;
+        }
+    }
+}
+
+int AdrEngine::findNode(StringView nodeId) const {
+    for (int i = 0; i < ADR_MAX_NODES; i++) {
+        if (_nodes[i].used && _nodes[i].nodeId == nodeId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int AdrEngine::allocNode(unsigned long now) {
+    // Slot livre ou, se cheio, o no visto ha mais tempo
+    int oldest = 0;
+    for (int i = 0; i < ADR_MAX_NODES; i++) {
+        if (!_nodes[i].used) {
+            return i;
+        }
+        if (now - _nodes[i].lastSeen > now - _nodes[oldest].lastSeen) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+void AdrEngine::resetNode(NodeLink& link, uint8_t sf, uint8_t power, unsigned long now) {
+    link.sf = sf;
+    link.power = power;
+    link.prevSf = sf;
+    link.prevPower = power;
+    link.count = 0;
+    link.head = 0;
+    link.probing = false;
+    link.probeFrames = 0;
+    link.probeLoss = 0;
+    link.pendingId = 0;
+    link.lastChange = now - ADR_MIN_INTERVAL_MS;
+    link.lastSeen = now;
+}
+
+void AdrEngine::applyPending(NodeLink& link, unsigned long now) {
+    DEBUG_PRINTF("[ADR] %s: agora em SF%d/%d dBm\n",
+                 link.nodeId.c_str(), link.pendingSf, link.pendingPower);
+
+    // Reversao nao e observada (evita alternar entre as duas configuracoes)
+    link.prevSf = link.pendingRevert ? link.pendingSf : link.sf;
+    link.prevPower = link.pendingRevert ? link.pendingPower : link.power;
+    link.sf = link.pendingSf;
+    link.power = link.pendingPower;
+    link.probing = !link.pendingRevert;
+    link.probeFrames = 0;
+    link.probeLoss = 0;
+    link.pendingId = 0;
+    link.lastChange = now;
+
+    // SNR medido na configuracao anterior nao vale mais
+    link.count = 0;
+    link.head = 0;
+
+    if (!link.pendingRevert) {
+        _adjustments++;
+    }
+}
+
+bool AdrEngine::computeTarget(const NodeLink& link, uint8_t& sf, uint8_t& power) const {
+    float margin = maxSnr(link) - requiredSnr(link.sf) - ADR_MARGIN_DB;
+    int steps = (int)floorf(margin / ADR_STEP_DB);
+
+    // Margem sobrando: primeiro SF menor (menos tempo no ar), depois potencia
+    while (steps > 0 && lowerSf(sf)) {
+        sf = lowerSf(sf);
+        steps--;
+    }
+    while (steps > 0 && power > ADR_POWER_MIN) {
+        power = power - ADR_STEP_DB < ADR_POWER_MIN ? ADR_POWER_MIN : power - ADR_STEP_DB;
+        steps--;
+    }
+
+    // Margem faltando: primeiro potencia, depois SF maior
+    while (steps < 0 && power < ADR_POWER_MAX) {
+        power = power + ADR_STEP_DB > ADR_POWER_MAX ? ADR_POWER_MAX : power + ADR_STEP_DB;
+        steps++;
+    }
+    while (steps < 0 && higherSf(sf)) {
+        sf = higherSf(sf);
+        steps++;
+    }
+
+    return sf != link.sf || power != link.power;
+}
+
+bool AdrEngine::queueChange(NodeLink& link, uint8_t sf, uint8_t power, bool revert,
+                            unsigned long now, DownlinkQueue& downlinks) {
+    char params[32];
+    snprintf(params, sizeof(params), "{\"sf\":%d,\"pwr\":%d}", sf, power);
+
+    uint32_t id = ++_nextCommandId;
+    if (!downlinks.add(id, link.nodeId, "set_radio", params, now, true)) {
+        return false;
+    }
+
+    link.pendingId = id;
+    link.pendingSf = sf;
+    link.pendingPower = power;
+    link.pendingRevert = revert;
+    link.pendingAt = now;
+    return true;
+}
+
+float AdrEngine::maxSnr(const NodeLink& link) const {
+    float best = link.snr[0];
+    for (uint8_t i = 1; i < link.count; i++) {
+        if (link.snr[i] > best) {
+            best = link.snr[i];
+        }
+    }
+    return best;
+}
+
+uint8_t AdrEngine::lowerSf(uint8_t sf) {
+    for (uint8_t s = sf - 1; s >= LORA_SF_MIN; s--) {
+        if (LORA_SCAN_SF_MASK & (1 << s)) {
+            return s;
+        }
+    }
+    return 0;
+}
+
+uint8_t AdrEngine::higherSf(uint8_t sf) {
+    for (uint8_t s = sf + 1; s <= LORA_SF_MAX; s++) {
+        if (LORA_SCAN_SF_MASK & (1 << s)) {
+            return s;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "airtime_accountant.h"
+
+static const unsigned long AIRTIME_BUCKET_MS = AIRTIME_WINDOW_MS / AIRTIME_BUCKETS;
+
+AirtimeWindow::AirtimeWindow() {
+    clear();
+}
+
+void AirtimeWindow::add(uint32_t airtimeUs, unsigned long now) {
+    uint32_t epoch = now / AIRTIME_BUCKET_MS;
+    int idx = epoch % AIRTIME_BUCKETS;
+
+    // Balde de uma volta anterior da janela: recomeca do zero
+    if (_epochs[idx] != epoch) {
+        _epochs[idx] = epoch;
+        _buckets[idx] = 0;
+    }
+
+    _buckets[idx] += airtimeUs;
+}
+
+uint64_t AirtimeWindow::totalUs(unsigned long now) const {
+    uint32_t epoch = now / AIRTIME_BUCKET_MS;
+    uint64_t total = 0;
+
+    for (int i = 0; i < AIRTIME_BUCKETS; i++) {
+        if (epoch - _epochs[i] < AIRTIME_BUCKETS) {
+            total += _buckets[i];
+        }
+    }
+
+    return total;
+}
+
+void AirtimeWindow::clear() {
+    for (int i = 0; i < AIRTIME_BUCKETS; i++) {
+        _buckets[i] = 0;
+        _epochs[i] = 0;
+    }
+}
+
+AirtimeAccountant::AirtimeAccountant() : _txBlocked(0) {
+    for (int i = 0; i < AIRTIME_MAX_NODES; i++) {
+        _nodes[i].used = false;
+    }
+}
+
+void AirtimeAccountant::recordChannelRx(uint32_t airtimeUs, unsigned long now) {
+    _rx.add(airtimeUs, now);
+}
+
+void AirtimeAccountant::recordNodeRx(StringView nodeId, uint32_t airtimeUs, unsigned long now) {
+    int idx = findNode(nodeId);
+
+    if (idx < 0) {
+        idx = allocNode(now);
+        NodeEntry& entry = _nodes[idx];
+        entry.nodeId.assign(nodeId);
+        entry.rx.clear();
+        entry.frames = 0;
+        entry.used = true;
+    }
+
+    NodeEntry& entry = _nodes[idx];
+    entry.rx.add(airtimeUs, now);
+    entry.frames++;
+    entry.lastSeen = now;
+}
+
+void AirtimeAccountant::recordTx(uint32_t airtimeUs, unsigned long now) {
+    _tx.add(airtimeUs, now);
+}
+
+bool AirtimeAccountant::canTransmit(uint32_t airtimeUs, unsigned long now) const {
+    uint64_t budgetUs = (uint64_t)AIRTIME_WINDOW_MS * LORA_TX_DUTY_CYCLE_PERMILLE;
+    return _tx.totalUs(now) + airtimeUs <= budgetUs;
+}
+
+uint32_t AirtimeAccountant::getRxAirtimeMs(unsigned long now) const {
+    return (uint32_t)(_rx.totalUs(now) / 1000);
+}
+
+uint32_t AirtimeAccountant::getTxAirtimeMs(unsigned long now) const {
+    return (uint32_t)(_tx.totalUs(now) / 1000);
+}
+
+uint32_t AirtimeAccountant::getTxBudgetMs() const {
+    return (uint32_t)((uint64_t)AIRTIME_WINDOW_MS * LORA_TX_DUTY_CYCLE_PERMILLE / 1000);
+}
+
+uint16_t AirtimeAccountant::getRxUtilization(unsigned long now) const {
+    return utilization(_rx.totalUs(now), now);
+}
+
+uint16_t AirtimeAccountant::getTxUtilization(unsigned long now) const {
+    return utilization(_tx.totalUs(now), now);
+}
+
+void AirtimeAccountant::appendTelemetry(JsonObject obj, unsigned long now) const {
+    obj["window_s"] = AIRTIME_WINDOW_MS / 1000;
+    obj["rx_ms"] = getRxAirtimeMs(now);
+    obj["tx_ms"] = getTxAirtimeMs(now);
+    obj["tx_budget_ms"] = getTxBudgetMs();
+    obj["rx_util_pct"] = getRxUtilization(now) / 10.0;
+    obj["tx_util_pct"] = getTxUtilization(now) / 10.0;
+    obj["tx_blocked"] = _txBlocked;
+
+    JsonArray nodes = obj["nodes"].to<JsonArray>();
+    for (int i = 0; i < AIRTIME_MAX_NODES; i++) {
+        const NodeEntry& entry = _nodes[i];
+        if (!entry.used) {
+            continue;
+        }
+
+        uint64_t rxUs = entry.rx.totalUs(now);
+        if (rxUs == 0) {
+            continue;
+        }
+
+        JsonObject node = nodes.add<JsonObject>();
+        node["id"] = entry.nodeId.c_str();
+        node["rx_ms"] = (uint32_t)(rxUs / 1000);
+        node["util_pct"] = utilization(rxUs, now) / 10.0;
+        node["frames"] = entry.frames;
+    }
+}
+
+int AirtimeAccountant::findNode(StringView nodeId) const {
+    for (int i = 0; i < AIRTIME_MAX_NODES; i++) {
+        if (_nodes[i].used && _nodes[i].nodeId == nodeId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int AirtimeAccountant::allocNode(unsigned long now) {
+    // Slot livre ou, se cheio, o no visto ha mais tempo
+    int oldest = 0;
+    for (int i = 0; i < AIRTIME_MAX_NODES; i++) {
+        if (!_nodes[i].used) {
+            return i;
+        }
+        if (now - _nodes[i].lastSeen > now - _nodes[oldest].lastSeen) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+uint16_t AirtimeAccountant::utilization(uint64_t airtimeUs, unsigned long now) const {
+    // Antes de completar a primeira janela, divide pelo tempo decorrido
+    unsigned long elapsedMs = now < AIRTIME_WINDOW_MS ? now : AIRTIME_WINDOW_MS;
+    if (elapsedMs == 0) {
+        return 0;
+    }
+
+    uint64_t permille = airtimeUs / elapsedMs;  // us / ms = permil
+    return permille > 1000 ? 1000 : (uint16_t)permille;
+}
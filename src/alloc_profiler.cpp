@@ -0,0 +1,129 @@
+#include "alloc_profiler.h"
+
+#if ALLOC_PROFILE
+
+AllocTagStats AllocProfiler::_tags[ALLOC_TAG_COUNT];
+uint32_t AllocProfiler::_frees = 0;
+uint32_t AllocProfiler::_packets = 0;
+uint32_t AllocProfiler::_packetLast = 0;
+uint32_t AllocProfiler::_packetMax = 0;
+uint64_t AllocProfiler::_packetTotal = 0;
+
+static const char* const TAG_NAMES[ALLOC_TAG_COUNT] = {"other", "radio", "protocol", "web", "wifi"};
+
+// Estado por task: etiqueta ativa e alocacoes feitas pela propria task
+static __thread uint8_t currentTag = ALLOC_TAG_OTHER;
+static __thread uint32_t taskAllocs = 0;
+static __thread uint32_t packetStart = 0;
+
+void AllocProfiler::setTag(uint8_t tag) {
+    currentTag = tag < ALLOC_TAG_COUNT ? tag : ALLOC_TAG_OTHER;
+}
+
+uint8_t AllocProfiler::getTag() {
+    return currentTag;
+}
+
+void AllocProfiler::beginPacket() {
+    packetStart = taskAllocs;
+}
+
+void AllocProfiler::endPacket() {
+    uint32_t count = taskAllocs - packetStart;
+
+    _packets++;
+    _packetLast = count;
+    _packetTotal += count;
+    if (count > _packetMax) {
+        _packetMax = count;
+    }
+}
+
+void AllocProfiler::record(size_t size, bool ok) {
+    AllocTagStats& stats = _tags[currentTag];
+
+    if (!ok) {
+        __atomic_fetch_add(&stats.failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    taskAllocs++;
+    __atomic_fetch_add(&stats.allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats.bytes, (uint32_t)size, __ATOMIC_RELAXED);
+}
+
+void AllocProfiler::recordFree() {
+    __atomic_fetch_add(&_frees, 1, __ATOMIC_RELAXED);
+}
+
+void AllocProfiler::appendTelemetry(JsonObject obj) {
+    // Leitura antes de montar o JSON: as alocacoes do proprio JSON nao entram
+    AllocTagStats snapshot[ALLOC_TAG_COUNT];
+    uint32_t allocs = 0;
+    for (uint8_t i = 0; i < ALLOC_TAG_COUNT; i++) {
+        snapshot[i] = _tags[i];
+        allocs += snapshot[i].allocs;
+    }
+    uint32_t frees = _frees;
+
+    obj["allocs"] = allocs;
+    obj["frees"] = frees;
+    obj["outstanding"] = (int32_t)(allocs - frees);
+
+    JsonObject tags = obj["tags"].to<JsonObject>();
+    for (uint8_t i = 0; i < ALLOC_TAG_COUNT; i++) {
+        JsonObject tag = tags[TAG_NAMES[i]].to<JsonObject>();
+        tag["allocs"] = snapshot[i].allocs;
+        tag["bytes"] = snapshot[i].bytes;
+        tag["failed"] = snapshot[i].failed;
+    }
+
+    JsonObject packet = obj["per_packet"].to<JsonObject>();
+    packet["last"] = _packetLast;
+    packet["max"] = _packetMax;
+    packet["avg"] = _packets > 0 ? (uint32_t)(_packetTotal / _packets) : 0;
+}
+
+// Wrappers do linker (-Wl,--wrap=...): nada aqui pode imprimir ou alocar
+extern "C" {
+
+void* __real_malloc(size_t size);
+void __real_free(void* ptr);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+    AllocProfiler::record(size, ptr != nullptr);
+    return ptr;
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr) {
+        AllocProfiler::recordFree();
+    }
+    __real_free(ptr);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* ptr = __real_calloc(count, size);
+    AllocProfiler::record(count * size, ptr != nullptr);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    void* result = __real_realloc(ptr, size);
+
+    // realloc = nova alocacao + liberacao do bloco antigo
+    if (size > 0) {
+        AllocProfiler::record(size, result != nullptr);
+    }
+    if (ptr && (result || size == 0)) {
+        AllocProfiler::recordFree();
+    }
+    return result;
+}
+
+} // extern "C"
+
+#endif // ALLOC_PROFILE
@@ -0,0 +1,152 @@
+#include "batch_controller.h"
+#include "metrics.h"
+
+BatchController::BatchController()
+    : _publishGauges(true),
+      _batchSize(UPLINK_AIMD_INITIAL_BATCH),
+      _flushIntervalMs(0),
+      _holding(false),
+      _flushDeadline(0),
+      _rttMs(0),
+      _rttBaseMs(0),
+      _errorRate(0),
+      _increases(0),
+      _decreases(0),
+      _maxEventWaitMs(0) {
+    memset(_flushes, 0, sizeof(_flushes));
+}
+
+BatchFlushReason BatchController::decide(unsigned long now, uint8_t pending, unsigned long oldestRx,
+                                         bool hasEvent, unsigned long eventRx) {
+    BatchFlushReason reason = BATCH_FLUSH_WAIT;
+
+    _flushDeadline = oldestRx + _flushIntervalMs;
+    if (hasEvent && (long)(eventRx + UPLINK_EVENT_LATENCY_BUDGET_MS - _flushDeadline) < 0) {
+        _flushDeadline = eventRx + UPLINK_EVENT_LATENCY_BUDGET_MS;
+    }
+
+    if (pending >= _batchSize) {
+        reason = BATCH_FLUSH_FULL;
+    } else if ((long)(now - _flushDeadline) >= 0) {
+        reason = (long)(now - oldestRx - _flushIntervalMs) >= 0 ? BATCH_FLUSH_INTERVAL
+                                                                 : BATCH_FLUSH_EVENT;
+    }
+
+    _holding = reason == BATCH_FLUSH_WAIT;
+    if (_holding) {
+        return reason;
+    }
+
+    _flushes[reason]++;
+    switch (reason) {
+        case BATCH_FLUSH_FULL:
+            Metrics::inc(METRIC_UPLINK_FLUSH_FULL);
+            break;
+        case BATCH_FLUSH_INTERVAL:
+            Metrics::inc(METRIC_UPLINK_FLUSH_TIMER);
+            break;
+        default:
+            Metrics::inc(METRIC_UPLINK_FLUSH_EVENT);
+            break;
+    }
+
+    if (hasEvent && now - eventRx > _maxEventWaitMs) {
+        _maxEventWaitMs = now - eventRx;
+    }
+    return reason;
+}
+
+void BatchController::recordResult(int httpStatus, uint32_t rttMs, uint8_t backlog) {
+    bool ok = httpStatus >= 200 && httpStatus < 300;
+    // 4xx (fora o 429) e erro do corpo, nao do backend: nao reduz o ritmo
+    bool overloaded = httpStatus <= 0 || httpStatus >= 500 || httpStatus == 429;
+
+    _errorRate = (uint16_t)((_errorRate * 7 + (ok ? 0 : 1000)) / 8);
+
+    if (overloaded) {
+        DEBUG_PRINTF("[Batch] POST falhou (%d): reduzindo lote e ritmo\n", httpStatus);
+        decrease(true);
+        publish();
+        return;
+    }
+
+    // RTT so de respostas: o timeout de um POST sem resposta nao e RTT
+    if (_rttMs == 0) {
+        _rttMs = rttMs;
+        _rttBaseMs = rttMs;
+    } else {
+        _rttMs = (_rttMs * 7 + rttMs) / 8;
+        if (rttMs < _rttBaseMs) {
+            _rttBaseMs = rttMs;
+        } else {
+            // Sobe devagar: uma mudanca de rota vira a nova base
+            _rttBaseMs += (rttMs - _rttBaseMs) / 64;
+        }
+    }
+
+    if (rttMs > _rttBaseMs * UPLINK_AIMD_RTT_FACTOR + UPLINK_AIMD_RTT_SLACK_MS) {
+        DEBUG_PRINTF("[Batch] RTT %u ms (base %u ms): reduzindo ritmo\n", rttMs, _rttBaseMs);
+        decrease(false);
+        publish();
+        return;
+    }
+
+    bool changed = false;
+    if (_flushIntervalMs > 0) {
+        _flushIntervalMs = _flushIntervalMs > UPLINK_AIMD_INTERVAL_STEP_MS
+                               ? _flushIntervalMs - UPLINK_AIMD_INTERVAL_STEP_MS
+                               : 0;
+        changed = true;
+    }
+    if (backlog > 0 && _batchSize < UPLINK_HTTP_BATCH_MAX) {
+        _batchSize++;
+        changed = true;
+    }
+    if (changed) {
+        _increases++;
+        Metrics::inc(METRIC_UPLINK_BATCH_INCREASES);
+    }
+    publish();
+}
+
+void BatchController::decrease(bool shrinkBatch) {
+    if (shrinkBatch && _batchSize > 1) {
+        _batchSize /= 2;
+    }
+
+    _flushIntervalMs = _flushIntervalMs > 0 ? _flushIntervalMs * 2 : UPLINK_AIMD_INTERVAL_STEP_MS;
+    if (_flushIntervalMs > UPLINK_AIMD_MAX_INTERVAL_MS) {
+        _flushIntervalMs = UPLINK_AIMD_MAX_INTERVAL_MS;
+    }
+
+    _decreases++;
+    Metrics::inc(METRIC_UPLINK_BATCH_DECREASES);
+}
+
+void BatchController::publish() const {
+    if (!_publishGauges) {
+        return;
+    }
+    Metrics::set(METRIC_UPLINK_BATCH_SIZE, _batchSize);
+    Metrics::set(METRIC_UPLINK_FLUSH_INTERVAL, _flushIntervalMs);
+    Metrics::set(METRIC_UPLINK_RTT, _rttMs);
+    Metrics::set(METRIC_UPLINK_ERROR_RATE, _errorRate);
+}
+
+void BatchController::appendTelemetry(JsonObject obj) const {
+    obj["batch_size"] = _batchSize;
+    obj["batch_max"] = UPLINK_HTTP_BATCH_MAX;
+    obj["flush_interval_ms"] = _flushIntervalMs;
+    obj["rtt_ms"] = _rttMs;
+    obj["rtt_base_ms"] = _rttBaseMs;
+    obj["error_rate_permille"] = _errorRate;
+    obj["increases"] = _increases;
+    obj["decreases"] = _decreases;
+    obj["event_budget_ms"] = UPLINK_EVENT_LATENCY_BUDGET_MS;
+    obj["event_wait_max_ms"] = _maxEventWaitMs;
+
+    JsonObject flushes = obj["flushes"].to<JsonObject>();
+    flushes["full"] = _flushes[BATCH_FLUSH_FULL];
+    flushes["interval"] = _flushes[BATCH_FLUSH_INTERVAL];
+    flushes["event"] = _flushes[BATCH_FLUSH_EVENT];
+}
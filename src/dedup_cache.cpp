@@ -0,0 +1,143 @@
+#include "dedup_cache.h"
+
+DedupCache::DedupCache() : _suppressed(0) {
+    for (int i = 0; i < DEDUP_MAX_NODES; i++) {
+        _entries[i].used = false;
+    }
+}
+
+bool DedupCache::isDuplicate(StringView nodeId, uint32_t sequence) {
+    int idx = findEntry(nodeId);
+    if (idx < 0) {
+        return false;
+    }
+
+    const Entry& entry = _entries[idx];
+    if (isExpired(entry, millis())) {
+        return false;
+    }
+
+    // No reiniciou: a janela antiga nao vale para a sequencia nova
+    if (isSequenceReset(entry.lastSeq, sequence, DEDUP_SEQ_WINDOW)) {
+        return false;
+    }
+
+    // Sequencia nova
+    if (sequence > entry.lastSeq) {
+        return false;
+    }
+
+    return (entry.window & (1UL << (entry.lastSeq - sequence))) != 0;
+}
+
+void DedupCache::markAccepted(StringView nodeId, uint32_t sequence, bool inFlight) {
+    unsigned long now = millis();
+    int idx = findEntry(nodeId);
+
+    if (idx < 0 || isExpired(_entries[idx], now)) {
+        if (idx < 0) {
+            idx = allocEntry();
+        }
+        Entry& entry = _entries[idx];
+        entry.nodeId.assign(nodeId);
+        entry.lastSeq = sequence;
+        entry.window = 1;
+        entry.inFlight = inFlight ? 1 : 0;
+        entry.lastSeen = now;
+        entry.used = true;
+        return;
+    }
+
+    Entry& entry = _entries[idx];
+    entry.lastSeen = now;
+
+    if (isSequenceReset(entry.lastSeq, sequence, DEDUP_SEQ_WINDOW)) {
+        // No reiniciou o contador: janela recomeca na sequencia nova
+        DEBUG_PRINTF("[Dedup] %s reiniciou sequencia (%u -> %u)\n",
+                     entry.nodeId.c_str(), entry.lastSeq, sequence);
+        entry.lastSeq = sequence;
+        entry.window = 1;
+        entry.inFlight = 0;
+    } else if (sequence > entry.lastSeq) {
+        // Avanca a janela
+        uint32_t shift = sequence - entry.lastSeq;
+        entry.window = shift >= DEDUP_SEQ_WINDOW ? 0 : (entry.window << shift);
+        entry.inFlight = shift >= DEDUP_SEQ_WINDOW ? 0 : (entry.inFlight << shift);
+        entry.window |= 1;
+        entry.lastSeq = sequence;
+    } else {
+        // Quadro atrasado dentro da janela
+        entry.window |= (1UL << (entry.lastSeq - sequence));
+    }
+
+    if (inFlight) {
+        entry.inFlight |= (1UL << (entry.lastSeq - sequence));
+    }
+}
+
+bool DedupCache::isInFlight(StringView nodeId, uint32_t sequence) {
+    int idx = findEntry(nodeId);
+    return idx >= 0 && (_entries[idx].inFlight & seqBit(idx, sequence)) != 0;
+}
+
+void DedupCache::markDelivered(StringView nodeId, uint32_t sequence) {
+    int idx = findEntry(nodeId);
+    if (idx >= 0) {
+        _entries[idx].inFlight &= ~seqBit(idx, sequence);
+    }
+}
+
+void DedupCache::release(StringView nodeId, uint32_t sequence) {
+    int idx = findEntry(nodeId);
+    if (idx >= 0) {
+        uint32_t bit = seqBit(idx, sequence);
+        _entries[idx].window &= ~bit;
+        _entries[idx].inFlight &= ~bit;
+    }
+}
+
+uint8_t DedupCache::getNodeCount() const {
+    uint8_t count = 0;
+    unsigned long now = millis();
+    for (int i = 0; i < DEDUP_MAX_NODES; i++) {
+        if (_entries[i].used && !isExpired(_entries[i], now)) count++;
+    }
+    return count;
+}
+
+int DedupCache::findEntry(StringView nodeId) {
+    for (int i = 0; i < DEDUP_MAX_NODES; i++) {
+        if (_entries[i].used && _entries[i].nodeId == nodeId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int DedupCache::allocEntry() {
+    // Slot livre ou, se cheio, o no visto ha mais tempo
+    unsigned long now = millis();
+    int oldest = 0;
+    for (int i = 0; i < DEDUP_MAX_NODES; i++) {
+        if (!_entries[i].used) {
+            return i;
+        }
+        if (now - _entries[i].lastSeen > now - _entries[oldest].lastSeen) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+uint32_t DedupCache::seqBit(int idx, uint32_t sequence) const {
+    const Entry& entry = _entries[idx];
+    if (isExpired(entry, millis()) || sequence > entry.lastSeq ||
+        entry.lastSeq - sequence >= DEDUP_SEQ_WINDOW) {
+        return 0;
+    }
+    return 1UL << (entry.lastSeq - sequence);
+}
+
+bool DedupCache::isExpired(const Entry& entry, unsigned long now) const {
+    return now - entry.lastSeen > DEDUP_WINDOW_MS;
+}
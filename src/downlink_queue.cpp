@@ -0,0 +1,179 @@
+#include "downlink_queue.h"
+
+DownlinkQueue::DownlinkQueue()
+    : _delivered(0), _failed(0), _totalLatency(0), _maxLatency(0) {
+    for (int i = 0; i < DOWNLINK_QUEUE_SIZE; i++) {
+        _commands[i].state = DOWNLINK_FREE;
+    }
+}
+
+bool DownlinkQueue::add(uint32_t id, StringView nodeId, StringView name, StringView params,
+                        unsigned long now, bool local) {
+    // Servidor pode reenviar um comando ja despachado (ex.: apos reboot)
+    if (findById(id) >= 0) {
+        return true;
+    }
+
+    for (int i = 0; i < DOWNLINK_QUEUE_SIZE; i++) {
+        DownlinkCommand& command = _commands[i];
+        if (command.state != DOWNLINK_FREE) {
+            continue;
+        }
+
+        command.id = id;
+        command.nodeId.assign(nodeId);
+        command.name.assign(name);
+        if (!command.params.assign(params.isEmpty() ? StringView("{}") : params)) {
+            DEBUG_PRINTF("[Downlink] ERRO: Parametros do comando %lu muito grandes\n",
+                         (unsigned long)id);
+            return false;
+        }
+        command.fetchedAt = now;
+        command.sentAt = 0;
+        command.doneAt = 0;
+        command.execMs = 0;
+        command.attempts = 0;
+        command.success = false;
+        command.local = local;
+        command.state = DOWNLINK_PENDING;
+
+        DEBUG_PRINTF("[Downlink] Comando %lu (%s) para %s enfileirado\n",
+                     (unsigned long)id, command.name.c_str(), command.nodeId.c_str());
+        return true;
+    }
+
+    DEBUG_PRINTLN("[Downlink] ERRO: Fila de comandos cheia!");
+    return false;
+}
+
+DownlinkCommand* DownlinkQueue::nextFor(StringView nodeId, unsigned long now) {
+    DownlinkCommand* next = nullptr;
+
+    for (int i = 0; i < DOWNLINK_QUEUE_SIZE; i++) {
+        DownlinkCommand& command = _commands[i];
+        if ((command.state != DOWNLINK_PENDING && command.state != DOWNLINK_SENT) ||
+            command.nodeId != nodeId) {
+            continue;
+        }
+
+        // Enviado antes e o no voltou a transmitir sem confirmar
+        if (command.attempts >= DOWNLINK_MAX_ATTEMPTS) {
+            DEBUG_PRINTF("[Downlink] Comando %lu sem confirmacao apos %d envios\n",
+                         (unsigned long)command.id, command.attempts);
+            finish(command, false, now);
+            continue;
+        }
+
+        // O mais antigo primeiro
+        if (!next || (long)(command.fetchedAt - next->fetchedAt) < 0) {
+            next = &command;
+        }
+    }
+
+    return next;
+}
+
+void DownlinkQueue::markSent(DownlinkCommand* command, unsigned long now) {
+    command->attempts++;
+    command->sentAt = now;
+    command->state = DOWNLINK_SENT;
+}
+
+bool DownlinkQueue::confirm(StringView nodeId, uint32_t id, bool success, uint32_t execMs,
+                            unsigned long now) {
+    int idx = findById(id);
+    if (idx < 0) {
+        return false;
+    }
+
+    DownlinkCommand& command = _commands[idx];
+    if (command.nodeId != nodeId || command.state == DOWNLINK_DONE) {
+        // Confirmacao repetida (cmd_ack retransmitido) ou de outro no
+        return false;
+    }
+
+    command.execMs = execMs;
+    finish(command, success, now);
+    return true;
+}
+
+void DownlinkQueue::expire(unsigned long now) {
+    for (int i = 0; i < DOWNLINK_QUEUE_SIZE; i++) {
+        DownlinkCommand& command = _commands[i];
+        if (command.state != DOWNLINK_PENDING && command.state != DOWNLINK_SENT) {
+            continue;
+        }
+        if (now - command.fetchedAt > DOWNLINK_TTL_MS) {
+            DEBUG_PRINTF("[Downlink] Comando %lu expirou\n", (unsigned long)command.id);
+            finish(command, false, now);
+        }
+    }
+}
+
+DownlinkCommand* DownlinkQueue::nextReport() {
+    for (int i = 0; i < DOWNLINK_QUEUE_SIZE; i++) {
+        if (_commands[i].state == DOWNLINK_DONE) {
+            return &_commands[i];
+        }
+    }
+    return nullptr;
+}
+
+void DownlinkQueue::release(DownlinkCommand* command) {
+    command->state = DOWNLINK_FREE;
+}
+
+uint8_t DownlinkQueue::freeSlots() const {
+    uint8_t count = 0;
+    for (int i = 0; i < DOWNLINK_QUEUE_SIZE; i++) {
+        if (_commands[i].state == DOWNLINK_FREE) count++;
+    }
+    return count;
+}
+
+uint8_t DownlinkQueue::getPending() const {
+    uint8_t count = 0;
+    for (int i = 0; i < DOWNLINK_QUEUE_SIZE; i++) {
+        if (_commands[i].state == DOWNLINK_PENDING || _commands[i].state == DOWNLINK_SENT) count++;
+    }
+    return count;
+}
+
+uint32_t DownlinkQueue::getAverageLatency() const {
+    if (_delivered == 0) {
+        return 0;
+    }
+    return (uint32_t)(_totalLatency / _delivered);
+}
+
+int DownlinkQueue::findById(uint32_t id) const {
+    for (int i = 0; i < DOWNLINK_QUEUE_SIZE; i++) {
+        if (_commands[i].state != DOWNLINK_FREE && _commands[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void DownlinkQueue::finish(DownlinkCommand& command, bool success, unsigned long now) {
+    // Comando local nao aguarda relatorio ao servidor
+    command.state = command.local ? DOWNLINK_FREE : DOWNLINK_DONE;
+    command.success = success;
+    command.doneAt = now;
+
+    if (!success || command.attempts == 0) {
+        _failed++;
+        return;
+    }
+
+    uint32_t latency = now - command.fetchedAt;
+    _delivered++;
+    _totalLatency += latency;
+    if (latency > _maxLatency) {
+        _maxLatency = latency;
+    }
+
+    DEBUG_PRINTF("[Downlink] Comando %lu executado por %s em %lu ms (execucao: %lu ms)\n",
+                 (unsigned long)command.id, command.nodeId.c_str(),
+                 (unsigned long)latency, (unsigned long)command.execMs);
+}
@@ -0,0 +1,44 @@
+#include "heap_stats.h"
+#include "json_arena.h"
+#include "alloc_profiler.h"
+
+HeapStats getHeapStats() {
+    HeapStats stats;
+
+    stats.freeHeap = ESP.getFreeHeap();
+    stats.largestFreeBlock = ESP.getMaxAllocHeap();
+    stats.minFreeHeap = ESP.getMinFreeHeap();
+
+    // Heap sem fragmentacao: o maior bloco livre e todo o heap livre
+    if (stats.freeHeap > 0 && stats.largestFreeBlock <= stats.freeHeap) {
+        stats.fragmentation = 100 - (uint8_t)((uint64_t)stats.largestFreeBlock * 100 / stats.freeHeap);
+    } else {
+        stats.fragmentation = 0;
+    }
+
+    return stats;
+}
+
+void appendHeapTelemetry(JsonObject obj) {
+    HeapStats heap = getHeapStats();
+
+    obj["free_heap"] = heap.freeHeap;
+    obj["largest_free_block"] = heap.largestFreeBlock;
+    obj["min_free_heap"] = heap.minFreeHeap;
+    obj["heap_frag_pct"] = heap.fragmentation;
+
+    // Pico de uso e estouros de cada arena
+    JsonObject arenas = obj["json_arenas"].to<JsonObject>();
+    for (size_t i = 0; i < JSON_ARENA_COUNT; i++) {
+        const JsonArena* arena = jsonArenas[i];
+        JsonObject a = arenas[arena->getName()].to<JsonObject>();
+        a["capacity"] = arena->getCapacity();
+        a["high_water"] = arena->getHighWater();
+        a["overflows"] = arena->getOverflows();
+    }
+
+#if ALLOC_PROFILE
+    // Alocacoes por etiqueta e por pacote (env jvtech_mij_alloc_profile)
+    AllocProfiler::appendTelemetry(obj["alloc"].to<JsonObject>());
+#endif
+}
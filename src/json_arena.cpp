@@ -0,0 +1,148 @@
+#include "json_arena.h"
+
+// Cabecalho de cada bloco: guarda o tamanho para permitir realloc
+// (alinhado em 8 bytes por causa de double/int64 nos slots do ArduinoJson)
+static const size_t ARENA_ALIGN = 8;
+static const size_t ARENA_HEADER = ARENA_ALIGN;
+static const size_t ARENA_NO_BLOCK = (size_t)-1;
+
+static inline size_t alignUp(size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+// Buffers estaticos de cada etapa
+alignas(8) static uint8_t rxBuffer[JSON_ARENA_RX_SIZE];
+alignas(8) static uint8_t uplinkBuffer[JSON_ARENA_UPLINK_SIZE];
+alignas(8) static uint8_t ackBuffer[JSON_ARENA_ACK_SIZE];
+alignas(8) static uint8_t statusBuffer[JSON_ARENA_STATUS_SIZE];
+alignas(8) static uint8_t downlinkBuffer[JSON_ARENA_DOWNLINK_SIZE];
+alignas(8) static uint8_t webBuffer[JSON_ARENA_WEB_SIZE];
+
+JsonArena jsonArenaRx("rx", rxBuffer, sizeof(rxBuffer));
+JsonArena jsonArenaUplink("uplink", uplinkBuffer, sizeof(uplinkBuffer));
+JsonArena jsonArenaAck("ack", ackBuffer, sizeof(ackBuffer));
+JsonArena jsonArenaStatus("status", statusBuffer, sizeof(statusBuffer));
+JsonArena jsonArenaDownlink("downlink", downlinkBuffer, sizeof(downlinkBuffer));
+JsonArena jsonArenaWeb("web", webBuffer, sizeof(webBuffer));
+
+JsonArena* const jsonArenas[] = {
+    &jsonArenaRx, &jsonArenaUplink, &jsonArenaAck, &jsonArenaStatus,
+    &jsonArenaDownlink, &jsonArenaWeb
+};
+const size_t JSON_ARENA_COUNT = sizeof(jsonArenas) / sizeof(jsonArenas[0]);
+
+JsonArena::JsonArena(const char* name, uint8_t* buffer, size_t capacity)
+    : _name(name), _buffer(buffer), _capacity(capacity),
+      _top(0), _lastBlock(ARENA_NO_BLOCK), _liveBlocks(0),
+      _highWater(0), _overflows(0), _resets(0) {
+}
+
+void* JsonArena::allocate(size_t size) {
+    size_t needed = ARENA_HEADER + alignUp(size);
+
+    if (_top + needed > _capacity) {
+        // Arena cheia: usa o heap para nao perder o documento
+        _overflows++;
+        DEBUG_PRINTF("[Arena] %s cheia (%u/%u), usando heap para %u bytes\n",
+                     _name, (unsigned)_top, (unsigned)_capacity, (unsigned)size);
+        return malloc(size);
+    }
+
+    uint8_t* header = _buffer + _top;
+    *reinterpret_cast<size_t*>(header) = alignUp(size);
+
+    _lastBlock = _top;
+    _top += needed;
+    _liveBlocks++;
+
+    if (_top > _highWater) {
+        _highWater = _top;
+    }
+
+    return header + ARENA_HEADER;
+}
+
+void JsonArena::deallocate(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    if (!owns(ptr)) {
+        free(ptr);
+        return;
+    }
+
+    // Se for o ultimo bloco, devolve o espaco imediatamente
+    if (_lastBlock != ARENA_NO_BLOCK && ptr == _buffer + _lastBlock + ARENA_HEADER) {
+        _top = _lastBlock;
+        _lastBlock = ARENA_NO_BLOCK;
+    }
+
+    if (_liveBlocks > 0) {
+        _liveBlocks--;
+    }
+
+    // Todos os blocos liberados: arena volta ao inicio
+    if (_liveBlocks == 0) {
+        _top = 0;
+        _lastBlock = ARENA_NO_BLOCK;
+    }
+}
+
+void* JsonArena::reallocate(void* ptr, size_t newSize) {
+    if (!ptr) {
+        return allocate(newSize);
+    }
+
+    if (!owns(ptr)) {
+        return realloc(ptr, newSize);
+    }
+
+    uint8_t* header = static_cast<uint8_t*>(ptr) - ARENA_HEADER;
+
+    // Ultimo bloco: cresce/encolhe no lugar
+    if (_lastBlock != ARENA_NO_BLOCK && header == _buffer + _lastBlock) {
+        size_t needed = ARENA_HEADER + alignUp(newSize);
+        if (_lastBlock + needed <= _capacity) {
+            *reinterpret_cast<size_t*>(header) = alignUp(newSize);
+            _top = _lastBlock + needed;
+            if (_top > _highWater) {
+                _highWater = _top;
+            }
+            return ptr;
+        }
+    }
+
+    size_t oldSize = blockSize(ptr);
+    void* newPtr = allocate(newSize);
+    if (!newPtr) {
+        return nullptr;
+    }
+
+    memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+    deallocate(ptr);
+
+    return newPtr;
+}
+
+void JsonArena::reset() {
+    if (_liveBlocks > 0) {
+        DEBUG_PRINTF("[Arena] AVISO: reset de %s com %u blocos vivos\n",
+                     _name, (unsigned)_liveBlocks);
+    }
+
+    _top = 0;
+    _lastBlock = ARENA_NO_BLOCK;
+    _liveBlocks = 0;
+    _resets++;
+}
+
+bool JsonArena::owns(const void* ptr) const {
+    const uint8_t* p = static_cast<const uint8_t*>(ptr);
+    return p >= _buffer && p < _buffer + _capacity;
+}
+
+size_t JsonArena::blockSize(const void* ptr) const {
+    const uint8_t* header = static_cast<const uint8_t*>(ptr) - ARENA_HEADER;
+    return *reinterpret_cast<const size_t*>(header);
+}
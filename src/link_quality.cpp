@@ -0,0 +1,145 @@
+#include "link_quality.h"
+
+static_assert(LINK_LOSS_WINDOW <= 64, "LINK_LOSS_WINDOW deve caber em 64 bits");
+
+static float round1(float value) {
+    return roundf(value * 10) / 10;
+}
+
+LinkQuality::LinkQuality() {
+    reset();
+}
+
+void LinkQuality::reset() {
+    _window = 0;
+    _windowFill = 0;
+    _lastSeq = 0;
+    _started = false;
+    _received = 0;
+    _lost = 0;
+    _reordered = 0;
+    _resets = 0;
+    _rssiAvg = 0;
+    _rssiMin = 0;
+    _rssiMax = 0;
+    _snrAvg = 0;
+    _snrMin = 0;
+    _snrMax = 0;
+    _freqErrLast = 0;
+    _freqErrAvg = 0;
+    _lastRx = 0;
+    _intervalMs = 0;
+    _jitterMs = 0;
+}
+
+void LinkQuality::update(uint32_t sequence, int rssi, float snr, long freqError,
+                         unsigned long now) {
+    if (!_started) {
+        _started = true;
+        _lastSeq = sequence;
+        _window = 1;
+        _windowFill = 1;
+        _lastRx = now;
+
+        _rssiAvg = _rssiMin = _rssiMax = rssi;
+        _snrAvg = _snrMin = _snrMax = snr;
+        _freqErrAvg = freqError;
+    } else if (isSequenceReset(_lastSeq, sequence, DEDUP_SEQ_WINDOW)) {
+        // No reiniciou (mesma regra e janela do cache de duplicados)
+        _resets++;
+        _lastSeq = sequence;
+        _window = 1;
+        _windowFill = 1;
+        _lastRx = now;
+    } else if (sequence > _lastSeq) {
+        uint32_t advance = sequence - _lastSeq;
+        _lost += advance - 1;
+
+        _window = advance >= LINK_LOSS_WINDOW ? 0 : _window << advance;
+        _window |= 1;
+        _windowFill = _windowFill + advance >= LINK_LOSS_WINDOW ? LINK_LOSS_WINDOW
+                                                                : _windowFill + advance;
+
+        // Intervalo por sequencia: perdas nao inflam o jitter
+        float interval = (float)(now - _lastRx) / advance;
+        if (_intervalMs == 0) {
+            _intervalMs = interval;
+        } else {
+            _jitterMs += LINK_EWMA_ALPHA * (fabsf(interval - _intervalMs) - _jitterMs);
+            _intervalMs += LINK_EWMA_ALPHA * (interval - _intervalMs);
+        }
+
+        _lastSeq = sequence;
+        _lastRx = now;
+    } else {
+        uint32_t behind = _lastSeq - sequence;
+        if (behind == 0) {
+            return;
+        }
+
+        if (behind <= LINK_REORDER_WINDOW && behind < _windowFill) {
+            // Chegou atrasado: a lacuna ja contada como perda foi preenchida
+            uint64_t bit = 1ULL << behind;
+            if (_window & bit) {
+                return;
+            }
+            _window |= bit;
+            _reordered++;
+            if (_lost > 0) {
+                _lost--;
+            }
+        }
+        // Mais atrasado que a janela de reordenacao: so entra nas medias de RF
+    }
+
+    _received++;
+
+    _rssiAvg += LINK_EWMA_ALPHA * (rssi - _rssiAvg);
+    _snrAvg += LINK_EWMA_ALPHA * (snr - _snrAvg);
+    _freqErrAvg += LINK_EWMA_ALPHA * (freqError - _freqErrAvg);
+    _freqErrLast = freqError;
+
+    if (rssi < _rssiMin) _rssiMin = rssi;
+    if (rssi > _rssiMax) _rssiMax = rssi;
+    if (snr < _snrMin) _snrMin = snr;
+    if (snr > _snrMax) _snrMax = snr;
+}
+
+uint16_t LinkQuality::getWindowLoss() const {
+    if (_windowFill == 0) {
+        return 0;
+    }
+
+    uint64_t mask = _windowFill >= 64 ? ~0ULL : (1ULL << _windowFill) - 1;
+    uint8_t received = __builtin_popcountll(_window & mask);
+    return (uint16_t)((_windowFill - received) * 1000 / _windowFill);
+}
+
+void LinkQuality::appendTelemetry(JsonObject obj) const {
+    obj["received"] = _received;
+    obj["lost"] = _lost;
+    obj["loss_pct"] = getWindowLoss() / 10.0;
+    obj["reordered"] = _reordered;
+    obj["resets"] = _resets;
+    obj["degraded"] = isDegraded();
+
+    obj["rssi_avg"] = round1(_rssiAvg);
+    obj["rssi_min"] = _rssiMin;
+    obj["rssi_max"] = _rssiMax;
+    obj["snr_avg"] = round1(_snrAvg);
+    obj["snr_min"] = _snrMin;
+    obj["snr_max"] = _snrMax;
+
+    obj["interval_ms"] = (uint32_t)_intervalMs;
+    obj["jitter_ms"] = (uint32_t)_jitterMs;
+    obj["freq_err_hz"] = _freqErrLast;
+    obj["freq_err_avg_hz"] = (long)_freqErrAvg;
+}
+
+void LinkQuality::appendSummary(JsonObject obj) const {
+    obj["loss_pct"] = getWindowLoss() / 10.0;
+    obj["lost"] = _lost;
+    obj["rssi_avg"] = round1(_rssiAvg);
+    obj["snr_avg"] = round1(_snrAvg);
+    obj["jitter_ms"] = (uint32_t)_jitterMs;
+}
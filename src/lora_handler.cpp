@@ -1,7 +1,60 @@
 #include "lora_handler.h"
 
+// Registradores do SX1276 usados diretamente
+#define REG_OP_MODE            0x01
+#define REG_IRQ_FLAGS          0x12
+#define REG_DIO_MAPPING_1      0x40
+#define MODE_LONG_RANGE_MODE   0x80
+#define MODE_CAD               0x07
+#define IRQ_TX_DONE_MASK       0x08
+#define IRQ_VALID_HEADER_MASK  0x10
+#define IRQ_CAD_DONE_MASK      0x04
+#define IRQ_CAD_DETECTED_MASK  0x01
+#define DIO0_MAPPING_RX_DONE   0x00
+#define DIO0_MAPPING_TX_DONE   0x40
+#define DIO0_MAPPING_CAD_DONE  0x80
+
+// Simbolos aguardados apos o CAD ate o header valido (preambulo + header)
+#define SCAN_HEADER_WAIT_SYMBOLS (_radio.preambleLength + 12)
+
+// Mesmas configuracoes de SPI da biblioteca LoRa
+static const SPISettings loraSpiSettings(8E6, MSBFIRST, SPI_MODE0);
+
+// Sinalizado pela ISR do DIO0 (RxDone em recepcao, TxDone em transmissao,
+// CadDone na varredura multi-SF).
+// A ISR nao acessa o SPI; o tratamento acontece em available()/poll().
+static volatile bool dio0Fired = false;
+static void (*volatile dio0Hook)() = nullptr;
+
+static void IRAM_ATTR onDio0Rise() {
+    dio0Fired = true;
+    if (dio0Hook) {
+        dio0Hook();
+    }
+}
+
 LoRaHandler::LoRaHandler()
-    : _initialized(false), _lastRSSI(0), _lastSNR(0.0) {
+    : _initialized(false), _lastRSSI(0), _lastSNR(0.0),
+      _radioSf(LORA_SF),
+      _scanCount(0), _scanIndex(0), _scanState(SCAN_IDLE), _scanHeaderSeen(false),
+      _scanStart(0), _scanDeadline(0), _cycleStart(0), _scanCycleMs(0),
+      _txCount(0), _txActive(-1), _txBusy(false), _txStart(0),
+      _txTimeout(LORA_TX_TIMEOUT_MARGIN_MS),
+      _txDone(0), _txFailed(0), _txTimeouts(0), _txDoneCallback(nullptr),
+      _airtime(nullptr) {
+    _radio = defaultRadioConfig();
+
+    // SFs da varredura a partir da mascara (sempre ao menos o SF padrao)
+    for (uint8_t sf = LORA_SF_MIN; sf <= LORA_SF_MAX; sf++) {
+        if (LORA_SCAN_SF_MASK & (1 << sf)) {
+            _scanSfs[_scanCount++] = sf;
+        }
+    }
+    if (_scanCount == 0) {
+        _scanSfs[_scanCount++] = LORA_SF;
+    }
+
+    memset(_sfStats, 0, sizeof(_sfStats));
 }
 
 bool LoRaHandler::begin() {
@@ -14,7 +67,7 @@ bool LoRaHandler::begin() {
     LoRa.setPins(LORA_CS, LORA_RST, LORA_DIO0);
 
     // Tenta inicializar na frequencia configurada
-    if (!LoRa.begin(LORA_FREQUENCY)) {
+    if (!LoRa.begin(_radio.frequency)) {
         DEBUG_PRINTLN("[LoRa] ERRO: Falha na inicializacao!");
         DEBUG_PRINTLN("[LoRa] Verifique conexoes e alimentacao do modulo.");
         return false;
@@ -23,12 +76,23 @@ bool LoRaHandler::begin() {
     // Configura parametros do radio
     configureRadio();
 
+    // Interrupcao do DIO0 para RxDone/TxDone
+    pinMode(LORA_DIO0, INPUT);
+    attachInterrupt(digitalPinToInterrupt(LORA_DIO0), onDio0Rise, RISING);
+
     _initialized = true;
     DEBUG_PRINTLN("[LoRa] Inicializado com sucesso!");
-    DEBUG_PRINTF("[LoRa] Frequencia: %.2f MHz\n", LORA_FREQUENCY / 1E6);
+    DEBUG_PRINTF("[LoRa] Frequencia: %.2f MHz\n", _radio.frequency / 1E6);
     DEBUG_PRINTF("[LoRa] SF: %d, BW: %.0f kHz, CR: 4/%d\n",
-                 LORA_SF, LORA_BW / 1E3, LORA_CR);
-    DEBUG_PRINTF("[LoRa] Potencia TX: %d dBm\n", LORA_TX_POWER);
+                 _radio.sf, _radio.bandwidth / 1E3, _radio.codingRate);
+    DEBUG_PRINTF("[LoRa] Potencia TX: %d dBm\n", _radio.txPower);
+    if (isScanning()) {
+        DEBUG_PRINT("[LoRa] Varredura CAD nos SFs:");
+        for (uint8_t i = 0; i < _scanCount; i++) {
+            DEBUG_PRINTF(" %d", _scanSfs[i]);
+        }
+        DEBUG_PRINTLN("");
+    }
 
     return true;
 }
@@ -36,101 +100,125 @@ bool LoRaHandler::begin() {
 void LoRaHandler::configureRadio() {
     // Spreading Factor (7-12)
     // Maior SF = maior alcance, menor taxa de dados
-    LoRa.setSpreadingFactor(LORA_SF);
+    LoRa.setSpreadingFactor(_radio.sf);
+    _radioSf = _radio.sf;
 
     // Bandwidth (7.8E3 a 500E3)
     // Maior BW = maior taxa de dados, menor sensibilidade
-    LoRa.setSignalBandwidth(LORA_BW);
+    LoRa.setSignalBandwidth(_radio.bandwidth);
 
     // Coding Rate (5-8 para 4/5 ate 4/8)
     // Maior CR = mais redundancia, menor taxa efetiva
-    LoRa.setCodingRate4(LORA_CR);
+    LoRa.setCodingRate4(_radio.codingRate);
 
     // Potencia de transmissao (2-20 dBm)
-    LoRa.setTxPower(LORA_TX_POWER);
+    LoRa.setTxPower(_radio.txPower);
 
     // Preambulo
-    LoRa.setPreambleLength(LORA_PREAMBLE_LENGTH);
+    LoRa.setPreambleLength(_radio.preambleLength);
 
     // Sync Word - usar valor diferente de 0x34 (LoRaWAN)
-    LoRa.setSyncWord(LORA_SYNC_WORD);
+    LoRa.setSyncWord(_radio.syncWord);
 
     // Habilita CRC para verificacao de integridade
     LoRa.enableCrc();
 
-    // Modo de recepcao continua
-    LoRa.receive();
+    // Recepcao continua (ou varredura CAD multi-SF)
+    resumeReceive();
 }
 
 bool LoRaHandler::available() {
-    return LoRa.parsePacket() > 0;
+    // Radio ocupado transmitindo ou em CAD (DIO0 = CadDone): nada para receber
+    if (_txBusy || _scanState == SCAN_CAD || !dio0Fired) {
+        return false;
+    }
+
+    dio0Fired = false;
+
+    // RxDone: parsePacket le o tamanho e limpa as IRQs
+    if (LoRa.parsePacket() > 0) {
+        return true;
+    }
+
+    // Quadro com erro de CRC: volta para recepcao continua / varredura
+    if (_scanState == SCAN_RX) {
+        _sfStats[_radioSf - LORA_SF_MIN].missed++;
+    }
+    resumeReceive();
+    return false;
 }
 
 LoRaPacket LoRaHandler::receive() {
     LoRaPacket packet;
     packet.valid = false;
+    packet.freqError = 0;
+    packet.airtimeUs = 0;
+    packet.sf = _radioSf;
     packet.timestamp = millis();
 
-    int packetSize = LoRa.parsePacket();
-    if (packetSize == 0) {
+    if (!available()) {
         return packet;
     }
 
-    // Le o payload
-    packet.payload = "";
-    while (LoRa.available()) {
-        packet.payload += (char)LoRa.read();
-    }
-
-    // Captura metricas do pacote
-    packet.rssi = LoRa.packetRssi();
-    packet.snr = LoRa.packetSnr();
-
-    _lastRSSI = packet.rssi;
-    _lastSNR = packet.snr;
-
-    // Valida se o RSSI esta acima do threshold
-    if (packet.rssi >= RSSI_THRESHOLD && packet.payload.length() > 0) {
-        packet.valid = true;
-    }
-
-    DEBUG_PRINTF("[LoRa] Pacote recebido: %d bytes, RSSI: %d dBm, SNR: %.2f dB\n",
-                 packet.payload.length(), packet.rssi, packet.snr);
-
-    return packet;
+    return receivePacket();
 }
 
 LoRaPacket LoRaHandler::receivePacket() {
     // Versao que NAO chama parsePacket() - usar apos available()
     LoRaPacket packet;
     packet.valid = false;
+    packet.airtimeUs = 0;
     packet.timestamp = millis();
 
     // Le o payload diretamente (parsePacket ja foi chamado em available())
-    packet.payload = "";
+    packet.payload.clear();
     while (LoRa.available()) {
-        packet.payload += (char)LoRa.read();
+        packet.payload.append((char)LoRa.read());
     }
 
     // Captura metricas do pacote
     packet.rssi = LoRa.packetRssi();
     packet.snr = LoRa.packetSnr();
+    packet.freqError = LoRa.packetFrequencyError();
 
     _lastRSSI = packet.rssi;
     _lastSNR = packet.snr;
 
+    // Todo quadro recebido ocupa o canal, valido ou nao
+    packet.sf = _radioSf;
+    packet.airtimeUs = timeOnAirUs(packet.payload.length(), packet.sf);
+    if (_airtime) {
+        _airtime->recordChannelRx(packet.airtimeUs, packet.timestamp);
+    }
+
+    if (_scanState == SCAN_RX) {
+        _sfStats[_radioSf - LORA_SF_MIN].received++;
+    }
+
+    // parsePacket deixou o radio em standby: volta para recepcao continua
+    resumeReceive();
+
     // Valida se o RSSI esta acima do threshold
     if (packet.rssi >= RSSI_THRESHOLD && packet.payload.length() > 0) {
         packet.valid = true;
     }
 
-    DEBUG_PRINTF("[LoRa] Pacote recebido: %d bytes, RSSI: %d dBm, SNR: %.2f dB\n",
-                 packet.payload.length(), packet.rssi, packet.snr);
+    DEBUG_PRINTF("[LoRa] Pacote recebido: %u bytes, SF%d, RSSI: %d dBm, SNR: %.2f dB\n",
+                 (unsigned)packet.payload.length(), packet.sf, packet.rssi, packet.snr);
 
     return packet;
 }
 
-bool LoRaHandler::send(const String& data) {
+bool LoRaHandler::send(StringView data) {
+    return sendAt(data, millis());
+}
+
+bool LoRaHandler::sendWithRetry(StringView data, int maxRetries) {
+    return sendAt(data, millis(), LORA_TX_TAG_DATA, 0, maxRetries);
+}
+
+bool LoRaHandler::sendAt(StringView data, unsigned long sendAt, uint8_t tag,
+                         unsigned long refTime, uint8_t maxAttempts, uint8_t sf) {
     if (!_initialized) {
         DEBUG_PRINTLN("[LoRa] ERRO: Modulo nao inicializado!");
         return false;
@@ -141,61 +229,410 @@ bool LoRaHandler::send(const String& data) {
         return false;
     }
 
-    DEBUG_PRINTF("[LoRa] Enviando %d bytes...\n", data.length());
+    if (_txCount >= LORA_TX_QUEUE_SIZE) {
+        DEBUG_PRINTLN("[LoRa] ERRO: Fila de transmissao cheia!");
+        _txFailed++;
+        return false;
+    }
+
+    TxFrame& frame = _txQueue[_txCount++];
+    frame.data.assign(data);
+    frame.sendAt = sendAt;
+    frame.refTime = refTime;
+    frame.tag = tag;
+    frame.attempts = 0;
+    frame.maxAttempts = maxAttempts > 0 ? maxAttempts : 1;
+    frame.sf = sf;
+
+    return true;
+}
+
+void LoRaHandler::poll() {
+    unsigned long now = millis();
+
+    if (_txBusy) {
+        if (dio0Fired) {
+            // TxDone no DIO0
+            dio0Fired = false;
+            uint8_t irqFlags = readRegister(REG_IRQ_FLAGS);
+            writeRegister(REG_IRQ_FLAGS, irqFlags);
+            finishTransmit((irqFlags & IRQ_TX_DONE_MASK) != 0);
+        } else if (now - _txStart > _txTimeout) {
+            DEBUG_PRINTLN("[LoRa] ERRO: Timeout aguardando TxDone");
+            _txTimeouts++;
+            writeRegister(REG_IRQ_FLAGS, 0xFF);
+            finishTransmit(false);
+        }
+        return;
+    }
+
+    if (isScanning()) {
+        pollScan(now);
+    }
+
+    // Quadro recebido aguardando leitura ou em recepcao: nao interrompe
+    if (dio0Fired || _scanState == SCAN_RX || _txCount == 0) {
+        return;
+    }
+
+    int index = findDueFrame(now);
+    if (index < 0) {
+        return;
+    }
+
+    // Duty cycle: um downlink atrasado ate a janela liberar ja nao serve
+    uint32_t airtimeUs = timeOnAirUs(_txQueue[index].data.length(), _txQueue[index].sf);
+    if (_airtime && !_airtime->canTransmit(airtimeUs, now)) {
+        DEBUG_PRINTF("[LoRa] Orcamento de duty cycle esgotado, descartando quadro (%lu us)\n",
+                     (unsigned long)airtimeUs);
+        _airtime->countBlocked();
+        dropTxFrame(index, now);
+        return;
+    }
+
+    startTransmit(index);
+}
+
+void LoRaHandler::setTxDoneCallback(void (*callback)(const LoRaTxResult& result)) {
+    _txDoneCallback = callback;
+}
+
+void LoRaHandler::setIrqHook(void (*hook)()) {
+    dio0Hook = hook;
+}
+
+uint32_t LoRaHandler::msUntilNextPoll(unsigned long now) const {
+    if (dio0Fired) {
+        return 0;
+    }
+
+    // Timeouts: TxDone, CadDone perdido e header/RxDone da varredura
+    if (_txBusy) {
+        return remainingMs(_txStart + _txTimeout + 1, now);
+    }
+    if (_scanState == SCAN_CAD) {
+        return remainingMs(_scanStart + LORA_CAD_TIMEOUT_MS + 1, now);
+    }
+    if (_scanState == SCAN_RX) {
+        return remainingMs(_scanDeadline, now);
+    }
+
+    // Proximo quadro da fila de TX
+    uint32_t waitMs = UINT32_MAX;
+    for (int i = 0; i < _txCount; i++) {
+        uint32_t remaining = remainingMs(_txQueue[i].sendAt, now);
+        if (remaining < waitMs) {
+            waitMs = remaining;
+        }
+    }
+    return waitMs;
+}
+
+uint32_t LoRaHandler::remainingMs(unsigned long deadline, unsigned long now) {
+    long remaining = (long)(deadline - now);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
 
-    LoRa.beginPacket();
-    LoRa.print(data);
-    int result = LoRa.endPacket();
+void LoRaHandler::setAirtimeAccountant(AirtimeAccountant* accountant) {
+    _airtime = accountant;
+}
 
-    // Volta para modo de recepcao
+uint32_t LoRaHandler::timeOnAirUs(size_t payloadLen, uint8_t sf) const {
+    if (payloadLen > MAX_PACKET_SIZE) {
+        payloadLen = MAX_PACKET_SIZE;
+    }
+    return loraTimeOnAirUs((uint8_t)payloadLen, sf ? sf : _radio.sf, _radio.bandwidth, _radio.codingRate,
+                           _radio.preambleLength);
+}
+
+void LoRaHandler::resumeReceive() {
+    if (isScanning()) {
+        startCad();
+        return;
+    }
+
+    // SF unico: restaura o SF padrao (o downlink pode ter usado outro)
+    _scanState = SCAN_IDLE;
+    setRadioSF(_radio.sf);
     LoRa.receive();
+}
 
-    if (result) {
-        DEBUG_PRINTLN("[LoRa] Envio OK");
-        return true;
+void LoRaHandler::setRadioSF(uint8_t sf) {
+    if (sf != _radioSf) {
+        LoRa.setSpreadingFactor(sf);
+        _radioSf = sf;
+    }
+}
+
+void LoRaHandler::startCad() {
+    unsigned long now = millis();
+
+    // Proximo SF da lista; fecha o ciclo ao voltar ao primeiro
+    _scanIndex = (_scanIndex + 1) % _scanCount;
+    if (_scanIndex == 0) {
+        _scanCycleMs = now - _cycleStart;
+        _cycleStart = now;
+    }
+
+    uint8_t sf = _scanSfs[_scanIndex];
+
+    LoRa.idle();
+    setRadioSF(sf);
+
+    // DIO0 => CadDone e inicia o CAD
+    writeRegister(REG_DIO_MAPPING_1, DIO0_MAPPING_CAD_DONE);
+    writeRegister(REG_IRQ_FLAGS, 0xFF);
+    dio0Fired = false;
+    writeRegister(REG_OP_MODE, MODE_LONG_RANGE_MODE | MODE_CAD);
+
+    _scanState = SCAN_CAD;
+    _scanStart = now;
+    _sfStats[sf - LORA_SF_MIN].cadRuns++;
+}
+
+void LoRaHandler::pollScan(unsigned long now) {
+    if (_scanState == SCAN_CAD) {
+        if (!dio0Fired) {
+            // CadDone perdido (ex.: antes da ISR ser anexada)
+            if (now - _scanStart > LORA_CAD_TIMEOUT_MS) {
+                startCad();
+            }
+            return;
+        }
+
+        dio0Fired = false;
+        uint8_t irqFlags = readRegister(REG_IRQ_FLAGS);
+        writeRegister(REG_IRQ_FLAGS, irqFlags);
+
+        if (!(irqFlags & IRQ_CAD_DETECTED_MASK)) {
+            startCad();
+            return;
+        }
+
+        // Preambulo neste SF: trava em RX (DIO0 => RxDone) ate o header
+        _sfStats[_radioSf - LORA_SF_MIN].detections++;
+        LoRa.receive();
+        _scanState = SCAN_RX;
+        _scanHeaderSeen = false;
+        _scanStart = now;
+        _scanDeadline = now + loraSymbolTimeUs(_radioSf, _radio.bandwidth) * SCAN_HEADER_WAIT_SYMBOLS / 1000 + 1;
+        return;
+    }
+
+    if (_scanState != SCAN_RX || dio0Fired || (long)(now - _scanDeadline) < 0) {
+        return;
+    }
+
+    if (!_scanHeaderSeen && (readRegister(REG_IRQ_FLAGS) & IRQ_VALID_HEADER_MASK)) {
+        // Header valido: aguarda o restante do maior quadro possivel
+        _scanHeaderSeen = true;
+        _scanDeadline = now + timeOnAirUs(MAX_PACKET_SIZE, _radioSf) / 1000 + LORA_TX_TIMEOUT_MARGIN_MS;
+        return;
+    }
+
+    abortScanRx(now);
+}
+
+void LoRaHandler::abortScanRx(unsigned long now) {
+    // Falso positivo do CAD ou quadro perdido: volta a varrer
+    _sfStats[_radioSf - LORA_SF_MIN].missed++;
+    DEBUG_PRINTF("[LoRa] SF%d: deteccao sem quadro valido (%lu ms)\n",
+                 _radioSf, now - _scanStart);
+    startCad();
+}
+
+void LoRaHandler::startTransmit(int index) {
+    TxFrame& frame = _txQueue[index];
+    frame.attempts++;
+
+    DEBUG_PRINTF("[LoRa] Enviando %u bytes (tentativa %d/%d)...\n",
+                 (unsigned)frame.data.length(), frame.attempts, frame.maxAttempts);
+
+    // Interrompe a varredura e transmite no SF do no de destino
+    _scanState = SCAN_IDLE;
+    LoRa.idle();
+    setRadioSF(frame.sf ? frame.sf : _radio.sf);
+
+    if (!LoRa.beginPacket()) {
+        // Radio ainda transmitindo: reagenda sem contar a tentativa
+        frame.attempts--;
+        frame.sendAt = millis() + LORA_TX_RETRY_BACKOFF_MS;
+        return;
+    }
+
+    LoRa.write((const uint8_t*)frame.data.c_str(), frame.data.length());
+
+    // DIO0 => TxDone e inicia a transmissao sem bloquear
+    writeRegister(REG_DIO_MAPPING_1, DIO0_MAPPING_TX_DONE);
+    dio0Fired = false;
+    LoRa.endPacket(true);
+
+    _txActive = index;
+    _txBusy = true;
+    _txStart = millis();
+
+    // Timeout proporcional ao tempo no ar (SF12 leva segundos)
+    uint32_t airtimeUs = timeOnAirUs(frame.data.length(), _radioSf);
+    _txTimeout = airtimeUs / 1000 + LORA_TX_TIMEOUT_MARGIN_MS;
+    if (_airtime) {
+        _airtime->recordTx(airtimeUs, _txStart);
+    }
+}
+
+void LoRaHandler::finishTransmit(bool success) {
+    _txBusy = false;
+
+    // Volta para recepcao continua (DIO0 => RxDone) ou varredura
+    resumeReceive();
+
+    if (_txActive < 0 || _txActive >= _txCount) {
+        _txActive = -1;
+        return;
+    }
+
+    TxFrame& frame = _txQueue[_txActive];
+    unsigned long now = millis();
+
+    if (!success && frame.attempts < frame.maxAttempts) {
+        // Retentativa por temporizador com backoff linear
+        DEBUG_PRINTF("[LoRa] Tentativa %d/%d falhou, retentando...\n",
+                     frame.attempts, frame.maxAttempts);
+        frame.sendAt = now + LORA_TX_RETRY_BACKOFF_MS * frame.attempts;
+        _txActive = -1;
+        return;
+    }
+
+    if (success) {
+        _txDone++;
+        DEBUG_PRINTF("[LoRa] Envio OK (%lu ms)\n", now - _txStart);
     } else {
+        _txFailed++;
         DEBUG_PRINTLN("[LoRa] ERRO no envio!");
-        return false;
     }
+
+    notifyTxDone(frame, now, success);
+
+    removeTxFrame(_txActive);
+    _txActive = -1;
+}
+
+void LoRaHandler::dropTxFrame(int index, unsigned long now) {
+    _txFailed++;
+    notifyTxDone(_txQueue[index], now, false);
+    removeTxFrame(index);
+}
+
+void LoRaHandler::notifyTxDone(const TxFrame& frame, unsigned long now, bool success) {
+    if (!_txDoneCallback) {
+        return;
+    }
+
+    LoRaTxResult result;
+    result.tag = frame.tag;
+    result.refTime = frame.refTime;
+    result.doneTime = now;
+    result.attempts = frame.attempts;
+    result.success = success;
+    _txDoneCallback(result);
+}
+
+void LoRaHandler::removeTxFrame(int index) {
+    // Mantem a ordem de chegada
+    for (int i = index; i < _txCount - 1; i++) {
+        _txQueue[i] = _txQueue[i + 1];
+    }
+    _txCount--;
 }
 
-bool LoRaHandler::sendWithRetry(const String& data, int maxRetries) {
-    for (int i = 0; i < maxRetries; i++) {
-        if (send(data)) {
-            return true;
+int LoRaHandler::findDueFrame(unsigned long now) {
+    // Quadro vencido com o horario alvo mais antigo
+    int due = -1;
+    for (int i = 0; i < _txCount; i++) {
+        if ((long)(now - _txQueue[i].sendAt) >= 0) {
+            if (due < 0 || (long)(_txQueue[i].sendAt - _txQueue[due].sendAt) < 0) {
+                due = i;
+            }
         }
-        DEBUG_PRINTF("[LoRa] Tentativa %d/%d falhou, retentando...\n", i + 1, maxRetries);
-        delay(100 * (i + 1));  // Backoff exponencial simples
     }
-    return false;
+    return due;
+}
+
+RadioConfig LoRaHandler::defaultRadioConfig() {
+    RadioConfig config;
+    config.frequency = (uint32_t)LORA_FREQUENCY;
+    config.bandwidth = (uint32_t)LORA_BW;
+    config.sf = LORA_SF;
+    config.codingRate = LORA_CR;
+    config.txPower = LORA_TX_POWER;
+    config.syncWord = LORA_SYNC_WORD;
+    config.preambleLength = LORA_PREAMBLE_LENGTH;
+    return config;
+}
+
+bool LoRaHandler::canReconfigure() const {
+    // Nem transmitindo, nem com quadro recebido/em recepcao pendente
+    return !_txBusy && !dio0Fired && _scanState != SCAN_RX;
+}
+
+bool LoRaHandler::applyRadioConfig(const RadioConfig& config) {
+    if (!_initialized) {
+        _radio = config;
+        return true;
+    }
+
+    if (!canReconfigure()) {
+        return false;
+    }
+
+    // Standby: os registradores de modem so mudam fora de RX/CAD
+    LoRa.idle();
+    if (config.frequency != _radio.frequency) {
+        LoRa.setFrequency(config.frequency);
+    }
+    _radio = config;
+    _scanState = SCAN_IDLE;
+    configureRadio();
+
+    DEBUG_PRINTF("[LoRa] Nova configuracao: %.2f MHz, SF%d, BW %.0f kHz, CR 4/%d, %d dBm, sync 0x%02X, preambulo %d\n",
+                 _radio.frequency / 1E6, _radio.sf, _radio.bandwidth / 1E3, _radio.codingRate,
+                 _radio.txPower, _radio.syncWord, _radio.preambleLength);
+    return true;
 }
 
 void LoRaHandler::setFrequency(long frequency) {
     LoRa.setFrequency(frequency);
+    _radio.frequency = frequency;
     DEBUG_PRINTF("[LoRa] Frequencia alterada para %.2f MHz\n", frequency / 1E6);
 }
 
 void LoRaHandler::setSpreadingFactor(int sf) {
-    if (sf >= 7 && sf <= 12) {
-        LoRa.setSpreadingFactor(sf);
+    if (sf >= LORA_SF_MIN && sf <= LORA_SF_MAX) {
+        // Na varredura o SF padrao vale apenas para downlinks sem SF
+        _radio.sf = sf;
+        if (!isScanning() && !_txBusy) {
+            setRadioSF(sf);
+        }
         DEBUG_PRINTF("[LoRa] SF alterado para %d\n", sf);
     }
 }
 
 void LoRaHandler::setBandwidth(long bw) {
     LoRa.setSignalBandwidth(bw);
+    _radio.bandwidth = bw;
     DEBUG_PRINTF("[LoRa] BW alterado para %.0f kHz\n", bw / 1E3);
 }
 
 void LoRaHandler::setTxPower(int power) {
     if (power >= 2 && power <= 20) {
         LoRa.setTxPower(power);
+        _radio.txPower = power;
         DEBUG_PRINTF("[LoRa] Potencia TX alterada para %d dBm\n", power);
     }
 }
 
 void LoRaHandler::setSyncWord(int sw) {
     LoRa.setSyncWord(sw);
+    _radio.syncWord = sw;
     DEBUG_PRINTF("[LoRa] Sync Word alterado para 0x%02X\n", sw);
 }
 
@@ -212,7 +649,7 @@ bool LoRaHandler::isInitialized() {
 }
 
 void LoRaHandler::enableReceiveMode() {
-    LoRa.receive();
+    resumeReceive();
 }
 
 void LoRaHandler::sleep() {
@@ -224,3 +661,23 @@ void LoRaHandler::idle() {
     LoRa.idle();
     DEBUG_PRINTLN("[LoRa] Modo idle ativado");
 }
+
+uint8_t LoRaHandler::readRegister(uint8_t address) {
+    digitalWrite(LORA_CS, LOW);
+    SPI.beginTransaction(loraSpiSettings);
+    SPI.transfer(address & 0x7F);
+    uint8_t value = SPI.transfer(0x00);
+    SPI.endTransaction();
+    digitalWrite(LORA_CS, HIGH);
+
+    return value;
+}
+
+void LoRaHandler::writeRegister(uint8_t address, uint8_t value) {
+    digitalWrite(LORA_CS, LOW);
+    SPI.beginTransaction(loraSpiSettings);
+    SPI.transfer(address | 0x80);
+    SPI.transfer(value);
+    SPI.endTransaction();
+    digitalWrite(LORA_CS, HIGH);
+}
@@ -17,35 +17,123 @@
 #include "wifi_handler.h"
 #include "protocol.h"
 #include "web_server.h"
+#include "json_arena.h"
+#include "heap_stats.h"
+#include "dedup_cache.h"
+#include "uplink_queue.h"
+#include "ack_scheduler.h"
+#include "airtime_accountant.h"
+#include "downlink_queue.h"
+#include "adr_engine.h"
+#include "runtime_config.h"
+#include "scheduler.h"
+#include "metrics.h"
+#include "alloc_profiler.h"
+#include "mqtt_client.h"
+#include "semtech_forwarder.h"
+#include "serial_link.h"
+#include "uplink_compressor.h"
+#include "uplink_router.h"
+#include "uplink_body.h"
 
 // Instancias globais
 LoRaHandler lora;
 WiFiHandler wifi;
 Protocol protocol;
 WebServer webServer(80);
-
-// Estatisticas
-uint32_t packetsReceived = 0;
-uint32_t packetsForwarded = 0;
-uint32_t packetsError = 0;
-unsigned long lastStatusReport = 0;
+DedupCache dedup;
+#if UPLINK_TRANSPORT != UPLINK_TRANSPORT_HTTP
+UplinkQueue uplinkQueue;
+#endif
+AckScheduler acks(lora, protocol);
+AirtimeAccountant airtime;
+DownlinkQueue downlinks;
+AdrEngine adr;
+RuntimeConfig runtimeConfig;
+Scheduler scheduler;
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+MqttClient mqtt;
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+SemtechForwarder forwarder;
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SERIAL
+SerialLink serialLink;
+#else
+UplinkRouter uplinkRouter;
+#if UPLINK_COMPRESSION
+UplinkCompressor compressor;
+#endif
+#endif
 
 // LED de status
 bool ledState = false;
-unsigned long lastLedBlink = 0;
+bool ledPulse = false;
 const int LED_BLINK_INTERVAL = 1000;
 
+// Tarefas do escalonador que antecipam o proprio prazo
+int radioTask = -1;
+int uplinkTask = -1;
+int downlinkTask = -1;
+int statusTask = -1;
+int ledTask = -1;
+
 // Prototipos
 void setupLED();
-void updateLED();
+void updateLED(unsigned long now);
+void pulseLED(unsigned long now);
 void blinkLED(int times, int delayMs);
+void setupScheduler();
+void radioTaskRun(unsigned long now);
+void uplinkTaskRun(unsigned long now);
+void downlinkTaskRun(unsigned long now);
+void configTaskRun(unsigned long now);
+void statusTaskRun(unsigned long now);
+void statsTaskRun(unsigned long now);
+void wifiTaskRun(unsigned long now);
 void processLoRaPacket(const LoRaPacket& packet);
+void onLoRaTxDone(const LoRaTxResult& result);
+void scheduleAck(StringView nodeId, uint32_t sequence, unsigned long rxTime, uint8_t sf);
+void sendPendingCommand(StringView nodeId, unsigned long dueTime, uint8_t sf);
+void handleCommandAck(const SensorData& sensorData, unsigned long rxTime);
+bool buildServerPayload(const UplinkEntry& entry, UplinkPayload& serverPayload);
+size_t renderServerPayload(const UplinkEntry& entry, uint8_t format, char* out, size_t capacity);
+bool enqueueUplink(const UplinkEntry& entry, unsigned long now);
+uint8_t getUplinkDepth();
+uint32_t getUplinkRejected();
+void onUplinkDelivered(const UplinkEntry& entry);
+void onUplinkDropped(const UplinkEntry& entry);
+void processUplinkQueue();
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP
+void processEndpoint(uint8_t index);
+#endif
+void processDownlinks();
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+void setupMqtt();
+void onMqttConnected();
+void onMqttPubAck(uint16_t packetId, uint32_t latencyMs);
+void onMqttMessage(StringView topic, StringView payload);
+#endif
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH || UPLINK_TRANSPORT == UPLINK_TRANSPORT_SERIAL
+void onUplinkAck(uint16_t sendId, bool acked);
+#endif
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+void setupSemtech();
+const char* onSemtechTx(const SemtechTxRequest& request);
+#endif
+bool applyRuntimeConfig(const GatewayConfig& config);
+GatewayStats collectStats();
+void updateMetrics(const GatewayStats& stats);
 void sendStatusReport();
 void printStartupInfo();
 
 void setup() {
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_SERIAL
+    // A UART do debug tambem leva os quadros para a ponte no host
+    serialLink.begin(Serial);
+    serialLink.setAckCallback(onUplinkAck);
+#else
     // Inicializa Serial
     Serial.begin(DEBUG_BAUD);
+#endif
     delay(1000);
 
     printStartupInfo();
@@ -54,12 +142,29 @@ void setup() {
     setupLED();
     blinkLED(3, 100);
 
+    // Configuracao gravada na NVS (ou padrao de fabrica)
+    runtimeConfig.begin();
+    lora.applyRadioConfig(runtimeConfig.get().radio);
+    wifi.setServer(runtimeConfig.get().serverHost.c_str(), runtimeConfig.get().serverPort);
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP
+    uplinkRouter.setPrimary(runtimeConfig.get().serverHost.c_str(), runtimeConfig.get().serverPort);
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+    setupMqtt();
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+    setupSemtech();
+#endif
+
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_SERIAL
+    // Uplink cabeado: WiFi desligado (sem dashboard)
+    DEBUG_PRINTF("\n=== Uplink serial a %d baud (WiFi desligado) ===\n", SERIAL_LINK_BAUD);
+#else
     // Inicializa WiFi
     DEBUG_PRINTLN("\n=== Inicializando WiFi ===");
     if (!wifi.begin()) {
         DEBUG_PRINTLN("ERRO: Falha ao conectar WiFi!");
         DEBUG_PRINTLN("Continuando sem WiFi...");
     }
+#endif
 
     // Inicializa LoRa
     DEBUG_PRINTLN("\n=== Inicializando LoRa ===");
@@ -74,6 +179,37 @@ void setup() {
         }
     }
 
+    // Resultado dos downlinks (ACKs) para metricas
+    lora.setTxDoneCallback(onLoRaTxDone);
+
+    // Leituras descartadas pela pressao da fila saem da janela de duplicados
+    UplinkQueue::setDropCallback(onUplinkDropped);
+
+    // Tempo no ar do canal e orcamento de duty cycle dos downlinks
+    lora.setAirtimeAccountant(&airtime);
+    webServer.setAirtimeAccountant(&airtime);
+    webServer.setLoRaHandler(&lora);
+    webServer.setAdrEngine(&adr);
+
+    // Mudancas de configuracao pela API sao aplicadas pelo loop
+    runtimeConfig.setApplyCallback(applyRuntimeConfig);
+    webServer.setRuntimeConfig(&runtimeConfig);
+
+    // Tarefas do loop principal; o DIO0 acorda o loop pela ISR
+    setupScheduler();
+    webServer.setScheduler(&scheduler);
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP
+    webServer.setUplinkRouter(&uplinkRouter);
+#else
+    webServer.setUplinkQueue(&uplinkQueue);
+#endif
+#if SERVER_TLS
+    webServer.setTlsClient(wifi.getTlsClient());
+#endif
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP && UPLINK_COMPRESSION
+    webServer.setUplinkCompressor(&compressor);
+#endif
+
     // Inicializa servidor web (se WiFi conectado)
     if (wifi.isConnected()) {
         DEBUG_PRINTLN("\n=== Inicializando Servidor Web ===");
@@ -92,38 +228,146 @@ void setup() {
 }
 
 void loop() {
-    // Verifica conexao WiFi periodicamente
-    wifi.checkConnection();
+    // Executa as tarefas vencidas e dorme ate o proximo prazo ou evento
+    scheduler.run();
+}
 
-    // Verifica se ha pacotes LoRa disponiveis
-    // Usa lora.available() que internamente chama parsePacket()
+static void IRAM_ATTR onRadioIrq() {
+    Scheduler::signalFromIsr(SCHED_EVENT_RADIO);
+}
+
+void setupScheduler() {
+    // Ordem de registro = ordem de execucao na mesma iteracao
+    radioTask = scheduler.add("radio", radioTaskRun, SCHEDULER_MAX_SLEEP_MS, SCHED_EVENT_RADIO);
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP
+    uplinkTask = scheduler.add("uplink", uplinkTaskRun, 0, SCHED_EVENT_UPLINK);
+#else
+    // O socket nao avisa: confirmacoes e downlinks sao lidos periodicamente
+    uplinkTask = scheduler.add("uplink", uplinkTaskRun, UPLINK_POLL_INTERVAL_MS, SCHED_EVENT_UPLINK);
+#endif
+    downlinkTask = scheduler.add("downlink", downlinkTaskRun, DOWNLINK_POLL_INTERVAL_MS);
+    scheduler.add("config", configTaskRun, CONFIG_POLL_INTERVAL_MS);
+    statusTask = scheduler.add("status", statusTaskRun, runtimeConfig.get().statusIntervalMs);
+    scheduler.add("stats", statsTaskRun, STATS_UPDATE_INTERVAL_MS);
+#if UPLINK_TRANSPORT != UPLINK_TRANSPORT_SERIAL
+    scheduler.add("wifi", wifiTaskRun, WIFI_CHECK_INTERVAL_MS);
+#endif
+    ledTask = scheduler.add("led", updateLED, LED_BLINK_INTERVAL);
+
+    scheduler.begin();
+    lora.setIrqHook(onRadioIrq);
+}
+
+void radioTaskRun(unsigned long now) {
+    AllocTagScope allocTag(ALLOC_TAG_RADIO);
+
+    // Pacote recebido (RxDone sinalizado no DIO0)
     if (lora.available()) {
         LoRaPacket packet = lora.receivePacket();
 
         if (packet.valid) {
-            packetsReceived++;
+            Metrics::inc(METRIC_RX_PACKETS);
+            Metrics::observe(HISTOGRAM_RX_RSSI, packet.rssi);
+            Metrics::observe(HISTOGRAM_RX_SNR, (int32_t)roundf(packet.snr));
             processLoRaPacket(packet);
 
             // Pisca LED ao receber pacote
-            blinkLED(1, 50);
+            pulseLED(now);
         }
     }
 
-    // Envia relatorio de status periodicamente
-    if (millis() - lastStatusReport > STATUS_REPORT_INTERVAL_MS) {
-        sendStatusReport();
-        lastStatusReport = millis();
+    // Fecha a janela do ACK agregado
+    acks.poll();
+
+    // Transmissoes LoRa: TxDone, retentativas e quadros vencidos
+    lora.poll();
+
+    // Proximo prazo do radio: quadro de TX, timeout ou janela do ACK
+    now = millis();
+    uint32_t waitMs = lora.msUntilNextPoll(now);
+    uint32_t flushMs = acks.msUntilFlush(now);
+    if (flushMs < waitMs) {
+        waitMs = flushMs;
+    }
+    if (waitMs < SCHEDULER_MAX_SLEEP_MS) {
+        scheduler.wakeAt(radioTask, now + waitMs);
+    }
+}
+
+#if UPLINK_TRANSPORT != UPLINK_TRANSPORT_HTTP
+void uplinkTaskRun(unsigned long now) {
+    // Confirmacoes, downlinks e keepalive; enviar nao espera resposta
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+    mqtt.poll(now);
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+    forwarder.poll(now);
+#else
+    serialLink.poll(now);
+#endif
+    processUplinkQueue();
+
+    // ACK fim-a-fim agendado por uma confirmacao do servidor
+    if (acks.hasPending()) {
+        scheduler.wakeAt(radioTask, millis());
+    }
+}
+#else
+void uplinkTaskRun(unsigned long now) {
+    // ACK pendente tem prioridade sobre o HTTP (que bloqueia)
+    if (acks.hasPending()) {
+        scheduler.wakeAt(uplinkTask, now + SCHEDULER_BUSY_RETRY_MS);
+        return;
+    }
+
+    // Encaminha um lote por vez a cada servidor
+    processUplinkQueue();
+
+    // ACK fim-a-fim agendado: o radio precisa recalcular o prazo
+    if (acks.hasPending()) {
+        scheduler.wakeAt(radioTask, millis());
     }
 
-    // Atualiza estatisticas do servidor web
-    webServer.updateStats(packetsReceived, packetsForwarded, packetsError,
-                          wifi.getRSSI(), millis());
+    // Proxima leitura (retentativa, prazo do lote incompleto ou teste do disjuntor)
+    unsigned long wakeAt;
+    if (uplinkRouter.nextWake(wakeAt) && wifi.isConnected()) {
+        scheduler.wakeAt(uplinkTask, wakeAt);
+    }
+}
+#endif
 
-    // Atualiza LED de status
-    updateLED();
+void downlinkTaskRun(unsigned long now) {
+    if (acks.hasPending()) {
+        scheduler.wakeAt(downlinkTask, now + SCHEDULER_BUSY_RETRY_MS);
+        return;
+    }
+
+    processDownlinks();
+}
+
+void configTaskRun(unsigned long now) {
+    // Aplica mudanca de configuracao pendente e vigia a recepcao
+    runtimeConfig.poll(now, Metrics::get(METRIC_RX_PACKETS));
+    scheduler.setInterval(statusTask, runtimeConfig.get().statusIntervalMs);
+}
 
-    // Pequeno delay para nao sobrecarregar
-    delay(10);
+void statusTaskRun(unsigned long now) {
+    sendStatusReport();
+}
+
+void statsTaskRun(unsigned long now) {
+    // Atualiza estatisticas do servidor web e medidores de /metrics
+    GatewayStats stats = collectStats();
+    webServer.updateStats(stats);
+    updateMetrics(stats);
+}
+
+void wifiTaskRun(unsigned long now) {
+    wifi.checkConnection();
+
+    // Reconectou: retoma a fila de uplink
+    if (wifi.isConnected() && getUplinkDepth() > 0) {
+        scheduler.wakeAt(uplinkTask, now);
+    }
 }
 
 void setupLED() {
@@ -131,13 +375,24 @@ void setupLED() {
     digitalWrite(LED_PIN, LOW);
 }
 
-void updateLED() {
-    // Pisca LED lentamente para indicar que esta funcionando
-    if (millis() - lastLedBlink > LED_BLINK_INTERVAL) {
-        ledState = !ledState;
+void updateLED(unsigned long now) {
+    // Fim do pulso de pacote: volta ao estado do pisca lento
+    if (ledPulse) {
+        ledPulse = false;
         digitalWrite(LED_PIN, ledState ? HIGH : LOW);
-        lastLedBlink = millis();
+        return;
     }
+
+    // Pisca LED lentamente para indicar que esta funcionando
+    ledState = !ledState;
+    digitalWrite(LED_PIN, ledState ? HIGH : LOW);
+}
+
+void pulseLED(unsigned long now) {
+    // Inverte o LED por LED_PULSE_MS sem bloquear o loop
+    ledPulse = true;
+    digitalWrite(LED_PIN, ledState ? LOW : HIGH);
+    scheduler.wakeAt(ledTask, now + LED_PULSE_MS);
 }
 
 void blinkLED(int times, int delayMs) {
@@ -150,6 +405,13 @@ void blinkLED(int times, int delayMs) {
 }
 
 void processLoRaPacket(const LoRaPacket& packet) {
+    // Perfil: alocacoes deste pacote, do parsing ao agendamento do ACK
+    AllocPacketScope allocPacket;
+    AllocTagScope allocTag(ALLOC_TAG_PROTOCOL);
+
+    // Libera a arena de recepcao ao final do pacote (O(1))
+    JsonArenaScope rxScope(jsonArenaRx);
+
     DEBUG_PRINTLN("\n--- Pacote LoRa Recebido ---");
     DEBUG_PRINTF("Payload: %s\n", packet.payload.c_str());
     DEBUG_PRINTF("RSSI: %d dBm\n", packet.rssi);
@@ -158,7 +420,8 @@ void processLoRaPacket(const LoRaPacket& packet) {
     // Valida o pacote
     if (!protocol.validatePacket(packet.payload)) {
         DEBUG_PRINTLN("ERRO: Pacote invalido!");
-        packetsError++;
+        Metrics::inc(METRIC_DECODE_ERRORS);
+        Metrics::inc(METRIC_PACKET_ERRORS);
         return;
     }
 
@@ -167,63 +430,968 @@ void processLoRaPacket(const LoRaPacket& packet) {
 
     if (!sensorData.valid) {
         DEBUG_PRINTLN("ERRO: Falha no parsing!");
-        packetsError++;
+        Metrics::inc(METRIC_DECODE_ERRORS);
+        Metrics::inc(METRIC_PACKET_ERRORS);
+        return;
+    }
+
+    // Tempo no ar por no (inclusive duplicados: tambem ocupam o canal)
+    airtime.recordNodeRx(sensorData.nodeId, packet.airtimeUs, packet.timestamp);
+
+    // Confirmacao de comando: nao e leitura, nao vai para o servidor
+    if (sensorData.nodeType == "cmd_ack") {
+        handleCommandAck(sensorData, packet.timestamp);
+        return;
+    }
+
+    // Duplicado (ACK perdido / retransmissao): re-ACK sem novo uplink
+    if (dedup.isDuplicate(sensorData.nodeId, sensorData.sequence)) {
+        dedup.countSuppressed();
+        if (dedup.isInFlight(sensorData.nodeId, sensorData.sequence)) {
+            // ACK fim-a-fim: a original ainda espera o servidor
+            DEBUG_PRINTF("Pacote duplicado (%s seq %u) aguardando o servidor, sem ACK\n",
+                         sensorData.nodeId.c_str(), sensorData.sequence);
+            return;
+        }
+        DEBUG_PRINTF("Pacote duplicado (%s seq %u), reenviando ACK\n",
+                     sensorData.nodeId.c_str(), sensorData.sequence);
+        scheduleAck(sensorData.nodeId, sensorData.sequence, packet.timestamp, packet.sf);
         return;
     }
 
+#if ADR_ENABLED
+    // Historico do enlace; um ajuste de SF/potencia vai junto deste ACK
+    adr.update(sensorData.nodeId, sensorData.sequence, packet.snr, packet.rssi, packet.sf,
+               packet.timestamp, downlinks);
+#endif
+
     // Registra pacote no servidor web para dashboard
-    webServer.logPacket(sensorData.nodeId, sensorData.nodeType,
-                        sensorData.data, packet.rssi, packet.snr);
+    // (e atualiza a qualidade de enlace do no pela sequencia)
+    webServer.logPacket(sensorData.nodeId, sensorData.nodeType, sensorData.sequence,
+                        sensorData.data, packet.rssi, packet.snr, packet.freqError);
 
-    // Cria payload para o servidor
-    String serverPayload = protocol.createServerPayload(sensorData, packet.rssi, packet.snr);
+    // Enfileira para envio ao servidor
+    UplinkEntry entry;
+    entry.payload = packet.payload;
+    entry.nodeId = sensorData.nodeId;
+    entry.sequence = sensorData.sequence;
+    entry.rssi = packet.rssi;
+    entry.snr = packet.snr;
+    entry.freqError = packet.freqError;
+    entry.sf = packet.sf;
+    entry.priority = UplinkQueue::classify(sensorData);
+    entry.rxTime = packet.timestamp;
+    entry.nextAttempt = packet.timestamp;
+    entry.attempts = 0;
+    entry.sendId = 0;
+    entry.linkSeq = 0;
+    entry.completed = false;
+    entry.mirror = false;
 
-    // Envia para o servidor via HTTP
-    if (wifi.isConnected()) {
-        DEBUG_PRINTLN("Enviando para servidor...");
+    if (!enqueueUplink(entry, packet.timestamp)) {
+        // Sem ACK: o no vai retransmitir
+        Metrics::inc(METRIC_UPLINK_REJECTED);
+        Metrics::inc(METRIC_PACKET_ERRORS);
+        return;
+    }
+    scheduler.signal(SCHED_EVENT_UPLINK);
 
-        if (wifi.sendHTTPPost(SERVER_ENDPOINT, serverPayload)) {
-            DEBUG_PRINTLN("Dados enviados com sucesso!");
-            packetsForwarded++;
+    // Na janela desde ja: retransmissoes nao voltam para a fila
+    dedup.markAccepted(sensorData.nodeId, sensorData.sequence,
+                       ACK_POLICY == ACK_POLICY_END_TO_END);
 
-            // Envia ACK para o no (opcional)
-            String ack = protocol.createAck(sensorData.nodeId, sensorData.sequence, true);
-            lora.send(ack);
-        } else {
-            DEBUG_PRINTLN("ERRO: Falha ao enviar para servidor!");
-            packetsError++;
+#if ACK_POLICY == ACK_POLICY_ON_ENQUEUE
+    // Leitura aceita localmente: ACK logo apos a recepcao
+    scheduleAck(sensorData.nodeId, sensorData.sequence, packet.timestamp, packet.sf);
+#else
+    // ACK so depois do servidor, mas o no esta escutando agora
+    sendPendingCommand(sensorData.nodeId, packet.timestamp + ACK_DELAY_MS, packet.sf);
+#endif
+
+    DEBUG_PRINTF("Leitura enfileirada como %s (%d/%d)\n", UplinkQueue::className(entry.priority),
+                 getUplinkDepth(), PACKET_QUEUE_SIZE);
+    DEBUG_PRINTLN("----------------------------\n");
+}
+
+void onLoRaTxDone(const LoRaTxResult& result) {
+    if (result.tag == LORA_TX_TAG_ACK) {
+        acks.recordSent(result);
+        if (result.success) {
+            Metrics::observe(HISTOGRAM_ACK_TURNAROUND, result.doneTime - result.refTime);
+        }
+    }
+
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+    // txnb do stat: downlinks do PULL_RESP efetivamente transmitidos
+    if (result.tag == LORA_TX_TAG_DATA && result.success) {
+        forwarder.countTx();
+    }
+#endif
+}
+
+void scheduleAck(StringView nodeId, uint32_t sequence, unsigned long rxTime, uint8_t sf) {
+    // Comando pendente para o no vai junto do ACK
+    DownlinkCommand* command = downlinks.nextFor(nodeId, rxTime);
+
+    if (acks.schedule(nodeId, sequence, true, rxTime, rxTime + ACK_DELAY_MS, command, sf) && command) {
+        downlinks.markSent(command, millis());
+    }
+}
+
+void sendPendingCommand(StringView nodeId, unsigned long dueTime, uint8_t sf) {
+    DownlinkCommand* command = downlinks.nextFor(nodeId, millis());
+    if (!command) {
+        return;
+    }
+
+    LoRaPayload frame = protocol.createCommand(*command);
+    if (lora.sendAt(frame, dueTime, LORA_TX_TAG_COMMAND, command->fetchedAt,
+                    LORA_TX_MAX_ATTEMPTS, sf)) {
+        downlinks.markSent(command, millis());
+    }
+}
+
+void handleCommandAck(const SensorData& sensorData, unsigned long rxTime) {
+    uint32_t commandId = sensorData.data["cmd"] | 0;
+    bool success = sensorData.data["ok"] | false;
+    uint32_t execMs = sensorData.data["exec_ms"] | 0;
+
+    if (!downlinks.confirm(sensorData.nodeId, commandId, success, execMs, rxTime)) {
+        DEBUG_PRINTF("Confirmacao de comando desconhecido/repetido (%s cmd %u)\n",
+                     sensorData.nodeId.c_str(), commandId);
+        return;
+    }
+
+    // Ajuste do ADR passa a valer so depois da confirmacao do no
+    if (AdrEngine::isLocalCommand(commandId)) {
+        adr.confirm(sensorData.nodeId, commandId, success, rxTime);
+    }
+}
+
+bool buildServerPayload(const UplinkEntry& entry, UplinkPayload& serverPayload) {
+    // Monta o payload do servidor a partir do quadro original
+    SensorData sensorData = protocol.parseLoRaPacket(entry.payload);
+    if (sensorData.valid) {
+        serverPayload = protocol.createServerPayload(sensorData, entry.rssi, entry.snr, entry.rxTime,
+                                                     entry.freqError,
+                                                     webServer.getLinkQuality(entry.nodeId));
+    }
+
+    if (serverPayload.isEmpty()) {
+        DEBUG_PRINTLN("ERRO: Falha ao montar payload do servidor!");
+        Metrics::inc(METRIC_PACKET_ERRORS);
+        return false;
+    }
+    return true;
+}
+
+size_t renderServerPayload(const UplinkEntry& entry, uint8_t format, char* out, size_t capacity) {
+    // Mesmo payload de buildServerPayload, escrito direto no corpo do lote
+    JsonArenaScope rxScope(jsonArenaRx);
+    SensorData sensorData = protocol.parseLoRaPacket(entry.payload);
+    if (!sensorData.valid) {
+        return 0;
+    }
+    return protocol.writeServerPayload(sensorData, entry.rssi, entry.snr, entry.rxTime,
+                                       entry.freqError, webServer.getLinkQuality(entry.nodeId),
+                                       out, capacity, format);
+}
+
+bool enqueueUplink(const UplinkEntry& entry, unsigned long now) {
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP
+    return uplinkRouter.push(entry, now);
+#else
+    return uplinkQueue.push(entry);
+#endif
+}
+
+uint8_t getUplinkDepth() {
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP
+    return uplinkRouter.size();
+#else
+    return uplinkQueue.size();
+#endif
+}
+
+uint32_t getUplinkRejected() {
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP
+    return uplinkRouter.getRejected();
+#else
+    return uplinkQueue.getRejected();
+#endif
+}
+
+void onUplinkDelivered(const UplinkEntry& entry) {
+    Metrics::inc(METRIC_UPLINK_FORWARDED);
+#if UPLINK_TRANSPORT != UPLINK_TRANSPORT_HTTP
+    // HTTP: cada servidor registra na propria fila
+    uplinkQueue.recordDelivered(entry, millis());
+#endif
+
+#if ACK_POLICY == ACK_POLICY_END_TO_END
+    // ACK fim-a-fim: somente apos confirmacao do servidor
+    dedup.markDelivered(entry.nodeId, entry.sequence);
+    acks.schedule(entry.nodeId, entry.sequence, true, entry.rxTime, millis(), nullptr, entry.sf);
+#endif
+}
+
+void onUplinkDropped(const UplinkEntry& entry) {
+#if ACK_POLICY == ACK_POLICY_END_TO_END
+    // Sem ACK ao no: a proxima retransmissao volta para a fila
+    if (!entry.mirror) {
+        dedup.release(entry.nodeId, entry.sequence);
+    }
+#endif
+}
+
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+void processUplinkQueue() {
+    char topic[MQTT_TOPIC_MAX_LEN + 1];
+
+    // Publica as leituras ainda nao enviadas ate encher a janela de PUBACK
+    for (uint8_t i = 0; i < uplinkQueue.size() && mqtt.canPublish(); i++) {
+        UplinkEntry* entry = uplinkQueue.at(i);
+        if (entry->completed || entry->sendId != 0) {
+            continue;
+        }
+
+        // So republica apos queda de sessao; sem ACK ao no, desiste apos
+        // UPLINK_MAX_ATTEMPTS (ja confirmada, so sai entregue ou despejada)
+        if (entry->attempts >= UPLINK_MAX_ATTEMPTS && !UplinkQueue::isAcked(*entry)) {
+            DEBUG_PRINTF("ERRO: %s seq %u sem PUBACK apos %d sessoes, descartando\n",
+                         entry->nodeId.c_str(), entry->sequence, entry->attempts);
+            Metrics::inc(METRIC_PACKET_ERRORS);
+            onUplinkDropped(*entry);
+            entry->completed = true;
+            continue;
+        }
+
+        JsonArenaScope rxScope(jsonArenaRx);
+        AllocTagScope allocTag(ALLOC_TAG_PROTOCOL);
+
+        UplinkPayload serverPayload;
+        if (!buildServerPayload(*entry, serverPayload)) {
+            entry->completed = true;
+            continue;
+        }
+
+        snprintf(topic, sizeof(topic), "%s/%s/up/%s", MQTT_TOPIC_PREFIX, GATEWAY_ID,
+                 entry->nodeId.c_str());
+        uint16_t packetId = mqtt.publish(topic, serverPayload, 1);
+        if (packetId == 0) {
+            Metrics::inc(METRIC_UPLINK_ERRORS);
+            break;
+        }
+
+        entry->sendId = packetId;
+        if (entry->attempts < 255) {
+            entry->attempts++;
+        }
+    }
+
+    uplinkQueue.popCompleted();
+}
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+void processUplinkQueue() {
+    RadioConfig radio = lora.getRadioConfig();
+
+    unsigned long now = millis();
+
+    // Agrupa as leituras ainda nao enviadas em PUSH_DATA (varios rxpk por datagrama)
+    while (forwarder.canPush()) {
+        UplinkEntry* batch[SEMTECH_MAX_RXPK];
+        uint8_t count = 0;
+
+        for (uint8_t i = 0; i < uplinkQueue.size() && count < SEMTECH_MAX_RXPK; i++) {
+            UplinkEntry* entry = uplinkQueue.at(i);
+            if (entry->completed || entry->sendId != 0 || (long)(now - entry->nextAttempt) < 0) {
+                continue;
+            }
+
+            if (entry->attempts >= UPLINK_MAX_ATTEMPTS && !UplinkQueue::isAcked(*entry)) {
+                DEBUG_PRINTF("ERRO: %s seq %u sem PUSH_ACK apos %d envios, descartando\n",
+                             entry->nodeId.c_str(), entry->sequence, entry->attempts);
+                Metrics::inc(METRIC_PACKET_ERRORS);
+                onUplinkDropped(*entry);
+                entry->completed = true;
+                continue;
+            }
+            batch[count++] = entry;
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        uint16_t token = 0;
+        uint8_t sent = forwarder.pushRxpk(batch, count, radio, token);
+        if (sent == 0) {
+            Metrics::inc(METRIC_UPLINK_ERRORS);
+            break;
+        }
+
+        for (uint8_t i = 0; i < sent; i++) {
+            batch[i]->sendId = token;
+            if (batch[i]->attempts < 255) {
+                batch[i]->attempts++;
+            }
         }
+    }
+
+    uplinkQueue.popCompleted();
+}
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SERIAL
+void processUplinkQueue() {
+    unsigned long now = millis();
+
+    // Um registro por leitura; a janela de ACKs da ponte limita o que fica em voo
+    for (uint8_t i = 0; i < uplinkQueue.size() && serialLink.canSend(); i++) {
+        UplinkEntry* entry = uplinkQueue.at(i);
+        if (entry->completed || entry->sendId != 0 || (long)(now - entry->nextAttempt) < 0) {
+            continue;
+        }
+
+        if (entry->attempts >= UPLINK_MAX_ATTEMPTS && !UplinkQueue::isAcked(*entry)) {
+            DEBUG_PRINTF("ERRO: %s seq %u sem ACK da ponte apos %d envios, descartando\n",
+                         entry->nodeId.c_str(), entry->sequence, entry->attempts);
+            Metrics::inc(METRIC_PACKET_ERRORS);
+            onUplinkDropped(*entry);
+            entry->completed = true;
+            continue;
+        }
+
+        JsonArenaScope rxScope(jsonArenaRx);
+        AllocTagScope allocTag(ALLOC_TAG_PROTOCOL);
+
+        SensorData sensorData = protocol.parseLoRaPacket(entry->payload);
+        uint16_t seq = sensorData.valid ? serialLink.sendReading(*entry, sensorData) : 0;
+        if (seq == 0) {
+            // Canal livre garantido por canSend(): a leitura nao cabe no registro
+            Metrics::inc(METRIC_PACKET_ERRORS);
+            entry->completed = true;
+            continue;
+        }
+
+        entry->sendId = seq;
+        entry->linkSeq = seq;
+        if (entry->attempts < 255) {
+            entry->attempts++;
+        }
+    }
+
+    uplinkQueue.popCompleted();
+}
+#else
+#if UPLINK_COMPRESSION
+// Corpo do POST em lote: [leitura, leitura, ...] (entrada do compressor)
+static char uplinkBatchBody[UPLINK_BATCH_BUFFER_SIZE];
+#else
+// Corpo do POST em lote, montado enquanto vai para o socket
+static UplinkBodyStream uplinkBody(renderServerPayload);
+#endif
+
+void processUplinkQueue() {
+    if (!wifi.isConnected()) {
+        return;
+    }
+
+    // Um lote por servidor, na ordem da lista: cada um tem a propria fila
+    for (uint8_t i = 0; i < uplinkRouter.getCount(); i++) {
+        processEndpoint(i);
+    }
+}
+
+void processEndpoint(uint8_t index) {
+    UplinkEndpoint& endpoint = uplinkRouter.getEndpoint(index);
+    UplinkQueue& queue = endpoint.queue;
+    UplinkEntry* entry = queue.front();
+
+    if (!entry) {
+        return;
+    }
+
+    unsigned long now = millis();
+    if ((long)(now - entry->nextAttempt) < 0 || !uplinkRouter.canSend(index, now)) {
+        return;
+    }
+
+    // Lote incompleto espera mais leituras ate o prazo do controle AIMD
+    uint8_t pending = 0;
+    unsigned long oldestRx = entry->rxTime;
+    bool hasEvent = false;
+    unsigned long eventRx = 0;
+    for (uint8_t i = 0; i < queue.size(); i++) {
+        const UplinkEntry* queued = queue.at(i);
+        if (queued->completed) {
+            continue;
+        }
+        pending++;
+        if ((long)(queued->rxTime - oldestRx) < 0) {
+            oldestRx = queued->rxTime;
+        }
+        if (queued->priority == UPLINK_CLASS_EVENT &&
+            (!hasEvent || (long)(queued->rxTime - eventRx) < 0)) {
+            hasEvent = true;
+            eventRx = queued->rxTime;
+        }
+    }
+    if (endpoint.batcher.decide(now, pending, oldestRx, hasEvent, eventRx) == BATCH_FLUSH_WAIT) {
+        return;
+    }
+
+    AllocTagScope allocTag(ALLOC_TAG_PROTOCOL);
+
+    // Junta as leituras da frente da fila (mesmo destino e mesma sorte)
+    uint8_t batchSize = endpoint.batcher.getBatchSize();
+    UplinkEntry* batch[UPLINK_HTTP_BATCH_MAX];
+    uint8_t count = 0;
+    uint8_t format = endpoint.format;
+#if UPLINK_COMPRESSION
+    bool json = format == PAYLOAD_FORMAT_JSON;
+    size_t length = 1;          // '[' ou fixarray, escrito no fim
+#else
+    uplinkBody.clear(format);
+#endif
+
+    for (uint8_t i = 0; i < queue.size() && count < batchSize; i++) {
+        UplinkEntry* candidate = queue.at(i);
+        if (candidate->completed) {
+            continue;
+        }
+
+#if UPLINK_COMPRESSION
+        // Escrita direto no corpo; sempre cabe: o buffer comporta
+        // UPLINK_HTTP_BATCH_MAX payloads
+        size_t separator = count > 0 && json ? 1 : 0;
+        size_t written = renderServerPayload(*candidate, format,
+                                             uplinkBatchBody + length + separator,
+                                             UPLINK_BATCH_BUFFER_SIZE - length - separator - 1);
+        bool added = written > 0;
+        if (added) {
+            if (separator) {
+                uplinkBatchBody[length] = ',';
+            }
+            length += separator + written;
+        }
+#else
+        bool added = uplinkBody.add(candidate);
+#endif
+        if (!added) {
+            DEBUG_PRINTLN("ERRO: Falha ao montar payload do servidor!");
+            Metrics::inc(METRIC_PACKET_ERRORS);
+            candidate->completed = true;
+            continue;
+        }
+        batch[count++] = candidate;
+    }
+
+    if (count == 0) {
+        queue.popCompleted();
+        return;
+    }
+
+    const char* contentType = format == PAYLOAD_FORMAT_MSGPACK ? MSGPACK_CONTENT_TYPE : nullptr;
+#if UPLINK_COMPRESSION
+    if (json) {
+        uplinkBatchBody[0] = '[';
+        uplinkBatchBody[length++] = ']';
     } else {
-        DEBUG_PRINTLN("AVISO: WiFi desconectado, dados nao enviados");
-        packetsError++;
+        uplinkBatchBody[0] = (char)(0x90 | count);
     }
 
-    DEBUG_PRINTLN("----------------------------\n");
+    StringView body(uplinkBatchBody, length);
+    const char* encoding = nullptr;
+    size_t packed = compressor.compress((const uint8_t*)uplinkBatchBody, length);
+    if (packed > 0) {
+        body = StringView((const char*)compressor.output(), packed);
+        encoding = "deflate";
+    }
+
+    DEBUG_PRINTF("Enviando %d leitura(s) para %s:%d (%d bytes, %d no corpo)...\n",
+                 count, endpoint.host.c_str(), endpoint.port, (int)length, (int)body.length());
+
+    uint32_t sendStart = micros();
+    bool sent = wifi.sendHTTPPost(endpoint.host.c_str(), endpoint.port, SERVER_BATCH_ENDPOINT,
+                                  body, encoding, contentType);
+#else
+    DEBUG_PRINTF("Enviando %d leitura(s) para %s:%d (%d bytes em fluxo)...\n",
+                 count, endpoint.host.c_str(), endpoint.port, (int)uplinkBody.getLength());
+
+    uint32_t sendStart = micros();
+    bool sent = wifi.sendHTTPPost(endpoint.host.c_str(), endpoint.port, SERVER_BATCH_ENDPOINT,
+                                  uplinkBody, uplinkBody.getLength(), contentType);
+#endif
+    uint32_t sendUs = micros() - sendStart;
+    Metrics::observe(HISTOGRAM_UPLINK_HTTP, sendUs / 1000);
+#if UPLINK_MSGPACK
+    uplinkRouter.recordFormat(index, wifi.getLastHttpStatus(), wifi.getLastAcceptsMsgPack());
+#endif
+    uint8_t backlog = pending > count ? pending - count : 0;
+
+    if (sent) {
+        DEBUG_PRINTLN("Dados enviados com sucesso!");
+#if UPLINK_COMPRESSION
+        compressor.recordTransfer(body.length(), sendUs);
+#endif
+        unsigned long deliveredAt = millis();
+        for (uint8_t i = 0; i < count; i++) {
+            queue.recordDelivered(*batch[i], deliveredAt);
+            // Copia para outro servidor: a leitura e confirmada pela original
+            if (!batch[i]->mirror) {
+                onUplinkDelivered(*batch[i]);
+            }
+            batch[i]->completed = true;
+        }
+        endpoint.delivered += count;
+        queue.popCompleted();
+        uplinkRouter.recordResult(index, wifi.getLastHttpStatus(), wifi.getLastRequestMs(),
+                                  backlog, deliveredAt);
+        return;
+    }
+
+    Metrics::inc(METRIC_UPLINK_ERRORS);
+    now = millis();
+    for (uint8_t i = 0; i < count; i++) {
+        UplinkEntry* failed = batch[i];
+        if (failed->attempts < 255) {
+            failed->attempts++;
+        }
+        if (failed->attempts < UPLINK_MAX_ATTEMPTS) {
+            failed->nextAttempt = now + UplinkQueue::retryDelay(failed->attempts);
+        } else if (!failed->mirror && uplinkRouter.reroute(index, *failed, now)) {
+            // Outro servidor disponivel assume a leitura
+            failed->completed = true;
+        } else if (UplinkQueue::isAcked(*failed)) {
+            // Ja confirmada ao no: espera o servidor voltar (o disjuntor
+            // segura os envios); so sai da fila entregue ou despejada
+            failed->nextAttempt = now + UplinkQueue::retryDelay(failed->attempts);
+        } else {
+            DEBUG_PRINTF("ERRO: Falha ao enviar %s seq %u apos %d tentativas, descartando\n",
+                         failed->nodeId.c_str(), failed->sequence, failed->attempts);
+            if (!failed->mirror) {
+                Metrics::inc(METRIC_PACKET_ERRORS);
+            }
+            onUplinkDropped(*failed);
+            failed->completed = true;
+        }
+    }
+    DEBUG_PRINTF("ERRO: Falha ao enviar lote para %s:%d (tentativa %d, proxima em %lu ms)\n",
+                 endpoint.host.c_str(), endpoint.port, batch[0]->attempts,
+                 UplinkQueue::retryDelay(batch[0]->attempts));
+    queue.popCompleted();
+
+    // Falhas seguidas abrem o disjuntor e passam a fila a outro servidor
+    uplinkRouter.recordResult(index, wifi.getLastHttpStatus(), wifi.getLastRequestMs(),
+                              backlog, millis());
+}
+#endif
+
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+void processDownlinks() {
+    downlinks.expire(millis());
+
+    // Relata comandos concluidos; comandos novos chegam pela assinatura
+    char topic[MQTT_TOPIC_MAX_LEN + 1];
+    DownlinkCommand* done;
+    while ((done = downlinks.nextReport()) != nullptr) {
+        String body = protocol.createCommandStatus(*done);
+        snprintf(topic, sizeof(topic), "%s/%s/cmd_status/%lu", MQTT_TOPIC_PREFIX, GATEWAY_ID,
+                 (unsigned long)done->id);
+
+        if (mqtt.publish(topic, body, 1) == 0) {
+            return;
+        }
+        downlinks.release(done);
+    }
+}
+
+void setupMqtt() {
+    mqtt.setServer(runtimeConfig.get().serverHost.c_str(), MQTT_PORT);
+    mqtt.setConnectedCallback(onMqttConnected);
+    mqtt.setAckCallback(onMqttPubAck);
+    mqtt.setMessageCallback(onMqttMessage);
+    mqtt.begin(GATEWAY_ID);
+    webServer.setMqttClient(&mqtt);
+}
+
+void onMqttConnected() {
+    char topic[MQTT_TOPIC_MAX_LEN + 1];
+    snprintf(topic, sizeof(topic), "%s/%s/down", MQTT_TOPIC_PREFIX, GATEWAY_ID);
+    mqtt.subscribe(topic, 1);
+
+    // Sessao nova: leituras sem PUBACK da sessao anterior sao republicadas
+    for (uint8_t i = 0; i < uplinkQueue.size(); i++) {
+        uplinkQueue.at(i)->sendId = 0;
+    }
+}
+
+void onMqttPubAck(uint16_t packetId, uint32_t latencyMs) {
+    // PUBACKs podem chegar fora da ordem da fila
+    for (uint8_t i = 0; i < uplinkQueue.size(); i++) {
+        UplinkEntry* entry = uplinkQueue.at(i);
+        if (entry->sendId == packetId && !entry->completed) {
+            entry->completed = true;
+            onUplinkDelivered(*entry);
+            break;
+        }
+    }
+
+    uplinkQueue.popCompleted();
+}
+
+void onMqttMessage(StringView topic, StringView payload) {
+    AllocTagScope allocTag(ALLOC_TAG_PROTOCOL);
+
+    char expected[MQTT_TOPIC_MAX_LEN + 1];
+    snprintf(expected, sizeof(expected), "%s/%s/down", MQTT_TOPIC_PREFIX, GATEWAY_ID);
+    if (topic != StringView(expected)) {
+        return;
+    }
+
+    // Mesmo formato de GET /api/commands/pending ({"commands": [...]})
+    uint8_t added = protocol.parseServerCommands(payload, downlinks, millis());
+    if (added > 0) {
+        DEBUG_PRINTF("%d comando(s) de downlink recebidos via MQTT\n", added);
+    }
+}
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH || UPLINK_TRANSPORT == UPLINK_TRANSPORT_SERIAL
+void processDownlinks() {
+    downlinks.expire(millis());
+
+    // Sem /api/commands: so os comandos locais (ADR) passam pela fila
+    // (no modo Semtech, downlinks chegam por PULL_RESP); o resultado fica no log
+    DownlinkCommand* done;
+    while ((done = downlinks.nextReport()) != nullptr) {
+        downlinks.release(done);
+    }
+}
+
+void onUplinkAck(uint16_t sendId, bool acked) {
+    for (uint8_t i = 0; i < uplinkQueue.size(); i++) {
+        UplinkEntry* entry = uplinkQueue.at(i);
+        // ACK serial atrasado chega depois do timeout, com a leitura esperando o reenvio
+        bool matches = entry->sendId == sendId || (acked && entry->linkSeq == sendId);
+        if (!matches || entry->completed) {
+            continue;
+        }
+
+        if (acked) {
+            entry->completed = true;
+            onUplinkDelivered(*entry);
+        } else {
+            // Sem confirmacao (PUSH_ACK ou ACK da ponte): volta para um envio
+            // depois da espera (cresce a cada falha)
+            entry->sendId = 0;
+            entry->nextAttempt = millis() + UplinkQueue::retryDelay(entry->attempts);
+        }
+    }
+
+    if (!acked) {
+        Metrics::inc(METRIC_UPLINK_ERRORS);
+    }
+    uplinkQueue.popCompleted();
+}
+
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+void setupSemtech() {
+    forwarder.setServer(runtimeConfig.get().serverHost.c_str(), SEMTECH_UDP_PORT);
+    forwarder.setAckCallback(onUplinkAck);
+    forwarder.setTxCallback(onSemtechTx);
+    forwarder.begin();
+    webServer.setSemtechForwarder(&forwarder);
+}
+
+const char* onSemtechTx(const SemtechTxRequest& request) {
+    // Um unico canal: so a frequencia e a largura de banda em uso
+    RadioConfig radio = lora.getRadioConfig();
+    long freqDelta = (long)request.frequency - (long)radio.frequency;
+    if (freqDelta > 100 || freqDelta < -100 || request.bandwidth != radio.bandwidth ||
+        request.sf < LORA_SF_MIN || request.sf > LORA_SF_MAX) {
+        return "TX_FREQ";
+    }
+
+    unsigned long now = millis();
+    unsigned long dueTime = now;
+    if (!request.immediate) {
+        // tmst na mesma base do rxpk (us, volta em 32 bits)
+        int32_t aheadUs = (int32_t)(request.tmst - SemtechForwarder::toTmst(now));
+        if (aheadUs < 0) {
+            return "TOO_LATE";
+        }
+        if ((uint32_t)aheadUs / 1000 > SEMTECH_TX_MAX_AHEAD_MS) {
+            return "TOO_EARLY";
+        }
+        dueTime = now + aheadUs / 1000;
+    }
+
+    if (!lora.sendAt(request.data, dueTime, LORA_TX_TAG_DATA, now, LORA_TX_MAX_ATTEMPTS, request.sf)) {
+        return "COLLISION_PACKET";
+    }
+
+    // O radio recalcula o prazo com o quadro novo
+    scheduler.wakeAt(radioTask, now);
+    return "NONE";
+}
+#endif
+#else
+void processDownlinks() {
+    if (!wifi.isConnected()) {
+        return;
+    }
+
+    downlinks.expire(millis());
+
+    // Relata comandos concluidos (para no primeiro erro)
+    char endpoint[96];
+    DownlinkCommand* done;
+    while ((done = downlinks.nextReport()) != nullptr) {
+        String body = protocol.createCommandStatus(*done);
+        snprintf(endpoint, sizeof(endpoint), "%s/%lu/status", COMMANDS_ENDPOINT, (unsigned long)done->id);
+
+        if (!wifi.sendHTTPPost(endpoint, body)) {
+            return;
+        }
+        downlinks.release(done);
+    }
+
+    // Busca novos comandos ate o espaco livre na fila
+    uint8_t freeSlots = downlinks.freeSlots();
+    if (freeSlots == 0) {
+        return;
+    }
+
+    snprintf(endpoint, sizeof(endpoint), "%s/pending?gateway_id=%s&max=%d",
+             COMMANDS_ENDPOINT, GATEWAY_ID, freeSlots);
+
+    String response;
+    if (wifi.sendHTTPGet(endpoint, response)) {
+        uint8_t added = protocol.parseServerCommands(response, downlinks, millis());
+        if (added > 0) {
+            DEBUG_PRINTF("%d comando(s) de downlink recebidos do servidor\n", added);
+        }
+    }
+}
+#endif
+
+bool applyRuntimeConfig(const GatewayConfig& config) {
+    // ACK agendado sairia com os parametros novos: espera ser enviado
+    if (acks.hasPending() || !lora.applyRadioConfig(config.radio)) {
+        return false;
+    }
+
+    wifi.setServer(config.serverHost.c_str(), config.serverPort);
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_HTTP
+    uplinkRouter.setPrimary(config.serverHost.c_str(), config.serverPort);
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+    mqtt.setServer(config.serverHost.c_str(), MQTT_PORT);
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+    forwarder.setServer(config.serverHost.c_str(), SEMTECH_UDP_PORT);
+#endif
+    return true;
+}
+
+GatewayStats collectStats() {
+    GatewayStats stats;
+
+    stats.packetsReceived = Metrics::get(METRIC_RX_PACKETS);
+    stats.packetsForwarded = Metrics::get(METRIC_UPLINK_FORWARDED);
+    stats.packetsError = Metrics::get(METRIC_PACKET_ERRORS);
+    stats.packetsDuplicate = dedup.getSuppressed();
+
+    stats.queueDepth = getUplinkDepth();
+    stats.queueRejected = getUplinkRejected();
+
+    stats.ackPolicy = ACK_POLICY;
+    stats.acksSent = acks.getSentCount();
+    stats.ackAvgMs = acks.getAverageTurnaround();
+    stats.ackMaxMs = acks.getMaxTurnaround();
+    stats.ackedReadings = acks.getAckedReadings();
+    stats.ackAirtimeMs = acks.getAirtimeMs();
+    stats.ackSingleAirtimeMs = acks.getSingleAirtimeMs();
+
+    stats.cmdPending = downlinks.getPending();
+    stats.cmdDelivered = downlinks.getDelivered();
+    stats.cmdFailed = downlinks.getFailed();
+    stats.cmdAvgLatencyMs = downlinks.getAverageLatency();
+    stats.cmdMaxLatencyMs = downlinks.getMaxLatency();
+
+    unsigned long now = millis();
+    stats.rxAirtimeMs = airtime.getRxAirtimeMs(now);
+    stats.txAirtimeMs = airtime.getTxAirtimeMs(now);
+    stats.rxUtilization = airtime.getRxUtilization(now);
+    stats.txUtilization = airtime.getTxUtilization(now);
+    stats.txBlocked = airtime.getTxBlocked();
+
+    stats.adrAdjustments = adr.getAdjustments();
+    stats.adrReverts = adr.getReverts();
+
+    stats.linksDegraded = webServer.getDegradedLinks();
+
+    stats.configApplied = runtimeConfig.getApplied();
+    stats.configRollbacks = runtimeConfig.getRollbacks();
+
+    stats.wifiRssi = wifi.getRSSI();
+    stats.uptimeMs = millis();
+
+    return stats;
+}
+
+void updateMetrics(const GatewayStats& stats) {
+    // Contadores mantidos pelos proprios modulos
+    Metrics::set(METRIC_RX_DUPLICATES, stats.packetsDuplicate);
+    Metrics::set(METRIC_TX_FRAMES, lora.getTxDone());
+    Metrics::set(METRIC_TX_FAILED, lora.getTxFailed());
+    Metrics::set(METRIC_TX_BLOCKED, stats.txBlocked);
+    Metrics::set(METRIC_ACKS_SENT, stats.acksSent);
+
+    Metrics::set(METRIC_UPTIME, stats.uptimeMs / 1000);
+    Metrics::set(METRIC_UPLINK_QUEUE, stats.queueDepth);
+    Metrics::set(METRIC_DOWNLINK_PENDING, stats.cmdPending);
+    Metrics::set(METRIC_CHANNEL_UTIL, stats.rxUtilization);
+    Metrics::set(METRIC_TX_UTIL, stats.txUtilization);
+    Metrics::set(METRIC_LINKS_DEGRADED, stats.linksDegraded);
+
+    HeapStats heap = getHeapStats();
+    Metrics::set(METRIC_HEAP_FREE, heap.freeHeap);
+    Metrics::set(METRIC_HEAP_MIN_FREE, heap.minFreeHeap);
+    Metrics::set(METRIC_HEAP_LARGEST, heap.largestFreeBlock);
+
+    Metrics::set(METRIC_WIFI_CONNECTED, wifi.isConnected() ? 1 : 0);
+    Metrics::set(METRIC_WIFI_RSSI, stats.wifiRssi);
+}
+
+static void printQueueClasses(const UplinkQueue& queue) {
+#if ENABLE_DEBUG
+    for (uint8_t c = 0; c < UPLINK_CLASS_COUNT; c++) {
+        const UplinkClassStats& cls = queue.getClassStats(c);
+        DEBUG_PRINTF("  %s: %d na fila, %lu entregues (media %lu ms, max %lu ms), %lu substituidas, %lu descartadas\n",
+                     UplinkQueue::className(c), cls.depth, (unsigned long)cls.delivered,
+                     (unsigned long)(cls.delivered > 0 ? cls.latencyTotalMs / cls.delivered : 0),
+                     (unsigned long)cls.latencyMaxMs, (unsigned long)cls.coalesced,
+                     (unsigned long)cls.shed);
+    }
+#endif
 }
 
 void sendStatusReport() {
     DEBUG_PRINTLN("\n=== Status do Gateway ===");
     DEBUG_PRINTF("Uptime: %lu s\n", millis() / 1000);
-    DEBUG_PRINTF("Pacotes recebidos: %d\n", packetsReceived);
-    DEBUG_PRINTF("Pacotes encaminhados: %d\n", packetsForwarded);
-    DEBUG_PRINTF("Pacotes com erro: %d\n", packetsError);
+    DEBUG_PRINTF("Pacotes recebidos: %d\n", Metrics::get(METRIC_RX_PACKETS));
+    DEBUG_PRINTF("Pacotes encaminhados: %d\n", Metrics::get(METRIC_UPLINK_FORWARDED));
+    DEBUG_PRINTF("Pacotes com erro: %d\n", Metrics::get(METRIC_PACKET_ERRORS));
+    DEBUG_PRINTF("Duplicados suprimidos: %d\n", dedup.getSuppressed());
+    DEBUG_PRINTF("Fila de uplink: %d/%d (recusados: %d)\n",
+                 getUplinkDepth(), PACKET_QUEUE_SIZE, getUplinkRejected());
+#if UPLINK_TRANSPORT != UPLINK_TRANSPORT_HTTP
+    printQueueClasses(uplinkQueue);
+#endif
+    DEBUG_PRINTF("ACK: %d enviados, medio %d ms, max %d ms\n",
+                 acks.getSentCount(), acks.getAverageTurnaround(), acks.getMaxTurnaround());
+    DEBUG_PRINTF("Comandos: %d pendentes, %d executados, %d falhas, latencia media %d ms\n",
+                 downlinks.getPending(), downlinks.getDelivered(), downlinks.getFailed(),
+                 downlinks.getAverageLatency());
+    DEBUG_PRINTF("ACK no ar: %d ms para %d leituras (individuais: %d ms)\n",
+                 acks.getAirtimeMs(), acks.getAckedReadings(), acks.getSingleAirtimeMs());
+#if ENABLE_DEBUG
+    unsigned long now = millis();
+    DEBUG_PRINTF("Canal: RX %d ms (%.1f%%), TX %d/%d ms (%.1f%%), bloqueados: %d\n",
+                 airtime.getRxAirtimeMs(now), airtime.getRxUtilization(now) / 10.0,
+                 airtime.getTxAirtimeMs(now), airtime.getTxBudgetMs(),
+                 airtime.getTxUtilization(now) / 10.0, airtime.getTxBlocked());
+#endif
+    if (lora.isScanning()) {
+        DEBUG_PRINTF("Varredura: ciclo %lu ms\n", (unsigned long)lora.getScanCycleMs());
+        for (uint8_t sf = LORA_SF_MIN; sf <= LORA_SF_MAX; sf++) {
+            const LoRaSfStats& sfStats = lora.getSfStats(sf);
+            if (sfStats.cadRuns == 0) {
+                continue;
+            }
+            DEBUG_PRINTF("  SF%d: %lu CAD, %lu deteccoes, %lu recebidos, %lu perdidos\n", sf,
+                         (unsigned long)sfStats.cadRuns, (unsigned long)sfStats.detections,
+                         (unsigned long)sfStats.received, (unsigned long)sfStats.missed);
+        }
+    }
+    DEBUG_PRINTF("ADR: %d ajustes, %d reversoes\n", adr.getAdjustments(), adr.getReverts());
+    DEBUG_PRINTF("Enlaces degradados (perda >= %d%%): %d\n",
+                 LINK_DEGRADED_LOSS_PCT, webServer.getDegradedLinks());
+    DEBUG_PRINTF("Loop: %d despertares, pior latencia de evento %d us, pior iteracao %d us\n",
+                 scheduler.getWakeups(), scheduler.getMaxEventLatencyUs(),
+                 scheduler.getMaxIterationUs());
+    DEBUG_PRINTF("Configuracao: %d mudancas aplicadas, %d revertidas\n",
+                 runtimeConfig.getApplied(), runtimeConfig.getRollbacks());
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+    DEBUG_PRINTF("MQTT: %s, %d publicados, %d PUBACKs, %d em voo, PUBACK medio %d ms (max %d), %.1f msg/s\n",
+                 mqtt.isConnected() ? "conectado" : "desconectado",
+                 mqtt.getPublished(), mqtt.getAcked(), mqtt.getInflight(),
+                 mqtt.getAvgLatencyMs(), mqtt.getMaxLatencyMs(), mqtt.getThroughput());
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+    DEBUG_PRINTF("Semtech: %d PUSH_DATA, %d PUSH_ACK (RTT medio %d ms), %d PULL_RESP\n",
+                 forwarder.getPushSent(), forwarder.getPushAcked(), forwarder.getAvgRttMs(),
+                 forwarder.getPullResp());
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SERIAL
+    DEBUG_PRINTF("Serial: %d quadros, %d ACKs (RTT medio %d ms), %d em voo, handoff medio %d us (max %d)\n",
+                 serialLink.getFramesSent(), serialLink.getAcked(), serialLink.getAvgRttMs(),
+                 serialLink.getInflight(), serialLink.getAvgHandoffUs(), serialLink.getMaxHandoffUs());
+#else
+    for (uint8_t i = 0; i < uplinkRouter.getCount(); i++) {
+        const UplinkEndpoint& endpoint = uplinkRouter.getEndpoint(i);
+        DEBUG_PRINTF("Servidor %s:%d: disjuntor %s, %s, nota %lu, %d na fila, %lu entregues, %lu repassadas\n",
+                     endpoint.host.c_str(), endpoint.port, UplinkRouter::breakerName(endpoint.breaker),
+                     endpoint.format == PAYLOAD_FORMAT_MSGPACK ? "MessagePack" : "JSON",
+                     (unsigned long)uplinkRouter.getScore(i), endpoint.queue.size(),
+                     (unsigned long)endpoint.delivered, (unsigned long)endpoint.rerouted);
+        DEBUG_PRINTF("  Lotes: %d leituras, espera %lu ms, RTT %lu ms (base %lu ms), erros %d/1000, evento esperou ate %lu ms\n",
+                     endpoint.batcher.getBatchSize(), (unsigned long)endpoint.batcher.getFlushIntervalMs(),
+                     (unsigned long)endpoint.batcher.getRttMs(),
+                     (unsigned long)endpoint.batcher.getRttBaseMs(), endpoint.batcher.getErrorRate(),
+                     (unsigned long)endpoint.batcher.getMaxEventWaitMs());
+        printQueueClasses(endpoint.queue);
+    }
+#if UPLINK_COMPRESSION
+    DEBUG_PRINTF("Compressao: %d -> %d bytes (%.2fx), %d us/KB, nivel %d, envio %.2f us/byte\n",
+                 compressor.getBytesIn(), compressor.getBytesOut(), compressor.getRatio(),
+                 compressor.getUsPerKb(), compressor.getLastLevel(), compressor.getTxUsPerByte());
+#endif
+#endif
+#if SERVER_TLS && ENABLE_DEBUG
+    const TlsClient* tls = wifi.getTlsClient();
+    DEBUG_PRINTF("TLS: %d handshakes completos, %d retomados (%d%%), %d falhas, %d/%d conexoes reaproveitadas, cripto medio %d us (max %d)\n",
+                 tls->getFullHandshakes(), tls->getResumedHandshakes(), tls->getResumptionRate(),
+                 tls->getFailures(), tls->getReusedRequests(), tls->getRequests(),
+                 tls->getAvgCryptoUs(), tls->getMaxCryptoUs());
+#endif
     DEBUG_PRINTF("WiFi: %s (RSSI: %d dBm)\n",
                  wifi.isConnected() ? "Conectado" : "Desconectado",
                  wifi.getRSSI());
-    DEBUG_PRINTF("Heap livre: %d bytes\n", ESP.getFreeHeap());
+#if ENABLE_DEBUG
+    HeapStats heap = getHeapStats();
+    DEBUG_PRINTF("Heap livre: %d bytes (maior bloco: %d, min: %d, frag: %d%%)\n",
+                 heap.freeHeap, heap.largestFreeBlock, heap.minFreeHeap, heap.fragmentation);
+#endif
     DEBUG_PRINTLN("=========================\n");
 
     // Envia status para o servidor
+#if UPLINK_TRANSPORT == UPLINK_TRANSPORT_MQTT
+    if (mqtt.isConnected()) {
+        String statusPayload = protocol.createGatewayStatus(collectStats());
+
+        char topic[MQTT_TOPIC_MAX_LEN + 1];
+        snprintf(topic, sizeof(topic), "%s/%s/status", MQTT_TOPIC_PREFIX, GATEWAY_ID);
+        mqtt.publish(topic, statusPayload, 0);
+    }
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SEMTECH
+    // Formato do packet forwarder: "stat" com os contadores do intervalo
+    forwarder.pushStat(Metrics::get(METRIC_RX_PACKETS));
+#elif UPLINK_TRANSPORT == UPLINK_TRANSPORT_SERIAL
+    // Registro binario; a ponte repassa a /api/gateway-status
+    serialLink.sendStatus(collectStats());
+#else
     if (wifi.isConnected()) {
-        String statusPayload = protocol.createGatewayStatus(
-            wifi.getRSSI(),
-            packetsReceived,
-            packetsForwarded,
-            millis()
-        );
+        String statusPayload = protocol.createGatewayStatus(collectStats());
 
         wifi.sendHTTPPost("/api/gateway-status", statusPayload);
     }
+#endif
 }
 
 void printStartupInfo() {
@@ -0,0 +1,155 @@
+#include "metrics.h"
+
+int32_t Metrics::_values[METRIC_COUNT];
+uint32_t Metrics::_buckets[HISTOGRAM_COUNT][METRICS_MAX_BUCKETS + 1];
+uint64_t Metrics::_sums[HISTOGRAM_COUNT];
+
+struct MetricInfo {
+    const char* name;
+    const char* help;
+    const char* type;
+};
+
+#define COUNTER_INFO(id, name, help) {name, help, "counter"},
+#define GAUGE_INFO(id, name, help) {name, help, "gauge"},
+static const MetricInfo METRIC_INFO[METRIC_COUNT] = {
+    METRICS_COUNTERS(COUNTER_INFO)
+    METRICS_GAUGES(GAUGE_INFO)
+};
+
+#define HISTOGRAM_BOUNDS(id, name, help, ...) \
+    static const int32_t BOUNDS_##id[] = {__VA_ARGS__}; \
+    static_assert(sizeof(BOUNDS_##id) / sizeof(int32_t) <= METRICS_MAX_BUCKETS, \
+                  "Histograma " name " com baldes demais");
+METRICS_HISTOGRAMS(HISTOGRAM_BOUNDS)
+
+struct HistogramInfo {
+    const char* name;
+    const char* help;
+    const int32_t* bounds;
+    uint8_t boundCount;
+};
+
+#define HISTOGRAM_INFO(id, name, help, ...) \
+    {name, help, BOUNDS_##id, sizeof(BOUNDS_##id) / sizeof(int32_t)},
+static const HistogramInfo HISTOGRAM_INFO_TABLE[HISTOGRAM_COUNT] = {
+    METRICS_HISTOGRAMS(HISTOGRAM_INFO)
+};
+
+void Metrics::observe(HistogramId id, int32_t value) {
+    const HistogramInfo& info = HISTOGRAM_INFO_TABLE[id];
+
+    // Primeiro balde com limite >= valor; acima de todos = +Inf
+    uint8_t bucket = 0;
+    while (bucket < info.boundCount && value > info.bounds[bucket]) {
+        bucket++;
+    }
+
+    __atomic_fetch_add(&_buckets[id][bucket], 1, __ATOMIC_RELAXED);
+    // 64 bits: latencias em us e bytes somam mais que um int32 em dias
+    __atomic_fetch_add(&_sums[id], (uint64_t)(int64_t)value, __ATOMIC_RELAXED);
+}
+
+size_t Metrics::renderChunk(MetricsCursor& cursor, char* buffer, size_t maxLen) {
+    size_t written = 0;
+
+    while (true) {
+        // Linha pendente: do pedaco anterior ou recem-formatada
+        if (cursor.pendingPos < cursor.pendingLen) {
+            size_t count = cursor.pendingLen - cursor.pendingPos;
+            if (count > maxLen - written) {
+                // Linha que nao cabe fica para o proximo pedaco; se nem em um
+                // pedaco vazio ela cabe, vai em partes
+                if (written > 0) {
+                    break;
+                }
+                count = maxLen;
+            }
+
+            memcpy(buffer + written, cursor.pending + cursor.pendingPos, count);
+            cursor.pendingPos += count;
+            written += count;
+            if (cursor.pendingPos < cursor.pendingLen) {
+                break;
+            }
+            continue;
+        }
+
+        if (cursor.family >= METRIC_COUNT + HISTOGRAM_COUNT) {
+            break;
+        }
+
+        int len = formatLine(cursor, cursor.pending, sizeof(cursor.pending));
+        if (len <= 0) {
+            cursor.family++;
+            cursor.line = 0;
+            continue;
+        }
+
+        cursor.pendingLen = (size_t)len < sizeof(cursor.pending) ? len : sizeof(cursor.pending) - 1;
+        cursor.pendingPos = 0;
+        cursor.line++;
+    }
+
+    return written;
+}
+
+int Metrics::formatLine(const MetricsCursor& cursor, char* line, size_t size) {
+    if (cursor.family >= METRIC_COUNT) {
+        return formatHistogramLine(cursor.family - METRIC_COUNT, cursor.line, line, size);
+    }
+
+    const MetricInfo& info = METRIC_INFO[cursor.family];
+    MetricId id = (MetricId)cursor.family;
+
+    switch (cursor.line) {
+        case 0:
+            return snprintf(line, size, "# HELP %s %s\n", info.name, info.help);
+        case 1:
+            return snprintf(line, size, "# TYPE %s %s\n", info.name, info.type);
+        case 2:
+            if (info.type[0] == 'c') {
+                return snprintf(line, size, "%s %lu\n", info.name, (unsigned long)(uint32_t)get(id));
+            }
+            return snprintf(line, size, "%s %ld\n", info.name, (long)get(id));
+        default:
+            return 0;
+    }
+}
+
+int Metrics::formatHistogramLine(uint16_t id, uint16_t line, char* out, size_t size) {
+    const HistogramInfo& info = HISTOGRAM_INFO_TABLE[id];
+
+    if (line == 0) {
+        return snprintf(out, size, "# HELP %s %s\n", info.name, info.help);
+    }
+    if (line == 1) {
+        return snprintf(out, size, "# TYPE %s histogram\n", info.name);
+    }
+
+    // Baldes cumulativos: limites declarados, +Inf, soma e contagem
+    uint16_t bucket = line - 2;
+    if (bucket > info.boundCount + 2) {
+        return 0;
+    }
+
+    uint32_t cumulative = 0;
+    uint16_t last = bucket <= info.boundCount ? bucket : info.boundCount;
+    for (uint16_t i = 0; i <= last; i++) {
+        cumulative += __atomic_load_n(&_buckets[id][i], __ATOMIC_RELAXED);
+    }
+
+    if (bucket < info.boundCount) {
+        return snprintf(out, size, "%s_bucket{le=\"%ld\"} %lu\n", info.name,
+                        (long)info.bounds[bucket], (unsigned long)cumulative);
+    }
+    if (bucket == info.boundCount) {
+        return snprintf(out, size, "%s_bucket{le=\"+Inf\"} %lu\n", info.name,
+                        (unsigned long)cumulative);
+    }
+    if (bucket == info.boundCount + 1) {
+        return snprintf(out, size, "%s_sum %lld\n", info.name,
+                        (long long)(int64_t)__atomic_load_n(&_sums[id], __ATOMIC_RELAXED));
+    }
+    return snprintf(out, size, "%s_count %lu\n", info.name, (unsigned long)cumulative);
+}
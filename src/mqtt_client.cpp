@@ -0,0 +1,548 @@
+#include "mqtt_client.h"
+#include <WiFi.h>
+#include "metrics.h"
+#include "alloc_profiler.h"
+
+// Tipos de pacote MQTT 3.1.1 (4 bits altos do primeiro byte)
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_SUBSCRIBE   0x82    // Flags reservadas 0010
+#define MQTT_SUBACK      0x90
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+
+// Comprimento restante: ate 4 bytes, 7 bits por byte
+static size_t encodeLength(uint8_t* out, size_t length) {
+    size_t count = 0;
+    do {
+        uint8_t digit = length % 128;
+        length /= 128;
+        if (length > 0) {
+            digit |= 0x80;
+        }
+        out[count++] = digit;
+    } while (length > 0 && count < 4);
+    return count;
+}
+
+static size_t writeString(uint8_t* out, const char* str, size_t length) {
+    out[0] = length >> 8;
+    out[1] = length & 0xFF;
+    memcpy(out + 2, str, length);
+    return length + 2;
+}
+
+MqttClient::MqttClient()
+    : _state(MQTT_STATE_DISCONNECTED),
+      _host(SERVER_HOST),
+      _port(MQTT_PORT),
+      _inflightCount(0),
+      _nextPacketId(0),
+      _rxLength(0),
+      _rxDiscard(0),
+      _connectStartedAt(0),
+      _lastConnectAttempt(0),
+      _lastTx(0),
+      _lastRx(0),
+      _messageCallback(nullptr),
+      _ackCallback(nullptr),
+      _connectedCallback(nullptr),
+      _published(0),
+      _acked(0),
+      _connects(0),
+      _timeouts(0),
+      _oversized(0),
+      _latencyTotal(0),
+      _latencyMax(0),
+      _latencyLast(0),
+      _throughput(0),
+      _rateAcked(0),
+      _rateStartedAt(0) {
+    memset(_inflight, 0, sizeof(_inflight));
+}
+
+void MqttClient::begin(const char* clientId) {
+    _clientId.assign(clientId);
+
+    // Primeira tentativa ja no proximo poll()
+    unsigned long now = millis();
+    _lastConnectAttempt = now - MQTT_RECONNECT_INTERVAL_MS;
+    _rateStartedAt = now;
+
+    DEBUG_PRINTF("[MQTT] Broker %s:%d, janela de %d PUBLISH QoS1\n",
+                 _host.c_str(), _port, MQTT_MAX_INFLIGHT);
+}
+
+void MqttClient::setServer(const char* host, uint16_t port) {
+    if (_host == StringView(host) && _port == port) {
+        return;
+    }
+
+    _host.assign(host);
+    _port = port;
+
+    // Reconecta ja no novo broker
+    if (_state != MQTT_STATE_DISCONNECTED) {
+        disconnect();
+    }
+    _lastConnectAttempt = millis() - MQTT_RECONNECT_INTERVAL_MS;
+}
+
+void MqttClient::poll(unsigned long now) {
+    AllocTagScope allocTag(ALLOC_TAG_WIFI);
+
+    if (WiFi.status() != WL_CONNECTED) {
+        if (_state != MQTT_STATE_DISCONNECTED) {
+            drop("WiFi desconectado");
+        }
+        return;
+    }
+
+    if (_state == MQTT_STATE_DISCONNECTED) {
+        if (now - _lastConnectAttempt >= MQTT_RECONNECT_INTERVAL_MS) {
+            startConnect(now);
+        }
+        return;
+    }
+
+    if (!_client.connected()) {
+        drop("conexao fechada pelo broker");
+        return;
+    }
+
+    readSocket(now);
+    if (_state == MQTT_STATE_DISCONNECTED) {
+        return;
+    }
+
+    if (_state == MQTT_STATE_CONNECTING) {
+        if (now - _connectStartedAt > MQTT_CONNECT_TIMEOUT_MS) {
+            drop("sem CONNACK");
+        }
+        return;
+    }
+
+    checkTimeouts(now);
+    if (_state != MQTT_STATE_CONNECTED) {
+        return;
+    }
+
+    // Keepalive: PINGREQ apos meio periodo sem TX; broker mudo = sessao morta
+    if (now - _lastRx > MQTT_KEEPALIVE_S * 1500UL) {
+        drop("sem resposta do broker");
+        return;
+    }
+    if (now - _lastTx >= MQTT_KEEPALIVE_S * 500UL) {
+        _tx[0] = MQTT_PINGREQ;
+        _tx[1] = 0;
+        send(2);
+    }
+
+    // Vazao: PUBACKs por segundo na ultima janela
+    if (now - _rateStartedAt >= MQTT_RATE_WINDOW_MS) {
+        _throughput = (_acked - _rateAcked) * 1000.0f / (now - _rateStartedAt);
+        _rateAcked = _acked;
+        _rateStartedAt = now;
+    }
+}
+
+void MqttClient::disconnect() {
+    if (_state == MQTT_STATE_CONNECTED) {
+        _tx[0] = MQTT_DISCONNECT;
+        _tx[1] = 0;
+        send(2);
+    }
+    if (_state != MQTT_STATE_DISCONNECTED) {
+        drop("desconexao solicitada");
+    }
+}
+
+void MqttClient::startConnect(unsigned long now) {
+    _lastConnectAttempt = now;
+
+    if (_host.isEmpty()) {
+        return;
+    }
+
+    DEBUG_PRINTF("[MQTT] Conectando a %s:%d...\n", _host.c_str(), _port);
+    if (!_client.connect(_host.c_str(), _port, MQTT_CONNECT_TIMEOUT_MS)) {
+        DEBUG_PRINTLN("[MQTT] ERRO: Falha na conexao TCP");
+        _lastConnectAttempt = millis();
+        return;
+    }
+
+    // PUBLISH pequenos em sequencia: sem Nagle para nao atrasar o pipeline
+    _client.setNoDelay(true);
+
+    // CONNECT: protocolo "MQTT" nivel 4, sessao limpa, keepalive, client id
+    uint8_t body[10 + 2 + 32];
+    size_t length = 0;
+    length += writeString(body, "MQTT", 4);
+    body[length++] = 4;
+    body[length++] = 0x02;
+    body[length++] = MQTT_KEEPALIVE_S >> 8;
+    body[length++] = MQTT_KEEPALIVE_S & 0xFF;
+    length += writeString(body + length, _clientId.c_str(), _clientId.length());
+
+    size_t pos = 0;
+    _tx[pos++] = MQTT_CONNECT;
+    pos += encodeLength(_tx + pos, length);
+    memcpy(_tx + pos, body, length);
+    pos += length;
+
+    _state = MQTT_STATE_CONNECTING;
+    _connectStartedAt = now;
+    _lastRx = now;
+    _rxLength = 0;
+    _rxDiscard = 0;
+    send(pos);
+}
+
+void MqttClient::readSocket(unsigned long now) {
+    while (_client.available() > 0) {
+        // Resto de um pacote grande demais: descarta sem guardar
+        if (_rxDiscard > 0) {
+            uint8_t scratch[64];
+            size_t want = _rxDiscard < sizeof(scratch) ? _rxDiscard : sizeof(scratch);
+            int count = _client.read(scratch, want);
+            if (count <= 0) {
+                break;
+            }
+            _rxDiscard -= count;
+            _lastRx = now;
+            continue;
+        }
+
+        int count = _client.read(_rx + _rxLength, sizeof(_rx) - _rxLength);
+        if (count <= 0) {
+            break;
+        }
+        _rxLength += count;
+        _lastRx = now;
+
+        // Trata todos os pacotes completos do buffer
+        size_t offset = 0;
+        while (_rxLength - offset >= 2) {
+            const uint8_t* packet = _rx + offset;
+            size_t available = _rxLength - offset;
+
+            size_t remaining = 0;
+            size_t multiplier = 1;
+            size_t headerLength = 1;
+            bool complete = false;
+            while (headerLength < available && headerLength <= 4) {
+                uint8_t digit = packet[headerLength++];
+                remaining += (digit & 0x7F) * multiplier;
+                multiplier *= 128;
+                if (!(digit & 0x80)) {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete) {
+                if (headerLength > 4) {
+                    drop("comprimento invalido");
+                    return;
+                }
+                break;
+            }
+
+            size_t total = headerLength + remaining;
+            if (total > sizeof(_rx)) {
+                DEBUG_PRINTF("[MQTT] AVISO: Pacote de %u bytes descartado\n", (unsigned)total);
+                _oversized++;
+                _rxDiscard = total - available;
+                offset = _rxLength;
+                break;
+            }
+            if (total > available) {
+                break;
+            }
+
+            handlePacket(packet, headerLength, total, now);
+            if (_state == MQTT_STATE_DISCONNECTED) {
+                return;
+            }
+            offset += total;
+        }
+
+        memmove(_rx, _rx + offset, _rxLength - offset);
+        _rxLength -= offset;
+    }
+}
+
+void MqttClient::handlePacket(const uint8_t* packet, size_t headerLength, size_t length,
+                              unsigned long now) {
+    const uint8_t* body = packet + headerLength;
+    size_t bodyLength = length - headerLength;
+
+    switch (packet[0] & 0xF0) {
+        case MQTT_CONNACK:
+            if (_state != MQTT_STATE_CONNECTING) {
+                return;
+            }
+            if (bodyLength < 2 || body[1] != 0) {
+                DEBUG_PRINTF("[MQTT] ERRO: CONNACK recusado (rc %d)\n", bodyLength >= 2 ? body[1] : -1);
+                drop("conexao recusada");
+                return;
+            }
+
+            _state = MQTT_STATE_CONNECTED;
+            _connects++;
+            Metrics::inc(METRIC_MQTT_CONNECTS);
+            DEBUG_PRINTF("[MQTT] Conectado (%lu ms)\n", (unsigned long)(now - _connectStartedAt));
+
+            if (_connectedCallback) {
+                _connectedCallback();
+            }
+            break;
+
+        case MQTT_PUBACK:
+            if (bodyLength >= 2) {
+                handlePubAck((body[0] << 8) | body[1], now);
+            }
+            break;
+
+        case MQTT_PUBLISH:
+            handlePublish(packet[0] & 0x0F, body, bodyLength);
+            break;
+
+        case MQTT_SUBACK:
+            if (bodyLength >= 3 && body[2] == 0x80) {
+                DEBUG_PRINTLN("[MQTT] ERRO: Assinatura recusada pelo broker");
+            }
+            break;
+
+        case MQTT_PINGRESP:
+        default:
+            break;
+    }
+}
+
+void MqttClient::handlePubAck(uint16_t packetId, unsigned long now) {
+    for (uint8_t i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+        MqttInflight& slot = _inflight[i];
+        if (slot.packetId != packetId) {
+            continue;
+        }
+
+        uint32_t latency = now - slot.sentAt;
+        slot.packetId = 0;
+        _inflightCount--;
+
+        _acked++;
+        _latencyTotal += latency;
+        _latencyLast = latency;
+        if (latency > _latencyMax) {
+            _latencyMax = latency;
+        }
+        Metrics::inc(METRIC_MQTT_PUBACKS);
+        Metrics::set(METRIC_MQTT_INFLIGHT, _inflightCount);
+        Metrics::observe(HISTOGRAM_MQTT_PUBACK, latency);
+
+        if (_ackCallback) {
+            _ackCallback(packetId, latency);
+        }
+        return;
+    }
+
+    // PUBACK de sessao anterior ou repetido: ignorado
+}
+
+void MqttClient::handlePublish(uint8_t flags, const uint8_t* body, size_t length) {
+    uint8_t qos = (flags >> 1) & 0x03;
+    if (length < 2) {
+        return;
+    }
+
+    size_t topicLength = (body[0] << 8) | body[1];
+    size_t pos = 2 + topicLength;
+    uint16_t packetId = 0;
+    if (qos > 0) {
+        if (pos + 2 > length) {
+            return;
+        }
+        packetId = (body[pos] << 8) | body[pos + 1];
+        pos += 2;
+    }
+    if (pos > length) {
+        return;
+    }
+
+    if (_messageCallback) {
+        _messageCallback(StringView((const char*)body + 2, topicLength),
+                         StringView((const char*)body + pos, length - pos));
+    }
+
+    // Assinaturas sao QoS1 no maximo: confirma com PUBACK
+    if (qos == 1 && _state == MQTT_STATE_CONNECTED) {
+        _tx[0] = MQTT_PUBACK;
+        _tx[1] = 2;
+        _tx[2] = packetId >> 8;
+        _tx[3] = packetId & 0xFF;
+        send(4);
+    }
+}
+
+void MqttClient::checkTimeouts(unsigned long now) {
+    for (uint8_t i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+        const MqttInflight& slot = _inflight[i];
+        if (slot.packetId != 0 && now - slot.sentAt > MQTT_ACK_TIMEOUT_MS) {
+            _timeouts++;
+            drop("PUBACK atrasado");
+            return;
+        }
+    }
+}
+
+uint16_t MqttClient::publish(const char* topic, StringView payload, uint8_t qos) {
+    if (!isConnected() || (qos > 0 && _inflightCount >= MQTT_MAX_INFLIGHT)) {
+        return 0;
+    }
+
+    size_t topicLength = strlen(topic);
+    if (topicLength > MQTT_TOPIC_MAX_LEN) {
+        DEBUG_PRINTF("[MQTT] ERRO: Topico muito longo: %s\n", topic);
+        return 0;
+    }
+
+    uint16_t packetId = qos > 0 ? takePacketId() : 0;
+    size_t remaining = 2 + topicLength + (qos > 0 ? 2 : 0) + payload.length();
+
+    size_t pos = 0;
+    _tx[pos++] = MQTT_PUBLISH | (qos > 0 ? 0x02 : 0x00);
+    pos += encodeLength(_tx + pos, remaining);
+    pos += writeString(_tx + pos, topic, topicLength);
+    if (qos > 0) {
+        _tx[pos++] = packetId >> 8;
+        _tx[pos++] = packetId & 0xFF;
+    }
+
+    unsigned long now = millis();
+    if (!send(pos, payload)) {
+        return 0;
+    }
+
+    _published++;
+    Metrics::inc(METRIC_MQTT_PUBLISHED);
+
+    if (qos == 0) {
+        return 1;
+    }
+
+    for (uint8_t i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+        if (_inflight[i].packetId == 0) {
+            _inflight[i].packetId = packetId;
+            _inflight[i].sentAt = now;
+            _inflightCount++;
+            break;
+        }
+    }
+    Metrics::set(METRIC_MQTT_INFLIGHT, _inflightCount);
+
+    return packetId;
+}
+
+bool MqttClient::subscribe(const char* topic, uint8_t qos) {
+    if (!isConnected()) {
+        return false;
+    }
+
+    size_t topicLength = strlen(topic);
+    if (topicLength > MQTT_TOPIC_MAX_LEN) {
+        return false;
+    }
+
+    uint16_t packetId = takePacketId();
+
+    size_t pos = 0;
+    _tx[pos++] = MQTT_SUBSCRIBE;
+    pos += encodeLength(_tx + pos, 2 + 2 + topicLength + 1);
+    _tx[pos++] = packetId >> 8;
+    _tx[pos++] = packetId & 0xFF;
+    pos += writeString(_tx + pos, topic, topicLength);
+    _tx[pos++] = qos;
+
+    DEBUG_PRINTF("[MQTT] Assinando %s\n", topic);
+    return send(pos);
+}
+
+bool MqttClient::send(size_t headerLength, StringView payload) {
+    size_t total = headerLength + payload.length();
+    size_t written;
+
+    // Cabecalho e payload no mesmo write() quando cabem no buffer
+    if (total <= sizeof(_tx)) {
+        memcpy(_tx + headerLength, payload.data(), payload.length());
+        written = _client.write(_tx, total);
+    } else {
+        written = _client.write(_tx, headerLength);
+        written += _client.write((const uint8_t*)payload.data(), payload.length());
+    }
+
+    if (written != total) {
+        drop("falha de escrita");
+        return false;
+    }
+
+    _lastTx = millis();
+    return true;
+}
+
+void MqttClient::drop(const char* reason) {
+    DEBUG_PRINTF("[MQTT] Sessao encerrada: %s\n", reason);
+
+    _client.stop();
+    _state = MQTT_STATE_DISCONNECTED;
+    _lastConnectAttempt = millis();
+    _rxLength = 0;
+    _rxDiscard = 0;
+
+    // Clean session: o que estava em voo sera reenviado na proxima sessao
+    memset(_inflight, 0, sizeof(_inflight));
+    _inflightCount = 0;
+    Metrics::set(METRIC_MQTT_INFLIGHT, 0);
+}
+
+uint16_t MqttClient::takePacketId() {
+    // Id 0 e invalido; pula ids ainda em voo apos a volta do contador
+    while (true) {
+        _nextPacketId++;
+        if (_nextPacketId == 0) {
+            continue;
+        }
+
+        bool inUse = false;
+        for (uint8_t i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+            if (_inflight[i].packetId == _nextPacketId) {
+                inUse = true;
+                break;
+            }
+        }
+        if (!inUse) {
+            return _nextPacketId;
+        }
+    }
+}
+
+void MqttClient::appendTelemetry(JsonObject obj) const {
+    static const char* const STATE_NAMES[] = {"disconnected", "connecting", "connected"};
+
+    obj["state"] = STATE_NAMES[_state];
+    obj["broker"] = _host.c_str();
+    obj["port"] = _port;
+    obj["connects"] = _connects;
+    obj["published"] = _published;
+    obj["acked"] = _acked;
+    obj["inflight"] = _inflightCount;
+    obj["max_inflight"] = MQTT_MAX_INFLIGHT;
+    obj["ack_timeouts"] = _timeouts;
+    obj["oversized"] = _oversized;
+    obj["puback_avg_ms"] = getAvgLatencyMs();
+    obj["puback_max_ms"] = _latencyMax;
+    obj["puback_last_ms"] = _latencyLast;
+    obj["throughput_msg_s"] = roundf(_throughput * 10) / 10;
+}
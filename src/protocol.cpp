@@ -1,9 +1,11 @@
 #include "protocol.h"
+#include "heap_stats.h"
+#include "metrics.h"
 
 Protocol::Protocol() {
 }
 
-SensorData Protocol::parseLoRaPacket(const String& payload) {
+SensorData Protocol::parseLoRaPacket(StringView payload) {
     SensorData result;
     result.valid = false;
 
@@ -12,8 +14,8 @@ SensorData Protocol::parseLoRaPacket(const String& payload) {
         return result;
     }
 
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    JsonDocument doc(&jsonArenaRx);
+    DeserializationError error = deserializeJson(doc, payload.data(), payload.length());
 
     if (error) {
         DEBUG_PRINTF("[Protocol] ERRO JSON: %s\n", error.c_str());
@@ -26,8 +28,15 @@ SensorData Protocol::parseLoRaPacket(const String& payload) {
         return result;
     }
 
-    result.nodeId = doc["id"].as<String>();
-    result.nodeType = doc["type"].as<String>();
+    JsonString id = doc["id"];
+    JsonString type = doc["type"];
+
+    // Id truncado colidiria com outro no (duplicados, ADR, tempo no ar)
+    if (!result.nodeId.assign(id.c_str(), id.size())) {
+        DEBUG_PRINTF("[Protocol] ERRO: Id do no com mais de %d caracteres\n", NODE_ID_MAX_LEN);
+        return result;
+    }
+    result.nodeType.assign(type.c_str(), type.size());
     result.sequence = doc["seq"] | 0;
 
     // Copia os dados do sensor
@@ -43,17 +52,33 @@ SensorData Protocol::parseLoRaPacket(const String& payload) {
     return result;
 }
 
-String Protocol::createServerPayload(const SensorData& sensorData, int rssi, float snr) {
-    JsonDocument doc;
+UplinkPayload Protocol::createServerPayload(const SensorData& sensorData, int rssi, float snr,
+                                            unsigned long rxTimeMs, long freqError,
+                                            const LinkQuality* link) {
+    UplinkPayload output;
+    output.resize(writeServerPayload(sensorData, rssi, snr, rxTimeMs, freqError, link,
+                                     output.data(), UplinkPayload::capacity()));
+
+    DEBUG_PRINTF("[Protocol] Payload servidor: %s\n", output.c_str());
+
+    return output;
+}
+
+size_t Protocol::writeServerPayload(const SensorData& sensorData, int rssi, float snr,
+                                    unsigned long rxTimeMs, long freqError,
+                                    const LinkQuality* link, char* out, size_t capacity,
+                                    uint8_t format) {
+    JsonArenaScope scope(jsonArenaUplink);
+    JsonDocument doc(&jsonArenaUplink);
 
     // Informacoes do gateway
     doc["gateway_id"] = GATEWAY_ID;
-    doc["timestamp"] = millis() / 1000;  // Segundos desde boot (idealmente usar NTP)
+    doc["timestamp"] = rxTimeMs / 1000;  // Segundos desde boot (idealmente usar NTP)
 
     // Informacoes do no
     JsonObject node = doc["node"].to<JsonObject>();
-    node["id"] = sensorData.nodeId;
-    node["type"] = sensorData.nodeType;
+    node["id"] = sensorData.nodeId.c_str();
+    node["type"] = sensorData.nodeType.c_str();
     node["seq"] = sensorData.sequence;
 
     // Dados do sensor
@@ -65,44 +90,205 @@ String Protocol::createServerPayload(const SensorData& sensorData, int rssi, flo
     JsonObject rf = doc["rf"].to<JsonObject>();
     rf["rssi"] = rssi;
     rf["snr"] = snr;
+    rf["freq_err"] = freqError;
+    if (link) {
+        link->appendSummary(rf["link"].to<JsonObject>());
+    }
 
-    String output;
-    serializeJson(doc, output);
+    bool msgpack = format == PAYLOAD_FORMAT_MSGPACK;
+    size_t length = msgpack ? measureMsgPack(doc) : measureJson(doc);
+    if (length > UPLINK_PAYLOAD_MAX_LEN) {
+        DEBUG_PRINTF("[Protocol] ERRO: Payload servidor muito grande (%u bytes)\n", (unsigned)length);
+        return 0;
+    }
+    if (!out) {
+        return length;
+    }
+    if (length > capacity) {
+        return 0;
+    }
 
-    DEBUG_PRINTF("[Protocol] Payload servidor: %s\n", output.c_str());
+    // Sem terminador: o destino pode ser o meio de um corpo maior
+    uint32_t start = micros();
+    size_t written = msgpack ? serializeMsgPack(doc, out, length) : serializeJson(doc, out, length);
+    uint32_t elapsed = micros() - start;
 
-    return output;
+    // Comparacao dos formatos nas leituras reais (bytes e tempo por leitura)
+    Metrics::inc(msgpack ? METRIC_UPLINK_MSGPACK_BYTES : METRIC_UPLINK_JSON_BYTES, written);
+    Metrics::observe(msgpack ? HISTOGRAM_UPLINK_SERIALIZE_MSGPACK : HISTOGRAM_UPLINK_SERIALIZE_JSON,
+                     elapsed);
+    return written;
 }
 
-String Protocol::createAck(const String& nodeId, uint32_t sequence, bool success) {
-    JsonDocument doc;
+LoRaPayload Protocol::createAck(StringView nodeId, uint32_t sequence, bool success,
+                                const DownlinkCommand* command) {
+    JsonArenaScope scope(jsonArenaAck);
+    JsonDocument doc(&jsonArenaAck);
 
     doc["type"] = "ack";
-    doc["to"] = nodeId;
+    doc["to"] = JsonString(nodeId.data(), nodeId.length());
     doc["seq"] = sequence;
     doc["ok"] = success;
     doc["gw"] = GATEWAY_ID;
 
+    if (command) {
+        appendCommand(doc["cmd"].to<JsonObject>(), *command);
+    }
+
+    LoRaPayload output;
+    output.resize(serializeJson(doc, output.data(), LoRaPayload::capacity() + 1));
+
+    return output;
+}
+
+LoRaPayload Protocol::createCommand(const DownlinkCommand& command) {
+    JsonArenaScope scope(jsonArenaAck);
+    JsonDocument doc(&jsonArenaAck);
+
+    doc["type"] = "cmd";
+    doc["to"] = command.nodeId.c_str();
+    doc["gw"] = GATEWAY_ID;
+    appendCommand(doc["cmd"].to<JsonObject>(), command);
+
+    LoRaPayload output;
+    output.resize(serializeJson(doc, output.data(), LoRaPayload::capacity() + 1));
+
+    return output;
+}
+
+void Protocol::appendCommand(JsonObject obj, const DownlinkCommand& command) {
+    obj["id"] = command.id;
+    obj["c"] = command.name.c_str();
+    obj["p"] = serialized(command.params.c_str(), command.params.length());
+}
+
+uint8_t Protocol::parseServerCommands(StringView body, DownlinkQueue& queue, unsigned long now) {
+    JsonArenaScope scope(jsonArenaDownlink);
+    JsonDocument doc(&jsonArenaDownlink);
+
+    DeserializationError error = deserializeJson(doc, body.data(), body.length());
+    if (error) {
+        DEBUG_PRINTF("[Protocol] ERRO JSON nos comandos: %s\n", error.c_str());
+        return 0;
+    }
+
+    uint8_t added = 0;
+    for (JsonObject cmd : doc["commands"].as<JsonArray>()) {
+        JsonString nodeId = cmd["node_id"];
+        JsonString name = cmd["cmd"];
+        if (!cmd["id"].is<uint32_t>() || nodeId.isNull() || name.isNull()) {
+            continue;
+        }
+
+        // Parametros sao repassados ao no como JSON compacto
+        char params[DOWNLINK_CMD_PARAMS_LEN + 1];
+        size_t paramsLen = 0;
+        if (cmd["params"].is<JsonObject>()) {
+            if (measureJson(cmd["params"]) > DOWNLINK_CMD_PARAMS_LEN) {
+                DEBUG_PRINTLN("[Protocol] ERRO: Parametros do comando muito grandes");
+                continue;
+            }
+            paramsLen = serializeJson(cmd["params"], params, sizeof(params));
+        }
+
+        if (queue.add(cmd["id"], StringView(nodeId.c_str(), nodeId.size()),
+                      StringView(name.c_str(), name.size()),
+                      StringView(params, paramsLen), now)) {
+            added++;
+        }
+    }
+
+    return added;
+}
+
+String Protocol::createCommandStatus(const DownlinkCommand& command) {
+    JsonArenaScope scope(jsonArenaDownlink);
+    JsonDocument doc(&jsonArenaDownlink);
+
+    doc["gateway_id"] = GATEWAY_ID;
+    doc["node_id"] = command.nodeId.c_str();
+    doc["status"] = command.success ? "executed" : "failed";
+    doc["attempts"] = command.attempts;
+    doc["latency_ms"] = command.doneAt - command.fetchedAt;
+    doc["exec_ms"] = command.execMs;
+
     String output;
     serializeJson(doc, output);
 
     return output;
 }
 
-String Protocol::createGatewayStatus(int wifiRssi, uint32_t packetsReceived,
-                                     uint32_t packetsForwarded, unsigned long uptime) {
-    JsonDocument doc;
+LoRaPayload Protocol::createAggregatedAck(const AckEntry* entries, uint8_t count) {
+    uint8_t frame[ACK_AGG_HEADER_SIZE + ACK_AGG_MAX_ENTRIES * ACK_AGG_ENTRY_SIZE];
+    if (count > ACK_AGG_MAX_ENTRIES) {
+        count = ACK_AGG_MAX_ENTRIES;
+    }
+
+    uint16_t gatewayHash = hashNodeId(GATEWAY_ID);
+    size_t len = 0;
+    frame[len++] = ACK_AGG_MARKER;
+    frame[len++] = gatewayHash >> 8;
+    frame[len++] = gatewayHash & 0xFF;
+    frame[len++] = count;
+
+    for (uint8_t i = 0; i < count; i++) {
+        frame[len++] = entries[i].nodeHash >> 8;
+        frame[len++] = entries[i].nodeHash & 0xFF;
+        frame[len++] = entries[i].sequence >> 8;
+        frame[len++] = entries[i].sequence & 0xFF;
+    }
+
+    LoRaPayload output;
+    output.assign((const char*)frame, len);
+
+    return output;
+}
+
+uint16_t Protocol::hashNodeId(StringView nodeId) {
+    // FNV-1a 32 bits dobrado em 16
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < nodeId.length(); i++) {
+        hash ^= (uint8_t)nodeId.data()[i];
+        hash *= 16777619UL;
+    }
+    return (uint16_t)((hash >> 16) ^ (hash & 0xFFFF));
+}
+
+String Protocol::createGatewayStatus(const GatewayStats& gatewayStats) {
+    JsonArenaScope scope(jsonArenaStatus);
+    JsonDocument doc(&jsonArenaStatus);
 
     doc["gateway_id"] = GATEWAY_ID;
     doc["type"] = "status";
     doc["timestamp"] = millis() / 1000;
 
     JsonObject stats = doc["stats"].to<JsonObject>();
-    stats["uptime_s"] = uptime / 1000;
-    stats["packets_rx"] = packetsReceived;
-    stats["packets_fwd"] = packetsForwarded;
-    stats["wifi_rssi"] = wifiRssi;
-    stats["free_heap"] = ESP.getFreeHeap();
+    stats["uptime_s"] = gatewayStats.uptimeMs / 1000;
+    stats["packets_rx"] = gatewayStats.packetsReceived;
+    stats["packets_fwd"] = gatewayStats.packetsForwarded;
+    stats["packets_err"] = gatewayStats.packetsError;
+    stats["packets_dup"] = gatewayStats.packetsDuplicate;
+    stats["queue_depth"] = gatewayStats.queueDepth;
+    stats["queue_rejected"] = gatewayStats.queueRejected;
+    stats["ack_avg_ms"] = gatewayStats.ackAvgMs;
+    stats["ack_max_ms"] = gatewayStats.ackMaxMs;
+    stats["ack_airtime_ms"] = gatewayStats.ackAirtimeMs;
+    stats["ack_airtime_single_ms"] = gatewayStats.ackSingleAirtimeMs;
+    stats["cmd_delivered"] = gatewayStats.cmdDelivered;
+    stats["cmd_failed"] = gatewayStats.cmdFailed;
+    stats["cmd_avg_latency_ms"] = gatewayStats.cmdAvgLatencyMs;
+    stats["channel_util_pct"] = gatewayStats.rxUtilization / 10.0;
+    stats["tx_util_pct"] = gatewayStats.txUtilization / 10.0;
+    stats["tx_blocked"] = gatewayStats.txBlocked;
+    stats["adr_adjustments"] = gatewayStats.adrAdjustments;
+    stats["adr_reverts"] = gatewayStats.adrReverts;
+    stats["links_degraded"] = gatewayStats.linksDegraded;
+    stats["config_applied"] = gatewayStats.configApplied;
+    stats["config_rollbacks"] = gatewayStats.configRollbacks;
+    stats["wifi_rssi"] = gatewayStats.wifiRssi;
+
+    // Heap livre, fragmentacao e uso das arenas JSON
+    appendHeapTelemetry(stats);
 
     String output;
     serializeJson(doc, output);
@@ -110,13 +296,13 @@ String Protocol::createGatewayStatus(int wifiRssi, uint32_t packetsReceived,
     return output;
 }
 
-bool Protocol::validatePacket(const String& payload) {
+bool Protocol::validatePacket(StringView payload) {
     if (payload.length() == 0 || payload.length() > MAX_PACKET_SIZE) {
         return false;
     }
 
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    JsonDocument doc(&jsonArenaRx);
+    DeserializationError error = deserializeJson(doc, payload.data(), payload.length());
 
     if (error) {
         return false;
@@ -126,15 +312,15 @@ bool Protocol::validatePacket(const String& payload) {
     return doc.containsKey("id") && doc.containsKey("type");
 }
 
-MessageType Protocol::getMessageType(const String& payload) {
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+MessageType Protocol::getMessageType(StringView payload) {
+    JsonDocument doc(&jsonArenaRx);
+    DeserializationError error = deserializeJson(doc, payload.data(), payload.length());
 
     if (error) {
         return MSG_TYPE_UNKNOWN;
     }
 
-    String type = doc["type"] | "";
+    StringView type = doc["type"] | "";
 
     if (type == "sensor") return MSG_TYPE_SENSOR_DATA;
     if (type == "actuator") return MSG_TYPE_ACTUATOR_CMD;
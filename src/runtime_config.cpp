@@ -0,0 +1,417 @@
+#include "runtime_config.h"
+#include <Preferences.h>
+
+// Blob gravado na NVS
+struct StoredConfig {
+    uint16_t version;
+    uint16_t size;
+    GatewayConfig config;
+};
+
+static const char* const ROOT_KEYS[] = {"radio", "server", "status_interval_s"};
+static const char* const RADIO_KEYS[] = {"frequency", "sf", "bandwidth", "coding_rate",
+                                         "tx_power", "sync_word", "preamble"};
+static const char* const SERVER_KEYS[] = {"host", "port"};
+
+// Larguras de banda suportadas pelo SX1276 (Hz)
+static const uint32_t VALID_BANDWIDTHS[] = {7800, 10400, 15600, 20800, 31250,
+                                            41700, 62500, 125000, 250000, 500000};
+
+#define COUNT_OF(array) (sizeof(array) / sizeof((array)[0]))
+
+static bool checkKeys(JsonObjectConst obj, const char* const* keys, size_t count,
+                      const char* section, String& error) {
+    for (JsonPairConst kv : obj) {
+        bool known = false;
+        for (size_t i = 0; i < count && !known; i++) {
+            known = strcmp(kv.key().c_str(), keys[i]) == 0;
+        }
+        if (!known) {
+            error = String("campo desconhecido: ") + section + kv.key().c_str();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Le um inteiro opcional dentro de [min, max]; ausente mantem o valor
+static bool readInt(JsonObjectConst obj, const char* key, long min, long max,
+                    long& value, String& error) {
+    JsonVariantConst field = obj[key];
+    if (field.isNull()) {
+        return true;
+    }
+    if (!field.is<long>() || field.as<long>() < min || field.as<long>() > max) {
+        error = String("valor invalido para ") + key;
+        return false;
+    }
+    value = field.as<long>();
+    return true;
+}
+
+RuntimeConfig::RuntimeConfig()
+    : _state(CONFIG_STABLE), _fromNvs(false),
+      _activeSince(0), _packetsAtActive(0), _baselineMs(0), _baselinePackets(0),
+      _probationStart(0), _probationPackets(0),
+      _applied(0), _rollbacks(0), _lastResult("none"),
+      _applyCallback(nullptr) {
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    _lock = unlocked;
+    _active = defaults();
+    _previous = _active;
+    _staged = _active;
+}
+
+void RuntimeConfig::begin() {
+    GatewayConfig stored;
+    _fromNvs = load(stored);
+
+    if (_fromNvs) {
+        _active = stored;
+        DEBUG_PRINTLN("[Config] Configuracao carregada da NVS");
+    } else {
+        _active = defaults();
+        DEBUG_PRINTLN("[Config] Usando configuracao padrao de fabrica");
+    }
+
+    _previous = _active;
+    _activeSince = millis();
+}
+
+GatewayConfig RuntimeConfig::defaults() {
+    GatewayConfig config;
+    config.radio = LoRaHandler::defaultRadioConfig();
+    config.serverHost.assign(SERVER_HOST);
+    config.serverPort = SERVER_PORT;
+    config.statusIntervalMs = STATUS_REPORT_INTERVAL_MS;
+    return config;
+}
+
+bool RuntimeConfig::request(JsonObjectConst changes, String& error) {
+    GatewayConfig config;
+    portENTER_CRITICAL(&_lock);
+    config = _active;
+    portEXIT_CRITICAL(&_lock);
+
+    if (!merge(changes, config, error) || !validate(config, error)) {
+        return false;
+    }
+
+    return stage(config, error);
+}
+
+bool RuntimeConfig::requestDefaults(String& error) {
+    return stage(defaults(), error);
+}
+
+bool RuntimeConfig::stage(const GatewayConfig& config, String& error) {
+    bool staged = false;
+
+    portENTER_CRITICAL(&_lock);
+    if (_state == CONFIG_STABLE) {
+        _staged = config;
+        _state = CONFIG_STAGED;
+        staged = true;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (!staged) {
+        error = "outra mudanca de configuracao em andamento";
+    }
+    return staged;
+}
+
+void RuntimeConfig::poll(unsigned long now, uint32_t packetsReceived) {
+    if (_state == CONFIG_STAGED) {
+        GatewayConfig staged;
+        portENTER_CRITICAL(&_lock);
+        staged = _staged;
+        portEXIT_CRITICAL(&_lock);
+
+        // Radio no meio de um quadro: tenta no proximo loop
+        if (!_applyCallback || !_applyCallback(staged)) {
+            return;
+        }
+
+        // Referencia: taxa de recepcao desde a ultima mudanca
+        _baselineMs = now - _activeSince;
+        _baselinePackets = packetsReceived - _packetsAtActive;
+
+        portENTER_CRITICAL(&_lock);
+        _previous = _active;
+        _active = staged;
+        _state = CONFIG_PROBATION;
+        portEXIT_CRITICAL(&_lock);
+
+        _activeSince = now;
+        _packetsAtActive = packetsReceived;
+        _probationStart = now;
+        _probationPackets = packetsReceived;
+        _applied++;
+        _lastResult = "probation";
+
+        DEBUG_PRINTF("[Config] Nova configuracao aplicada, observando por %lu s\n",
+                     CONFIG_PROBATION_MS / 1000);
+        return;
+    }
+
+    if (_state == CONFIG_PROBATION && now - _probationStart >= CONFIG_PROBATION_MS) {
+        finishProbation(now, packetsReceived);
+        return;
+    }
+
+    if (_state == CONFIG_ROLLBACK) {
+        if (!_applyCallback || !_applyCallback(_previous)) {
+            return;
+        }
+
+        portENTER_CRITICAL(&_lock);
+        _active = _previous;
+        _state = CONFIG_STABLE;
+        portEXIT_CRITICAL(&_lock);
+
+        _activeSince = now;
+        _packetsAtActive = packetsReceived;
+        _rollbacks++;
+        _lastResult = "rolled_back";
+        DEBUG_PRINTLN("[Config] Configuracao anterior restaurada");
+    }
+}
+
+void RuntimeConfig::finishProbation(unsigned long now, uint32_t packetsReceived) {
+    uint32_t received = packetsReceived - _probationPackets;
+
+    // Sem referencia suficiente (pouco trafego antes) nao ha como julgar
+    bool hasBaseline = _baselineMs >= CONFIG_BASELINE_MIN_MS &&
+                       _baselinePackets >= CONFIG_BASELINE_MIN_PACKETS;
+
+    if (hasBaseline) {
+        uint64_t expected = (uint64_t)_baselinePackets * (now - _probationStart) / _baselineMs;
+        if ((uint64_t)received * 100 < expected * CONFIG_ROLLBACK_RATIO_PCT) {
+            DEBUG_PRINTF("[Config] Recepcao caiu (%lu pacotes, esperado ~%lu), revertendo\n",
+                         (unsigned long)received, (unsigned long)expected);
+            _state = CONFIG_ROLLBACK;
+            return;
+        }
+    }
+
+    if (save(_active)) {
+        _fromNvs = true;
+        _lastResult = "committed";
+        DEBUG_PRINTF("[Config] Configuracao aprovada (%lu pacotes) e gravada na NVS\n",
+                     (unsigned long)received);
+    } else {
+        _lastResult = "save_failed";
+        DEBUG_PRINTLN("[Config] ERRO: Falha ao gravar na NVS (ativa ate o reboot)");
+    }
+    _state = CONFIG_STABLE;
+}
+
+void RuntimeConfig::setApplyCallback(bool (*callback)(const GatewayConfig& config)) {
+    _applyCallback = callback;
+}
+
+void RuntimeConfig::toJson(const GatewayConfig& config, JsonObject obj) {
+    JsonObject radio = obj["radio"].to<JsonObject>();
+    radio["frequency"] = config.radio.frequency;
+    radio["sf"] = config.radio.sf;
+    radio["bandwidth"] = config.radio.bandwidth;
+    radio["coding_rate"] = config.radio.codingRate;
+    radio["tx_power"] = config.radio.txPower;
+    radio["sync_word"] = config.radio.syncWord;
+    radio["preamble"] = config.radio.preambleLength;
+
+    JsonObject server = obj["server"].to<JsonObject>();
+    server["host"] = config.serverHost.c_str();
+    server["port"] = config.serverPort;
+
+    obj["status_interval_s"] = config.statusIntervalMs / 1000;
+}
+
+bool RuntimeConfig::merge(JsonObjectConst changes, GatewayConfig& config, String& error) {
+    if (!checkKeys(changes, ROOT_KEYS, COUNT_OF(ROOT_KEYS), "", error)) {
+        return false;
+    }
+
+    JsonObjectConst radio = changes["radio"];
+    if (!radio.isNull()) {
+        if (!checkKeys(radio, RADIO_KEYS, COUNT_OF(RADIO_KEYS), "radio.", error)) {
+            return false;
+        }
+
+        long frequency = config.radio.frequency;
+        long sf = config.radio.sf;
+        long bandwidth = config.radio.bandwidth;
+        long codingRate = config.radio.codingRate;
+        long txPower = config.radio.txPower;
+        long syncWord = config.radio.syncWord;
+        long preamble = config.radio.preambleLength;
+
+        if (!readInt(radio, "frequency", 0, 0x7FFFFFFFL, frequency, error) ||
+            !readInt(radio, "sf", 0, 255, sf, error) ||
+            !readInt(radio, "bandwidth", 0, 0x7FFFFFFFL, bandwidth, error) ||
+            !readInt(radio, "coding_rate", 0, 255, codingRate, error) ||
+            !readInt(radio, "tx_power", -128, 127, txPower, error) ||
+            !readInt(radio, "sync_word", 0, 255, syncWord, error) ||
+            !readInt(radio, "preamble", 0, 65535, preamble, error)) {
+            return false;
+        }
+
+        config.radio.frequency = frequency;
+        config.radio.sf = sf;
+        config.radio.bandwidth = bandwidth;
+        config.radio.codingRate = codingRate;
+        config.radio.txPower = txPower;
+        config.radio.syncWord = syncWord;
+        config.radio.preambleLength = preamble;
+    }
+
+    JsonObjectConst server = changes["server"];
+    if (!server.isNull()) {
+        if (!checkKeys(server, SERVER_KEYS, COUNT_OF(SERVER_KEYS), "server.", error)) {
+            return false;
+        }
+
+        JsonVariantConst host = server["host"];
+        if (!host.isNull()) {
+            if (!host.is<const char*>() || !config.serverHost.assign(host.as<const char*>())) {
+                error = "valor invalido para host";
+                return false;
+            }
+        }
+
+        long port = config.serverPort;
+        if (!readInt(server, "port", 0, 65535, port, error)) {
+            return false;
+        }
+        config.serverPort = port;
+    }
+
+    long intervalS = config.statusIntervalMs / 1000;
+    if (!readInt(changes, "status_interval_s", 0, 86400, intervalS, error)) {
+        return false;
+    }
+    config.statusIntervalMs = intervalS * 1000UL;
+
+    return true;
+}
+
+bool RuntimeConfig::validate(const GatewayConfig& config, String& error) {
+    const RadioConfig& radio = config.radio;
+
+    if (radio.frequency < CONFIG_FREQ_MIN || radio.frequency > CONFIG_FREQ_MAX) {
+        error = "frequency fora da faixa permitida";
+        return false;
+    }
+
+    // SF6 exige header implicito (nao suportado pelo protocolo)
+    if (radio.sf < LORA_SF_MIN || radio.sf > LORA_SF_MAX) {
+        error = "sf deve estar entre 7 e 12";
+        return false;
+    }
+
+    bool validBandwidth = false;
+    for (size_t i = 0; i < COUNT_OF(VALID_BANDWIDTHS); i++) {
+        validBandwidth = validBandwidth || radio.bandwidth == VALID_BANDWIDTHS[i];
+    }
+    if (!validBandwidth) {
+        error = "bandwidth nao suportada";
+        return false;
+    }
+
+    if (radio.codingRate < 5 || radio.codingRate > 8) {
+        error = "coding_rate deve estar entre 5 (4/5) e 8 (4/8)";
+        return false;
+    }
+
+    if (radio.txPower < 2 || radio.txPower > 20) {
+        error = "tx_power deve estar entre 2 e 20 dBm";
+        return false;
+    }
+
+    if (radio.syncWord == 0x34) {
+        error = "sync_word 0x34 e reservado ao LoRaWAN";
+        return false;
+    }
+
+    if (radio.preambleLength < 6) {
+        error = "preamble deve ter ao menos 6 simbolos";
+        return false;
+    }
+
+    if (config.serverHost.length() == 0 || config.serverHost.length() > CONFIG_HOST_MAX_LEN ||
+        config.serverPort == 0) {
+        error = "servidor invalido";
+        return false;
+    }
+
+    if (config.statusIntervalMs < 10000 || config.statusIntervalMs > 3600000UL) {
+        error = "status_interval_s deve estar entre 10 e 3600";
+        return false;
+    }
+
+    return true;
+}
+
+void RuntimeConfig::appendTelemetry(JsonObject obj, unsigned long now) const {
+    static const char* const STATE_NAMES[] = {"stable", "staged", "probation", "rollback"};
+
+    // Chamado pela task do servidor web: copia sob a trava
+    GatewayConfig active;
+    portENTER_CRITICAL(&_lock);
+    active = _active;
+    portEXIT_CRITICAL(&_lock);
+
+    toJson(active, obj["active"].to<JsonObject>());
+    obj["source"] = _fromNvs ? "nvs" : "defaults";
+    obj["state"] = STATE_NAMES[_state];
+    obj["last_result"] = _lastResult;
+    obj["applied"] = _applied;
+    obj["rollbacks"] = _rollbacks;
+
+    if (_state == CONFIG_PROBATION) {
+        unsigned long elapsed = now - _probationStart;
+        obj["probation_left_s"] = elapsed >= CONFIG_PROBATION_MS ? 0 : (CONFIG_PROBATION_MS - elapsed) / 1000;
+    }
+}
+
+bool RuntimeConfig::load(GatewayConfig& config) {
+    Preferences prefs;
+    if (!prefs.begin(RUNTIME_CONFIG_NAMESPACE, true)) {
+        return false;
+    }
+
+    StoredConfig stored;
+    bool ok = prefs.getBytesLength("cfg") == sizeof(stored) &&
+              prefs.getBytes("cfg", &stored, sizeof(stored)) == sizeof(stored);
+    prefs.end();
+
+    if (!ok || stored.version != RUNTIME_CONFIG_VERSION || stored.size != sizeof(GatewayConfig)) {
+        return false;
+    }
+
+    String error;
+    if (!validate(stored.config, error)) {
+        DEBUG_PRINTF("[Config] Configuracao da NVS invalida (%s)\n", error.c_str());
+        return false;
+    }
+
+    config = stored.config;
+    return true;
+}
+
+bool RuntimeConfig::save(const GatewayConfig& config) {
+    Preferences prefs;
+    if (!prefs.begin(RUNTIME_CONFIG_NAMESPACE, false)) {
+        return false;
+    }
+
+    StoredConfig stored;
+    stored.version = RUNTIME_CONFIG_VERSION;
+    stored.size = sizeof(GatewayConfig);
+    stored.config = config;
+
+    bool ok = prefs.putBytes("cfg", &stored, sizeof(stored)) == sizeof(stored);
+    prefs.end();
+    return ok;
+}
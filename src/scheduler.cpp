@@ -0,0 +1,219 @@
+#include "scheduler.h"
+
+volatile uint32_t Scheduler::_pendingEvents = 0;
+volatile uint32_t Scheduler::_eventAtUs = 0;
+TaskHandle_t Scheduler::_loopTask = nullptr;
+
+static portMUX_TYPE schedulerMux = portMUX_INITIALIZER_UNLOCKED;
+
+Scheduler::Scheduler()
+    : _taskCount(0), _wakeups(0), _maxEventLatencyUs(0), _maxIterationUs(0),
+      _busyUs(0), _startedAt(0) {
+}
+
+void Scheduler::begin() {
+    _loopTask = xTaskGetCurrentTaskHandle();
+    _startedAt = millis();
+
+    // Tarefas periodicas rodam pela primeira vez apos um intervalo completo
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        _tasks[i].nextRun = _startedAt + _tasks[i].intervalMs;
+    }
+
+    DEBUG_PRINTF("[Sched] %d tarefas registradas\n", _taskCount);
+}
+
+int Scheduler::add(const char* name, SchedulerTaskFn fn, uint32_t intervalMs, uint32_t events) {
+    if (_taskCount >= SCHEDULER_MAX_TASKS) {
+        DEBUG_PRINTF("[Sched] ERRO: Tabela cheia, tarefa %s ignorada\n", name);
+        return -1;
+    }
+
+    SchedulerTask& task = _tasks[_taskCount];
+    task.name = name;
+    task.fn = fn;
+    task.intervalMs = intervalMs;
+    task.events = events;
+    task.nextRun = millis() + intervalMs;
+    task.armed = intervalMs > 0;
+    task.runs = 0;
+    task.totalUs = 0;
+    task.maxUs = 0;
+    task.maxLateMs = 0;
+
+    return _taskCount++;
+}
+
+void Scheduler::wakeAt(int id, unsigned long when) {
+    if (id < 0 || id >= _taskCount) {
+        return;
+    }
+
+    SchedulerTask& task = _tasks[id];
+    if (!task.armed || (long)(when - task.nextRun) < 0) {
+        task.nextRun = when;
+        task.armed = true;
+    }
+}
+
+void Scheduler::setInterval(int id, uint32_t intervalMs) {
+    if (id < 0 || id >= _taskCount || _tasks[id].intervalMs == intervalMs) {
+        return;
+    }
+
+    // Reancora o prazo no inicio do intervalo atual
+    SchedulerTask& task = _tasks[id];
+    if (task.armed) {
+        task.nextRun = task.nextRun - task.intervalMs + intervalMs;
+    }
+    task.intervalMs = intervalMs;
+}
+
+void Scheduler::signal(uint32_t events) {
+    portENTER_CRITICAL(&schedulerMux);
+    if (_pendingEvents == 0) {
+        _eventAtUs = micros();
+    }
+    _pendingEvents |= events;
+    portEXIT_CRITICAL(&schedulerMux);
+
+    if (_loopTask && xTaskGetCurrentTaskHandle() != _loopTask) {
+        xTaskNotifyGive(_loopTask);
+    }
+}
+
+void IRAM_ATTR Scheduler::signalFromIsr(uint32_t events) {
+    portENTER_CRITICAL_ISR(&schedulerMux);
+    if (_pendingEvents == 0) {
+        _eventAtUs = micros();
+    }
+    _pendingEvents |= events;
+    portEXIT_CRITICAL_ISR(&schedulerMux);
+
+    if (_loopTask) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(_loopTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+uint32_t Scheduler::takeEvents(uint32_t& eventAtUs) {
+    portENTER_CRITICAL(&schedulerMux);
+    uint32_t events = _pendingEvents;
+    eventAtUs = _eventAtUs;
+    _pendingEvents = 0;
+    portEXIT_CRITICAL(&schedulerMux);
+    return events;
+}
+
+void Scheduler::run() {
+    uint32_t eventAtUs = 0;
+    uint32_t events = takeEvents(eventAtUs);
+    uint32_t iterationStart = micros();
+    unsigned long now = millis();
+    bool ranAny = false;
+
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        SchedulerTask& task = _tasks[i];
+        bool byEvent = (task.events & events) != 0;
+        bool due = task.armed && (long)(now - task.nextRun) >= 0;
+        if (!byEvent && !due) {
+            continue;
+        }
+
+        uint32_t startUs = micros();
+        if (byEvent) {
+            uint32_t latency = startUs - eventAtUs;
+            if (latency > _maxEventLatencyUs) {
+                _maxEventLatencyUs = latency;
+            }
+        }
+        if (due && now - task.nextRun > task.maxLateMs) {
+            task.maxLateMs = now - task.nextRun;
+        }
+
+        // Prazo seguinte antes de executar: a tarefa pode antecipar com wakeAt
+        task.armed = task.intervalMs > 0;
+        task.nextRun = now + task.intervalMs;
+
+        task.fn(now);
+
+        uint32_t elapsed = micros() - startUs;
+        task.runs++;
+        task.totalUs += elapsed;
+        if (elapsed > task.maxUs) {
+            task.maxUs = elapsed;
+        }
+
+        ranAny = true;
+        now = millis();
+    }
+
+    if (ranAny) {
+        uint32_t elapsed = micros() - iterationStart;
+        _busyUs += elapsed;
+        if (elapsed > _maxIterationUs) {
+            _maxIterationUs = elapsed;
+        }
+    }
+
+    // Evento chegou durante as tarefas: proxima iteracao sem dormir
+    if (_pendingEvents) {
+        return;
+    }
+
+    uint32_t waitMs = msUntilNextDeadline(millis());
+    if (waitMs == 0) {
+        return;
+    }
+
+    // Notificacao dada antes daqui fica pendente: o take retorna na hora
+    if (_loopTask) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+    } else {
+        delay(waitMs);
+    }
+    _wakeups++;
+}
+
+uint32_t Scheduler::msUntilNextDeadline(unsigned long now) const {
+    uint32_t waitMs = SCHEDULER_MAX_SLEEP_MS;
+
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        const SchedulerTask& task = _tasks[i];
+        if (!task.armed) {
+            continue;
+        }
+
+        long remaining = (long)(task.nextRun - now);
+        if (remaining <= 0) {
+            return 0;
+        }
+        if ((uint32_t)remaining < waitMs) {
+            waitMs = remaining;
+        }
+    }
+
+    return waitMs;
+}
+
+void Scheduler::appendTelemetry(JsonObject obj) const {
+    unsigned long uptimeMs = millis() - _startedAt;
+
+    obj["wakeups"] = _wakeups;
+    obj["busy_pct"] = uptimeMs > 0 ? roundf(_busyUs / 10.0f / uptimeMs * 10) / 10 : 0;
+    obj["max_event_latency_us"] = _maxEventLatencyUs;
+    obj["max_iteration_us"] = _maxIterationUs;
+
+    JsonArray tasks = obj["tasks"].to<JsonArray>();
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        const SchedulerTask& task = _tasks[i];
+        JsonObject entry = tasks.add<JsonObject>();
+        entry["name"] = task.name;
+        entry["interval_ms"] = task.intervalMs;
+        entry["runs"] = task.runs;
+        entry["avg_us"] = task.runs > 0 ? (uint32_t)(task.totalUs / task.runs) : 0;
+        entry["max_us"] = task.maxUs;
+        entry["max_late_ms"] = task.maxLateMs;
+    }
+}
@@ -0,0 +1,449 @@
+#include "semtech_forwarder.h"
+#include <WiFi.h>
+#include <time.h>
+#include "json_arena.h"
+#include "metrics.h"
+#include "alloc_profiler.h"
+
+// Identificadores de pacote GWMP v2
+#define GWMP_VERSION    2
+#define GWMP_PUSH_DATA  0x00
+#define GWMP_PUSH_ACK   0x01
+#define GWMP_PULL_DATA  0x02
+#define GWMP_PULL_RESP  0x03
+#define GWMP_PULL_ACK   0x04
+#define GWMP_TX_ACK     0x05
+#define GWMP_HEADER_LEN 12       // Versao, token, tipo e EUI
+
+// Horario valido so depois da sincronizacao pelo dashboard
+#define SEMTECH_MIN_VALID_TIME 1600000000L
+
+static const char BASE64_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static size_t base64Encode(const uint8_t* data, size_t length, char* out) {
+    size_t pos = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t chunk = (uint32_t)data[i] << 16;
+        if (i + 1 < length) chunk |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length) chunk |= data[i + 2];
+
+        out[pos++] = BASE64_CHARS[(chunk >> 18) & 0x3F];
+        out[pos++] = BASE64_CHARS[(chunk >> 12) & 0x3F];
+        out[pos++] = i + 1 < length ? BASE64_CHARS[(chunk >> 6) & 0x3F] : '=';
+        out[pos++] = i + 2 < length ? BASE64_CHARS[chunk & 0x3F] : '=';
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+static int base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+// Retorna false se a entrada for invalida ou nao couber no quadro
+static bool base64Decode(const char* in, size_t length, LoRaPayload& out) {
+    out.clear();
+    uint32_t chunk = 0;
+    uint8_t bits = 0;
+
+    for (size_t i = 0; i < length && in[i] != '='; i++) {
+        int value = base64Value(in[i]);
+        if (value < 0) {
+            return false;
+        }
+        chunk = (chunk << 6) | value;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (!out.append((char)((chunk >> bits) & 0xFF))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+SemtechForwarder::SemtechForwarder()
+    : _started(false),
+      _host(SERVER_HOST),
+      _port(SEMTECH_UDP_PORT),
+      _inflightCount(0),
+      _nextToken(0),
+      _statToken(0),
+      _lastPull(0),
+      _lastPullAck(0),
+      _ackCallback(nullptr),
+      _txCallback(nullptr),
+      _pushSent(0),
+      _pushAcked(0),
+      _pushTimeouts(0),
+      _pullSent(0),
+      _pullAcked(0),
+      _pullResp(0),
+      _txRejected(0),
+      _txDone(0),
+      _rxForwarded(0),
+      _rttTotal(0),
+      _rttMax(0),
+      _statRx(0),
+      _statRxForwarded(0),
+      _statPushSent(0),
+      _statPushAcked(0),
+      _statPullResp(0),
+      _statTxDone(0) {
+    memset(_eui, 0, sizeof(_eui));
+    memset(_inflight, 0, sizeof(_inflight));
+}
+
+void SemtechForwarder::begin() {
+    // EUI-64 a partir do MAC: MAC[0..2] FF FE MAC[3..5]
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    memcpy(_eui, mac, 3);
+    _eui[3] = 0xFF;
+    _eui[4] = 0xFE;
+    memcpy(_eui + 5, mac + 3, 3);
+
+    _started = _udp.begin(SEMTECH_LOCAL_PORT);
+    _lastPull = millis() - SEMTECH_PULL_INTERVAL_MS;
+
+    DEBUG_PRINTF("[Semtech] EUI %02X%02X%02X%02X%02X%02X%02X%02X, servidor %s:%d\n",
+                 _eui[0], _eui[1], _eui[2], _eui[3], _eui[4], _eui[5], _eui[6], _eui[7],
+                 _host.c_str(), _port);
+    if (!_started) {
+        DEBUG_PRINTLN("[Semtech] ERRO: Falha ao abrir a porta UDP local");
+    }
+}
+
+void SemtechForwarder::setServer(const char* host, uint16_t port) {
+    _host.assign(host);
+    _port = port;
+}
+
+void SemtechForwarder::poll(unsigned long now) {
+    AllocTagScope allocTag(ALLOC_TAG_WIFI);
+
+    if (!_started || WiFi.status() != WL_CONNECTED) {
+        return;
+    }
+
+    readDatagrams(now);
+    checkTimeouts(now);
+
+    // PULL_DATA: mantem o NAT aberto e avisa que o gateway aceita downlinks
+    if (now - _lastPull >= SEMTECH_PULL_INTERVAL_MS) {
+        _lastPull = now;
+        if (sendDatagram(writeHeader(GWMP_PULL_DATA, takeToken()))) {
+            _pullSent++;
+        }
+    }
+}
+
+uint8_t SemtechForwarder::pushRxpk(UplinkEntry* const* entries, uint8_t count,
+                                   const RadioConfig& radio, uint16_t& token) {
+    if (!canPush() || count == 0) {
+        return 0;
+    }
+
+    JsonArenaScope scope(jsonArenaUplink);
+    JsonDocument doc(&jsonArenaUplink);
+    JsonArray rxpks = doc["rxpk"].to<JsonArray>();
+
+    char datr[16];
+    char codr[8];
+    char data[(MAX_PACKET_SIZE + 2) / 3 * 4 + 1];
+    char isoTime[32];
+    snprintf(codr, sizeof(codr), "4/%d", radio.codingRate);
+
+    unsigned long now = millis();
+    time_t wallNow = time(nullptr);
+    uint8_t included = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        const UplinkEntry& entry = *entries[i];
+        JsonObject rxpk = rxpks.add<JsonObject>();
+
+        rxpk["tmst"] = toTmst(entry.rxTime);
+        if (wallNow > SEMTECH_MIN_VALID_TIME) {
+            time_t rxWall = wallNow - (now - entry.rxTime) / 1000;
+            strftime(isoTime, sizeof(isoTime), "%Y-%m-%dT%H:%M:%SZ", gmtime(&rxWall));
+            rxpk["time"] = isoTime;
+        }
+        rxpk["chan"] = 0;
+        rxpk["rfch"] = 0;
+        rxpk["freq"] = radio.frequency / 1e6;
+        rxpk["stat"] = 1;
+        rxpk["modu"] = "LORA";
+        snprintf(datr, sizeof(datr), "SF%dBW%lu", entry.sf, (unsigned long)(radio.bandwidth / 1000));
+        rxpk["datr"] = datr;
+        rxpk["codr"] = codr;
+        rxpk["rssi"] = entry.rssi;
+        rxpk["lsnr"] = roundf(entry.snr * 10) / 10;
+        rxpk["size"] = entry.payload.length();
+        base64Encode((const uint8_t*)entry.payload.c_str(), entry.payload.length(), data);
+        rxpk["data"] = data;
+
+        // O datagrama precisa caber sem fragmentacao: a ultima fica para o proximo
+        if (GWMP_HEADER_LEN + measureJson(doc) > SEMTECH_DATAGRAM_MAX) {
+            rxpks.remove(rxpks.size() - 1);
+            break;
+        }
+        included++;
+    }
+
+    if (included == 0) {
+        DEBUG_PRINTLN("[Semtech] ERRO: rxpk nao cabe no datagrama");
+        return 0;
+    }
+
+    token = takeToken();
+    size_t length = writeHeader(GWMP_PUSH_DATA, token);
+    length += serializeJson(doc, (char*)_buffer + length, SEMTECH_DATAGRAM_MAX - length);
+
+    unsigned long sentAt = millis();
+    if (!sendDatagram(length)) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < SEMTECH_MAX_INFLIGHT; i++) {
+        if (_inflight[i].token == 0) {
+            _inflight[i].token = token;
+            _inflight[i].sentAt = sentAt;
+            _inflightCount++;
+            break;
+        }
+    }
+
+    _pushSent++;
+    _rxForwarded += included;
+    Metrics::inc(METRIC_SEMTECH_PUSH_DATA);
+    return included;
+}
+
+bool SemtechForwarder::pushStat(uint32_t rxTotal) {
+    if (!_started || WiFi.status() != WL_CONNECTED) {
+        return false;
+    }
+
+    JsonArenaScope scope(jsonArenaStatus);
+    JsonDocument doc(&jsonArenaStatus);
+    JsonObject stat = doc["stat"].to<JsonObject>();
+
+    time_t wallNow = time(nullptr);
+    if (wallNow > SEMTECH_MIN_VALID_TIME) {
+        char statTime[32];
+        strftime(statTime, sizeof(statTime), "%Y-%m-%d %H:%M:%S GMT", gmtime(&wallNow));
+        stat["time"] = statTime;
+    }
+
+    // Contadores do intervalo desde o stat anterior
+    uint32_t pushSent = _pushSent - _statPushSent;
+    uint32_t pushAcked = _pushAcked - _statPushAcked;
+    stat["rxnb"] = rxTotal - _statRx;
+    stat["rxok"] = rxTotal - _statRx;
+    stat["rxfw"] = _rxForwarded - _statRxForwarded;
+    stat["ackr"] = pushSent > 0 ? roundf(pushAcked * 1000.0f / pushSent) / 10 : 100.0f;
+    stat["dwnb"] = _pullResp - _statPullResp;
+    stat["txnb"] = _txDone - _statTxDone;
+
+    _statRx = rxTotal;
+    _statRxForwarded = _rxForwarded;
+    _statPushSent = _pushSent;
+    _statPushAcked = _pushAcked;
+    _statPullResp = _pullResp;
+    _statTxDone = _txDone;
+
+    // PUSH_ACK do stat conta no ackr, mas nao ocupa a janela das leituras
+    _statToken = takeToken();
+    size_t length = writeHeader(GWMP_PUSH_DATA, _statToken);
+    length += serializeJson(doc, (char*)_buffer + length, SEMTECH_DATAGRAM_MAX - length);
+
+    if (!sendDatagram(length)) {
+        return false;
+    }
+    _pushSent++;
+    Metrics::inc(METRIC_SEMTECH_PUSH_DATA);
+    return true;
+}
+
+void SemtechForwarder::readDatagrams(unsigned long now) {
+    int size;
+    while ((size = _udp.parsePacket()) > 0) {
+        int length = _udp.read(_buffer, SEMTECH_DATAGRAM_MAX);
+        if (length < 4 || _buffer[0] != GWMP_VERSION) {
+            continue;
+        }
+
+        uint16_t token = (_buffer[1] << 8) | _buffer[2];
+        switch (_buffer[3]) {
+            case GWMP_PUSH_ACK:
+                handlePushAck(token, now);
+                break;
+
+            case GWMP_PULL_ACK:
+                _pullAcked++;
+                _lastPullAck = now;
+                break;
+
+            case GWMP_PULL_RESP:
+                _pullResp++;
+                Metrics::inc(METRIC_SEMTECH_PULL_RESP);
+                handlePullResp(token, (const char*)_buffer + 4, length - 4);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void SemtechForwarder::handlePushAck(uint16_t token, unsigned long now) {
+    if (token != 0 && token == _statToken) {
+        _statToken = 0;
+        _pushAcked++;
+        return;
+    }
+
+    for (uint8_t i = 0; i < SEMTECH_MAX_INFLIGHT; i++) {
+        SemtechInflight& slot = _inflight[i];
+        if (slot.token == 0 || slot.token != token) {
+            continue;
+        }
+
+        uint32_t rtt = now - slot.sentAt;
+        slot.token = 0;
+        _inflightCount--;
+
+        _pushAcked++;
+        _rttTotal += rtt;
+        if (rtt > _rttMax) {
+            _rttMax = rtt;
+        }
+        Metrics::inc(METRIC_SEMTECH_PUSH_ACKS);
+        Metrics::observe(HISTOGRAM_SEMTECH_PUSH_RTT, rtt);
+
+        if (_ackCallback) {
+            _ackCallback(token, true);
+        }
+        return;
+    }
+
+    // PUSH_ACK atrasado (ja reenviado) ou repetido: ignorado
+}
+
+void SemtechForwarder::handlePullResp(uint16_t token, const char* json, size_t length) {
+    JsonArenaScope scope(jsonArenaDownlink);
+    JsonDocument doc(&jsonArenaDownlink);
+
+    DeserializationError error = deserializeJson(doc, json, length);
+    JsonObject txpk = doc["txpk"];
+    if (error || txpk.isNull()) {
+        DEBUG_PRINTLN("[Semtech] ERRO: PULL_RESP sem txpk valido");
+        return;
+    }
+
+    SemtechTxRequest request;
+    request.immediate = txpk["imme"] | false;
+    request.tmst = txpk["tmst"] | 0UL;
+    request.frequency = (uint32_t)lround((txpk["freq"] | 0.0) * 1e6);
+
+    unsigned sf = 0;
+    unsigned long bwKhz = 0;
+    const char* datr = txpk["datr"] | "";
+    JsonString data = txpk["data"];
+    if (sscanf(datr, "SF%uBW%lu", &sf, &bwKhz) != 2 || data.isNull() ||
+        !base64Decode(data.c_str(), data.size(), request.data)) {
+        DEBUG_PRINTLN("[Semtech] ERRO: txpk com datr/data invalido");
+        return;
+    }
+    request.sf = sf;
+    request.bandwidth = bwKhz * 1000;
+
+    const char* result = _txCallback ? _txCallback(request) : "NONE";
+    if (strcmp(result, "NONE") != 0) {
+        _txRejected++;
+        Metrics::inc(METRIC_SEMTECH_TX_REJECTED);
+        DEBUG_PRINTF("[Semtech] txpk recusado: %s\n", result);
+    }
+
+    // TX_ACK com o mesmo token do PULL_RESP
+    JsonDocument ack(&jsonArenaDownlink);
+    ack["txpk_ack"]["error"] = result;
+    size_t ackLength = writeHeader(GWMP_TX_ACK, token);
+    ackLength += serializeJson(ack, (char*)_buffer + ackLength, SEMTECH_DATAGRAM_MAX - ackLength);
+    sendDatagram(ackLength);
+}
+
+void SemtechForwarder::checkTimeouts(unsigned long now) {
+    for (uint8_t i = 0; i < SEMTECH_MAX_INFLIGHT; i++) {
+        SemtechInflight& slot = _inflight[i];
+        if (slot.token == 0 || now - slot.sentAt <= SEMTECH_PUSH_TIMEOUT_MS) {
+            continue;
+        }
+
+        uint16_t token = slot.token;
+        slot.token = 0;
+        _inflightCount--;
+        _pushTimeouts++;
+
+        if (_ackCallback) {
+            _ackCallback(token, false);
+        }
+    }
+}
+
+size_t SemtechForwarder::writeHeader(uint8_t type, uint16_t token) {
+    _buffer[0] = GWMP_VERSION;
+    _buffer[1] = token >> 8;
+    _buffer[2] = token & 0xFF;
+    _buffer[3] = type;
+    memcpy(_buffer + 4, _eui, sizeof(_eui));
+    return GWMP_HEADER_LEN;
+}
+
+bool SemtechForwarder::sendDatagram(size_t length) {
+    if (!_udp.beginPacket(_host.c_str(), _port)) {
+        return false;
+    }
+    _udp.write(_buffer, length);
+    return _udp.endPacket() == 1;
+}
+
+uint16_t SemtechForwarder::takeToken() {
+    // Token 0 e reservado para "sem envio"
+    _nextToken++;
+    if (_nextToken == 0) {
+        _nextToken = 1;
+    }
+    return _nextToken;
+}
+
+void SemtechForwarder::appendTelemetry(JsonObject obj) const {
+    char eui[17];
+    snprintf(eui, sizeof(eui), "%02X%02X%02X%02X%02X%02X%02X%02X",
+             _eui[0], _eui[1], _eui[2], _eui[3], _eui[4], _eui[5], _eui[6], _eui[7]);
+
+    obj["eui"] = eui;
+    obj["server"] = _host.c_str();
+    obj["port"] = _port;
+    obj["push_data"] = _pushSent;
+    obj["push_ack"] = _pushAcked;
+    obj["push_timeouts"] = _pushTimeouts;
+    obj["ackr"] = _pushSent > 0 ? roundf(_pushAcked * 1000.0f / _pushSent) / 10 : 0;
+    obj["rxpk_forwarded"] = _rxForwarded;
+    obj["inflight"] = _inflightCount;
+    obj["rtt_avg_ms"] = getAvgRttMs();
+    obj["rtt_max_ms"] = _rttMax;
+    obj["pull_data"] = _pullSent;
+    obj["pull_ack"] = _pullAcked;
+    obj["pull_ack_age_ms"] = _pullAcked > 0 ? millis() - _lastPullAck : 0;
+    obj["pull_resp"] = _pullResp;
+    obj["tx_rejected"] = _txRejected;
+    obj["tx_done"] = _txDone;
+}
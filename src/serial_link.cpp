@@ -0,0 +1,438 @@
+#include "serial_link.h"
+#include "heap_stats.h"
+#include "metrics.h"
+
+// Escrita little-endian limitada ao tamanho do registro
+struct RecordWriter {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+
+    RecordWriter(uint8_t* out, size_t size) : buffer(out), capacity(size), length(0), overflow(false) {}
+
+    void put8(uint8_t value) {
+        if (length + 1 > capacity) {
+            overflow = true;
+            return;
+        }
+        buffer[length++] = value;
+    }
+
+    void put16(uint16_t value) {
+        put8(value & 0xFF);
+        put8(value >> 8);
+    }
+
+    void put32(uint32_t value) {
+        put16(value & 0xFFFF);
+        put16(value >> 16);
+    }
+
+    void putBytes(const void* data, size_t size) {
+        if (length + size > capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(buffer + length, data, size);
+        length += size;
+    }
+
+    // Texto curto com o tamanho em um byte
+    void putString(StringView text) {
+        size_t size = text.length() > 255 ? 255 : text.length();
+        put8(size);
+        putBytes(text.data(), size);
+    }
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+static uint16_t crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// COBS: out precisa de length + length / 254 + 1 bytes; retorna o tamanho
+static size_t cobsEncode(const uint8_t* data, size_t length, uint8_t* out) {
+    size_t codePos = 0;
+    size_t pos = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != 0) {
+            out[pos++] = data[i];
+            code++;
+        }
+        if (data[i] == 0 || code == 0xFF) {
+            out[codePos] = code;
+            codePos = pos++;
+            code = 1;
+        }
+    }
+    out[codePos] = code;
+    return pos;
+}
+
+// Decodifica no proprio buffer; retorna 0 se o quadro for invalido
+static size_t cobsDecode(uint8_t* data, size_t length) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length) {
+        uint8_t code = data[in++];
+        if (code == 0 || in + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            data[out++] = data[in++];
+        }
+        if (code != 0xFF && in < length) {
+            data[out++] = 0;
+        }
+    }
+    return out;
+}
+
+SerialLink::SerialLink()
+    : _serial(nullptr),
+      _ringHead(0),
+      _ringCount(0),
+      _inflightCount(0),
+      _nextSeq(0),
+      _rxLength(0),
+      _rxOverflow(false),
+      _ackCallback(nullptr),
+      _framesSent(0),
+      _bytesSent(0),
+      _acked(0),
+      _timeouts(0),
+      _badFrames(0),
+      _txStalls(0),
+      _ringFull(0),
+      _rttTotal(0),
+      _rttMax(0),
+      _handoffTotalUs(0),
+      _handoffMaxUs(0) {
+    memset(_inflight, 0, sizeof(_inflight));
+}
+
+void SerialLink::begin(HardwareSerial& serial) {
+    _serial = &serial;
+
+    // Buffers do driver antes do begin(): um quadro inteiro cabe de uma vez
+    serial.setTxBufferSize(SERIAL_LINK_TX_BUFFER);
+    serial.setRxBufferSize(SERIAL_LINK_RX_BUFFER);
+    serial.begin(SERIAL_LINK_BAUD);
+#if SERIAL_LINK_CTS_PIN >= 0 && SERIAL_LINK_RTS_PIN >= 0
+    serial.setPins(-1, -1, SERIAL_LINK_CTS_PIN, SERIAL_LINK_RTS_PIN);
+    serial.setHwFlowCtrlMode(HW_FLOWCTRL_CTS_RTS);
+#endif
+
+    // HELLO: a ponte descobre o gateway e zera a deteccao de repetidos
+    RecordWriter record(_record, SERIAL_LINK_RECORD_MAX);
+    record.put8(SERIAL_RECORD_HELLO);
+    record.put16(takeSeq());
+    record.put8(SERIAL_LINK_VERSION);
+    record.putString(GATEWAY_ID);
+    enqueue(record.length);
+    drainRing();
+}
+
+void SerialLink::poll(unsigned long now) {
+    if (!_serial) {
+        return;
+    }
+
+    readFrames(now);
+    checkTimeouts(now);
+    drainRing();
+}
+
+uint16_t SerialLink::sendReading(const UplinkEntry& entry, const SensorData& sensorData) {
+    if (!canSend()) {
+        return 0;
+    }
+
+    // Reenvio com o seq original: a ponte reconhece a leitura repetida
+    uint16_t seq = entry.linkSeq != 0 ? entry.linkSeq : takeSeq();
+    RecordWriter record(_record, SERIAL_LINK_RECORD_MAX);
+    record.put8(SERIAL_RECORD_READING);
+    record.put16(seq);
+    record.put32(entry.rxTime);
+    record.put32(sensorData.sequence);
+    record.put16((int16_t)entry.rssi);
+    record.put16((int16_t)roundf(entry.snr * 10));
+    record.put32((int32_t)entry.freqError);
+    record.put8(entry.sf);
+    record.putString(sensorData.nodeId);
+    record.putString(sensorData.nodeType);
+
+    // "data" compacto direto no registro, depois do tamanho
+    size_t dataLength = sensorData.data.isNull() ? 0 : measureJson(sensorData.data);
+    if (record.length + 2 + dataLength > SERIAL_LINK_RECORD_MAX) {
+        DEBUG_PRINTF("[Serial] ERRO: Leitura de %s nao cabe no registro (%u bytes)\n",
+                     sensorData.nodeId.c_str(), (unsigned)dataLength);
+        return 0;
+    }
+    record.put16(dataLength);
+    if (dataLength > 0) {
+        serializeJson(sensorData.data, (char*)_record + record.length, dataLength + 1);
+        record.length += dataLength;
+    }
+
+    if (record.overflow || !enqueue(record.length)) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < SERIAL_LINK_MAX_INFLIGHT; i++) {
+        if (_inflight[i].seq == 0) {
+            _inflight[i].seq = seq;
+            _inflight[i].sentAt = millis();
+            _inflightCount++;
+            break;
+        }
+    }
+
+    // Escreve ja: a leitura nao espera o proximo poll()
+    drainRing();
+    return seq;
+}
+
+bool SerialLink::sendStatus(const GatewayStats& gatewayStats) {
+    if (!_serial) {
+        return false;
+    }
+    if (_ringCount >= SERIAL_LINK_RING_SIZE) {
+        _ringFull++;
+        return false;
+    }
+
+    uint32_t fields[SERIAL_STATUS_FIELD_COUNT];
+    HeapStats heap = getHeapStats();
+
+    fields[SERIAL_STATUS_UPTIME_S] = gatewayStats.uptimeMs / 1000;
+    fields[SERIAL_STATUS_PACKETS_RX] = gatewayStats.packetsReceived;
+    fields[SERIAL_STATUS_PACKETS_FWD] = gatewayStats.packetsForwarded;
+    fields[SERIAL_STATUS_PACKETS_ERR] = gatewayStats.packetsError;
+    fields[SERIAL_STATUS_PACKETS_DUP] = gatewayStats.packetsDuplicate;
+    fields[SERIAL_STATUS_QUEUE_DEPTH] = gatewayStats.queueDepth;
+    fields[SERIAL_STATUS_QUEUE_REJECTED] = gatewayStats.queueRejected;
+    fields[SERIAL_STATUS_ACK_AVG_MS] = gatewayStats.ackAvgMs;
+    fields[SERIAL_STATUS_ACK_MAX_MS] = gatewayStats.ackMaxMs;
+    fields[SERIAL_STATUS_ACK_AIRTIME_MS] = gatewayStats.ackAirtimeMs;
+    fields[SERIAL_STATUS_ACK_AIRTIME_SINGLE_MS] = gatewayStats.ackSingleAirtimeMs;
+    fields[SERIAL_STATUS_CMD_DELIVERED] = gatewayStats.cmdDelivered;
+    fields[SERIAL_STATUS_CMD_FAILED] = gatewayStats.cmdFailed;
+    fields[SERIAL_STATUS_CMD_AVG_LATENCY_MS] = gatewayStats.cmdAvgLatencyMs;
+    fields[SERIAL_STATUS_CHANNEL_UTIL_PERMILLE] = gatewayStats.rxUtilization;
+    fields[SERIAL_STATUS_TX_UTIL_PERMILLE] = gatewayStats.txUtilization;
+    fields[SERIAL_STATUS_TX_BLOCKED] = gatewayStats.txBlocked;
+    fields[SERIAL_STATUS_ADR_ADJUSTMENTS] = gatewayStats.adrAdjustments;
+    fields[SERIAL_STATUS_ADR_REVERTS] = gatewayStats.adrReverts;
+    fields[SERIAL_STATUS_LINKS_DEGRADED] = gatewayStats.linksDegraded;
+    fields[SERIAL_STATUS_CONFIG_APPLIED] = gatewayStats.configApplied;
+    fields[SERIAL_STATUS_CONFIG_ROLLBACKS] = gatewayStats.configRollbacks;
+    fields[SERIAL_STATUS_FREE_HEAP] = heap.freeHeap;
+    fields[SERIAL_STATUS_MIN_FREE_HEAP] = heap.minFreeHeap;
+    fields[SERIAL_STATUS_LARGEST_FREE_BLOCK] = heap.largestFreeBlock;
+    fields[SERIAL_STATUS_LINK_FRAMES] = _framesSent;
+    fields[SERIAL_STATUS_LINK_ACKS] = _acked;
+    fields[SERIAL_STATUS_LINK_TIMEOUTS] = _timeouts;
+    fields[SERIAL_STATUS_LINK_BAD_FRAMES] = _badFrames;
+    fields[SERIAL_STATUS_LINK_TX_STALLS] = _txStalls;
+    fields[SERIAL_STATUS_LINK_ACK_RTT_MS] = getAvgRttMs();
+    fields[SERIAL_STATUS_LINK_HANDOFF_US] = getAvgHandoffUs();
+    fields[SERIAL_STATUS_LINK_HANDOFF_MAX_US] = _handoffMaxUs;
+
+    RecordWriter record(_record, SERIAL_LINK_RECORD_MAX);
+    record.put8(SERIAL_RECORD_STATUS);
+    record.put16(takeSeq());
+    record.putString(GATEWAY_ID);
+    record.put8(SERIAL_STATUS_FIELD_COUNT);
+    for (uint8_t i = 0; i < SERIAL_STATUS_FIELD_COUNT; i++) {
+        record.put32(fields[i]);
+    }
+
+    if (record.overflow || !enqueue(record.length)) {
+        return false;
+    }
+    drainRing();
+    return true;
+}
+
+bool SerialLink::enqueue(size_t recordLength) {
+    if (_ringCount >= SERIAL_LINK_RING_SIZE) {
+        return false;
+    }
+
+    uint16_t crc = crc16(_record, recordLength);
+    _record[recordLength++] = crc & 0xFF;
+    _record[recordLength++] = crc >> 8;
+
+    // Delimitador antes e depois: separa o quadro de texto de debug anterior
+    SerialFrame& frame = _ring[(_ringHead + _ringCount) % SERIAL_LINK_RING_SIZE];
+    frame.data[0] = 0;
+    size_t length = 1 + cobsEncode(_record, recordLength, frame.data + 1);
+    frame.data[length++] = 0;
+    frame.length = length;
+    frame.queuedAtUs = micros();
+
+    _ringCount++;
+    return true;
+}
+
+void SerialLink::drainRing() {
+    while (_ringCount > 0) {
+        SerialFrame& frame = _ring[_ringHead];
+
+        // Quadro inteiro ou nada: texto de debug nunca fica no meio
+        if (_serial->availableForWrite() < (int)frame.length) {
+            _txStalls++;
+            return;
+        }
+
+        _serial->write(frame.data, frame.length);
+
+        uint32_t handoffUs = micros() - frame.queuedAtUs;
+        _handoffTotalUs += handoffUs;
+        if (handoffUs > _handoffMaxUs) {
+            _handoffMaxUs = handoffUs;
+        }
+        Metrics::observe(HISTOGRAM_SERIAL_HANDOFF, handoffUs);
+        Metrics::inc(METRIC_SERIAL_FRAMES);
+
+        _framesSent++;
+        _bytesSent += frame.length;
+        _ringHead = (_ringHead + 1) % SERIAL_LINK_RING_SIZE;
+        _ringCount--;
+    }
+}
+
+void SerialLink::readFrames(unsigned long now) {
+    while (_serial->available() > 0) {
+        int value = _serial->read();
+        if (value < 0) {
+            break;
+        }
+
+        if (value != 0) {
+            if (_rxLength < sizeof(_rx)) {
+                _rx[_rxLength++] = value;
+            } else {
+                _rxOverflow = true;
+            }
+            continue;
+        }
+
+        // Delimitador: fecha o quadro (zeros seguidos = quadro vazio)
+        if (_rxOverflow) {
+            _badFrames++;
+            Metrics::inc(METRIC_SERIAL_BAD_FRAMES);
+        } else if (_rxLength > 0) {
+            handleFrame(_rx, _rxLength, now);
+        }
+        _rxLength = 0;
+        _rxOverflow = false;
+    }
+}
+
+void SerialLink::handleFrame(const uint8_t* frame, size_t length, unsigned long now) {
+    uint8_t record[SERIAL_LINK_RX_FRAME_MAX];
+    memcpy(record, frame, length);
+    size_t recordLength = cobsDecode(record, length);
+
+    // Tipo, seq e CRC no minimo
+    if (recordLength < 5 ||
+        crc16(record, recordLength - 2) != (record[recordLength - 2] | (record[recordLength - 1] << 8))) {
+        _badFrames++;
+        Metrics::inc(METRIC_SERIAL_BAD_FRAMES);
+        return;
+    }
+
+    uint16_t seq = record[1] | (record[2] << 8);
+    if (record[0] == SERIAL_RECORD_ACK) {
+        handleAck(seq, now);
+    }
+}
+
+void SerialLink::handleAck(uint16_t seq, unsigned long now) {
+    for (uint8_t i = 0; i < SERIAL_LINK_MAX_INFLIGHT; i++) {
+        SerialInflight& slot = _inflight[i];
+        if (slot.seq == 0 || slot.seq != seq) {
+            continue;
+        }
+
+        uint32_t rtt = now - slot.sentAt;
+        slot.seq = 0;
+        _inflightCount--;
+
+        _acked++;
+        _rttTotal += rtt;
+        if (rtt > _rttMax) {
+            _rttMax = rtt;
+        }
+        Metrics::inc(METRIC_SERIAL_ACKS);
+        Metrics::observe(HISTOGRAM_SERIAL_ACK_RTT, rtt);
+
+        if (_ackCallback) {
+            _ackCallback(seq, true);
+        }
+        return;
+    }
+
+    // ACK atrasado (depois do timeout, leitura esperando o reenvio): o seq e
+    // o mesmo do reenvio, entao ainda confirma a leitura; repetido, nada casa
+    if (_ackCallback) {
+        _ackCallback(seq, true);
+    }
+}
+
+void SerialLink::checkTimeouts(unsigned long now) {
+    for (uint8_t i = 0; i < SERIAL_LINK_MAX_INFLIGHT; i++) {
+        SerialInflight& slot = _inflight[i];
+        if (slot.seq == 0 || now - slot.sentAt < SERIAL_LINK_ACK_TIMEOUT_MS) {
+            continue;
+        }
+
+        uint16_t seq = slot.seq;
+        slot.seq = 0;
+        _inflightCount--;
+        _timeouts++;
+
+        if (_ackCallback) {
+            _ackCallback(seq, false);
+        }
+    }
+}
+
+uint16_t SerialLink::takeSeq() {
+    // Seq 0 e reservado para "sem envio"
+    _nextSeq++;
+    if (_nextSeq == 0) {
+        _nextSeq = 1;
+    }
+    return _nextSeq;
+}
+
+void SerialLink::appendTelemetry(JsonObject obj) const {
+    obj["baud"] = SERIAL_LINK_BAUD;
+    obj["frames"] = _framesSent;
+    obj["bytes"] = _bytesSent;
+    obj["acked"] = _acked;
+    obj["timeouts"] = _timeouts;
+    obj["bad_frames"] = _badFrames;
+    obj["inflight"] = _inflightCount;
+    obj["ring"] = _ringCount;
+    obj["tx_stalls"] = _txStalls;
+    obj["ring_full"] = _ringFull;
+    obj["ack_rtt_avg_ms"] = getAvgRttMs();
+    obj["ack_rtt_max_ms"] = _rttMax;
+    obj["handoff_avg_us"] = getAvgHandoffUs();
+    obj["handoff_max_us"] = _handoffMaxUs;
+}
@@ -0,0 +1,436 @@
+#include "tls_client.h"
+#include <LittleFS.h>
+#include <mbedtls/error.h>
+#include "metrics.h"
+
+TlsClient::TlsClient()
+    : _ready(false),
+      _tlsConnected(false),
+      _peeked(-1),
+      _hasSession(false),
+      _sessionPort(0),
+      _peerPort(0),
+      _verifyCalls(0),
+      _ioUs(0),
+      _requestCryptoUs(0),
+      _requestReused(false),
+      _fullHandshakes(0),
+      _resumedHandshakes(0),
+      _failures(0),
+      _fullHandshakeTotalMs(0),
+      _resumedHandshakeTotalMs(0),
+      _requests(0),
+      _reusedRequests(0),
+      _cryptoTotalUs(0),
+      _cryptoMaxUs(0),
+      _lastError(0) {
+    mbedtls_ssl_init(&_ssl);
+    mbedtls_ssl_config_init(&_conf);
+    mbedtls_x509_crt_init(&_ca);
+    mbedtls_entropy_init(&_entropy);
+    mbedtls_ctr_drbg_init(&_drbg);
+    mbedtls_ssl_session_init(&_session);
+}
+
+TlsClient::~TlsClient() {
+    stop();
+    mbedtls_ssl_session_free(&_session);
+    mbedtls_ssl_free(&_ssl);
+    mbedtls_ssl_config_free(&_conf);
+    mbedtls_x509_crt_free(&_ca);
+    mbedtls_ctr_drbg_free(&_drbg);
+    mbedtls_entropy_free(&_entropy);
+}
+
+bool TlsClient::begin() {
+    if (_ready) {
+        return true;
+    }
+
+    // CA em PEM no LittleFS (pio run -t uploadfs); interpretado so aqui
+    if (!LittleFS.begin(true)) {
+        DEBUG_PRINTLN("[TLS] ERRO: LittleFS indisponivel");
+        return false;
+    }
+    File file = LittleFS.open(TLS_CA_FILE, "r");
+    if (!file) {
+        DEBUG_PRINTF("[TLS] ERRO: CA %s nao encontrado\n", TLS_CA_FILE);
+        return false;
+    }
+    size_t size = file.size();
+    if (size == 0 || size > TLS_CA_MAX_SIZE) {
+        DEBUG_PRINTF("[TLS] ERRO: CA com tamanho invalido (%d bytes)\n", (int)size);
+        file.close();
+        return false;
+    }
+
+    // PEM precisa terminar em '\0' (o tamanho passado inclui o terminador)
+    unsigned char* pem = (unsigned char*)malloc(size + 1);
+    if (!pem) {
+        file.close();
+        return false;
+    }
+    size_t readBytes = file.read(pem, size);
+    file.close();
+    pem[readBytes] = '\0';
+
+    uint32_t parseStart = micros();
+    int ret = mbedtls_x509_crt_parse(&_ca, pem, readBytes + 1);
+    uint32_t parseUs = micros() - parseStart;
+    (void)parseUs;  // So no log de debug
+    free(pem);
+    if (ret != 0) {
+        logError("CA", ret);
+        return false;
+    }
+
+    static const char personalization[] = "lora-gateway-tls";
+    ret = mbedtls_ctr_drbg_seed(&_drbg, mbedtls_entropy_func, &_entropy,
+                                (const unsigned char*)personalization, sizeof(personalization) - 1);
+    if (ret != 0) {
+        logError("DRBG", ret);
+        return false;
+    }
+
+    ret = mbedtls_ssl_config_defaults(&_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        logError("config", ret);
+        return false;
+    }
+    mbedtls_ssl_conf_authmode(&_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&_conf, &_ca, nullptr);
+    mbedtls_ssl_conf_rng(&_conf, mbedtls_ctr_drbg_random, &_drbg);
+    mbedtls_ssl_conf_verify(&_conf, verifyCallback, this);
+#ifdef MBEDTLS_SSL_SESSION_TICKETS
+    mbedtls_ssl_conf_session_tickets(&_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    // Contexto (e buffers de registro) reaproveitado por todas as conexoes
+    ret = mbedtls_ssl_setup(&_ssl, &_conf);
+    if (ret != 0) {
+        logError("setup", ret);
+        return false;
+    }
+
+    _ready = true;
+    DEBUG_PRINTF("[TLS] CA carregado: %d bytes em %d us\n", (int)readBytes, (int)parseUs);
+    return true;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    return connect(ip.toString().c_str(), port, timeout);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, TLS_HANDSHAKE_TIMEOUT_MS);
+}
+
+int TlsClient::connect(const char* host, uint16_t port, int32_t timeout) {
+    if (!_ready) {
+        DEBUG_PRINTLN("[TLS] ERRO: CA nao carregado");
+        return 0;
+    }
+
+    stop();
+    if (!WiFiClient::connect(host, port, timeout)) {
+        _failures++;
+        Metrics::inc(METRIC_TLS_FAILURES);
+        return 0;
+    }
+
+    if (!handshake(host, port)) {
+        _failures++;
+        Metrics::inc(METRIC_TLS_FAILURES);
+        WiFiClient::stop();
+        return 0;
+    }
+
+    _tlsConnected = true;
+    return 1;
+}
+
+bool TlsClient::handshake(const char* host, uint16_t port) {
+    uint32_t start = cryptoStart();
+    int ret = mbedtls_ssl_session_reset(&_ssl);
+    if (ret == 0) {
+        ret = mbedtls_ssl_set_hostname(&_ssl, host);
+    }
+    cryptoEnd(start);
+    if (ret != 0) {
+        logError("reset", ret);
+        return false;
+    }
+    mbedtls_ssl_set_bio(&_ssl, this, bioSend, bioRecv, nullptr);
+
+    // Sessao anterior com o mesmo servidor: pede a retomada (ticket ou ID)
+    bool offered = false;
+    if (_hasSession && _sessionPort == port && _sessionHost == host) {
+        offered = mbedtls_ssl_set_session(&_ssl, &_session) == 0;
+    }
+
+    _verifyCalls = 0;
+    unsigned long handshakeStart = millis();
+    for (;;) {
+        start = cryptoStart();
+        ret = mbedtls_ssl_handshake(&_ssl);
+        cryptoEnd(start);
+        if (ret == 0) {
+            break;
+        }
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            logError("handshake", ret);
+            uint32_t flags = mbedtls_ssl_get_verify_result(&_ssl);
+            if (flags != 0) {
+                char info[128];
+                mbedtls_x509_crt_verify_info(info, sizeof(info), "", flags);
+                DEBUG_PRINTF("[TLS] Certificado recusado: %s", info);
+            }
+            clearSession();
+            return false;
+        }
+        if (millis() - handshakeStart > TLS_HANDSHAKE_TIMEOUT_MS) {
+            DEBUG_PRINTLN("[TLS] ERRO: Timeout do handshake");
+            clearSession();
+            return false;
+        }
+        delay(1);
+    }
+    unsigned long elapsed = millis() - handshakeStart;
+    Metrics::observe(HISTOGRAM_TLS_HANDSHAKE, elapsed);
+
+    // Handshake abreviado nao traz certificado: o callback nao e chamado
+    if (_verifyCalls == 0) {
+        _resumedHandshakes++;
+        _resumedHandshakeTotalMs += elapsed;
+        Metrics::inc(METRIC_TLS_RESUMED);
+    } else {
+        _fullHandshakes++;
+        _fullHandshakeTotalMs += elapsed;
+        Metrics::inc(METRIC_TLS_HANDSHAKES);
+    }
+
+    DEBUG_PRINTF("[TLS] %s:%d %s em %lu ms (%s, %s)%s\n", host, port,
+                 _verifyCalls == 0 ? "retomada" : "handshake completo", elapsed,
+                 mbedtls_ssl_get_version(&_ssl), mbedtls_ssl_get_ciphersuite(&_ssl),
+                 offered && _verifyCalls > 0 ? " - sessao recusada" : "");
+    (void)offered;  // So no log de debug
+
+    _peerHost.assign(host);
+    _peerPort = port;
+    saveSession(host, port);
+    return true;
+}
+
+void TlsClient::saveSession(const char* host, uint16_t port) {
+    clearSession();
+    if (mbedtls_ssl_get_session(&_ssl, &_session) == 0) {
+        _hasSession = true;
+        _sessionHost.assign(host);
+        _sessionPort = port;
+    }
+}
+
+void TlsClient::clearSession() {
+    mbedtls_ssl_session_free(&_session);
+    mbedtls_ssl_session_init(&_session);
+    _hasSession = false;
+}
+
+size_t TlsClient::write(uint8_t data) {
+    return write(&data, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+    if (!_tlsConnected) {
+        return 0;
+    }
+
+    size_t written = 0;
+    while (written < size) {
+        uint32_t start = cryptoStart();
+        int ret = mbedtls_ssl_write(&_ssl, buf + written, size - written);
+        cryptoEnd(start);
+        if (ret > 0) {
+            written += ret;
+        } else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            logError("write", ret);
+            stop();
+            break;
+        }
+    }
+    return written;
+}
+
+int TlsClient::available() {
+    if (!_tlsConnected) {
+        return _peeked >= 0 ? 1 : 0;
+    }
+
+    int pending = (int)mbedtls_ssl_get_bytes_avail(&_ssl);
+    if (pending == 0 && WiFiClient::available() > 0) {
+        // Processa o proximo registro sem consumir dados da aplicacao
+        uint32_t start = cryptoStart();
+        int ret = mbedtls_ssl_read(&_ssl, nullptr, 0);
+        cryptoEnd(start);
+        if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            if (ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+                logError("read", ret);
+            }
+            stop();
+            return _peeked >= 0 ? 1 : 0;
+        }
+        pending = (int)mbedtls_ssl_get_bytes_avail(&_ssl);
+    }
+    return pending + (_peeked >= 0 ? 1 : 0);
+}
+
+int TlsClient::read() {
+    uint8_t data;
+    return read(&data, 1) == 1 ? data : -1;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+
+    int count = 0;
+    if (_peeked >= 0) {
+        buf[0] = (uint8_t)_peeked;
+        _peeked = -1;
+        buf++;
+        size--;
+        count = 1;
+    }
+    if (size == 0 || available() == 0) {
+        return count > 0 ? count : -1;
+    }
+
+    uint32_t start = cryptoStart();
+    int ret = mbedtls_ssl_read(&_ssl, buf, size);
+    cryptoEnd(start);
+    if (ret > 0) {
+        return count + ret;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        stop();
+    }
+    return count > 0 ? count : -1;
+}
+
+int TlsClient::peek() {
+    if (_peeked < 0) {
+        _peeked = read();
+    }
+    return _peeked;
+}
+
+void TlsClient::flush() {
+    // Registros sao enviados inteiros em write(); nada fica no cliente
+}
+
+void TlsClient::stop() {
+    if (_tlsConnected) {
+        uint32_t start = cryptoStart();
+        mbedtls_ssl_close_notify(&_ssl);
+        cryptoEnd(start);
+        _tlsConnected = false;
+    }
+    _peeked = -1;
+    WiFiClient::stop();
+}
+
+bool TlsClient::isConnectedTo(const char* host, uint16_t port) {
+    return connected() && _peerPort == port && _peerHost == host;
+}
+
+uint8_t TlsClient::connected() {
+    if (_peeked >= 0 || (_tlsConnected && mbedtls_ssl_get_bytes_avail(&_ssl) > 0)) {
+        return 1;
+    }
+    if (_tlsConnected && !WiFiClient::connected()) {
+        _tlsConnected = false;
+    }
+    return _tlsConnected ? 1 : 0;
+}
+
+void TlsClient::beginRequest() {
+    _requestCryptoUs = 0;
+    _requestReused = connected();
+}
+
+void TlsClient::endRequest() {
+    _requests++;
+    if (_requestReused) {
+        _reusedRequests++;
+    }
+    _cryptoTotalUs += _requestCryptoUs;
+    if (_requestCryptoUs > _cryptoMaxUs) {
+        _cryptoMaxUs = _requestCryptoUs;
+    }
+    Metrics::observe(HISTOGRAM_TLS_CRYPTO, _requestCryptoUs);
+}
+
+void TlsClient::appendTelemetry(JsonObject obj) const {
+    obj["ready"] = _ready;
+    obj["connected"] = _tlsConnected;
+    obj["full_handshakes"] = _fullHandshakes;
+    obj["resumed_handshakes"] = _resumedHandshakes;
+    obj["resumption_rate_pct"] = getResumptionRate();
+    obj["failures"] = _failures;
+    obj["avg_full_handshake_ms"] =
+        _fullHandshakes > 0 ? (uint32_t)(_fullHandshakeTotalMs / _fullHandshakes) : 0;
+    obj["avg_resumed_handshake_ms"] =
+        _resumedHandshakes > 0 ? (uint32_t)(_resumedHandshakeTotalMs / _resumedHandshakes) : 0;
+    obj["requests"] = _requests;
+    obj["reused_connections"] = _reusedRequests;
+    obj["avg_crypto_us"] = getAvgCryptoUs();
+    obj["max_crypto_us"] = _cryptoMaxUs;
+    obj["last_error"] = _lastError;
+}
+
+void TlsClient::logError(const char* step, int ret) {
+    _lastError = ret;
+    char message[96];
+    mbedtls_strerror(ret, message, sizeof(message));
+    DEBUG_PRINTF("[TLS] ERRO em %s: -0x%04X %s\n", step, (unsigned int)-ret, message);
+}
+
+int TlsClient::bioSend(void* ctx, const unsigned char* buf, size_t len) {
+    TlsClient* self = static_cast<TlsClient*>(ctx);
+    uint32_t start = micros();
+    size_t sent = self->WiFiClient::write(buf, len);
+    self->_ioUs += micros() - start;
+    return sent > 0 ? (int)sent : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int TlsClient::bioRecv(void* ctx, unsigned char* buf, size_t len) {
+    TlsClient* self = static_cast<TlsClient*>(ctx);
+    uint32_t start = micros();
+    int ret;
+    if (self->WiFiClient::available() > 0) {
+        ret = self->WiFiClient::read(buf, len);
+        if (ret <= 0) {
+            ret = MBEDTLS_ERR_NET_RECV_FAILED;
+        }
+    } else if (self->WiFiClient::connected()) {
+        ret = MBEDTLS_ERR_SSL_WANT_READ;
+    } else {
+        ret = 0;                // EOF: servidor fechou o TCP
+    }
+    self->_ioUs += micros() - start;
+    return ret;
+}
+
+int TlsClient::verifyCallback(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+    (void)crt;
+    (void)depth;
+    (void)flags;
+    static_cast<TlsClient*>(ctx)->_verifyCalls++;
+    return 0;
+}
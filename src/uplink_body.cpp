@@ -0,0 +1,117 @@
+#include "uplink_body.h"
+
+UplinkBodyStream::UplinkBodyStream(UplinkRenderFn render)
+    : _render(render) {
+    clear();
+}
+
+void UplinkBodyStream::clear(uint8_t format) {
+    _format = format;
+    _count = 0;
+    _length = format == PAYLOAD_FORMAT_MSGPACK ? 1 : 2;  // fixarray ou '[' e ']'
+    _chunkPos = 0;
+    _chunkLen = 0;
+    _next = 0;
+    _sent = 0;
+    _failed = false;
+}
+
+bool UplinkBodyStream::add(UplinkEntry* entry) {
+    if (_count >= UPLINK_HTTP_BATCH_MAX) {
+        return false;
+    }
+
+    size_t length = _render(*entry, _format, nullptr, 0);
+    if (length == 0) {
+        return false;
+    }
+
+    if (_count > 0 && _format == PAYLOAD_FORMAT_JSON) {
+        _length++;              // ','
+    }
+    _entries[_count] = entry;
+    _lengths[_count] = length;
+    _count++;
+    _length += length;
+    return true;
+}
+
+int UplinkBodyStream::available() {
+    if (_failed) {
+        return -1;
+    }
+    return _length - _sent;
+}
+
+int UplinkBodyStream::read() {
+    if (!refill()) {
+        return -1;
+    }
+    _sent++;
+    return (uint8_t)_chunk[_chunkPos++];
+}
+
+int UplinkBodyStream::peek() {
+    if (!refill()) {
+        return -1;
+    }
+    return (uint8_t)_chunk[_chunkPos];
+}
+
+size_t UplinkBodyStream::readBytes(char* buffer, size_t length) {
+    size_t copied = 0;
+    while (copied < length && refill()) {
+        size_t count = _chunkLen - _chunkPos;
+        if (count > length - copied) {
+            count = length - copied;
+        }
+        memcpy(buffer + copied, _chunk + _chunkPos, count);
+        _chunkPos += count;
+        copied += count;
+    }
+    _sent += copied;
+    return copied;
+}
+
+bool UplinkBodyStream::refill() {
+    if (_chunkPos < _chunkLen) {
+        return true;
+    }
+    if (_failed || _next > _count) {
+        return false;
+    }
+
+    _chunkPos = 0;
+    _chunkLen = 0;
+    bool json = _format == PAYLOAD_FORMAT_JSON;
+
+    // Abertura do array, separador e fechamento
+    if (_next == 0) {
+        _chunk[_chunkLen++] = json ? '[' : (char)(0x90 | _count);
+    } else if (json && _next < _count) {
+        _chunk[_chunkLen++] = ',';
+    }
+    if (_next == _count) {
+        if (json) {
+            _chunk[_chunkLen++] = ']';
+        }
+        _next = _count + 1;
+        return _chunkLen > 0;
+    }
+
+    // Montada de novo no tamanho medido: mais longa nao cabe e aborta
+    size_t expected = _lengths[_next];
+    size_t written = _render(*_entries[_next], _format, _chunk + _chunkLen, expected);
+    if (written == 0 || (written < expected && !json)) {
+        DEBUG_PRINTF("[Body] %s seq %u mudou de tamanho apos medida, abortando envio\n",
+                     _entries[_next]->nodeId.c_str(), _entries[_next]->sequence);
+        _failed = true;
+        return false;
+    }
+    if (written < expected) {
+        memset(_chunk + _chunkLen + written, ' ', expected - written);
+    }
+    _chunkLen += expected;
+    _next++;
+    return true;
+}
@@ -0,0 +1,324 @@
+#include "uplink_compressor.h"
+#include "metrics.h"
+
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_NO_POS 0xFFFF
+
+// Candidatos comparados por posicao em cada nivel
+static const uint8_t LEVEL_MAX_CHAIN[UPLINK_COMPRESS_LEVELS] = { 0, 1, 4, 32 };
+
+// Tabelas do deflate (RFC 1951, 3.2.5): simbolos 257..285 e distancias 0..29
+static const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static inline uint16_t hash3(const uint8_t* p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (uint16_t)((uint32_t)(v * 2654435761U) >> (32 - UPLINK_COMPRESS_HASH_BITS));
+}
+
+UplinkCompressor::UplinkCompressor()
+    : _pos(nullptr),
+      _end(nullptr),
+      _bitBuffer(0),
+      _bitCount(0),
+      _overflow(false),
+      _batches(0),
+      _lastLevel(0),
+      _exploreUp(true),
+      _txUsPerByte(UPLINK_COMPRESS_TX_US_PER_BYTE),
+      _txMeanBytes(0),
+      _txMeanUs(0),
+      _txVarBytes(0),
+      _txCovBytesUs(0),
+      _transfers(0),
+      _bytesIn(0),
+      _bytesOut(0),
+      _compressUsTotal(0),
+      _compressedIn(0) {
+    memset(_levels, 0, sizeof(_levels));
+    _levels[0].ratio = 1.0f;
+}
+
+size_t UplinkCompressor::compress(const uint8_t* data, size_t length) {
+    _lastLevel = 0;
+    _bytesIn += length;
+    Metrics::inc(METRIC_UPLINK_BODY_BYTES, length);
+
+    uint8_t level = 0;
+    if (length >= UPLINK_COMPRESS_MIN_BYTES && length <= sizeof(_out)) {
+        level = chooseLevel(length);
+    }
+    if (level == 0) {
+        _bytesOut += length;
+        Metrics::inc(METRIC_UPLINK_SENT_BYTES, length);
+        return 0;
+    }
+
+    uint32_t start = micros();
+    size_t packed = deflate(data, length, level);
+    uint32_t elapsed = micros() - start;
+
+    // Media movel por nivel (1/8); sem ganho conta como razao 1
+    CompressionLevelStats& stats = _levels[level];
+    float usPerByte = (float)elapsed / length;
+    float ratio = packed > 0 ? (float)packed / length : 1.0f;
+    if (stats.samples == 0) {
+        stats.usPerByte = usPerByte;
+        stats.ratio = ratio;
+    } else {
+        stats.usPerByte += (usPerByte - stats.usPerByte) / 8;
+        stats.ratio += (ratio - stats.ratio) / 8;
+    }
+    stats.samples++;
+
+    _compressUsTotal += elapsed;
+    _compressedIn += length;
+    Metrics::observe(HISTOGRAM_UPLINK_COMPRESS, (int32_t)((uint64_t)elapsed * 1024 / length));
+
+    if (packed == 0) {
+        _bytesOut += length;
+        Metrics::inc(METRIC_UPLINK_SENT_BYTES, length);
+        return 0;
+    }
+
+    _lastLevel = level;
+    _bytesOut += packed;
+    Metrics::inc(METRIC_UPLINK_SENT_BYTES, packed);
+    return packed;
+}
+
+void UplinkCompressor::recordTransfer(size_t bytes, uint32_t durationUs) {
+    // Variancia e covariancia com peso 1/16 para as amostras novas
+    const float weight = 1.0f / 16;
+    float dx = (float)bytes - _txMeanBytes;
+    float dy = (float)durationUs - _txMeanUs;
+    if (_transfers++ == 0) {
+        _txMeanBytes = bytes;
+        _txMeanUs = durationUs;
+        return;
+    }
+    _txMeanBytes += weight * dx;
+    _txMeanUs += weight * dy;
+    _txVarBytes = (1 - weight) * (_txVarBytes + weight * dx * dx);
+    _txCovBytesUs = (1 - weight) * (_txCovBytesUs + weight * dx * dy);
+
+    // Tamanhos quase iguais nao separam RTT de transmissao: mantem a estimativa
+    if (_txVarBytes < UPLINK_COMPRESS_MIN_SPREAD * UPLINK_COMPRESS_MIN_SPREAD) {
+        return;
+    }
+    float slope = _txCovBytesUs / _txVarBytes;
+    _txUsPerByte = slope > 0 ? slope : 0;
+}
+
+uint8_t UplinkCompressor::chooseLevel(size_t length) {
+    _batches++;
+
+    for (uint8_t level = 1; level < UPLINK_COMPRESS_LEVELS; level++) {
+        if (_levels[level].samples == 0) {
+            return level;
+        }
+    }
+
+    uint8_t best = 0;
+    float bestCost = estimateCost(0, length);
+    for (uint8_t level = 1; level < UPLINK_COMPRESS_LEVELS; level++) {
+        float cost = estimateCost(level, length);
+        if (cost < bestCost) {
+            best = level;
+            bestCost = cost;
+        }
+    }
+
+    // Reavalia um vizinho de tempos em tempos (CPU e rede mudam)
+    if (_batches % UPLINK_COMPRESS_EXPLORE_EVERY == 0) {
+        _exploreUp = !_exploreUp;
+        if (_exploreUp && best + 1 < UPLINK_COMPRESS_LEVELS) {
+            return best + 1;
+        }
+        if (!_exploreUp && best > 1) {
+            return best - 1;
+        }
+    }
+    return best;
+}
+
+float UplinkCompressor::estimateCost(uint8_t level, size_t length) const {
+    const CompressionLevelStats& stats = _levels[level];
+    return stats.usPerByte * length + length * stats.ratio * _txUsPerByte;
+}
+
+// ---------------------------------------------------------------------------
+// Deflate: cabecalho zlib, um bloco com Huffman fixo e Adler-32
+// ---------------------------------------------------------------------------
+
+size_t UplinkCompressor::deflate(const uint8_t* data, size_t length, uint8_t level) {
+    // Saida maior ou igual a entrada nao compensa: para antes
+    _pos = _out;
+    _end = _out + (length < sizeof(_out) ? length : sizeof(_out));
+    _bitBuffer = 0;
+    _bitCount = 0;
+    _overflow = false;
+
+    putByte(0x78);              // CMF: deflate, janela de 32 KB
+    putByte(0x01);              // FLG: sem dicionario, (CMF*256 + FLG) % 31 == 0
+    putBits(1, 1);              // BFINAL
+    putBits(1, 2);              // BTYPE = 01 (Huffman fixo)
+
+    memset(_head, 0xFF, sizeof(_head));
+    uint8_t maxChain = LEVEL_MAX_CHAIN[level];
+
+    size_t pos = 0;
+    while (pos < length && !_overflow) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+
+        if (pos + DEFLATE_MIN_MATCH <= length) {
+            uint16_t h = hash3(data + pos);
+            size_t maxLength = length - pos < DEFLATE_MAX_MATCH ? length - pos : DEFLATE_MAX_MATCH;
+
+            uint16_t candidate = _head[h];
+            for (uint8_t chain = 0; chain < maxChain && candidate != DEFLATE_NO_POS; chain++) {
+                size_t matched = 0;
+                while (matched < maxLength && data[candidate + matched] == data[pos + matched]) {
+                    matched++;
+                }
+                if (matched > bestLength) {
+                    bestLength = matched;
+                    bestDistance = pos - candidate;
+                    if (matched == maxLength) {
+                        break;
+                    }
+                }
+                candidate = _prev[candidate];
+            }
+
+            _prev[pos] = _head[h];
+            _head[h] = (uint16_t)pos;
+        }
+
+        if (bestLength >= DEFLATE_MIN_MATCH) {
+            putMatch(bestLength, bestDistance);
+            // Posicoes dentro da repeticao tambem entram no hash
+            size_t end = pos + bestLength;
+            for (pos++; pos < end && pos + DEFLATE_MIN_MATCH <= length; pos++) {
+                uint16_t h = hash3(data + pos);
+                _prev[pos] = _head[h];
+                _head[h] = (uint16_t)pos;
+            }
+            pos = end;
+        } else {
+            putSymbol(data[pos]);
+            pos++;
+        }
+    }
+
+    putSymbol(256);             // Fim do bloco
+    if (_bitCount > 0) {
+        putByte((uint8_t)_bitBuffer);
+        _bitBuffer = 0;
+        _bitCount = 0;
+    }
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t i = 0; i < length; i++) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    putByte((uint8_t)(adler >> 24));
+    putByte((uint8_t)(adler >> 16));
+    putByte((uint8_t)(adler >> 8));
+    putByte((uint8_t)adler);
+
+    return _overflow ? 0 : (size_t)(_pos - _out);
+}
+
+void UplinkCompressor::putBits(uint32_t value, uint8_t count) {
+    _bitBuffer |= value << _bitCount;
+    _bitCount += count;
+    while (_bitCount >= 8) {
+        putByte((uint8_t)_bitBuffer);
+        _bitBuffer >>= 8;
+        _bitCount -= 8;
+    }
+}
+
+void UplinkCompressor::putCode(uint16_t code, uint8_t count) {
+    // Codigos Huffman vao do bit mais significativo para o menos
+    uint16_t reversed = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    putBits(reversed, count);
+}
+
+void UplinkCompressor::putSymbol(uint16_t symbol) {
+    if (symbol < 144) {
+        putCode(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        putCode(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        putCode(symbol - 256, 7);
+    } else {
+        putCode(0xC0 + symbol - 280, 8);
+    }
+}
+
+void UplinkCompressor::putMatch(size_t length, size_t distance) {
+    uint8_t code = 28;
+    while (LENGTH_BASE[code] > length) {
+        code--;
+    }
+    putSymbol(257 + code);
+    putBits(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+    code = 29;
+    while (DIST_BASE[code] > distance) {
+        code--;
+    }
+    putCode(code, 5);
+    putBits(distance - DIST_BASE[code], DIST_EXTRA[code]);
+}
+
+void UplinkCompressor::putByte(uint8_t value) {
+    if (_pos >= _end) {
+        _overflow = true;
+        return;
+    }
+    *_pos++ = value;
+}
+
+void UplinkCompressor::appendTelemetry(JsonObject obj) const {
+    obj["level"] = _lastLevel;
+    obj["bytes_in"] = _bytesIn;
+    obj["bytes_out"] = _bytesOut;
+    obj["ratio"] = roundf(getRatio() * 100) / 100;
+    obj["us_per_kb"] = getUsPerKb();
+    obj["tx_us_per_byte"] = roundf(_txUsPerByte * 100) / 100;
+
+    JsonArray levels = obj["levels"].to<JsonArray>();
+    for (uint8_t level = 1; level < UPLINK_COMPRESS_LEVELS; level++) {
+        const CompressionLevelStats& stats = _levels[level];
+        JsonObject entry = levels.add<JsonObject>();
+        entry["level"] = level;
+        entry["samples"] = stats.samples;
+        entry["us_per_kb"] = (uint32_t)(stats.usPerByte * 1024);
+        entry["ratio_pct"] = (uint32_t)(stats.ratio * 100);
+    }
+}
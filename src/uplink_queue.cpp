@@ -0,0 +1,233 @@
+#include "uplink_queue.h"
+#include "metrics.h"
+
+UplinkDropCallback UplinkQueue::_dropCallback = nullptr;
+
+UplinkQueue::UplinkQueue()
+    : _count(0), _highWater(0), _rejected(0) {
+    memset(_classes, 0, sizeof(_classes));
+}
+
+uint8_t UplinkQueue::classify(const SensorData& sensorData) {
+#define UPLINK_RULE_MATCH(field, value, priority)                                   \
+    if (strcmp(field, "type") == 0 ? sensorData.nodeType == StringView(value)        \
+                                   : strcmp(sensorData.data[field] | "", value) == 0) { \
+        return priority;                                                             \
+    }
+    UPLINK_PRIORITY_RULES(UPLINK_RULE_MATCH)
+#undef UPLINK_RULE_MATCH
+    return UPLINK_CLASS_NORMAL;
+}
+
+bool UplinkQueue::isAcked(const UplinkEntry& entry) {
+#if ACK_POLICY == ACK_POLICY_ON_ENQUEUE
+    return !entry.mirror;
+#else
+    return false;
+#endif
+}
+
+unsigned long UplinkQueue::retryDelay(uint8_t attempts) {
+    // Dobra a cada falha: 2 s, 4 s, 8 s... ate UPLINK_RETRY_MAX_MS
+    unsigned long delay = UPLINK_RETRY_INTERVAL_MS;
+    for (uint8_t i = 1; i < attempts && delay < UPLINK_RETRY_MAX_MS; i++) {
+        delay *= 2;
+    }
+    return delay < UPLINK_RETRY_MAX_MS ? delay : UPLINK_RETRY_MAX_MS;
+}
+
+bool UplinkQueue::push(const UplinkEntry& entry) {
+    uint8_t priority = entry.priority < UPLINK_CLASS_COUNT ? entry.priority : UPLINK_CLASS_NORMAL;
+
+    // Sob pressao, as periodicas ainda nao enviadas do mesmo no dao lugar a nova
+    if (priority == UPLINK_CLASS_PERIODIC && _count >= UPLINK_COALESCE_DEPTH) {
+        int index;
+        while ((index = findPeriodic(&entry.nodeId)) >= 0) {
+            DEBUG_PRINTF("[Queue] %s seq %u substituida pela seq %u\n", entry.nodeId.c_str(),
+                         _entries[_order[index]].sequence, entry.sequence);
+            evictAt(index);
+            _classes[UPLINK_CLASS_PERIODIC].coalesced++;
+            Metrics::inc(METRIC_UPLINK_COALESCED);
+        }
+    }
+
+    // Fila cheia: descarta a periodica mais antiga ainda nao enviada
+    if (isFull()) {
+        int index = findPeriodic(nullptr);
+        if (index < 0) {
+            _rejected++;
+            DEBUG_PRINTLN("[Queue] ERRO: Fila de uplink cheia!");
+            return false;
+        }
+        DEBUG_PRINTF("[Queue] Fila cheia: descartando periodica %s seq %u\n",
+                     _entries[_order[index]].nodeId.c_str(), _entries[_order[index]].sequence);
+        evictAt(index);
+        _classes[UPLINK_CLASS_PERIODIC].shed++;
+        Metrics::inc(METRIC_UPLINK_SHED);
+    }
+
+    uint8_t slot = freeSlot();
+    _entries[slot] = entry;
+    _entries[slot].priority = priority;
+
+    // Depois de todas as entradas da mesma classe ou de classe mais alta
+    uint8_t position = _count;
+    while (position > 0 && _entries[_order[position - 1]].priority > priority) {
+        _order[position] = _order[position - 1];
+        position--;
+    }
+    _order[position] = slot;
+    _count++;
+
+    _classes[priority].depth++;
+    _classes[priority].enqueued++;
+
+    if (_count > _highWater) {
+        _highWater = _count;
+    }
+
+    return true;
+}
+
+UplinkEntry* UplinkQueue::front() {
+    if (isEmpty()) {
+        return nullptr;
+    }
+    return &_entries[_order[0]];
+}
+
+const UplinkEntry* UplinkQueue::front() const {
+    if (isEmpty()) {
+        return nullptr;
+    }
+    return &_entries[_order[0]];
+}
+
+void UplinkQueue::pop() {
+    if (isEmpty()) {
+        return;
+    }
+    removeAt(0);
+}
+
+UplinkEntry* UplinkQueue::at(uint8_t index) {
+    if (index >= _count) {
+        return nullptr;
+    }
+    return &_entries[_order[index]];
+}
+
+const UplinkEntry* UplinkQueue::at(uint8_t index) const {
+    if (index >= _count) {
+        return nullptr;
+    }
+    return &_entries[_order[index]];
+}
+
+void UplinkQueue::popCompleted() {
+    uint8_t index = 0;
+    while (index < _count) {
+        if (_entries[_order[index]].completed) {
+            removeAt(index);
+        } else {
+            index++;
+        }
+    }
+}
+
+void UplinkQueue::recordDelivered(const UplinkEntry& entry, unsigned long now) {
+    static const HistogramId histograms[UPLINK_CLASS_COUNT] = {
+        HISTOGRAM_UPLINK_LATENCY_EVENT,
+        HISTOGRAM_UPLINK_LATENCY_NORMAL,
+        HISTOGRAM_UPLINK_LATENCY_PERIODIC
+    };
+
+    uint8_t priority = entry.priority < UPLINK_CLASS_COUNT ? entry.priority : UPLINK_CLASS_NORMAL;
+    uint32_t latency = now - entry.rxTime;
+
+    UplinkClassStats& stats = _classes[priority];
+    stats.delivered++;
+    stats.latencyTotalMs += latency;
+    if (latency > stats.latencyMaxMs) {
+        stats.latencyMaxMs = latency;
+    }
+    Metrics::observe(histograms[priority], latency);
+}
+
+const char* UplinkQueue::className(uint8_t priority) {
+    switch (priority) {
+        case UPLINK_CLASS_EVENT:
+            return "event";
+        case UPLINK_CLASS_PERIODIC:
+            return "periodic";
+        default:
+            return "normal";
+    }
+}
+
+void UplinkQueue::appendTelemetry(JsonArray classes) const {
+    for (uint8_t priority = 0; priority < UPLINK_CLASS_COUNT; priority++) {
+        const UplinkClassStats& stats = _classes[priority];
+        JsonObject entry = classes.add<JsonObject>();
+        entry["class"] = className(priority);
+        entry["depth"] = stats.depth;
+        entry["enqueued"] = stats.enqueued;
+        entry["delivered"] = stats.delivered;
+        entry["coalesced"] = stats.coalesced;
+        entry["shed"] = stats.shed;
+        entry["evicted"] = stats.evicted;
+        entry["avg_latency_ms"] =
+            stats.delivered > 0 ? (uint32_t)(stats.latencyTotalMs / stats.delivered) : 0;
+        entry["max_latency_ms"] = stats.latencyMaxMs;
+    }
+}
+
+int UplinkQueue::findPeriodic(const NodeId* nodeId) const {
+    // Em envio (sendId) ainda pode ser confirmada: nao entra
+    for (uint8_t index = 0; index < _count; index++) {
+        const UplinkEntry& entry = _entries[_order[index]];
+        if (entry.priority != UPLINK_CLASS_PERIODIC || entry.sendId != 0 || entry.completed) {
+            continue;
+        }
+        if (!nodeId || entry.nodeId == *nodeId) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+void UplinkQueue::removeAt(uint8_t index) {
+    uint8_t priority = _entries[_order[index]].priority;
+    if (priority < UPLINK_CLASS_COUNT && _classes[priority].depth > 0) {
+        _classes[priority].depth--;
+    }
+
+    for (uint8_t i = index; i + 1 < _count; i++) {
+        _order[i] = _order[i + 1];
+    }
+    _count--;
+}
+
+void UplinkQueue::evictAt(uint8_t index) {
+    const UplinkEntry& entry = _entries[_order[index]];
+    if (isAcked(entry)) {
+        _classes[entry.priority].evicted++;
+        Metrics::inc(METRIC_UPLINK_EVICTED);
+    } else if (!entry.mirror && _dropCallback) {
+        _dropCallback(entry);
+    }
+    removeAt(index);
+}
+
+uint8_t UplinkQueue::freeSlot() const {
+    for (uint8_t slot = 0; slot < PACKET_QUEUE_SIZE; slot++) {
+        bool used = false;
+        for (uint8_t index = 0; index < _count && !used; index++) {
+            used = _order[index] == slot;
+        }
+        if (!used) {
+            return slot;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+#include "uplink_router.h"
+#include "metrics.h"
+
+UplinkRouter::UplinkRouter()
+    : _next(0), _rejected(0) {
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT; i++) {
+        UplinkEndpoint& endpoint = _endpoints[i];
+        endpoint.port = 0;
+        endpoint.format = PAYLOAD_FORMAT_JSON;
+        endpoint.breaker = BREAKER_CLOSED;
+        endpoint.failures = 0;
+        endpoint.openUntil = 0;
+        endpoint.breakerOpens = 0;
+        endpoint.delivered = 0;
+        endpoint.rerouted = 0;
+        endpoint.batcher.setPublishGauges(i == 0);
+    }
+
+    _endpoints[0].host.assign(SERVER_HOST);
+    _endpoints[0].port = SERVER_PORT;
+
+    uint8_t index = 1;
+#define UPLINK_ENDPOINT_INIT(endpointHost, endpointPort) \
+    _endpoints[index].host.assign(endpointHost);         \
+    _endpoints[index].port = endpointPort;               \
+    index++;
+    UPLINK_EXTRA_ENDPOINTS(UPLINK_ENDPOINT_INIT)
+#undef UPLINK_ENDPOINT_INIT
+    (void)index;
+}
+
+void UplinkRouter::setPrimary(const char* host, uint16_t port) {
+    // Outro servidor: formato negociado de novo
+    if (!(_endpoints[0].host == host) || _endpoints[0].port != port) {
+        _endpoints[0].format = PAYLOAD_FORMAT_JSON;
+    }
+    _endpoints[0].host.assign(host);
+    _endpoints[0].port = port;
+    publish();
+}
+
+bool UplinkRouter::push(const UplinkEntry& entry, unsigned long now) {
+    UplinkEntry copy = entry;
+    copy.mirror = false;
+
+    // Nenhum disponivel: espera na fila do primeiro
+    int owner = pick(now, -1);
+    if (owner < 0) {
+        owner = 0;
+    }
+
+    // Fila cheia: tenta os demais servidores antes de recusar
+    bool accepted = pushTo(owner, copy);
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT && !accepted; i++) {
+        if (i != owner && pushTo(i, copy)) {
+            owner = i;
+            accepted = true;
+        }
+    }
+    if (!accepted) {
+        _rejected++;
+        return false;
+    }
+
+#if UPLINK_POLICY == UPLINK_POLICY_MIRROR
+    // Copias sem ACK para os demais; fila cheia perde so a copia
+    copy.mirror = true;
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT; i++) {
+        if (i != owner && pushTo(i, copy)) {
+            Metrics::inc(METRIC_UPLINK_MIRRORED);
+        }
+    }
+#endif
+    return true;
+}
+
+bool UplinkRouter::canSend(uint8_t index, unsigned long now) {
+    UplinkEndpoint& endpoint = _endpoints[index];
+    if (endpoint.breaker != BREAKER_OPEN) {
+        return true;
+    }
+    if ((long)(now - endpoint.openUntil) < 0) {
+        return false;
+    }
+
+    DEBUG_PRINTF("[Router] %s:%d meio aberto: requisicao de teste\n",
+                 endpoint.host.c_str(), endpoint.port);
+    endpoint.breaker = BREAKER_HALF_OPEN;
+    return true;
+}
+
+void UplinkRouter::recordResult(uint8_t index, int httpStatus, uint32_t rttMs, uint8_t backlog,
+                                unsigned long now) {
+    UplinkEndpoint& endpoint = _endpoints[index];
+    endpoint.batcher.recordResult(httpStatus, rttMs, backlog);
+
+    // Mesmo criterio do controle de lotes: 4xx (fora o 429) nao e o servidor
+    bool failed = httpStatus <= 0 || httpStatus >= 500 || httpStatus == 429;
+    if (!failed) {
+        if (endpoint.breaker != BREAKER_CLOSED) {
+            DEBUG_PRINTF("[Router] %s:%d respondeu: disjuntor fechado\n",
+                         endpoint.host.c_str(), endpoint.port);
+        }
+        endpoint.breaker = BREAKER_CLOSED;
+        endpoint.failures = 0;
+        publish();
+        return;
+    }
+
+    if (endpoint.failures < 255) {
+        endpoint.failures++;
+    }
+    if (endpoint.breaker == BREAKER_HALF_OPEN || endpoint.failures >= UPLINK_BREAKER_FAILURES) {
+        endpoint.breaker = BREAKER_OPEN;
+        endpoint.openUntil = now + UPLINK_BREAKER_OPEN_MS;
+        endpoint.breakerOpens++;
+        Metrics::inc(METRIC_UPLINK_BREAKER_OPENS);
+        DEBUG_PRINTF("[Router] %s:%d: %d falhas seguidas, disjuntor aberto por %d ms\n",
+                     endpoint.host.c_str(), endpoint.port, endpoint.failures,
+                     UPLINK_BREAKER_OPEN_MS);
+        drain(index, now);
+    }
+    publish();
+}
+
+void UplinkRouter::recordFormat(uint8_t index, int httpStatus, bool acceptsMsgPack) {
+    // Outras respostas (5xx de um proxy, timeout) nao dizem nada do formato
+    bool accepted = httpStatus >= 200 && httpStatus < 300;
+    if (!accepted && httpStatus != 415) {
+        return;
+    }
+
+    UplinkEndpoint& endpoint = _endpoints[index];
+    uint8_t format = accepted && acceptsMsgPack ? PAYLOAD_FORMAT_MSGPACK : PAYLOAD_FORMAT_JSON;
+    if (format != endpoint.format) {
+        DEBUG_PRINTF("[Router] %s:%d: lotes em %s\n", endpoint.host.c_str(), endpoint.port,
+                     format == PAYLOAD_FORMAT_MSGPACK ? "MessagePack" : "JSON");
+        endpoint.format = format;
+    }
+}
+
+bool UplinkRouter::reroute(uint8_t from, const UplinkEntry& entry, unsigned long now) {
+    int target = pick(now, from);
+    if (target < 0) {
+        return false;
+    }
+
+    UplinkQueue& queue = _endpoints[target].queue;
+
+    // Copia (MIRROR) ja na fila de destino: passa a confirmar a leitura
+    bool promoted = false;
+    for (uint8_t i = 0; i < queue.size() && !promoted; i++) {
+        UplinkEntry* queued = queue.at(i);
+        if (!queued->completed && queued->sequence == entry.sequence &&
+            queued->nodeId == entry.nodeId) {
+            queued->mirror = false;
+            promoted = true;
+        }
+    }
+
+    if (!promoted) {
+        UplinkEntry moved = entry;
+        moved.mirror = false;
+        moved.attempts = 0;
+        moved.nextAttempt = now;
+        moved.sendId = 0;
+        if (!queue.push(moved)) {
+            return false;
+        }
+    }
+
+    _endpoints[from].rerouted++;
+    Metrics::inc(METRIC_UPLINK_REROUTED);
+    DEBUG_PRINTF("[Router] %s seq %u: %s:%d -> %s:%d\n", entry.nodeId.c_str(), entry.sequence,
+                 _endpoints[from].host.c_str(), _endpoints[from].port,
+                 _endpoints[target].host.c_str(), _endpoints[target].port);
+    return true;
+}
+
+bool UplinkRouter::nextWake(unsigned long& wakeAt) const {
+    bool any = false;
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT; i++) {
+        const UplinkEndpoint& endpoint = _endpoints[i];
+        if (endpoint.queue.isEmpty()) {
+            continue;
+        }
+
+        unsigned long at = endpoint.queue.front()->nextAttempt;
+        if (endpoint.batcher.isHolding() && (long)(endpoint.batcher.getFlushDeadline() - at) > 0) {
+            at = endpoint.batcher.getFlushDeadline();
+        }
+        if (endpoint.breaker == BREAKER_OPEN && (long)(endpoint.openUntil - at) > 0) {
+            at = endpoint.openUntil;
+        }
+
+        if (!any || (long)(at - wakeAt) < 0) {
+            wakeAt = at;
+            any = true;
+        }
+    }
+    return any;
+}
+
+uint8_t UplinkRouter::size() const {
+    uint8_t total = 0;
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT; i++) {
+        total += _endpoints[i].queue.size();
+    }
+    return total;
+}
+
+uint32_t UplinkRouter::getScore(uint8_t index) const {
+    const BatchController& batcher = _endpoints[index].batcher;
+    return batcher.getRttMs() + (uint32_t)batcher.getErrorRate() * UPLINK_HEALTH_ERROR_WEIGHT_MS / 1000;
+}
+
+const char* UplinkRouter::breakerName(uint8_t state) {
+    switch (state) {
+        case BREAKER_OPEN:
+            return "open";
+        case BREAKER_HALF_OPEN:
+            return "half_open";
+        default:
+            return "closed";
+    }
+}
+
+void UplinkRouter::appendTelemetry(JsonObject obj) const {
+#if UPLINK_POLICY == UPLINK_POLICY_MIRROR
+    obj["policy"] = "mirror";
+#elif UPLINK_POLICY == UPLINK_POLICY_ROUND_ROBIN
+    obj["policy"] = "round_robin";
+#else
+    obj["policy"] = "failover";
+#endif
+    obj["rejected"] = _rejected;
+
+    JsonArray endpoints = obj["endpoints"].to<JsonArray>();
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT; i++) {
+        const UplinkEndpoint& endpoint = _endpoints[i];
+        JsonObject entry = endpoints.add<JsonObject>();
+        entry["host"] = endpoint.host.c_str();
+        entry["port"] = endpoint.port;
+        entry["breaker"] = breakerName(endpoint.breaker);
+        entry["format"] = endpoint.format == PAYLOAD_FORMAT_MSGPACK ? "msgpack" : "json";
+        entry["score"] = getScore(i);
+        entry["failures"] = endpoint.failures;
+        entry["breaker_opens"] = endpoint.breakerOpens;
+        entry["delivered"] = endpoint.delivered;
+        entry["rerouted"] = endpoint.rerouted;
+        entry["queue_depth"] = endpoint.queue.size();
+        entry["queue_rejected"] = endpoint.queue.getRejected();
+        endpoint.queue.appendTelemetry(entry["classes"].to<JsonArray>());
+        endpoint.batcher.appendTelemetry(entry["batching"].to<JsonObject>());
+    }
+}
+
+bool UplinkRouter::isAvailable(uint8_t index, unsigned long now) const {
+    const UplinkEndpoint& endpoint = _endpoints[index];
+    return endpoint.breaker != BREAKER_OPEN || (long)(now - endpoint.openUntil) >= 0;
+}
+
+int UplinkRouter::pick(unsigned long now, int exclude) {
+#if UPLINK_POLICY == UPLINK_POLICY_ROUND_ROBIN
+    for (uint8_t k = 0; k < UPLINK_ENDPOINT_COUNT; k++) {
+        uint8_t i = (_next + k) % UPLINK_ENDPOINT_COUNT;
+        if (i != exclude && isAvailable(i, now)) {
+            _next = (i + 1) % UPLINK_ENDPOINT_COUNT;
+            return i;
+        }
+    }
+    return -1;
+#elif UPLINK_POLICY == UPLINK_POLICY_MIRROR
+    // Melhor nota confirma a leitura (empate: ordem da lista)
+    int best = -1;
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT; i++) {
+        if (i != exclude && isAvailable(i, now) && (best < 0 || getScore(i) < getScore(best))) {
+            best = i;
+        }
+    }
+    return best;
+#else
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT; i++) {
+        if (i != exclude && isAvailable(i, now)) {
+            return i;
+        }
+    }
+    return -1;
+#endif
+}
+
+bool UplinkRouter::pushTo(uint8_t index, const UplinkEntry& entry) {
+    return _endpoints[index].queue.push(entry);
+}
+
+void UplinkRouter::drain(uint8_t from, unsigned long now) {
+    // Leituras paradas no servidor fora do ar passam aos disponiveis
+    UplinkQueue& queue = _endpoints[from].queue;
+    for (uint8_t i = 0; i < queue.size(); i++) {
+        UplinkEntry* entry = queue.at(i);
+        if (entry->completed || entry->sendId != 0 || entry->mirror) {
+            continue;
+        }
+        if (!reroute(from, *entry, now)) {
+            break;
+        }
+#if UPLINK_POLICY == UPLINK_POLICY_MIRROR
+        // A copia continua na fila para quando o servidor voltar
+        entry->mirror = true;
+#else
+        entry->completed = true;
+#endif
+    }
+    queue.popCompleted();
+}
+
+void UplinkRouter::publish() const {
+    int32_t up = 0;
+    for (uint8_t i = 0; i < UPLINK_ENDPOINT_COUNT; i++) {
+        if (_endpoints[i].breaker == BREAKER_CLOSED) {
+            up++;
+        }
+    }
+    Metrics::set(METRIC_UPLINK_ENDPOINTS_UP, up);
+}
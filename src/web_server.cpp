@@ -1,12 +1,46 @@
 #include "web_server.h"
+#include "heap_stats.h"
+#include "metrics.h"
+#include "alloc_profiler.h"
 #include <time.h>
 
+// Cliente pediu MessagePack (Accept: application/msgpack)
+static bool acceptsMsgPack(AsyncWebServerRequest* request) {
+    AsyncWebHeader* accept = request->getHeader("Accept");
+    return accept && accept->value().indexOf(MSGPACK_CONTENT_TYPE) >= 0;
+}
+
+// Resposta em JSON ou MessagePack conforme o Accept
+static void sendDocument(AsyncWebServerRequest* request, const JsonDocument& doc, bool msgpack) {
+    AsyncWebServerResponse* response;
+    if (msgpack) {
+        // Binario (bytes nulos): direto no buffer da resposta, sem String
+        AsyncResponseStream* stream =
+            request->beginResponseStream(MSGPACK_CONTENT_TYPE, measureMsgPack(doc));
+        serializeMsgPack(doc, *stream);
+        response = stream;
+    } else {
+        String body;
+        serializeJson(doc, body);
+        response = request->beginResponse(200, "application/json", body);
+    }
+    response->addHeader("Vary", "Accept");
+    request->send(response);
+}
+
 WebServer::WebServer(uint16_t port) : server(port), serverPort(port) {
-    packetsReceived = 0;
-    packetsForwarded = 0;
-    packetsError = 0;
-    wifiRssi = 0;
-    uptimeMs = 0;
+    memset(&stats, 0, sizeof(stats));
+    airtime = nullptr;
+    lora = nullptr;
+    adr = nullptr;
+    runtimeConfig = nullptr;
+    scheduler = nullptr;
+    mqtt = nullptr;
+    forwarder = nullptr;
+    tls = nullptr;
+    compressor = nullptr;
+    uplinkQueue = nullptr;
+    uplinkRouter = nullptr;
     deviceCount = 0;
     packetHistoryIndex = 0;
     packetHistoryCount = 0;
@@ -18,6 +52,10 @@ WebServer::WebServer(uint16_t port) : server(port), serverPort(port) {
         devices[i].active = false;
         devices[i].packets = 0;
     }
+
+    for (int i = 0; i < MAX_PACKET_HISTORY; i++) {
+        strcpy(packetHistory[i].data, "{}");
+    }
 }
 
 bool WebServer::begin() {
@@ -72,7 +110,9 @@ void WebServer::setupRoutes() {
 
     // API para verificar status do tempo (GET)
     server.on("/api/time", HTTP_GET, [this](AsyncWebServerRequest* request) {
-        JsonDocument doc;
+        Metrics::inc(METRIC_WEB_REQUESTS);
+        JsonArenaScope scope(jsonArenaWeb);
+        JsonDocument doc(&jsonArenaWeb);
         doc["synced"] = timeSynced;
         doc["boot_time"] = bootTime;
         doc["current_time"] = bootTime > 0 ? bootTime + (millis() / 1000) : 0;
@@ -83,6 +123,30 @@ void WebServer::setupRoutes() {
         request->send(200, "application/json", response);
     });
 
+    // Configuracao em tempo de execucao
+    server.on("/api/config", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleConfigGet(request);
+    });
+
+    // Corpo JSON tratado no handler de body; sem corpo = requisicao invalida
+    server.on("/api/config", HTTP_POST, [](AsyncWebServerRequest* request) {
+        if (request->contentLength() == 0) {
+            request->send(400, "application/json", "{\"error\":\"json body required\"}");
+        }
+    }, nullptr, [this](AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                       size_t index, size_t total) {
+        this->handleConfigBody(request, data, len, index, total);
+    });
+
+    server.on("/api/config/reset", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        this->handleConfigReset(request);
+    });
+
+    // Metricas no formato texto do Prometheus
+    server.on("/metrics", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        this->handleMetrics(request);
+    });
+
     // Serve arquivos estaticos do LittleFS (DEPOIS das APIs)
     server.serveStatic("/", LittleFS, "/").setDefaultFile("index.html");
 
@@ -93,15 +157,109 @@ void WebServer::setupRoutes() {
 }
 
 void WebServer::handleStats(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    Metrics::inc(METRIC_WEB_REQUESTS);
+    AllocTagScope allocTag(ALLOC_TAG_WEB);
+    JsonArenaScope scope(jsonArenaWeb);
+    JsonDocument doc(&jsonArenaWeb);
 
     doc["gateway_id"] = GATEWAY_ID;
-    doc["uptime_s"] = uptimeMs / 1000;
-    doc["packets_rx"] = packetsReceived;
-    doc["packets_fwd"] = packetsForwarded;
-    doc["packets_err"] = packetsError;
-    doc["wifi_rssi"] = wifiRssi;
-    doc["free_heap"] = ESP.getFreeHeap();
+    doc["uptime_s"] = stats.uptimeMs / 1000;
+    doc["packets_rx"] = stats.packetsReceived;
+    doc["packets_fwd"] = stats.packetsForwarded;
+    doc["packets_err"] = stats.packetsError;
+    doc["packets_dup"] = stats.packetsDuplicate;
+    doc["wifi_rssi"] = stats.wifiRssi;
+
+    // Heap livre, fragmentacao e uso das arenas JSON
+    appendHeapTelemetry(doc.as<JsonObject>());
+
+    // Fila de uplink e ACKs
+    JsonObject uplink = doc["uplink"].to<JsonObject>();
+    uplink["queue_depth"] = stats.queueDepth;
+    uplink["queue_size"] = PACKET_QUEUE_SIZE;
+    uplink["queue_rejected"] = stats.queueRejected;
+    if (uplinkQueue) {
+        uplinkQueue->appendTelemetry(uplink["classes"].to<JsonArray>());
+    }
+    uplink["ack_policy"] = stats.ackPolicy == ACK_POLICY_END_TO_END ? "end_to_end" : "on_enqueue";
+    uplink["acks_sent"] = stats.acksSent;
+    uplink["ack_avg_ms"] = stats.ackAvgMs;
+    uplink["ack_max_ms"] = stats.ackMaxMs;
+    uplink["ack_mode"] = ACK_AGGREGATION ? "aggregated" : "single";
+    uplink["acked_readings"] = stats.ackedReadings;
+    uplink["ack_airtime_ms"] = stats.ackAirtimeMs;
+    uplink["ack_airtime_single_ms"] = stats.ackSingleAirtimeMs;
+    uplink["links_degraded"] = stats.linksDegraded;
+
+    // Comandos de downlink
+    JsonObject downlink = doc["downlink"].to<JsonObject>();
+    downlink["pending"] = stats.cmdPending;
+    downlink["queue_size"] = DOWNLINK_QUEUE_SIZE;
+    downlink["delivered"] = stats.cmdDelivered;
+    downlink["failed"] = stats.cmdFailed;
+    downlink["latency_avg_ms"] = stats.cmdAvgLatencyMs;
+    downlink["latency_max_ms"] = stats.cmdMaxLatencyMs;
+
+    // Utilizacao do canal e orcamento de duty cycle
+    if (airtime) {
+        airtime->appendTelemetry(doc["airtime"].to<JsonObject>(), millis());
+    }
+
+    // Varredura multi-SF: deteccoes CAD x quadros recebidos por SF
+    if (lora) {
+        JsonObject scan = doc["scan"].to<JsonObject>();
+        scan["enabled"] = lora->isScanning();
+        scan["default_sf"] = lora->getDefaultSF();
+        scan["cycle_ms"] = lora->getScanCycleMs();
+        JsonArray sfs = scan["sfs"].to<JsonArray>();
+        for (uint8_t sf = LORA_SF_MIN; sf <= LORA_SF_MAX; sf++) {
+            if (!(LORA_SCAN_SF_MASK & (1 << sf))) {
+                continue;
+            }
+            const LoRaSfStats& sfStats = lora->getSfStats(sf);
+            JsonObject entry = sfs.add<JsonObject>();
+            entry["sf"] = sf;
+            entry["cad"] = sfStats.cadRuns;
+            entry["detected"] = sfStats.detections;
+            entry["rx"] = sfStats.received;
+            entry["missed"] = sfStats.missed;
+        }
+    }
+
+    // ADR: SF/potencia e margem de enlace por no
+    if (adr) {
+        adr->appendTelemetry(doc["adr"].to<JsonObject>());
+    }
+
+    // Loop principal: tempo por tarefa e pior latencia ate o atendimento
+    if (scheduler) {
+        scheduler->appendTelemetry(doc["scheduler"].to<JsonObject>());
+    }
+
+    // Uplink MQTT: janela em voo, latencia ate o PUBACK e vazao
+    if (mqtt) {
+        mqtt->appendTelemetry(doc["mqtt"].to<JsonObject>());
+    }
+
+    // Packet forwarder: PUSH_ACK, RTT e downlinks do PULL_RESP
+    if (forwarder) {
+        forwarder->appendTelemetry(doc["semtech"].to<JsonObject>());
+    }
+
+    // HTTPS: handshakes completos x retomados e tempo de cripto por requisicao
+    if (tls) {
+        tls->appendTelemetry(doc["tls"].to<JsonObject>());
+    }
+
+    // Servidores de uplink: disjuntor, nota, fila por classe e lotes (AIMD)
+    if (uplinkRouter) {
+        uplinkRouter->appendTelemetry(doc["backends"].to<JsonObject>());
+    }
+
+    // Lotes de uplink: razao de compressao, us/KB e nivel escolhido
+    if (compressor) {
+        compressor->appendTelemetry(doc["compression"].to<JsonObject>());
+    }
 
     // Info de tempo
     doc["time_synced"] = timeSynced;
@@ -109,26 +267,29 @@ void WebServer::handleStats(AsyncWebServerRequest* request) {
         doc["current_time"] = bootTime + (millis() / 1000);
     }
 
-    // Configuracao LoRa
+    // Configuracao LoRa em uso (pode ter mudado via /api/config)
+    RadioConfig radio = this->lora ? this->lora->getRadioConfig()
+                                   : LoRaHandler::defaultRadioConfig();
     JsonObject lora = doc["lora"].to<JsonObject>();
-    lora["freq"] = LORA_FREQUENCY;
-    lora["sf"] = LORA_SF;
-    lora["bw"] = LORA_BW;
-    lora["cr"] = LORA_CR;
-    lora["tx_power"] = LORA_TX_POWER;
-    lora["sync_word"] = LORA_SYNC_WORD;
-
-    String response;
-    serializeJson(doc, response);
-
-    request->send(200, "application/json", response);
+    lora["freq"] = radio.frequency;
+    lora["sf"] = radio.sf;
+    lora["bw"] = radio.bandwidth;
+    lora["cr"] = radio.codingRate;
+    lora["tx_power"] = radio.txPower;
+    lora["sync_word"] = radio.syncWord;
+
+    sendDocument(request, doc, acceptsMsgPack(request));
 }
 
 void WebServer::handleDevices(AsyncWebServerRequest* request) {
+    Metrics::inc(METRIC_WEB_REQUESTS);
+    AllocTagScope allocTag(ALLOC_TAG_WEB);
     // Limpa dispositivos inativos antes de responder
     cleanupInactiveDevices();
 
-    JsonDocument doc;
+    bool msgpack = acceptsMsgPack(request);
+    JsonArenaScope scope(jsonArenaWeb);
+    JsonDocument doc(&jsonArenaWeb);
 
     // Envia uptime atual para calculo de "tempo atras" no frontend
     unsigned long currentMillis = millis();
@@ -139,13 +300,14 @@ void WebServer::handleDevices(AsyncWebServerRequest* request) {
     for (int i = 0; i < MAX_DEVICES; i++) {
         if (devices[i].active) {
             JsonObject dev = devicesArray.add<JsonObject>();
-            dev["id"] = devices[i].id;
-            dev["type"] = devices[i].type;
+            dev["id"] = devices[i].id.c_str();
+            dev["type"] = devices[i].type.c_str();
             dev["rssi"] = devices[i].rssi;
             dev["snr"] = devices[i].snr;
             dev["packets"] = devices[i].packets;
             // Envia millis do ultimo contato (para calcular diferenca)
             dev["last_seen_ms"] = devices[i].lastSeen;
+            devices[i].link.appendTelemetry(dev["link"].to<JsonObject>());
         }
     }
 
@@ -161,25 +323,120 @@ void WebServer::handleDevices(AsyncWebServerRequest* request) {
         int idx = (packetHistoryIndex - 1 - i + MAX_PACKET_HISTORY) % MAX_PACKET_HISTORY;
 
         JsonObject pkt = packetsArray.add<JsonObject>();
-        pkt["node_id"] = packetHistory[idx].nodeId;
+        pkt["node_id"] = packetHistory[idx].nodeId.c_str();
         pkt["rssi"] = packetHistory[idx].rssi;
         pkt["snr"] = packetHistory[idx].snr;
         pkt["timestamp_ms"] = packetHistory[idx].timestamp;  // Em milissegundos desde boot
 
-        // Copia dados do pacote
-        JsonObject data = pkt["data"].to<JsonObject>();
-        for (JsonPair kv : packetHistory[idx].data.as<JsonObject>()) {
-            data[kv.key()] = kv.value();
+        // Dados ja serializados no historico (JSON); em MessagePack o texto
+        // cru nao vale e o objeto e remontado
+        if (msgpack) {
+            JsonDocument data(&jsonArenaWeb);
+            if (!deserializeJson(data, packetHistory[idx].data)) {
+                pkt["data"] = data;
+            }
+        } else {
+            pkt["data"] = serialized(packetHistory[idx].data);
         }
     }
 
+    sendDocument(request, doc, msgpack);
+}
+
+void WebServer::handleConfigGet(AsyncWebServerRequest* request) {
+    Metrics::inc(METRIC_WEB_REQUESTS);
+    AllocTagScope allocTag(ALLOC_TAG_WEB);
+    if (!runtimeConfig) {
+        request->send(503, "application/json", "{\"error\":\"config unavailable\"}");
+        return;
+    }
+
+    JsonArenaScope scope(jsonArenaWeb);
+    JsonDocument doc(&jsonArenaWeb);
+    runtimeConfig->appendTelemetry(doc.to<JsonObject>(), millis());
+
     String response;
     serializeJson(doc, response);
-
     request->send(200, "application/json", response);
 }
 
+void WebServer::handleConfigBody(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                                 size_t index, size_t total) {
+    // So o primeiro pedaco responde; corpo grande ou fragmentado e recusado
+    if (index != 0) {
+        return;
+    }
+    Metrics::inc(METRIC_WEB_REQUESTS);
+    AllocTagScope allocTag(ALLOC_TAG_WEB);
+
+    if (total > CONFIG_MAX_BODY || len != total) {
+        request->send(413, "application/json", "{\"error\":\"body too large\"}");
+        return;
+    }
+
+    if (!runtimeConfig) {
+        request->send(503, "application/json", "{\"error\":\"config unavailable\"}");
+        return;
+    }
+
+    JsonArenaScope scope(jsonArenaWeb);
+    JsonDocument doc(&jsonArenaWeb);
+    DeserializationError parseError = deserializeJson(doc, (const char*)data, len);
+    if (parseError || !doc.is<JsonObject>()) {
+        request->send(400, "application/json", "{\"error\":\"invalid json\"}");
+        return;
+    }
+
+    String error;
+    bool busy = runtimeConfig->isChanging();
+    if (busy || !runtimeConfig->request(doc.as<JsonObjectConst>(), error)) {
+        JsonDocument reply(&jsonArenaWeb);
+        reply["error"] = busy ? "change in progress" : error.c_str();
+
+        String response;
+        serializeJson(reply, response);
+        request->send(busy || runtimeConfig->isChanging() ? 409 : 400,
+                      "application/json", response);
+        return;
+    }
+
+    DEBUG_PRINTLN("[WebServer] Nova configuracao aceita, aplicando");
+    request->send(202, "application/json", "{\"success\":true,\"state\":\"staged\"}");
+}
+
+void WebServer::handleConfigReset(AsyncWebServerRequest* request) {
+    Metrics::inc(METRIC_WEB_REQUESTS);
+    if (!runtimeConfig) {
+        request->send(503, "application/json", "{\"error\":\"config unavailable\"}");
+        return;
+    }
+
+    String error;
+    if (!runtimeConfig->requestDefaults(error)) {
+        request->send(409, "application/json", "{\"error\":\"change in progress\"}");
+        return;
+    }
+
+    DEBUG_PRINTLN("[WebServer] Restaurando configuracao de fabrica");
+    request->send(202, "application/json", "{\"success\":true,\"state\":\"staged\"}");
+}
+
+void WebServer::handleMetrics(AsyncWebServerRequest* request) {
+    Metrics::inc(METRIC_WEB_REQUESTS);
+    AllocTagScope allocTag(ALLOC_TAG_WEB);
+
+    // Resposta chunked: cada pedaco renderiza linhas a partir do cursor
+    MetricsCursor cursor = {0, 0};
+    AsyncWebServerResponse* response = request->beginChunkedResponse(
+        "text/plain; version=0.0.4",
+        [cursor](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+            return Metrics::renderChunk(cursor, (char*)buffer, maxLen);
+        });
+    request->send(response);
+}
+
 void WebServer::handleTimeSync(AsyncWebServerRequest* request) {
+    Metrics::inc(METRIC_WEB_REQUESTS);
     // Verifica se tem o parametro timestamp
     if (!request->hasParam("timestamp", true)) {
         request->send(400, "application/json", "{\"error\":\"timestamp required\"}");
@@ -212,7 +469,8 @@ void WebServer::handleTimeSync(AsyncWebServerRequest* request) {
                      timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
                      timeinfo.tm_mday, timeinfo.tm_mon + 1, timeinfo.tm_year + 1900);
 
-        JsonDocument doc;
+        JsonArenaScope scope(jsonArenaWeb);
+        JsonDocument doc(&jsonArenaWeb);
         doc["success"] = true;
         doc["synced_time"] = browserTime;
         doc["boot_time"] = bootTime;
@@ -229,25 +487,22 @@ void WebServer::handleNotFound(AsyncWebServerRequest* request) {
     request->send(404, "text/plain", "Pagina nao encontrada");
 }
 
-void WebServer::updateStats(uint32_t packetsRx, uint32_t packetsFwd, uint32_t packetsErr,
-                             int wifiRssiVal, unsigned long uptimeMsVal) {
-    packetsReceived = packetsRx;
-    packetsForwarded = packetsFwd;
-    packetsError = packetsErr;
-    wifiRssi = wifiRssiVal;
-    uptimeMs = uptimeMsVal;
+void WebServer::updateStats(const GatewayStats& gatewayStats) {
+    stats = gatewayStats;
 }
 
-void WebServer::logPacket(const String& nodeId, const String& nodeType,
-                           const JsonDocument& data, int rssi, float snr) {
+void WebServer::logPacket(StringView nodeId, StringView nodeType, uint32_t sequence,
+                          const JsonDocument& data, int rssi, float snr, long freqError) {
+    AllocTagScope allocTag(ALLOC_TAG_WEB);
+
     // Atualiza informacoes do dispositivo
-    updateDevice(nodeId, nodeType, rssi, snr);
+    updateDevice(nodeId, nodeType, sequence, rssi, snr, freqError);
 
     // Adiciona ao historico de pacotes
     addPacketToHistory(nodeId, data, rssi, snr);
 }
 
-int WebServer::findDeviceIndex(const String& nodeId) {
+int WebServer::findDeviceIndex(StringView nodeId) const {
     for (int i = 0; i < MAX_DEVICES; i++) {
         if (devices[i].active && devices[i].id == nodeId) {
             return i;
@@ -256,7 +511,8 @@ int WebServer::findDeviceIndex(const String& nodeId) {
     return -1;
 }
 
-void WebServer::updateDevice(const String& nodeId, const String& nodeType, int rssi, float snr) {
+void WebServer::updateDevice(StringView nodeId, StringView nodeType, uint32_t sequence,
+                             int rssi, float snr, long freqError) {
     int idx = findDeviceIndex(nodeId);
 
     if (idx >= 0) {
@@ -265,33 +521,38 @@ void WebServer::updateDevice(const String& nodeId, const String& nodeType, int r
         devices[idx].snr = snr;
         devices[idx].packets++;
         devices[idx].lastSeen = millis();
+        devices[idx].link.update(sequence, rssi, snr, freqError, devices[idx].lastSeen);
     } else {
         // Novo dispositivo, procura slot livre
         for (int i = 0; i < MAX_DEVICES; i++) {
             if (!devices[i].active) {
-                devices[i].id = nodeId;
-                devices[i].type = nodeType;
+                devices[i].id.assign(nodeId);
+                devices[i].type.assign(nodeType);
                 devices[i].rssi = rssi;
                 devices[i].snr = snr;
                 devices[i].packets = 1;
                 devices[i].lastSeen = millis();
+                devices[i].link.reset();
+                devices[i].link.update(sequence, rssi, snr, freqError, devices[i].lastSeen);
                 devices[i].active = true;
                 deviceCount++;
-                DEBUG_PRINTF("Novo dispositivo registrado: %s\n", nodeId.c_str());
+                DEBUG_PRINTF("Novo dispositivo registrado: %s\n", devices[i].id.c_str());
                 break;
             }
         }
     }
 }
 
-void WebServer::addPacketToHistory(const String& nodeId, const JsonDocument& data, int rssi, float snr) {
+void WebServer::addPacketToHistory(StringView nodeId, const JsonDocument& data, int rssi, float snr) {
     // Buffer circular
-    packetHistory[packetHistoryIndex].nodeId = nodeId;
-    packetHistory[packetHistoryIndex].data.clear();
+    packetHistory[packetHistoryIndex].nodeId.assign(nodeId);
 
-    // Copia dados
-    for (JsonPairConst kv : data.as<JsonObjectConst>()) {
-        packetHistory[packetHistoryIndex].data[kv.key()] = kv.value();
+    // Serializa os dados no buffer fixo (objeto vazio se nao couber)
+    char* buffer = packetHistory[packetHistoryIndex].data;
+    if (data.isNull() || measureJson(data) >= PACKET_LOG_DATA_SIZE) {
+        strcpy(buffer, "{}");
+    } else {
+        serializeJson(data, buffer, PACKET_LOG_DATA_SIZE);
     }
 
     packetHistory[packetHistoryIndex].rssi = rssi;
@@ -317,6 +578,19 @@ void WebServer::cleanupInactiveDevices() {
     }
 }
 
+const LinkQuality* WebServer::getLinkQuality(StringView nodeId) const {
+    int idx = findDeviceIndex(nodeId);
+    return idx >= 0 ? &devices[idx].link : nullptr;
+}
+
+uint8_t WebServer::getDegradedLinks() const {
+    uint8_t count = 0;
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        if (devices[i].active && devices[i].link.isDegraded()) count++;
+    }
+    return count;
+}
+
 uint32_t WebServer::getDeviceCount() const {
     uint32_t count = 0;
     for (int i = 0; i < MAX_DEVICES; i++) {
@@ -1,10 +1,17 @@
 #include "wifi_handler.h"
+#include "metrics.h"
+#include "alloc_profiler.h"
 
 WiFiHandler::WiFiHandler()
     : _state(WIFI_STATE_DISCONNECTED),
       _lastReconnectAttempt(0),
       _ssid(WIFI_SSID),
       _password(WIFI_PASSWORD),
+      _serverHost(SERVER_HOST),
+      _serverPort(SERVER_PORT),
+      _lastHttpStatus(0),
+      _lastRequestMs(0),
+      _lastAcceptsMsgPack(false),
       _connectedCallback(nullptr),
       _disconnectedCallback(nullptr) {
 }
@@ -23,6 +30,12 @@ bool WiFiHandler::begin() {
 
     DEBUG_PRINTF("[WiFi] MAC: %s\n", WiFi.macAddress().c_str());
 
+#if SERVER_TLS
+    // CA e configuracao TLS montados uma vez; a conexao HTTPS fica aberta
+    _tls.begin();
+    _http.setReuse(true);
+#endif
+
     return connect();
 }
 
@@ -64,6 +77,9 @@ bool WiFiHandler::connect() {
 }
 
 void WiFiHandler::disconnect() {
+#if SERVER_TLS
+    _tls.stop();
+#endif
     WiFi.disconnect(true);
     updateState(WIFI_STATE_DISCONNECTED);
     DEBUG_PRINTLN("[WiFi] Desconectado");
@@ -117,28 +133,84 @@ void WiFiHandler::checkConnection() {
 }
 
 void WiFiHandler::reconnect() {
+    Metrics::inc(METRIC_WIFI_RECONNECTS);
     disconnect();
     delay(100);
     connect();
 }
 
-bool WiFiHandler::sendHTTPPost(const String& endpoint, const String& jsonPayload) {
+bool WiFiHandler::sendHTTPPost(const char* endpoint, StringView jsonPayload,
+                               const char* contentEncoding) {
+    return sendHTTPPost(_serverHost.c_str(), _serverPort, endpoint, jsonPayload, contentEncoding);
+}
+
+bool WiFiHandler::sendHTTPPost(const char* host, uint16_t port, const char* endpoint,
+                               StringView jsonPayload, const char* contentEncoding,
+                               const char* contentType) {
+    return post(host, port, endpoint, (const uint8_t*)jsonPayload.data(), nullptr,
+                jsonPayload.length(), contentEncoding, contentType);
+}
+
+bool WiFiHandler::sendHTTPPost(const char* host, uint16_t port, const char* endpoint,
+                               Stream& body, size_t length, const char* contentType) {
+    return post(host, port, endpoint, nullptr, &body, length, nullptr, contentType);
+}
+
+bool WiFiHandler::post(const char* host, uint16_t port, const char* endpoint,
+                       const uint8_t* data, Stream* stream, size_t length,
+                       const char* contentEncoding, const char* contentType) {
+    AllocTagScope allocTag(ALLOC_TAG_WIFI);
+
     if (!isConnected()) {
         DEBUG_PRINTLN("[HTTP] ERRO: WiFi nao conectado!");
+        _lastHttpStatus = 0;
+        _lastRequestMs = 0;
+        _lastAcceptsMsgPack = false;
         return false;
     }
 
+#if SERVER_TLS
+    HTTPClient& http = _http;
+    // Conexao aberta com outro servidor nao serve para este
+    if (_tls.connected() && !_tls.isConnectedTo(host, port)) {
+        _tls.stop();
+    }
+    _tls.beginRequest();
+    DEBUG_PRINTF("[HTTP] POST para: https://%s:%d%s%s\n", host, port,
+                 endpoint, _tls.connected() ? " (conexao reaproveitada)" : "");
+    http.begin(_tls, host, port, endpoint, true);
+#else
     HTTPClient http;
-    String url = String("http://") + SERVER_HOST + ":" + SERVER_PORT + endpoint;
+    String url = String("http://") + host + ":" + port + endpoint;
 
     DEBUG_PRINTF("[HTTP] POST para: %s\n", url.c_str());
-    DEBUG_PRINTF("[HTTP] Payload: %s\n", jsonPayload.c_str());
-
     http.begin(url);
-    http.addHeader("Content-Type", "application/json");
+#endif
+    bool binary = contentType && strcmp(contentType, "application/json") != 0;
+    if (stream) {
+        DEBUG_PRINTF("[HTTP] Payload: %d bytes (em fluxo)\n", (int)length);
+    } else if (contentEncoding || binary) {
+        DEBUG_PRINTF("[HTTP] Payload: %d bytes (%s)\n", (int)length,
+                     contentEncoding ? contentEncoding : contentType);
+    } else {
+        DEBUG_PRINTF("[HTTP] Payload: %.*s\n", (int)length, (const char*)data);
+    }
+
+    http.addHeader("Content-Type", contentType ? contentType : "application/json");
+    if (contentEncoding) {
+        http.addHeader("Content-Encoding", contentEncoding);
+    }
     http.setTimeout(HTTP_TIMEOUT_MS);
 
-    int httpCode = http.POST(jsonPayload);
+    // Formatos aceitos pelo servidor alem de JSON (negociacao do uplink)
+    const char* collect[] = { "Accept-Post" };
+    http.collectHeaders(collect, 1);
+
+    unsigned long requestStart = millis();
+    // Stream: blocos de ate HTTP_TCP_BUFFER_SIZE copiados direto no socket
+    int httpCode = stream ? http.sendRequest("POST", stream, length)
+                          : http.POST((uint8_t*)data, length);
+    bool ok = false;
 
     if (httpCode > 0) {
         DEBUG_PRINTF("[HTTP] Resposta: %d\n", httpCode);
@@ -146,32 +218,55 @@ bool WiFiHandler::sendHTTPPost(const String& endpoint, const String& jsonPayload
         if (httpCode == HTTP_CODE_OK || httpCode == HTTP_CODE_CREATED) {
             String response = http.getString();
             DEBUG_PRINTF("[HTTP] Body: %s\n", response.c_str());
-            http.end();
-            return true;
+            ok = true;
         }
     } else {
         DEBUG_PRINTF("[HTTP] ERRO: %s\n", http.errorToString(httpCode).c_str());
     }
 
+    _lastHttpStatus = httpCode;
+    _lastRequestMs = millis() - requestStart;
+    _lastAcceptsMsgPack =
+        httpCode > 0 && http.header("Accept-Post").indexOf(MSGPACK_CONTENT_TYPE) >= 0;
+
     http.end();
-    return false;
+#if SERVER_TLS
+    _tls.endRequest();
+#endif
+    return ok;
 }
 
-bool WiFiHandler::sendHTTPGet(const String& endpoint, String& response) {
+bool WiFiHandler::sendHTTPGet(const char* endpoint, String& response) {
+    AllocTagScope allocTag(ALLOC_TAG_WIFI);
+
     if (!isConnected()) {
         DEBUG_PRINTLN("[HTTP] ERRO: WiFi nao conectado!");
+        _lastHttpStatus = 0;
+        _lastRequestMs = 0;
         return false;
     }
 
+#if SERVER_TLS
+    HTTPClient& http = _http;
+    if (_tls.connected() && !_tls.isConnectedTo(_serverHost.c_str(), _serverPort)) {
+        _tls.stop();
+    }
+    _tls.beginRequest();
+    DEBUG_PRINTF("[HTTP] GET: https://%s:%d%s%s\n", _serverHost.c_str(), _serverPort,
+                 endpoint, _tls.connected() ? " (conexao reaproveitada)" : "");
+    http.begin(_tls, _serverHost, _serverPort, endpoint, true);
+#else
     HTTPClient http;
-    String url = String("http://") + SERVER_HOST + ":" + SERVER_PORT + endpoint;
+    String url = String("http://") + _serverHost + ":" + _serverPort + endpoint;
 
     DEBUG_PRINTF("[HTTP] GET: %s\n", url.c_str());
-
     http.begin(url);
+#endif
     http.setTimeout(HTTP_TIMEOUT_MS);
 
+    unsigned long requestStart = millis();
     int httpCode = http.GET();
+    bool ok = false;
 
     if (httpCode > 0) {
         DEBUG_PRINTF("[HTTP] Resposta: %d\n", httpCode);
@@ -179,15 +274,33 @@ bool WiFiHandler::sendHTTPGet(const String& endpoint, String& response) {
         if (httpCode == HTTP_CODE_OK) {
             response = http.getString();
             DEBUG_PRINTF("[HTTP] Body: %s\n", response.c_str());
-            http.end();
-            return true;
+            ok = true;
         }
     } else {
         DEBUG_PRINTF("[HTTP] ERRO: %s\n", http.errorToString(httpCode).c_str());
     }
 
+    _lastHttpStatus = httpCode;
+    _lastRequestMs = millis() - requestStart;
+
     http.end();
-    return false;
+#if SERVER_TLS
+    _tls.endRequest();
+#endif
+    return ok;
+}
+
+void WiFiHandler::setServer(const char* host, uint16_t port) {
+    if (_serverHost == host && _serverPort == port) {
+        return;
+    }
+
+    _serverHost = host;
+    _serverPort = port;
+#if SERVER_TLS
+    _tls.stop();
+#endif
+    DEBUG_PRINTF("[HTTP] Servidor: %s:%d\n", _serverHost.c_str(), _serverPort);
 }
 
 void WiFiHandler::setConnectedCallback(void (*callback)()) {
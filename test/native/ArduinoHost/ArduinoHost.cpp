@@ -0,0 +1,313 @@
+#include "Arduino.h"
+#include "LoRa.h"
+#include <ctype.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+SPIClass SPI;
+LoRaClass LoRa;
+
+// ---------- Relogio ----------
+
+static uint64_t clockUs = 0;
+
+unsigned long millis() {
+    return (unsigned long)(clockUs / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)clockUs;
+}
+
+void hostAdvance(unsigned long ms) {
+    clockUs += (uint64_t)ms * 1000;
+}
+
+void hostAdvanceMicros(unsigned long us) {
+    clockUs += us;
+}
+
+void delay(unsigned long ms) {
+    hostAdvance(ms);
+}
+
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {}
+
+int digitalRead(uint8_t pin) {
+    return HIGH;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {}
+
+void detachInterrupt(uint8_t pin) {}
+
+long random(long max) {
+    return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+    return max > min ? min + rand() % (max - min) : min;
+}
+
+// ---------- Print / Stream ----------
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (size--) {
+        written += write(*buffer++);
+    }
+    return written;
+}
+
+size_t Print::print(long value, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%ld", value);
+    return write(text);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%lu", value);
+    return write(text);
+}
+
+size_t Print::print(double value, int digits) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return write(text);
+}
+
+size_t Print::printf(const char* format, ...) {
+    // Buffer na pilha: o debug nao entra na contagem de alocacoes
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0) {
+        return 0;
+    }
+    return write((const uint8_t*)text, (size_t)length < sizeof(text) ? length : sizeof(text) - 1);
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int value = read();
+        if (value < 0) {
+            break;
+        }
+        buffer[count++] = (char)value;
+    }
+    return count;
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+    return fwrite(&value, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
+
+// ---------- String ----------
+
+String::String(const char* text) : _buffer(nullptr), _capacity(0), _length(0) {
+    concat(text);
+}
+
+String::String(const char* text, unsigned int length) : _buffer(nullptr), _capacity(0), _length(0) {
+    concat(text, length);
+}
+
+String::String(const String& other) : _buffer(nullptr), _capacity(0), _length(0) {
+    concat(other);
+}
+
+String::String(String&& other) : _buffer(other._buffer), _capacity(other._capacity), _length(other._length) {
+    other._buffer = nullptr;
+    other._capacity = 0;
+    other._length = 0;
+}
+
+String::String(char value) : _buffer(nullptr), _capacity(0), _length(0) {
+    concat(value);
+}
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) : _buffer(nullptr), _capacity(0), _length(0) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%ld", value);
+    concat(text);
+}
+
+String::String(unsigned long value, unsigned char base) : _buffer(nullptr), _capacity(0), _length(0) {
+    char text[24];
+    snprintf(text, sizeof(text), base == HEX ? "%lx" : "%lu", value);
+    concat(text);
+}
+
+String::String(double value, unsigned int decimals) : _buffer(nullptr), _capacity(0), _length(0) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", (int)decimals, value);
+    concat(text);
+}
+
+String::~String() {
+    free(_buffer);
+}
+
+String& String::operator=(const String& other) {
+    if (this != &other) {
+        _length = 0;
+        if (_buffer) {
+            _buffer[0] = 0;
+        }
+        concat(other);
+    }
+    return *this;
+}
+
+String& String::operator=(String&& other) {
+    if (this != &other) {
+        free(_buffer);
+        _buffer = other._buffer;
+        _capacity = other._capacity;
+        _length = other._length;
+        other._buffer = nullptr;
+        other._capacity = 0;
+        other._length = 0;
+    }
+    return *this;
+}
+
+String& String::operator=(const char* text) {
+    // nullptr libera o buffer, como invalidate() no core
+    if (!text) {
+        free(_buffer);
+        _buffer = nullptr;
+        _capacity = 0;
+        _length = 0;
+        return *this;
+    }
+    _length = 0;
+    if (_buffer) {
+        _buffer[0] = 0;
+    }
+    concat(text);
+    return *this;
+}
+
+bool String::reserve(unsigned int size) {
+    if (size <= _capacity && _buffer) {
+        return true;
+    }
+    // Arredonda para 16 bytes como changeBuffer() do core
+    unsigned int capacity = ((size + 16) & ~0xf) - 1;
+    char* buffer = (char*)realloc(_buffer, capacity + 1);
+    if (!buffer) {
+        return false;
+    }
+    if (!_buffer) {
+        buffer[0] = 0;
+    }
+    _buffer = buffer;
+    _capacity = capacity;
+    return true;
+}
+
+bool String::concat(const char* text) {
+    return text ? concat(text, strlen(text)) : false;
+}
+
+bool String::concat(const char* text, unsigned int length) {
+    if (length == 0) {
+        return true;
+    }
+    if (_length + length > _capacity || !_buffer) {
+        if (!reserve(_length + length)) {
+            return false;
+        }
+    }
+    memmove(_buffer + _length, text, length);
+    _length += length;
+    _buffer[_length] = 0;
+    return true;
+}
+
+bool String::equals(const char* text) const {
+    return strcmp(c_str(), text ? text : "") == 0;
+}
+
+int String::indexOf(char value, unsigned int from) const {
+    for (unsigned int i = from; i < _length; i++) {
+        if (_buffer[i] == value) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int String::indexOf(const char* text, unsigned int from) const {
+    if (from > _length) {
+        return -1;
+    }
+    const char* found = strstr(c_str() + from, text);
+    return found ? (int)(found - c_str()) : -1;
+}
+
+bool String::startsWith(const char* text) const {
+    return strncmp(c_str(), text, strlen(text)) == 0;
+}
+
+bool String::endsWith(const char* text) const {
+    size_t length = strlen(text);
+    return length <= _length && strcmp(c_str() + _length - length, text) == 0;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (to > _length) {
+        to = _length;
+    }
+    if (from >= to) {
+        return String();
+    }
+    return String(_buffer + from, to - from);
+}
+
+long String::toInt() const {
+    return atol(c_str());
+}
+
+float String::toFloat() const {
+    return (float)atof(c_str());
+}
+
+void String::toLowerCase() {
+    for (unsigned int i = 0; i < _length; i++) {
+        _buffer[i] = (char)tolower((unsigned char)_buffer[i]);
+    }
+}
+
+void String::trim() {
+    unsigned int start = 0;
+    while (start < _length && isspace((unsigned char)_buffer[start])) {
+        start++;
+    }
+    unsigned int end = _length;
+    while (end > start && isspace((unsigned char)_buffer[end - 1])) {
+        end--;
+    }
+    if (start > 0 || end < _length) {
+        memmove(_buffer, _buffer + start, end - start);
+        _length = end - start;
+        _buffer[_length] = 0;
+    }
+}
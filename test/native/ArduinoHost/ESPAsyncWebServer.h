@@ -0,0 +1,107 @@
+#ifndef ARDUINO_HOST_ESP_ASYNC_WEB_SERVER_H
+#define ARDUINO_HOST_ESP_ASYNC_WEB_SERVER_H
+
+// Servidor HTTP sem rede: so as declaracoes que web_server.h usa. Os
+// handlers nunca rodam no host (WebServer::begin() nao e chamado).
+
+#include <Arduino.h>
+#include <functional>
+#include "LittleFS.h"
+
+enum WebRequestMethod {
+    HTTP_GET = 1,
+    HTTP_POST = 2,
+    HTTP_DELETE = 4,
+    HTTP_PUT = 8,
+    HTTP_ANY = 255
+};
+
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebParameter {
+public:
+    const String& value() const { return _value; }
+
+private:
+    String _value;
+};
+
+class AsyncWebHeader {
+public:
+    const String& value() const { return _value; }
+
+private:
+    String _value;
+};
+
+class AsyncWebServerResponse {
+public:
+    virtual ~AsyncWebServerResponse() {}
+    void addHeader(const String& name, const String& value) {}
+    void setCode(int code) {}
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+public:
+    size_t write(uint8_t value) override { return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { return size; }
+    using Print::write;
+};
+
+class AsyncWebServerRequest {
+public:
+    size_t contentLength() const { return 0; }
+    void send(int code, const String& contentType = String(), const String& content = String()) {}
+    void send(AsyncWebServerResponse* response) { delete response; }
+    AsyncResponseStream* beginResponseStream(const String& contentType, size_t bufferSize = 1460) {
+        return new AsyncResponseStream();
+    }
+    AsyncWebServerResponse* beginResponse(int code, const String& contentType, const String& content) {
+        return new AsyncWebServerResponse();
+    }
+    AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller filler) {
+        return new AsyncWebServerResponse();
+    }
+    bool hasParam(const String& name, bool post = false, bool file = false) const { return false; }
+    AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const {
+        return nullptr;
+    }
+    AsyncWebHeader* getHeader(const char* name) const { return nullptr; }
+
+    void* _tempObject = nullptr;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String&, size_t, uint8_t*, size_t, bool)>
+    ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t)> ArBodyHandlerFunction;
+
+class AsyncCallbackWebHandler {};
+
+class AsyncStaticWebHandler {
+public:
+    AsyncStaticWebHandler& setDefaultFile(const char* filename) { return *this; }
+};
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port) {}
+    void begin() {}
+    AsyncCallbackWebHandler& on(const char* uri, WebRequestMethod method, ArRequestHandlerFunction onRequest) {
+        return _handler;
+    }
+    AsyncCallbackWebHandler& on(const char* uri, WebRequestMethod method, ArRequestHandlerFunction onRequest,
+                                ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+        return _handler;
+    }
+    AsyncStaticWebHandler& serveStatic(const char* uri, LittleFSFS& fs, const char* path) {
+        return _static;
+    }
+    void onNotFound(ArRequestHandlerFunction onRequest) {}
+
+private:
+    AsyncCallbackWebHandler _handler;
+    AsyncStaticWebHandler _static;
+};
+
+#endif // ARDUINO_HOST_ESP_ASYNC_WEB_SERVER_H
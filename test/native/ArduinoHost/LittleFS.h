@@ -0,0 +1,36 @@
+#ifndef ARDUINO_HOST_LITTLEFS_H
+#define ARDUINO_HOST_LITTLEFS_H
+
+// Sistema de arquivos vazio: open() nunca encontra nada
+
+#include <Arduino.h>
+
+class File : public Stream {
+public:
+    size_t write(uint8_t value) override { return 0; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t read(uint8_t* buffer, size_t size) { return 0; }
+    size_t size() const { return 0; }
+    const char* name() const { return ""; }
+    bool isDirectory() const { return false; }
+    File openNextFile() { return File(); }
+    void close() {}
+    operator bool() const { return false; }
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false) { return false; }
+    File open(const char* path, const char* mode = "r") { return File(); }
+    bool exists(const char* path) { return false; }
+    bool remove(const char* path) { return false; }
+    size_t totalBytes() { return 0; }
+    size_t usedBytes() { return 0; }
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // ARDUINO_HOST_LITTLEFS_H
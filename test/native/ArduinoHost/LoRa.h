@@ -0,0 +1,41 @@
+#ifndef ARDUINO_HOST_LORA_H
+#define ARDUINO_HOST_LORA_H
+
+// Radio de mentira: aceita a configuracao, nunca recebe e descarta o que
+// transmite. Basta para o LoRaHandler existir nos testes (AckScheduler).
+
+#include <Arduino.h>
+#include <SPI.h>
+
+class LoRaClass {
+public:
+    int begin(long frequency) { return 1; }
+    void setPins(int ss, int reset, int dio0) {}
+    void setFrequency(long frequency) {}
+    void setSpreadingFactor(int sf) {}
+    void setSignalBandwidth(long bandwidth) {}
+    void setCodingRate4(int denominator) {}
+    void setCodingRate(int denominator) {}
+    void setPreambleLength(long length) {}
+    void setSyncWord(int word) {}
+    void setTxPower(int level, int outputPin = 1) {}
+    void enableCrc() {}
+    void idle() {}
+    void sleep() {}
+    void receive(int size = 0) {}
+
+    int beginPacket(int implicitHeader = 0) { return 1; }
+    size_t write(const uint8_t* buffer, size_t size) { return size; }
+    int endPacket(bool async = false) { return 1; }
+
+    int parsePacket(int size = 0) { return 0; }
+    int available() { return 0; }
+    int read() { return -1; }
+    int packetRssi() { return -120; }
+    float packetSnr() { return 0; }
+    long packetFrequencyError() { return 0; }
+};
+
+extern LoRaClass LoRa;
+
+#endif // ARDUINO_HOST_LORA_H
@@ -0,0 +1,26 @@
+#ifndef ARDUINO_HOST_SPI_H
+#define ARDUINO_HOST_SPI_H
+
+// Barramento sem dispositivo: toda leitura devolve 0
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings {
+public:
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {}
+};
+
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+    void beginTransaction(const SPISettings& settings) {}
+    void endTransaction() {}
+    uint8_t transfer(uint8_t value) { return 0; }
+};
+
+extern SPIClass SPI;
+
+#endif // ARDUINO_HOST_SPI_H
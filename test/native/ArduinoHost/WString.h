@@ -0,0 +1,89 @@
+#ifndef ARDUINO_HOST_WSTRING_H
+#define ARDUINO_HOST_WSTRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// String do Arduino: buffer no heap (malloc/realloc), vazia sem alocar
+class String {
+public:
+    String(const char* text = "");
+    String(const char* text, unsigned int length);
+    String(const String& other);
+    String(String&& other);
+    explicit String(char value);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(double value, unsigned int decimals = 2);
+    ~String();
+
+    String& operator=(const String& other);
+    String& operator=(String&& other);
+    String& operator=(const char* text);
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return _length; }
+    bool isEmpty() const { return _length == 0; }
+    const char* c_str() const { return _buffer ? _buffer : ""; }
+
+    bool concat(const String& other) { return concat(other.c_str(), other._length); }
+    bool concat(const char* text);
+    bool concat(const char* text, unsigned int length);
+    bool concat(char value) { return concat(&value, 1); }
+    bool concat(int value) { return concat(String(value)); }
+    bool concat(unsigned int value) { return concat(String(value)); }
+    bool concat(long value) { return concat(String(value)); }
+    bool concat(unsigned long value) { return concat(String(value)); }
+    bool concat(double value) { return concat(String(value)); }
+
+    template <typename T>
+    String& operator+=(const T& value) {
+        concat(value);
+        return *this;
+    }
+
+    bool equals(const char* text) const;
+    bool operator==(const String& other) const { return equals(other.c_str()); }
+    bool operator==(const char* text) const { return equals(text); }
+    bool operator!=(const String& other) const { return !equals(other.c_str()); }
+    bool operator!=(const char* text) const { return !equals(text); }
+    char operator[](unsigned int index) const { return index < _length ? _buffer[index] : 0; }
+
+    int indexOf(char value, unsigned int from = 0) const;
+    int indexOf(const char* text, unsigned int from = 0) const;
+    bool startsWith(const char* text) const;
+    bool endsWith(const char* text) const;
+    String substring(unsigned int from) const { return substring(from, _length); }
+    String substring(unsigned int from, unsigned int to) const;
+    long toInt() const;
+    float toFloat() const;
+    void toLowerCase();
+    void trim();
+
+private:
+    char* _buffer;
+    unsigned int _capacity;
+    unsigned int _length;
+};
+
+inline String operator+(const String& left, const String& right) {
+    String result(left);
+    result += right;
+    return result;
+}
+
+inline String operator+(const String& left, const char* right) {
+    String result(left);
+    result += right;
+    return result;
+}
+
+inline String operator+(const char* left, const String& right) {
+    String result(left);
+    result += right;
+    return result;
+}
+
+#endif // ARDUINO_HOST_WSTRING_H
@@ -0,0 +1,41 @@
+#ifndef ARDUINO_HOST_WIFI_CLIENT_H
+#define ARDUINO_HOST_WIFI_CLIENT_H
+
+// Cliente TCP sem rede: connect() sempre falha
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+    operator uint32_t() const { return _address; }
+
+private:
+    uint32_t _address;
+};
+
+class WiFiClient : public Stream {
+public:
+    virtual int connect(IPAddress ip, uint16_t port) { return 0; }
+    virtual int connect(IPAddress ip, uint16_t port, int32_t timeout) { return 0; }
+    virtual int connect(const char* host, uint16_t port) { return 0; }
+    virtual int connect(const char* host, uint16_t port, int32_t timeout) { return 0; }
+    size_t write(uint8_t value) override { return 0; }
+    size_t write(const uint8_t* buffer, size_t size) override { return 0; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    virtual int read(uint8_t* buffer, size_t size) { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+    virtual void stop() {}
+    virtual uint8_t connected() { return 0; }
+    int setTimeout(uint32_t seconds) { return 0; }
+    int setNoDelay(bool noDelay) { return 0; }
+    int fd() const { return -1; }
+    operator bool() { return connected(); }
+};
+
+#endif // ARDUINO_HOST_WIFI_CLIENT_H
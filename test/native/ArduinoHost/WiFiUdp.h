@@ -0,0 +1,28 @@
+#ifndef ARDUINO_HOST_WIFI_UDP_H
+#define ARDUINO_HOST_WIFI_UDP_H
+
+// Socket UDP sem rede: nada chega e nada sai
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+
+class WiFiUDP : public Stream {
+public:
+    uint8_t begin(uint16_t port) { return 0; }
+    void stop() {}
+    int beginPacket(const char* host, uint16_t port) { return 0; }
+    int beginPacket(IPAddress ip, uint16_t port) { return 0; }
+    int endPacket() { return 0; }
+    size_t write(uint8_t value) override { return 0; }
+    size_t write(const uint8_t* buffer, size_t size) override { return 0; }
+    using Print::write;
+    int parsePacket() { return 0; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int read(uint8_t* buffer, size_t size) { return 0; }
+    int peek() override { return -1; }
+    IPAddress remoteIP() { return IPAddress(); }
+    uint16_t remotePort() { return 0; }
+};
+
+#endif // ARDUINO_HOST_WIFI_UDP_H
@@ -0,0 +1,2 @@
+// Tipos em mbedtls/ssl.h
+#include "ssl.h"
@@ -0,0 +1,16 @@
+#ifndef ARDUINO_HOST_MBEDTLS_SSL_H
+#define ARDUINO_HOST_MBEDTLS_SSL_H
+
+// Tipos do mbedTLS que aparecem em tls_client.h (tls_client.cpp nao entra
+// no env:native)
+
+#include <stdint.h>
+
+typedef struct { int unused; } mbedtls_ssl_context;
+typedef struct { int unused; } mbedtls_ssl_config;
+typedef struct { int unused; } mbedtls_ssl_session;
+typedef struct { int unused; } mbedtls_x509_crt;
+typedef struct { int unused; } mbedtls_entropy_context;
+typedef struct { int unused; } mbedtls_ctr_drbg_context;
+
+#endif // ARDUINO_HOST_MBEDTLS_SSL_H
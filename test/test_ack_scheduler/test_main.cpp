@@ -0,0 +1,104 @@
+// ============================================
+// LOTE DO ACK AGREGADO (env:native)
+// ============================================
+
+#include <unity.h>
+#include <Arduino.h>
+#include "ack_scheduler.h"
+
+// Nos diferentes com o mesmo hash16 (FNV-1a dobrado): 0xDC3E
+#define COLLIDING_A "NODE103"
+#define COLLIDING_B "NODE120"
+
+static Protocol protocol;
+static LoRaHandler* lora;
+static AckScheduler* acks;
+
+static void schedule(StringView nodeId, uint32_t sequence) {
+    unsigned long now = millis();
+    TEST_ASSERT_TRUE(acks->schedule(nodeId, sequence, true, now, now + ACK_DELAY_MS));
+}
+
+// Fecha a janela do lote
+static void flush() {
+    hostAdvance(ACK_DELAY_MS + ACK_AGG_WINDOW_MS + 1);
+    acks->poll();
+}
+
+void setUp() {
+    lora = new LoRaHandler();
+    TEST_ASSERT_TRUE(lora->begin());
+    acks = new AckScheduler(*lora, protocol);
+}
+
+void tearDown() {
+    delete acks;
+    delete lora;
+}
+
+void test_hash_collision_premise() {
+    TEST_ASSERT_EQUAL_HEX16(Protocol::hashNodeId(COLLIDING_A), Protocol::hashNodeId(COLLIDING_B));
+}
+
+void test_distinct_nodes_share_a_frame() {
+    schedule("NODE001", 1);
+    schedule("NODE002", 7);
+    TEST_ASSERT_EQUAL_UINT32(0, acks->getAckedReadings());
+
+    flush();
+    TEST_ASSERT_EQUAL_UINT32(2, acks->getAckedReadings());
+}
+
+void test_retransmission_merges() {
+    schedule("NODE001", 1);
+    schedule("NODE001", 2);
+    flush();
+    TEST_ASSERT_EQUAL_UINT32(1, acks->getAckedReadings());
+}
+
+void test_hash_collision_flushes_batch() {
+    schedule(COLLIDING_A, 10);
+    schedule(COLLIDING_B, 20);
+
+    // O primeiro saiu sozinho; o segundo abriu outro lote
+    TEST_ASSERT_EQUAL_UINT32(1, acks->getAckedReadings());
+    TEST_ASSERT_TRUE(acks->msUntilFlush(millis()) != UINT32_MAX);
+
+    flush();
+    TEST_ASSERT_EQUAL_UINT32(2, acks->getAckedReadings());
+}
+
+void test_early_flush_waits_for_ack_delay() {
+    // Lote cheio sai antes da janela, mas nao antes do prazo do ultimo no
+    char nodeId[NODE_ID_MAX_LEN + 1];
+    for (uint8_t i = 0; i < ACK_AGG_MAX_ENTRIES - 1; i++) {
+        snprintf(nodeId, sizeof(nodeId), "NODE%03u", (unsigned)i);
+        schedule(nodeId, i);
+    }
+    hostAdvance(ACK_DELAY_MS / 2);
+    schedule("NODE999", 1);
+
+    TEST_ASSERT_EQUAL_UINT32(ACK_AGG_MAX_ENTRIES, acks->getAckedReadings());
+    TEST_ASSERT_EQUAL_UINT32(ACK_DELAY_MS, lora->msUntilNextPoll(millis()));
+}
+
+void test_collision_flush_waits_for_ack_delay() {
+    schedule(COLLIDING_A, 10);
+    hostAdvance(ACK_DELAY_MS / 2);
+    schedule(COLLIDING_B, 20);
+
+    // O lote do primeiro saiu: no prazo dele, nao agora
+    TEST_ASSERT_EQUAL_UINT32(1, acks->getAckedReadings());
+    TEST_ASSERT_EQUAL_UINT32(ACK_DELAY_MS - ACK_DELAY_MS / 2, lora->msUntilNextPoll(millis()));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hash_collision_premise);
+    RUN_TEST(test_distinct_nodes_share_a_frame);
+    RUN_TEST(test_retransmission_merges);
+    RUN_TEST(test_hash_collision_flushes_batch);
+    RUN_TEST(test_early_flush_waits_for_ack_delay);
+    RUN_TEST(test_collision_flush_waits_for_ack_delay);
+    return UNITY_END();
+}
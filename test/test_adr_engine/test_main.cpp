@@ -0,0 +1,82 @@
+// ============================================
+// ADR: QUADRO ATRASADO x REINICIO DO NO (env:native)
+// ============================================
+
+#include <unity.h>
+#include <Arduino.h>
+#include "adr_engine.h"
+
+static AdrEngine* adr;
+static DownlinkQueue* downlinks;
+static JsonDocument telemetry;
+
+// Estado do no em appendTelemetry
+static JsonObject node() {
+    telemetry.clear();
+    adr->appendTelemetry(telemetry.to<JsonObject>());
+    return telemetry["nodes"][0];
+}
+
+// Enlace folgado em SF7: ADR_MIN_SAMPLES quadros geram um ajuste pendente
+static void trainUntilAdjustment(unsigned long now) {
+    bool queued = false;
+    for (uint32_t seq = 100; seq < 100 + ADR_MIN_SAMPLES; seq++) {
+        queued = adr->update("NODE001", seq, 10.0f, -60, 7, now, *downlinks);
+    }
+    TEST_ASSERT_TRUE(queued);
+    TEST_ASSERT_TRUE(node()["pending"].as<bool>());
+}
+
+void setUp() {
+    adr = new AdrEngine();
+    downlinks = new DownlinkQueue();
+}
+
+void tearDown() {
+    delete downlinks;
+    delete adr;
+}
+
+void test_late_frame_in_window_is_ignored() {
+    trainUntilAdjustment(1000);
+    uint32_t lastSeq = 100 + ADR_MIN_SAMPLES - 1;
+
+    // Reordenado: nao e reinicio, nao mexe no historico nem no comando
+    TEST_ASSERT_FALSE(adr->update("NODE001", lastSeq - 3, 10.0f, -60, 7, 1000, *downlinks));
+    JsonObject state = node();
+    TEST_ASSERT_TRUE(state["pending"].as<bool>());
+    TEST_ASSERT_EQUAL_UINT8(ADR_MIN_SAMPLES, state["samples"].as<uint8_t>());
+    TEST_ASSERT_EQUAL_UINT32(0, state["lost"].as<uint32_t>());
+
+    // A sequencia seguinte continua sem lacuna
+    adr->update("NODE001", lastSeq + 1, 10.0f, -60, 7, 1000, *downlinks);
+    TEST_ASSERT_EQUAL_UINT32(0, node()["lost"].as<uint32_t>());
+}
+
+void test_reset_to_one_restarts_node() {
+    trainUntilAdjustment(1000);
+
+    // Volta para 1: no reiniciou em potencia maxima, comando descartado
+    adr->update("NODE001", 1, 10.0f, -60, 7, 1000, *downlinks);
+    JsonObject state = node();
+    TEST_ASSERT_FALSE(state["pending"].as<bool>());
+    TEST_ASSERT_EQUAL_UINT8(1, state["samples"].as<uint8_t>());
+    TEST_ASSERT_EQUAL_UINT8(ADR_POWER_MAX, state["tx_power"].as<uint8_t>());
+}
+
+void test_jump_back_beyond_window_restarts_node() {
+    trainUntilAdjustment(1000);
+
+    uint32_t lastSeq = 100 + ADR_MIN_SAMPLES - 1;
+    adr->update("NODE001", lastSeq - DEDUP_SEQ_WINDOW, 10.0f, -60, 7, 1000, *downlinks);
+    TEST_ASSERT_FALSE(node()["pending"].as<bool>());
+    TEST_ASSERT_EQUAL_UINT8(1, node()["samples"].as<uint8_t>());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_late_frame_in_window_is_ignored);
+    RUN_TEST(test_reset_to_one_restarts_node);
+    RUN_TEST(test_jump_back_beyond_window_restarts_node);
+    return UNITY_END();
+}
@@ -0,0 +1,141 @@
+// ============================================
+// REGRESSAO DE ALOCACAO: PROTOCOL E WEBSERVER (env:native)
+// ============================================
+//
+// Conta malloc/calloc/realloc (ALLOC_PROFILE, --wrap=malloc) em cada
+// chamada do caminho quente, ja em regime (depois de uma chamada de
+// aquecimento), e falha se passar do teto abaixo. Um teto so sobe junto
+// com a justificativa no commit.
+
+#include <unity.h>
+#include <Arduino.h>
+#include "alloc_profiler.h"
+#include "json_arena.h"
+#include "protocol.h"
+#include "web_server.h"
+
+// Tetos por chamada em regime
+#define MAX_ALLOCS_VALIDATE 0
+#define MAX_ALLOCS_PARSE 0
+#define MAX_ALLOCS_SERVER_PAYLOAD 0
+#define MAX_ALLOCS_ACK 0
+#define MAX_ALLOCS_LOG_PACKET 0
+
+// Status em String: o serializer escreve em blocos de
+// ARDUINOJSON_STRING_BUFFER_SIZE - 1 caracteres e a String cresce a cada
+// bloco (mais o bloco parcial e um do arredondamento); nada alem disso, o
+// documento inteiro fica na arena de status
+#define MAX_ALLOCS_STATUS(length) ((length) / (ARDUINOJSON_STRING_BUFFER_SIZE - 1) + 2)
+
+static const char* PACKET =
+    "{\"id\":\"NODE001\",\"type\":\"sensor\",\"seq\":42,"
+    "\"data\":{\"temp\":25.5,\"hum\":60.0,\"bat\":3.7}}";
+
+static Protocol protocol;
+static WebServer webServer(80);
+
+static uint32_t totalAllocs() {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < ALLOC_TAG_COUNT; i++) {
+        total += AllocProfiler::getStats(i).allocs;
+    }
+    return total;
+}
+
+// Alocacoes feitas por fn na segunda chamada (a primeira aquece)
+template <typename Fn>
+static uint32_t steadyAllocs(Fn fn) {
+    fn();
+    uint32_t before = totalAllocs();
+    fn();
+    return totalAllocs() - before;
+}
+
+void setUp() {}
+
+void tearDown() {
+    jsonArenaRx.reset();
+}
+
+void test_validate_packet() {
+    uint32_t allocs = steadyAllocs([]() {
+        TEST_ASSERT_TRUE(protocol.validatePacket(PACKET));
+    });
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_ALLOCS_VALIDATE, allocs);
+}
+
+void test_parse_packet() {
+    uint32_t allocs = steadyAllocs([]() {
+        JsonArenaScope arena(jsonArenaRx);
+        SensorData data = protocol.parseLoRaPacket(PACKET);
+        TEST_ASSERT_TRUE(data.valid);
+        TEST_ASSERT_EQUAL_STRING("NODE001", data.nodeId.c_str());
+        TEST_ASSERT_EQUAL_UINT32(42, data.sequence);
+    });
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_ALLOCS_PARSE, allocs);
+}
+
+void test_server_payload() {
+    uint32_t allocs = steadyAllocs([]() {
+        JsonArenaScope arena(jsonArenaRx);
+        SensorData data = protocol.parseLoRaPacket(PACKET);
+        UplinkPayload payload = protocol.createServerPayload(data, -70, 8.5f, 1000);
+        TEST_ASSERT_GREATER_THAN(0, payload.length());
+
+        char out[UPLINK_PAYLOAD_MAX_LEN];
+        TEST_ASSERT_GREATER_THAN(0, protocol.writeServerPayload(data, -70, 8.5f, 1000, 0, nullptr,
+                                                                out, sizeof(out),
+                                                                PAYLOAD_FORMAT_MSGPACK));
+    });
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_ALLOCS_SERVER_PAYLOAD, allocs);
+}
+
+void test_ack() {
+    uint32_t allocs = steadyAllocs([]() {
+        LoRaPayload ack = protocol.createAck("NODE001", 42, true);
+        TEST_ASSERT_GREATER_THAN(0, ack.length());
+
+        AckEntry entries[2] = {{Protocol::hashNodeId("NODE001"), 42},
+                               {Protocol::hashNodeId("NODE002"), 7}};
+        LoRaPayload aggregated = protocol.createAggregatedAck(entries, 2);
+        TEST_ASSERT_EQUAL(ACK_AGG_HEADER_SIZE + 2 * ACK_AGG_ENTRY_SIZE, aggregated.length());
+    });
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_ALLOCS_ACK, allocs);
+}
+
+void test_log_packet() {
+    uint32_t allocs = steadyAllocs([]() {
+        JsonArenaScope arena(jsonArenaRx);
+        SensorData data = protocol.parseLoRaPacket(PACKET);
+        webServer.logPacket(data.nodeId, data.nodeType, data.sequence, data.data, -70, 8.5f, 0);
+    });
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_ALLOCS_LOG_PACKET, allocs);
+    TEST_ASSERT_NOT_NULL(webServer.getLinkQuality("NODE001"));
+}
+
+void test_gateway_status() {
+    GatewayStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.packetsReceived = 10;
+    stats.uptimeMs = 60000;
+
+    size_t length = 0;
+    uint32_t allocs = steadyAllocs([&stats, &length]() {
+        String status = protocol.createGatewayStatus(stats);
+        length = status.length();
+    });
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_ALLOCS_STATUS(length), allocs);
+    TEST_ASSERT_EQUAL_UINT32(0, jsonArenaStatus.getOverflows());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_validate_packet);
+    RUN_TEST(test_parse_packet);
+    RUN_TEST(test_server_payload);
+    RUN_TEST(test_ack);
+    RUN_TEST(test_log_packet);
+    RUN_TEST(test_gateway_status);
+    return UNITY_END();
+}
@@ -0,0 +1,143 @@
+// ============================================
+// CONTROLE AIMD DOS LOTES HTTP (env:native)
+// ============================================
+
+#include <unity.h>
+#include <Arduino.h>
+#include "batch_controller.h"
+
+#define RTT_MS 100
+
+static BatchController* batch;
+
+void setUp() {
+    batch = new BatchController();
+}
+
+void tearDown() {
+    delete batch;
+}
+
+void test_additive_increase_with_backlog() {
+    TEST_ASSERT_EQUAL_UINT8(UPLINK_AIMD_INITIAL_BATCH, batch->getBatchSize());
+
+    // Sem fila o lote fica; com fila cresce uma leitura por POST ate o maximo
+    batch->recordResult(200, RTT_MS, 0);
+    TEST_ASSERT_EQUAL_UINT8(UPLINK_AIMD_INITIAL_BATCH, batch->getBatchSize());
+
+    for (uint8_t i = 1; i <= UPLINK_HTTP_BATCH_MAX - UPLINK_AIMD_INITIAL_BATCH; i++) {
+        batch->recordResult(200, RTT_MS, 5);
+        TEST_ASSERT_EQUAL_UINT8(UPLINK_AIMD_INITIAL_BATCH + i, batch->getBatchSize());
+    }
+    batch->recordResult(200, RTT_MS, 5);
+    TEST_ASSERT_EQUAL_UINT8(UPLINK_HTTP_BATCH_MAX, batch->getBatchSize());
+    TEST_ASSERT_EQUAL_UINT32(0, batch->getFlushIntervalMs());
+}
+
+void test_multiplicative_decrease_on_overload() {
+    // 503, 429 e POST sem resposta: lote pela metade, intervalo dobrado
+    const int statuses[] = {503, 429, 0};
+    uint8_t expectedBatch = UPLINK_AIMD_INITIAL_BATCH;
+    uint32_t expectedInterval = UPLINK_AIMD_INTERVAL_STEP_MS;
+    for (uint8_t i = 0; i < 3; i++) {
+        batch->recordResult(statuses[i], 0, 5);
+        expectedBatch = expectedBatch > 1 ? expectedBatch / 2 : 1;
+        TEST_ASSERT_EQUAL_UINT8(expectedBatch, batch->getBatchSize());
+        TEST_ASSERT_EQUAL_UINT32(expectedInterval, batch->getFlushIntervalMs());
+        expectedInterval *= 2;
+    }
+
+    // Lote nunca abaixo de 1, intervalo limitado
+    for (uint8_t i = 0; i < 20; i++) {
+        batch->recordResult(503, 0, 5);
+    }
+    TEST_ASSERT_EQUAL_UINT8(1, batch->getBatchSize());
+    TEST_ASSERT_EQUAL_UINT32(UPLINK_AIMD_MAX_INTERVAL_MS, batch->getFlushIntervalMs());
+    TEST_ASSERT_GREATER_THAN(900, batch->getErrorRate());
+}
+
+void test_client_error_keeps_pace() {
+    // 4xx (fora o 429) e erro do corpo: conta erro, nao reduz
+    batch->recordResult(400, RTT_MS, 0);
+    TEST_ASSERT_EQUAL_UINT8(UPLINK_AIMD_INITIAL_BATCH, batch->getBatchSize());
+    TEST_ASSERT_EQUAL_UINT32(0, batch->getFlushIntervalMs());
+    TEST_ASSERT_EQUAL_UINT16(125, batch->getErrorRate());
+}
+
+void test_slow_rtt_only_doubles_interval() {
+    batch->recordResult(200, RTT_MS, 0);
+    TEST_ASSERT_EQUAL_UINT32(RTT_MS, batch->getRttBaseMs());
+
+    // A base sobe um pouco a cada amostra: RTT bem acima do limite
+    uint32_t slow = 2 * RTT_MS * UPLINK_AIMD_RTT_FACTOR + UPLINK_AIMD_RTT_SLACK_MS;
+    batch->recordResult(200, slow, 5);
+    TEST_ASSERT_EQUAL_UINT8(UPLINK_AIMD_INITIAL_BATCH, batch->getBatchSize());
+    TEST_ASSERT_EQUAL_UINT32(UPLINK_AIMD_INTERVAL_STEP_MS, batch->getFlushIntervalMs());
+
+    batch->recordResult(200, slow, 5);
+    TEST_ASSERT_EQUAL_UINT32(2 * UPLINK_AIMD_INTERVAL_STEP_MS, batch->getFlushIntervalMs());
+}
+
+void test_interval_recovers_additively() {
+    batch->recordResult(503, 0, 0);
+    batch->recordResult(503, 0, 0);
+    batch->recordResult(503, 0, 0);
+    TEST_ASSERT_EQUAL_UINT32(4 * UPLINK_AIMD_INTERVAL_STEP_MS, batch->getFlushIntervalMs());
+
+    for (uint8_t i = 3; i > 0; i--) {
+        batch->recordResult(200, RTT_MS, 0);
+        TEST_ASSERT_EQUAL_UINT32(i * UPLINK_AIMD_INTERVAL_STEP_MS, batch->getFlushIntervalMs());
+    }
+    batch->recordResult(200, RTT_MS, 0);
+    batch->recordResult(200, RTT_MS, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, batch->getFlushIntervalMs());
+}
+
+void test_calm_night_sends_each_reading() {
+    // Intervalo 0: a leitura sai sozinha, sem esperar o lote
+    TEST_ASSERT_EQUAL(BATCH_FLUSH_INTERVAL, batch->decide(1000, 1, 1000, false, 0));
+    TEST_ASSERT_FALSE(batch->isHolding());
+}
+
+void test_decide_full_interval_and_event() {
+    // RTT lento sobe o intervalo acima do orcamento do evento sem mexer no lote
+    batch->recordResult(200, RTT_MS, 0);
+    for (uint8_t i = 0; i < 4; i++) {
+        batch->recordResult(200, 2 * RTT_MS * UPLINK_AIMD_RTT_FACTOR + UPLINK_AIMD_RTT_SLACK_MS, 0);
+    }
+    uint32_t interval = batch->getFlushIntervalMs();
+    TEST_ASSERT_GREATER_THAN(UPLINK_EVENT_LATENCY_BUDGET_MS + 200, interval);
+    uint8_t size = batch->getBatchSize();
+    TEST_ASSERT_EQUAL_UINT8(UPLINK_AIMD_INITIAL_BATCH, size);
+
+    // Lote completo sai na hora
+    TEST_ASSERT_EQUAL(BATCH_FLUSH_FULL, batch->decide(1000, size, 1000, false, 0));
+
+    // Incompleto espera a leitura mais antiga completar o intervalo
+    TEST_ASSERT_EQUAL(BATCH_FLUSH_WAIT, batch->decide(1000, size - 1, 1000, false, 0));
+    TEST_ASSERT_TRUE(batch->isHolding());
+    TEST_ASSERT_EQUAL_UINT32(1000 + interval, batch->getFlushDeadline());
+    TEST_ASSERT_EQUAL(BATCH_FLUSH_INTERVAL,
+                      batch->decide(1000 + interval, size - 1, 1000, false, 0));
+
+    // Evento: sai quando esgota o orcamento, antes do intervalo
+    unsigned long eventRx = 1200;
+    TEST_ASSERT_EQUAL(BATCH_FLUSH_WAIT, batch->decide(1500, size - 1, 1000, true, eventRx));
+    TEST_ASSERT_EQUAL_UINT32(eventRx + UPLINK_EVENT_LATENCY_BUDGET_MS, batch->getFlushDeadline());
+    TEST_ASSERT_EQUAL(BATCH_FLUSH_EVENT,
+                      batch->decide(eventRx + UPLINK_EVENT_LATENCY_BUDGET_MS, size - 1, 1000, true,
+                                    eventRx));
+    TEST_ASSERT_EQUAL_UINT32(UPLINK_EVENT_LATENCY_BUDGET_MS, batch->getMaxEventWaitMs());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_additive_increase_with_backlog);
+    RUN_TEST(test_multiplicative_decrease_on_overload);
+    RUN_TEST(test_client_error_keeps_pace);
+    RUN_TEST(test_slow_rtt_only_doubles_interval);
+    RUN_TEST(test_interval_recovers_additively);
+    RUN_TEST(test_calm_night_sends_each_reading);
+    RUN_TEST(test_decide_full_interval_and_event);
+    return UNITY_END();
+}
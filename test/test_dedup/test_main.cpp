@@ -0,0 +1,135 @@
+// ============================================
+// JANELA DO CACHE DE DUPLICADOS (env:native)
+// ============================================
+
+#include <unity.h>
+#include <Arduino.h>
+#include "dedup_cache.h"
+
+static DedupCache* cache;
+
+// Aceita as sequencias first..last, como o loop faz apos enfileirar
+static void acceptRange(StringView nodeId, uint32_t first, uint32_t last) {
+    for (uint32_t seq = first; seq <= last; seq++) {
+        TEST_ASSERT_FALSE(cache->isDuplicate(nodeId, seq));
+        cache->markAccepted(nodeId, seq);
+    }
+}
+
+void setUp() {
+    cache = new DedupCache();
+}
+
+void tearDown() {
+    delete cache;
+}
+
+void test_retransmission_is_duplicate() {
+    acceptRange("NODE001", 10, 20);
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 20));
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 15));
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", 21));
+
+    // Outro no com a mesma sequencia nao e duplicado
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE002", 20));
+}
+
+void test_late_frame_inside_window_is_accepted_once() {
+    cache->markAccepted("NODE001", 10);
+    cache->markAccepted("NODE001", 12);
+
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", 11));
+    cache->markAccepted("NODE001", 11);
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 11));
+}
+
+void test_window_edge() {
+    acceptRange("NODE001", 1, DEDUP_SEQ_WINDOW + 5);
+    uint32_t last = DEDUP_SEQ_WINDOW + 5;
+
+    // Ultima sequencia lembrada e a primeira fora da janela
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", last - (DEDUP_SEQ_WINDOW - 1)));
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", last - DEDUP_SEQ_WINDOW));
+}
+
+void test_node_reset_to_zero_or_one() {
+    // O no reinicia logo no inicio: 0/1 ainda estariam na janela
+    acceptRange("NODE001", 0, 10);
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", 0));
+    cache->markAccepted("NODE001", 0);
+
+    // Depois do reinicio a janela e a nova
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 0));
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", 1));
+    cache->markAccepted("NODE001", 1);
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 1));
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", 2));
+}
+
+void test_backwards_jump_beyond_window_is_reset() {
+    acceptRange("NODE001", 100, 110);
+    uint32_t seq = 110 - DEDUP_SEQ_WINDOW;
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", seq));
+    cache->markAccepted("NODE001", seq);
+
+    // Sequencias antigas acima da nova nao sao mais lembradas
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", seq));
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", seq + 1));
+}
+
+void test_entry_expires() {
+    cache->markAccepted("NODE001", 5);
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 5));
+    TEST_ASSERT_EQUAL_UINT8(1, cache->getNodeCount());
+
+    hostAdvance(DEDUP_WINDOW_MS + 1);
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", 5));
+    TEST_ASSERT_EQUAL_UINT8(0, cache->getNodeCount());
+}
+
+void test_end_to_end_retransmission_while_queued() {
+    // ACK fim-a-fim: na janela ao enfileirar, em voo ate o servidor confirmar
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", 7));
+    cache->markAccepted("NODE001", 7, true);
+
+    // Retransmissao com a original na fila: suprimida, sem re-ACK
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 7));
+    TEST_ASSERT_TRUE(cache->isInFlight("NODE001", 7));
+
+    // O bit em voo anda com a janela
+    cache->markAccepted("NODE001", 8, true);
+    cache->markAccepted("NODE001", 10, true);
+    TEST_ASSERT_TRUE(cache->isInFlight("NODE001", 7));
+    TEST_ASSERT_FALSE(cache->isInFlight("NODE001", 9));
+
+    // Entregue: duplicados passam a receber re-ACK
+    cache->markDelivered("NODE001", 7);
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 7));
+    TEST_ASSERT_FALSE(cache->isInFlight("NODE001", 7));
+    TEST_ASSERT_TRUE(cache->isInFlight("NODE001", 8));
+
+    // Descartada sem entrega: a retransmissao entra de novo na fila
+    cache->release("NODE001", 8);
+    TEST_ASSERT_FALSE(cache->isDuplicate("NODE001", 8));
+    TEST_ASSERT_FALSE(cache->isInFlight("NODE001", 8));
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 10));
+}
+
+void test_on_enqueue_is_never_in_flight() {
+    acceptRange("NODE001", 1, 3);
+    TEST_ASSERT_TRUE(cache->isDuplicate("NODE001", 2));
+    TEST_ASSERT_FALSE(cache->isInFlight("NODE001", 2));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_retransmission_is_duplicate);
+    RUN_TEST(test_late_frame_inside_window_is_accepted_once);
+    RUN_TEST(test_window_edge);
+    RUN_TEST(test_node_reset_to_zero_or_one);
+    RUN_TEST(test_backwards_jump_beyond_window_is_reset);
+    RUN_TEST(test_entry_expires);
+    RUN_TEST(test_end_to_end_retransmission_while_queued);
+    RUN_TEST(test_on_enqueue_is_never_in_flight);
+    return UNITY_END();
+}
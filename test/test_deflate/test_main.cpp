@@ -0,0 +1,127 @@
+// ============================================
+// DEFLATE DO LOTE DE UPLINK x ZLIB (env:native)
+// ============================================
+//
+// Cada corpo comprimido pelo UplinkCompressor tem de abrir no zlib do
+// host (o mesmo zlib.decompress do servidor): cabecalho, blocos Huffman
+// fixos e Adler-32 no fim. Precisa do zlib de desenvolvimento no host.
+
+#include <unity.h>
+#include <Arduino.h>
+#include <zlib.h>
+#include "uplink_compressor.h"
+
+static UplinkCompressor* compressor;
+static char body[UPLINK_BATCH_BUFFER_SIZE];
+static uint8_t inflated[UPLINK_BATCH_BUFFER_SIZE];
+
+// Lote JSON como o gateway monta: [leitura,leitura,...]
+static size_t buildBatch(uint8_t readings, uint32_t seed) {
+    size_t length = 0;
+    body[length++] = '[';
+    for (uint8_t i = 0; i < readings; i++) {
+        if (i > 0) {
+            body[length++] = ',';
+        }
+        length += snprintf(body + length, sizeof(body) - length,
+                           "{\"gateway_id\":\"GW001\",\"timestamp\":%u,\"node\":{\"id\":\"NODE%03u\","
+                           "\"type\":\"sensor\",\"seq\":%u,\"data\":{\"temp\":%u.%u,\"hum\":%u,"
+                           "\"trigger\":\"periodic\"}},\"rf\":{\"rssi\":-%u,\"snr\":%u.25}}",
+                           (unsigned)(86400 + seed + i), (unsigned)(i % 3), (unsigned)(seed + i),
+                           (unsigned)(20 + (seed + i) % 10), (unsigned)(i % 10),
+                           (unsigned)(40 + (seed * 7 + i) % 50), (unsigned)(60 + i % 40),
+                           (unsigned)(i % 12));
+    }
+    body[length++] = ']';
+    return length;
+}
+
+// Abre a saida com o zlib e confere o Adler-32 do fim do fluxo
+static void assertRoundTrip(const uint8_t* packed, size_t packedLength, const char* original,
+                            size_t length) {
+    TEST_ASSERT_GREATER_THAN(6, packedLength);
+    TEST_ASSERT_EQUAL_HEX8(0x78, packed[0]);
+    TEST_ASSERT_EQUAL(0, ((packed[0] << 8) | packed[1]) % 31);
+
+    uLongf inflatedLength = sizeof(inflated);
+    TEST_ASSERT_EQUAL(Z_OK, uncompress(inflated, &inflatedLength, packed, packedLength));
+    TEST_ASSERT_EQUAL_size_t(length, inflatedLength);
+    TEST_ASSERT_EQUAL_MEMORY(original, inflated, length);
+
+    uint32_t expected = adler32(adler32(0, Z_NULL, 0), (const Bytef*)original, length);
+    const uint8_t* trailer = packed + packedLength - 4;
+    uint32_t stored = ((uint32_t)trailer[0] << 24) | ((uint32_t)trailer[1] << 16) |
+                      ((uint32_t)trailer[2] << 8) | trailer[3];
+    TEST_ASSERT_EQUAL_HEX32(expected, stored);
+}
+
+void setUp() {
+    compressor = new UplinkCompressor();
+}
+
+void tearDown() {
+    delete compressor;
+}
+
+void test_batches_inflate_with_zlib() {
+    // Lotes seguidos passam pelos niveis que o compressor explora
+    bool levelSeen[UPLINK_COMPRESS_LEVELS] = {false};
+    for (uint32_t batch = 0; batch < 4 * UPLINK_COMPRESS_EXPLORE_EVERY; batch++) {
+        size_t length = buildBatch(1 + batch % UPLINK_HTTP_BATCH_MAX, batch * 13);
+        size_t packed = compressor->compress((const uint8_t*)body, length);
+        if (packed == 0) {
+            continue;
+        }
+        assertRoundTrip(compressor->output(), packed, body, length);
+        TEST_ASSERT_LESS_THAN(length, packed);
+        levelSeen[compressor->getLastLevel()] = true;
+    }
+
+    uint8_t levels = 0;
+    for (uint8_t i = 1; i < UPLINK_COMPRESS_LEVELS; i++) {
+        levels += levelSeen[i];
+    }
+    TEST_ASSERT_GREATER_THAN(0, levels);
+}
+
+void test_long_runs_and_distant_matches() {
+    // Repeticoes de 258+ bytes (comprimento maximo) e a distancias longas
+    size_t length = 0;
+    while (length + 64 < sizeof(body) / 2) {
+        length += snprintf(body + length, sizeof(body) - length, "%s",
+                           length % 3 == 0 ? "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+                                           : "{\"id\":\"NODE001\",\"seq\":12345},");
+    }
+    size_t packed = compressor->compress((const uint8_t*)body, length);
+    TEST_ASSERT_GREATER_THAN(0, packed);
+    assertRoundTrip(compressor->output(), packed, body, length);
+}
+
+void test_small_body_is_sent_raw() {
+    size_t length = snprintf(body, sizeof(body), "[{\"id\":\"NODE001\"}]");
+    TEST_ASSERT_LESS_THAN(UPLINK_COMPRESS_MIN_BYTES, length);
+    TEST_ASSERT_EQUAL_size_t(0, compressor->compress((const uint8_t*)body, length));
+}
+
+void test_incompressible_body_is_valid_or_raw() {
+    // Bytes pseudoaleatorios: sem ganho volta 0, com ganho tem de abrir
+    uint32_t state = 12345;
+    size_t length = 2048;
+    for (size_t i = 0; i < length; i++) {
+        state = state * 1103515245 + 12345;
+        body[i] = (char)(state >> 16);
+    }
+    size_t packed = compressor->compress((const uint8_t*)body, length);
+    if (packed > 0) {
+        assertRoundTrip(compressor->output(), packed, body, length);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_batches_inflate_with_zlib);
+    RUN_TEST(test_long_runs_and_distant_matches);
+    RUN_TEST(test_small_body_is_sent_raw);
+    RUN_TEST(test_incompressible_body_is_valid_or_raw);
+    return UNITY_END();
+}
@@ -0,0 +1,82 @@
+// ============================================
+// SEQUENCIA NA QUALIDADE DE ENLACE (env:native)
+// ============================================
+
+#include <unity.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "link_quality.h"
+
+static LinkQuality quality;
+static JsonDocument doc;
+
+static void receive(uint32_t sequence) {
+    hostAdvance(1000);
+    quality.update(sequence, -70, 8.0f, 0, millis());
+}
+
+static uint32_t telemetry(const char* key) {
+    doc.clear();
+    quality.appendTelemetry(doc.to<JsonObject>());
+    return doc[key] | 0;
+}
+
+void setUp() {
+    quality.reset();
+}
+
+void tearDown() {}
+
+void test_gap_counts_as_loss() {
+    receive(10);
+    receive(11);
+    receive(14);
+    TEST_ASSERT_EQUAL_UINT32(3, quality.getReceived());
+    TEST_ASSERT_EQUAL_UINT32(2, quality.getLost());
+}
+
+void test_late_frame_fills_gap() {
+    receive(10);
+    receive(12);
+    receive(11);
+    TEST_ASSERT_EQUAL_UINT32(0, quality.getLost());
+    TEST_ASSERT_EQUAL_UINT32(1, telemetry("reordered"));
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry("resets"));
+}
+
+void test_reset_to_zero_or_one_is_not_reordering() {
+    // 1 esta dentro da janela de reordenacao de 5, mas e reinicio
+    for (uint32_t seq = 1; seq <= 5; seq++) {
+        receive(seq);
+    }
+    receive(1);
+    TEST_ASSERT_EQUAL_UINT32(1, telemetry("resets"));
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry("reordered"));
+
+    // Conta de novo a partir de 1, sem perda
+    receive(2);
+    receive(3);
+    TEST_ASSERT_EQUAL_UINT32(0, quality.getLost());
+    TEST_ASSERT_EQUAL_UINT32(0, quality.getWindowLoss());
+}
+
+void test_reset_rule_matches_dedup() {
+    receive(100);
+
+    // Atrasado alem da reordenacao, mas dentro da janela do dedup: nao e reinicio
+    receive(100 - (LINK_REORDER_WINDOW + 1));
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry("resets"));
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry("reordered"));
+
+    receive(100 - DEDUP_SEQ_WINDOW);
+    TEST_ASSERT_EQUAL_UINT32(1, telemetry("resets"));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_gap_counts_as_loss);
+    RUN_TEST(test_late_frame_fills_gap);
+    RUN_TEST(test_reset_to_zero_or_one_is_not_reordering);
+    RUN_TEST(test_reset_rule_matches_dedup);
+    return UNITY_END();
+}
@@ -0,0 +1,68 @@
+// ============================================
+// RENDERIZACAO DO /metrics (env:native)
+// ============================================
+
+#include <unity.h>
+#include <Arduino.h>
+#include "metrics.h"
+
+// Resposta inteira, pedidos de maxLen bytes como o ESPAsyncWebServer faz
+static size_t renderAll(char* out, size_t capacity, size_t maxLen) {
+    MetricsCursor cursor = {0, 0};
+    size_t total = 0;
+    while (true) {
+        size_t room = capacity - total < maxLen ? capacity - total : maxLen;
+        TEST_ASSERT_GREATER_THAN(0, room);
+        size_t written = Metrics::renderChunk(cursor, out + total, room);
+        if (written == 0) {
+            break;
+        }
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(room, written);
+        total += written;
+    }
+    out[total] = '\0';
+    return total;
+}
+
+static char full[32768];
+static char split[32768];
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_histogram_sum_does_not_wrap() {
+    // 3 x 2e9 passa de INT32_MAX e de UINT32_MAX
+    for (uint8_t i = 0; i < 3; i++) {
+        Metrics::observe(HISTOGRAM_TLS_CRYPTO, 2000000000);
+    }
+    Metrics::observe(HISTOGRAM_RX_RSSI, -70);
+    Metrics::observe(HISTOGRAM_RX_RSSI, -90);
+
+    renderAll(full, sizeof(full) - 1, 1024);
+    TEST_ASSERT_NOT_NULL(strstr(full, "gateway_tls_crypto_us_sum 6000000000\n"));
+    TEST_ASSERT_NOT_NULL(strstr(full, "gateway_tls_crypto_us_count 3\n"));
+    TEST_ASSERT_NOT_NULL(strstr(full, "gateway_lora_rx_rssi_dbm_sum -160\n"));
+}
+
+void test_small_chunks_render_the_same_text() {
+    Metrics::inc(METRIC_RX_PACKETS, 5);
+
+    size_t fullLength = renderAll(full, sizeof(full) - 1, 4096);
+    TEST_ASSERT_GREATER_THAN(0, fullLength);
+
+    // Pedacos menores que varias linhas (HELP) nao podem encerrar a resposta
+    static const size_t SIZES[] = {1, 7, 40, 100, 191, 500};
+    for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+        size_t length = renderAll(split, sizeof(split) - 1, SIZES[i]);
+        TEST_ASSERT_EQUAL_size_t(fullLength, length);
+        TEST_ASSERT_EQUAL_STRING(full, split);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_sum_does_not_wrap);
+    RUN_TEST(test_small_chunks_render_the_same_text);
+    return UNITY_END();
+}
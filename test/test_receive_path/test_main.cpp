@@ -0,0 +1,215 @@
+// ============================================
+// CAMINHO DE RECEPCAO SEM HEAP (env:native)
+// ============================================
+//
+// Repete os passos de processLoRaPacket (main.cpp) com os mesmos modulos:
+// validacao, parsing, tempo no ar, duplicados, ADR, registro no dashboard,
+// fila de uplink e agendamento do ACK. Cada pacote roda dentro de um
+// AllocPacketScope, como no gateway, e nenhum pode alocar.
+
+#include <unity.h>
+#include <Arduino.h>
+#include "alloc_profiler.h"
+#include "json_arena.h"
+#include "fixed_string.h"
+#include "protocol.h"
+#include "lora_handler.h"
+#include "web_server.h"
+#include "dedup_cache.h"
+#include "uplink_queue.h"
+#include "ack_scheduler.h"
+#include "airtime_accountant.h"
+#include "downlink_queue.h"
+#include "adr_engine.h"
+
+static LoRaHandler lora;
+static Protocol protocol;
+static WebServer webServer(80);
+static DedupCache dedup;
+static UplinkQueue uplinkQueue;
+static AckScheduler acks(lora, protocol);
+static AirtimeAccountant airtime;
+static DownlinkQueue downlinks;
+static AdrEngine adr;
+
+static uint32_t totalAllocs() {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < ALLOC_TAG_COUNT; i++) {
+        total += AllocProfiler::getStats(i).allocs;
+    }
+    return total;
+}
+
+static LoRaPacket makePacket(StringView nodeId, uint32_t sequence) {
+    char text[MAX_PACKET_SIZE + 1];
+    snprintf(text, sizeof(text),
+             "{\"id\":\"%.*s\",\"type\":\"sensor\",\"seq\":%u,"
+             "\"data\":{\"temp\":25.5,\"hum\":60.0,\"bat\":3.7}}",
+             (int)nodeId.length(), nodeId.data(), (unsigned)sequence);
+
+    LoRaPacket packet;
+    packet.payload.assign(text);
+    packet.rssi = -70;
+    packet.snr = 8.5f;
+    packet.freqError = 120;
+    packet.timestamp = millis();
+    packet.airtimeUs = 61000;
+    packet.sf = 7;
+    packet.valid = true;
+    return packet;
+}
+
+// Os mesmos passos de processLoRaPacket (ACK_POLICY_ON_ENQUEUE)
+static bool receive(const LoRaPacket& packet) {
+    AllocPacketScope allocPacket;
+    AllocTagScope allocTag(ALLOC_TAG_PROTOCOL);
+    JsonArenaScope rxScope(jsonArenaRx);
+
+    if (!protocol.validatePacket(packet.payload)) {
+        return false;
+    }
+
+    SensorData sensorData = protocol.parseLoRaPacket(packet.payload);
+    if (!sensorData.valid) {
+        return false;
+    }
+
+    airtime.recordNodeRx(sensorData.nodeId, packet.airtimeUs, packet.timestamp);
+
+    if (dedup.isDuplicate(sensorData.nodeId, sensorData.sequence)) {
+        dedup.countSuppressed();
+        acks.schedule(sensorData.nodeId, sensorData.sequence, true, packet.timestamp,
+                      packet.timestamp + ACK_DELAY_MS, downlinks.nextFor(sensorData.nodeId, packet.timestamp),
+                      packet.sf);
+        return true;
+    }
+
+#if ADR_ENABLED
+    adr.update(sensorData.nodeId, sensorData.sequence, packet.snr, packet.rssi, packet.sf,
+               packet.timestamp, downlinks);
+#endif
+
+    webServer.logPacket(sensorData.nodeId, sensorData.nodeType, sensorData.sequence,
+                        sensorData.data, packet.rssi, packet.snr, packet.freqError);
+
+    UplinkEntry entry;
+    entry.payload = packet.payload;
+    entry.nodeId = sensorData.nodeId;
+    entry.sequence = sensorData.sequence;
+    entry.rssi = packet.rssi;
+    entry.snr = packet.snr;
+    entry.freqError = packet.freqError;
+    entry.sf = packet.sf;
+    entry.priority = UplinkQueue::classify(sensorData);
+    entry.rxTime = packet.timestamp;
+    entry.nextAttempt = packet.timestamp;
+    entry.attempts = 0;
+    entry.sendId = 0;
+    entry.linkSeq = 0;
+    entry.completed = false;
+    entry.mirror = false;
+
+    if (!uplinkQueue.push(entry)) {
+        return false;
+    }
+
+    dedup.markAccepted(sensorData.nodeId, sensorData.sequence);
+    acks.schedule(sensorData.nodeId, sensorData.sequence, true, packet.timestamp,
+                  packet.timestamp + ACK_DELAY_MS, downlinks.nextFor(sensorData.nodeId, packet.timestamp),
+                  packet.sf);
+    return true;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_fixed_string_copies_without_heap() {
+    uint32_t before = totalAllocs();
+
+    NodeId id("NODE001");
+    NodeId copy = id;
+    TEST_ASSERT_TRUE(copy == "NODE001");
+    TEST_ASSERT_TRUE(copy.append('X'));
+
+    // Conteudo maior que a capacidade e truncado, sem alocar
+    char longId[NODE_ID_MAX_LEN + 8];
+    memset(longId, 'A', sizeof(longId) - 1);
+    longId[sizeof(longId) - 1] = '\0';
+    TEST_ASSERT_FALSE(copy.assign(longId));
+    TEST_ASSERT_EQUAL(NODE_ID_MAX_LEN, copy.length());
+    TEST_ASSERT_EQUAL('\0', copy.c_str()[NODE_ID_MAX_LEN]);
+
+    LoRaPayload payload;
+    payload.assign("{\"id\":\"NODE001\"}");
+    LoRaPacket packet;
+    packet.payload = payload;
+    TEST_ASSERT_TRUE(StringView(packet.payload) == StringView(payload));
+
+    TEST_ASSERT_EQUAL_UINT32(0, totalAllocs() - before);
+}
+
+void test_new_readings_do_not_allocate() {
+    static const char* const NODES[] = {"NODE001", "NODE002", "NODE003"};
+
+    // Aquecimento: primeira leitura de cada no (entradas das tabelas)
+    uint32_t sequence = 1;
+    for (uint8_t n = 0; n < 3; n++) {
+        TEST_ASSERT_TRUE(receive(makePacket(NODES[n], sequence)));
+    }
+
+    for (uint8_t round = 0; round < 20; round++) {
+        sequence++;
+        for (uint8_t n = 0; n < 3; n++) {
+            hostAdvance(1000);
+            TEST_ASSERT_TRUE(receive(makePacket(NODES[n], sequence)));
+            TEST_ASSERT_EQUAL_UINT32(0, AllocProfiler::getLastPacketAllocs());
+        }
+
+        // Fila e ACKs andam como no loop
+        while (uplinkQueue.size() > 0) {
+            uplinkQueue.pop();
+        }
+        hostAdvance(ACK_DELAY_MS);
+        acks.poll();
+    }
+}
+
+void test_duplicate_does_not_allocate() {
+    LoRaPacket packet = makePacket("NODE010", 5);
+    TEST_ASSERT_TRUE(receive(packet));
+
+    hostAdvance(500);
+    packet.timestamp = millis();
+    TEST_ASSERT_TRUE(receive(packet));
+    TEST_ASSERT_EQUAL_UINT32(0, AllocProfiler::getLastPacketAllocs());
+    TEST_ASSERT_EQUAL_UINT32(1, dedup.getSuppressed());
+}
+
+void test_over_length_node_id_is_rejected() {
+    // Dois ids longos com o mesmo prefixo: truncados seriam o mesmo no
+    char first[NODE_ID_MAX_LEN + 3];
+    char second[NODE_ID_MAX_LEN + 3];
+    memset(first, 'L', NODE_ID_MAX_LEN);
+    memcpy(second, first, NODE_ID_MAX_LEN);
+    strcpy(first + NODE_ID_MAX_LEN, "-A");
+    strcpy(second + NODE_ID_MAX_LEN, "-B");
+
+    uint32_t suppressed = dedup.getSuppressed();
+    TEST_ASSERT_FALSE(receive(makePacket(first, 1)));
+    TEST_ASSERT_FALSE(receive(makePacket(second, 1)));
+    TEST_ASSERT_EQUAL_UINT32(suppressed, dedup.getSuppressed());
+
+    // No limite ainda e aceito
+    first[NODE_ID_MAX_LEN] = '\0';
+    TEST_ASSERT_TRUE(receive(makePacket(first, 1)));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_string_copies_without_heap);
+    RUN_TEST(test_new_readings_do_not_allocate);
+    RUN_TEST(test_duplicate_does_not_allocate);
+    RUN_TEST(test_over_length_node_id_is_rejected);
+    return UNITY_END();
+}
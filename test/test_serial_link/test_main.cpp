@@ -0,0 +1,290 @@
+// ============================================
+// QUADROS COBS + CRC DO UPLINK SERIAL (env:native)
+// ============================================
+//
+// A UART e um laco de memoria: o que o SerialLink escreve e decodificado
+// aqui com um COBS e um CRC-16/CCITT-FALSE de referencia (os mesmos da
+// ponte em tools/serial_bridge.cpp), e os ACKs da ponte sao injetados na
+// recepcao.
+
+#include <unity.h>
+#include <Arduino.h>
+#include "serial_link.h"
+#include "json_arena.h"
+
+// UART em memoria: TX guardado para decodificar, RX injetado pelo teste
+class LoopbackSerial : public HardwareSerial {
+public:
+    uint8_t tx[4096];
+    size_t txLength;
+    uint8_t rx[256];
+    size_t rxLength;
+    size_t rxPos;
+
+    LoopbackSerial() : txLength(0), rxLength(0), rxPos(0) {}
+
+    size_t write(uint8_t value) override { return write(&value, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        TEST_ASSERT_LESS_OR_EQUAL(sizeof(tx), txLength + size);
+        memcpy(tx + txLength, buffer, size);
+        txLength += size;
+        return size;
+    }
+    using Print::write;
+    int available() override { return (int)(rxLength - rxPos); }
+    int read() override { return rxPos < rxLength ? rx[rxPos++] : -1; }
+    int availableForWrite() override { return (int)(sizeof(tx) - txLength); }
+
+    void inject(const uint8_t* data, size_t length) {
+        memcpy(rx + rxLength, data, length);
+        rxLength += length;
+    }
+};
+
+static LoopbackSerial* uart;
+static SerialLink* link;
+static uint16_t lastAckSeq;
+static uint8_t ackCalls;
+
+static void onAck(uint16_t seq, bool acked) {
+    if (acked) {
+        lastAckSeq = seq;
+        ackCalls++;
+    }
+}
+
+// ---------- Referencia ----------
+
+static uint16_t refCrc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            bool top = ((crc >> 15) ^ (data[i] >> (7 - bit))) & 1;
+            crc <<= 1;
+            if (top) {
+                crc ^= 0x1021;
+            }
+        }
+    }
+    return crc;
+}
+
+static size_t refCobsEncode(const uint8_t* data, size_t length, uint8_t* out) {
+    size_t outLength = 0;
+    size_t codePos = outLength++;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == 0) {
+            out[codePos] = code;
+            codePos = outLength++;
+            code = 1;
+            continue;
+        }
+        out[outLength++] = data[i];
+        if (++code == 0xFF) {
+            out[codePos] = code;
+            codePos = outLength++;
+            code = 1;
+        }
+    }
+    out[codePos] = code;
+    return outLength;
+}
+
+static size_t refCobsDecode(const uint8_t* data, size_t length, uint8_t* out) {
+    size_t in = 0;
+    size_t outLength = 0;
+    while (in < length) {
+        uint8_t code = data[in++];
+        TEST_ASSERT_NOT_EQUAL(0, code);
+        TEST_ASSERT_LESS_OR_EQUAL(length, in + code - 1);
+        for (uint8_t i = 1; i < code; i++) {
+            out[outLength++] = data[in++];
+        }
+        if (code != 0xFF && in < length) {
+            out[outLength++] = 0;
+        }
+    }
+    return outLength;
+}
+
+// Proximo quadro do TX a partir de *pos: confere delimitadores, COBS e
+// CRC; retorna o registro sem o CRC
+static size_t nextRecord(size_t* pos, uint8_t* record) {
+    TEST_ASSERT_LESS_THAN(uart->txLength, *pos);
+    TEST_ASSERT_EQUAL_HEX8(0x00, uart->tx[*pos]);
+    size_t start = *pos + 1;
+    size_t end = start;
+    while (end < uart->txLength && uart->tx[end] != 0) {
+        end++;
+    }
+    TEST_ASSERT_LESS_THAN(uart->txLength, end);
+    *pos = end + 1;
+
+    size_t length = refCobsDecode(uart->tx + start, end - start, record);
+    TEST_ASSERT_GREATER_OR_EQUAL(5, length);
+    uint16_t crc = record[length - 2] | (record[length - 1] << 8);
+    TEST_ASSERT_EQUAL_HEX16(refCrc16(record, length - 2), crc);
+    return length - 2;
+}
+
+static void injectAck(uint16_t seq, bool corrupt) {
+    uint8_t record[5] = {SERIAL_RECORD_ACK, (uint8_t)(seq & 0xFF), (uint8_t)(seq >> 8)};
+    uint16_t crc = refCrc16(record, 3);
+    record[3] = crc & 0xFF;
+    record[4] = crc >> 8;
+    if (corrupt) {
+        record[3] ^= 0x01;
+    }
+
+    uint8_t frame[16];
+    frame[0] = 0;
+    size_t length = 1 + refCobsEncode(record, sizeof(record), frame + 1);
+    frame[length++] = 0;
+    uart->inject(frame, length);
+}
+
+static uint16_t sendReading(uint32_t sequence, const char* blob) {
+    JsonArenaScope arena(jsonArenaRx);
+    SensorData sensorData;
+    sensorData.nodeId.assign("NODE001");
+    sensorData.nodeType.assign("sensor");
+    sensorData.sequence = sequence;
+    sensorData.data["blob"] = blob;
+    sensorData.valid = true;
+
+    UplinkEntry entry;
+    entry.nodeId = sensorData.nodeId;
+    entry.sequence = sequence;
+    entry.rssi = -97;
+    entry.snr = 7.25f;
+    entry.freqError = -1234;
+    entry.sf = 9;
+    entry.rxTime = millis();
+    entry.linkSeq = 0;
+    return link->sendReading(entry, sensorData);
+}
+
+static uint32_t badFrames() {
+    JsonDocument doc;
+    link->appendTelemetry(doc.to<JsonObject>());
+    return doc["bad_frames"];
+}
+
+void setUp() {
+    uart = new LoopbackSerial();
+    link = new SerialLink();
+    lastAckSeq = 0;
+    ackCalls = 0;
+    link->setAckCallback(onAck);
+    link->begin(*uart);
+}
+
+void tearDown() {
+    delete link;
+    delete uart;
+}
+
+void test_reference_crc_check_value() {
+    // Valor de verificacao do CRC-16/CCITT-FALSE
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, refCrc16((const uint8_t*)"123456789", 9));
+}
+
+void test_hello_frame() {
+    uint8_t record[SERIAL_LINK_RECORD_MAX + 2];
+    size_t pos = 0;
+    size_t length = nextRecord(&pos, record);
+    TEST_ASSERT_EQUAL_size_t(uart->txLength, pos);
+
+    TEST_ASSERT_EQUAL_HEX8(SERIAL_RECORD_HELLO, record[0]);
+    TEST_ASSERT_EQUAL_UINT16(1, record[1] | (record[2] << 8));
+    TEST_ASSERT_EQUAL_UINT8(SERIAL_LINK_VERSION, record[3]);
+    TEST_ASSERT_EQUAL_UINT8(strlen(GATEWAY_ID), record[4]);
+    TEST_ASSERT_EQUAL_size_t(5 + strlen(GATEWAY_ID), length);
+    TEST_ASSERT_EQUAL_MEMORY(GATEWAY_ID, record + 5, strlen(GATEWAY_ID));
+}
+
+void test_reading_with_long_run_of_non_zero_bytes() {
+    // Mais de 254 bytes sem zero: o COBS precisa de um codigo 0xFF no meio
+    char blob[300];
+    memset(blob, 'x', sizeof(blob) - 1);
+    blob[sizeof(blob) - 1] = '\0';
+
+    size_t start = uart->txLength;
+    uint16_t seq = sendReading(4242, blob);
+    TEST_ASSERT_NOT_EQUAL(0, seq);
+
+    uint8_t record[SERIAL_LINK_RECORD_MAX + 2];
+    size_t pos = start;
+    size_t length = nextRecord(&pos, record);
+    TEST_ASSERT_EQUAL_size_t(uart->txLength, pos);
+
+    TEST_ASSERT_EQUAL_HEX8(SERIAL_RECORD_READING, record[0]);
+    TEST_ASSERT_EQUAL_UINT16(seq, record[1] | (record[2] << 8));
+    TEST_ASSERT_EQUAL_UINT32(4242, record[7] | (record[8] << 8) | (record[9] << 16) |
+                                       ((uint32_t)record[10] << 24));
+    TEST_ASSERT_EQUAL_INT16(-97, (int16_t)(record[11] | (record[12] << 8)));
+    TEST_ASSERT_EQUAL_INT16(73, (int16_t)(record[13] | (record[14] << 8)));
+    TEST_ASSERT_EQUAL_UINT8(9, record[19]);
+
+    // id, tipo e "data" no fim do registro
+    size_t at = 20;
+    TEST_ASSERT_EQUAL_UINT8(7, record[at]);
+    TEST_ASSERT_EQUAL_MEMORY("NODE001", record + at + 1, 7);
+    at += 1 + 7;
+    TEST_ASSERT_EQUAL_UINT8(6, record[at]);
+    at += 1 + 6;
+    uint16_t dataLength = record[at] | (record[at + 1] << 8);
+    at += 2;
+    TEST_ASSERT_EQUAL_size_t(length, at + dataLength);
+    TEST_ASSERT_EQUAL_MEMORY("{\"blob\":\"xxx", record + at, 12);
+}
+
+void test_ack_confirms_reading() {
+    uint16_t seq = sendReading(1, "ok");
+    TEST_ASSERT_EQUAL_UINT8(1, link->getInflight());
+
+    hostAdvance(15);
+    injectAck(seq, false);
+    link->poll(millis());
+
+    TEST_ASSERT_EQUAL_UINT8(1, ackCalls);
+    TEST_ASSERT_EQUAL_UINT16(seq, lastAckSeq);
+    TEST_ASSERT_EQUAL_UINT8(0, link->getInflight());
+    TEST_ASSERT_EQUAL_UINT32(1, link->getAcked());
+    TEST_ASSERT_EQUAL_UINT32(15, link->getAvgRttMs());
+}
+
+void test_corrupted_ack_is_rejected() {
+    uint16_t seq = sendReading(1, "ok");
+    injectAck(seq, true);
+    link->poll(millis());
+
+    TEST_ASSERT_EQUAL_UINT8(0, ackCalls);
+    TEST_ASSERT_EQUAL_UINT8(1, link->getInflight());
+    TEST_ASSERT_EQUAL_UINT32(1, badFrames());
+}
+
+void test_resyncs_after_garbage() {
+    // Lixo sem zero ate o delimitador vira um quadro ruim; o ACK seguinte vale
+    uint16_t seq = sendReading(1, "ok");
+    const uint8_t garbage[] = {'l', 'i', 'x', 'o', '\r', '\n'};
+    uart->inject(garbage, sizeof(garbage));
+    injectAck(seq, false);
+    link->poll(millis());
+
+    TEST_ASSERT_EQUAL_UINT8(1, ackCalls);
+    TEST_ASSERT_EQUAL_UINT16(seq, lastAckSeq);
+    TEST_ASSERT_EQUAL_UINT32(1, badFrames());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reference_crc_check_value);
+    RUN_TEST(test_hello_frame);
+    RUN_TEST(test_reading_with_long_run_of_non_zero_bytes);
+    RUN_TEST(test_ack_confirms_reading);
+    RUN_TEST(test_corrupted_ack_is_rejected);
+    RUN_TEST(test_resyncs_after_garbage);
+    return UNITY_END();
+}
@@ -0,0 +1,50 @@
+#!/bin/bash
+# Gera um CA autoassinado e o certificado do servidor de testes HTTPS.
+# Usage: tools/make_dev_ca.sh [host]   (padrao: SERVER_HOST do config.h)
+#
+# Saida em server/certs/ (ca.pem, ca.key, server.pem, server.key) e copia
+# do CA em data/ca.pem, gravado no LittleFS com "pio run -t uploadfs".
+# O mbedTLS do ESP32 (2.x) so compara nomes DNS, entao um host IP vai no
+# SAN como IP e tambem como DNS.
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+HOST="${1:-$(sed -n 's/^#define SERVER_HOST "\(.*\)"/\1/p' include/config.h)}"
+OUT=server/certs
+DAYS=825
+
+if [ -z "$HOST" ]; then
+    echo "[ERRO] Host nao informado e SERVER_HOST nao encontrado"
+    exit 1
+fi
+
+mkdir -p "$OUT" data
+
+if [ ! -f "$OUT/ca.key" ]; then
+    echo "[CA] Gerando CA de desenvolvimento"
+    openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+        -keyout "$OUT/ca.key" -out "$OUT/ca.pem" -days "$DAYS" \
+        -subj "/CN=LoRa Gateway Dev CA"
+fi
+
+if [[ "$HOST" =~ ^[0-9.]+$ ]]; then
+    SAN="IP:$HOST,DNS:$HOST"
+else
+    SAN="DNS:$HOST"
+fi
+
+echo "[CA] Certificado do servidor para $HOST ($SAN)"
+openssl req -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+    -keyout "$OUT/server.key" -out "$OUT/server.csr" -subj "/CN=$HOST"
+openssl x509 -req -in "$OUT/server.csr" -CA "$OUT/ca.pem" -CAkey "$OUT/ca.key" \
+    -CAcreateserial -out "$OUT/server.pem" -days "$DAYS" \
+    -extfile <(printf "subjectAltName=%s\nextendedKeyUsage=serverAuth\n" "$SAN")
+rm -f "$OUT/server.csr"
+
+cp "$OUT/ca.pem" data/ca.pem
+
+echo
+echo "CA do gateway: data/ca.pem (pio run -t uploadfs)"
+echo "Servidor:      SERVER_TLS_CERT=$OUT/server.pem SERVER_TLS_KEY=$OUT/server.key python server/app.py"
@@ -0,0 +1,137 @@
+// Compara JSON e MessagePack no payload de uplink (tabela do README,
+// secao "MessagePack").
+//
+// Monta a leitura do no de maquina de examples/sensor_node com os campos
+// que o gateway acrescenta (Protocol::writeServerPayload: gateway, RF e
+// resumo de enlace) e mede, nos dois formatos: bytes por leitura, tempo de
+// serializacao e o lote de 8 leituras (array) cru e comprimido em zlib,
+// como o POST de /api/sensor-data/batch.
+//
+// Compilar (ArduinoJson do PlatformIO, zlib do sistema):
+//   pio pkg install -e jvtech_mij
+//   g++ -std=c++11 -O2 -I.pio/libdeps/jvtech_mij/ArduinoJson/src -o payload_format_bench tools/payload_format_bench.cpp -lz
+//
+// Uso:
+//   ./payload_format_bench [-n iteracoes]
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <chrono>
+
+static const int BATCH = 8;
+
+// Leitura i do lote: sequencia e horario avancam como num no real
+static void buildReading(JsonDocument& doc, int i) {
+    doc.clear();
+    doc["gateway_id"] = "GW001";
+    doc["timestamp"] = 86400 + i * 60;
+
+    JsonObject node = doc["node"].to<JsonObject>();
+    node["id"] = "M001";
+    node["type"] = "machine";
+    node["seq"] = 4242 + i;
+
+    JsonObject data = node["data"].to<JsonObject>();
+    data["macAddress"] = "AA:BB:CC:DD:EE:FF";
+    data["machineId"] = "M001";
+    data["timestamp"] = 1234567 + i * 60000;
+    JsonObject di = data["digitalInputs"].to<JsonObject>();
+    di["di1"] = true;
+    di["di2"] = false;
+    di["di3"] = (i % 2) == 0;
+    di["di4"] = false;
+    JsonObject ai = data["analogInputs"].to<JsonObject>();
+    ai["ai1"] = 2048 + i * 3;
+    ai["ai2"] = 1536 - i;
+    data["temperature"] = 25.5 + i * 0.1;
+    data["trigger"] = "event";
+
+    JsonObject rf = doc["rf"].to<JsonObject>();
+    rf["rssi"] = -97;
+    rf["snr"] = 7.25;
+    rf["freq_err"] = -1234;
+    JsonObject link = rf["link"].to<JsonObject>();
+    link["loss_pct"] = 1.5;
+    link["lost"] = 3;
+    link["rssi_avg"] = -96.4;
+    link["snr_avg"] = 7.1;
+    link["jitter_ms"] = 420;
+}
+
+static size_t serialize(const JsonDocument& doc, bool msgpack, char* out, size_t capacity) {
+    return msgpack ? serializeMsgPack(doc, out, capacity) : serializeJson(doc, out, capacity);
+}
+
+// Lote como o gateway envia: [a,b,...] em JSON, fixarray em MessagePack
+static size_t buildBatch(bool msgpack, char* out, size_t capacity) {
+    JsonDocument doc;
+    size_t length = 0;
+
+    out[length++] = msgpack ? (char)(0x90 | BATCH) : '[';
+    for (int i = 0; i < BATCH; i++) {
+        if (i > 0 && !msgpack) {
+            out[length++] = ',';
+        }
+        buildReading(doc, i);
+        length += serialize(doc, msgpack, out + length, capacity - length);
+    }
+    if (!msgpack) {
+        out[length++] = ']';
+    }
+    return length;
+}
+
+static size_t zlibSize(const char* data, size_t length) {
+    static unsigned char packed[16384];
+    uLongf packedLength = sizeof(packed);
+    if (compress2(packed, &packedLength, (const Bytef*)data, length, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        return 0;
+    }
+    return packedLength;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 200000;
+    if (argc == 3 && strcmp(argv[1], "-n") == 0) {
+        iterations = atoi(argv[2]);
+    }
+
+    JsonDocument doc;
+    buildReading(doc, 0);
+
+    static char buffer[16384];
+    size_t bytes[2];
+    double nsPerReading[2];
+    size_t batch[2];
+    size_t batchZlib[2];
+    size_t check = 0;
+
+    for (int format = 0; format < 2; format++) {
+        bool msgpack = format == 1;
+        bytes[format] = msgpack ? measureMsgPack(doc) : measureJson(doc);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            check += serialize(doc, msgpack, buffer, sizeof(buffer));
+        }
+        auto end = std::chrono::steady_clock::now();
+        nsPerReading[format] = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+
+        batch[format] = buildBatch(msgpack, buffer, sizeof(buffer));
+        batchZlib[format] = zlibSize(buffer, batch[format]);
+    }
+
+    printf("%-28s %10s %12s\n", "", "JSON", "MessagePack");
+    printf("%-28s %10zu %12zu (%+.0f%%)\n", "Bytes por leitura", bytes[0], bytes[1],
+           100.0 * ((double)bytes[1] / bytes[0] - 1));
+    printf("%-28s %10.0f %12.0f (%.2f)\n", "Serializacao (ns)", nsPerReading[0], nsPerReading[1],
+           nsPerReading[1] / nsPerReading[0]);
+    printf("%-28s %10zu %12zu\n", "Lote de 8 leituras", batch[0], batch[1]);
+    printf("%-28s %10zu %12zu\n", "Lote de 8 com zlib", batchZlib[0], batchZlib[1]);
+
+    // Impede o compilador de descartar o laco medido
+    return check == 0;
+}
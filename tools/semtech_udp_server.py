@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+Servidor UDP minimo do protocolo do packet forwarder Semtech (GWMP v2),
+para testar o gateway no modo UPLINK_TRANSPORT_SEMTECH sem um network server.
+Usage: python3 semtech_udp_server.py [porta] [--downlink HEX] [--imme]
+
+Responde PUSH_ACK/PULL_ACK, mostra os rxpk (com o quadro decodificado) e os
+stat. Com --downlink, apos o primeiro rxpk envia um PULL_RESP com o quadro
+HEX agendado para tmst + 1 s (ou imediato com --imme) e mostra o TX_ACK.
+"""
+
+import argparse
+import base64
+import json
+import socket
+import struct
+
+PUSH_DATA = 0x00
+PUSH_ACK = 0x01
+PULL_DATA = 0x02
+PULL_RESP = 0x03
+PULL_ACK = 0x04
+TX_ACK = 0x05
+
+
+def print_rxpk(rxpk):
+    """Mostra uma leitura repassada pelo gateway."""
+    data = base64.b64decode(rxpk.get("data", ""))
+    try:
+        frame = data.decode()
+    except UnicodeDecodeError:
+        frame = data.hex()
+    print(f"  rxpk tmst={rxpk.get('tmst')} {rxpk.get('datr')} "
+          f"{rxpk.get('freq')} MHz rssi={rxpk.get('rssi')} lsnr={rxpk.get('lsnr')}: {frame}")
+
+
+def build_txpk(rxpk, payload, immediate):
+    """txpk no mesmo canal e SF da leitura recebida."""
+    txpk = {
+        "freq": rxpk["freq"],
+        "rfch": 0,
+        "powe": 14,
+        "modu": "LORA",
+        "datr": rxpk["datr"],
+        "codr": rxpk.get("codr", "4/5"),
+        "ipol": False,
+        "size": len(payload),
+        "data": base64.b64encode(payload).decode(),
+    }
+    if immediate:
+        txpk["imme"] = True
+    else:
+        txpk["tmst"] = (rxpk["tmst"] + 1000000) & 0xFFFFFFFF
+    return {"txpk": txpk}
+
+
+def serve(port, downlink, immediate):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", port))
+    print(f"Aguardando o gateway na porta UDP {port}")
+
+    pull_addr = None
+    downlink_sent = False
+    token = 1
+
+    while True:
+        packet, addr = sock.recvfrom(65535)
+        if len(packet) < 4 or packet[0] != 2:
+            print(f"Datagrama ignorado de {addr}: {packet[:16].hex()}")
+            continue
+
+        kind = packet[3]
+        if kind == PUSH_DATA and len(packet) >= 12:
+            sock.sendto(packet[:3] + bytes([PUSH_ACK]), addr)
+            eui = packet[4:12].hex()
+            try:
+                body = json.loads(packet[12:])
+            except ValueError:
+                print(f"PUSH_DATA de {eui} com JSON invalido")
+                continue
+
+            if "stat" in body:
+                print(f"stat de {eui}: {json.dumps(body['stat'])}")
+            rxpks = body.get("rxpk", [])
+            if rxpks:
+                print(f"PUSH_DATA de {eui}: {len(rxpks)} rxpk")
+                for rxpk in rxpks:
+                    print_rxpk(rxpk)
+
+            if downlink and not downlink_sent and rxpks and pull_addr:
+                txpk = build_txpk(rxpks[0], downlink, immediate)
+                header = struct.pack(">BHB", 2, token, PULL_RESP)
+                sock.sendto(header + json.dumps(txpk).encode(), pull_addr)
+                print(f"PULL_RESP enviado: {json.dumps(txpk)}")
+                downlink_sent = True
+                token += 1
+        elif kind == PULL_DATA and len(packet) >= 12:
+            sock.sendto(packet[:3] + bytes([PULL_ACK]), addr)
+            if pull_addr != addr:
+                print(f"PULL_DATA de {packet[4:12].hex()} ({addr[0]}:{addr[1]})")
+            pull_addr = addr
+        elif kind == TX_ACK:
+            print(f"TX_ACK: {packet[12:].decode(errors='replace')}")
+        else:
+            print(f"Tipo {kind} ignorado de {addr}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Servidor UDP Semtech para testes")
+    parser.add_argument("port", nargs="?", type=int, default=1700)
+    parser.add_argument("--downlink", help="Quadro (hex) enviado por PULL_RESP")
+    parser.add_argument("--imme", action="store_true", help="Downlink imediato (sem tmst)")
+    args = parser.parse_args()
+
+    try:
+        serve(args.port, bytes.fromhex(args.downlink) if args.downlink else None, args.imme)
+    except KeyboardInterrupt:
+        pass
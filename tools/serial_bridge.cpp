@@ -0,0 +1,732 @@
+// Ponte serial -> servidor para o gateway em UPLINK_TRANSPORT_SERIAL.
+//
+// Le os quadros COBS da UART do gateway (formato em include/serial_link.h),
+// repassa leituras a /api/sensor-data e status a /api/gateway-status no
+// mesmo JSON do uplink HTTP, e confirma cada leitura aceita pelo servidor
+// com um ACK. Texto de debug entre os quadros e mostrado como log.
+//
+// Compilar (Linux/macOS, sem dependencias):
+//   g++ -std=c++11 -O2 -o serial_bridge tools/serial_bridge.cpp
+//
+// Uso:
+//   ./serial_bridge /dev/ttyUSB0 [-b 921600] [-s 127.0.0.1:8081] [-g GW001] [-n]
+//     -b  velocidade (SERIAL_LINK_BAUD)
+//     -s  servidor backend (host:porta)
+//     -g  id do gateway ate o primeiro HELLO/status
+//     -n  nao envia ao servidor: mostra o JSON e confirma na hora
+//
+// Teste sem hardware, com um par de pty:
+//   socat -d -d pty,raw,echo=0 pty,raw,echo=0   # mostra /dev/pts/A e /dev/pts/B
+//   ./serial_bridge /dev/pts/A -n                # gateway (ou simulador) em /dev/pts/B
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+// Mesmos valores de include/serial_link.h
+#define SERIAL_RECORD_READING 0x01
+#define SERIAL_RECORD_STATUS  0x02
+#define SERIAL_RECORD_HELLO   0x03
+#define SERIAL_RECORD_ACK     0x81
+
+#define FRAME_MAX 1024          // Maior segmento aceito entre delimitadores
+#define DEDUP_SIZE 64           // Leituras recentes (ACK perdido = leitura repetida)
+#define HTTP_TIMEOUT_S 5
+
+// Nomes dos campos u32 do registro de status (ordem de SerialStatusField)
+static const char* const STATUS_FIELDS[] = {
+    "uptime_s", "packets_rx", "packets_fwd", "packets_err", "packets_dup",
+    "queue_depth", "queue_rejected", "ack_avg_ms", "ack_max_ms", "ack_airtime_ms",
+    "ack_airtime_single_ms", "cmd_delivered", "cmd_failed", "cmd_avg_latency_ms",
+    "channel_util_pct", "tx_util_pct", "tx_blocked", "adr_adjustments", "adr_reverts",
+    "links_degraded", "config_applied", "config_rollbacks", "free_heap", "min_free_heap",
+    "largest_free_block", "link_frames", "link_acks", "link_timeouts", "link_bad_frames",
+    "link_tx_stalls", "link_ack_rtt_ms", "link_handoff_us", "link_handoff_max_us"
+};
+static const size_t STATUS_FIELD_COUNT = sizeof(STATUS_FIELDS) / sizeof(STATUS_FIELDS[0]);
+static const size_t STATUS_CHANNEL_UTIL = 14;  // Permil no registro, % no JSON
+static const size_t STATUS_TX_UTIL = 15;
+
+// Leitura ja repassada, reconhecida pelo seq do registro (o reenvio repete
+// o seq) ou pela identidade da leitura na fila do gateway (no, seq do no,
+// rx_ms)
+struct SeenReading {
+    int seq = -1;
+    std::string nodeId;
+    uint32_t nodeSeq = 0;
+    uint32_t rxMs = 0;
+
+    bool matches(uint16_t linkSeq, const std::string& id, uint32_t nodeSequence, uint32_t rx) const {
+        if (seq < 0) {
+            return false;
+        }
+        return seq == linkSeq || (nodeSeq == nodeSequence && rxMs == rx && nodeId == id);
+    }
+};
+
+struct Options {
+    std::string device;
+    int baud = 921600;
+    std::string host = "127.0.0.1";
+    int port = 8081;
+    std::string gatewayId = "GW001";
+    bool dryRun = false;
+};
+
+struct Stats {
+    unsigned long frames = 0;
+    unsigned long badFrames = 0;
+    unsigned long logLines = 0;
+    unsigned long readings = 0;
+    unsigned long duplicates = 0;
+    unsigned long forwarded = 0;
+    unsigned long failed = 0;
+    unsigned long statuses = 0;
+    double postTotalMs = 0;
+    double handoffTotalUs = 0;   // Fim do quadro -> ACK escrito
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int) {
+    running = 0;
+}
+
+static double nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// ---------- Quadros ----------
+
+static uint16_t crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static std::vector<uint8_t> cobsEncode(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> out(1);
+    size_t codePos = 0;
+    uint8_t code = 1;
+
+    for (uint8_t byte : data) {
+        if (byte != 0) {
+            out.push_back(byte);
+            code++;
+        }
+        if (byte == 0 || code == 0xFF) {
+            out[codePos] = code;
+            codePos = out.size();
+            out.push_back(0);
+            code = 1;
+        }
+    }
+    out[codePos] = code;
+    return out;
+}
+
+static bool cobsDecode(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+    out.clear();
+    size_t pos = 0;
+    while (pos < in.size()) {
+        uint8_t code = in[pos++];
+        if (code == 0 || pos + code - 1 > in.size()) {
+            return false;
+        }
+        out.insert(out.end(), in.begin() + pos, in.begin() + pos + code - 1);
+        pos += code - 1;
+        if (code != 0xFF && pos < in.size()) {
+            out.push_back(0);
+        }
+    }
+    return true;
+}
+
+// Leitura little-endian com verificacao de limite
+struct RecordReader {
+    const uint8_t* data;
+    size_t length;
+    size_t pos;
+    bool error;
+
+    RecordReader(const uint8_t* buffer, size_t size) : data(buffer), length(size), pos(0), error(false) {}
+
+    uint32_t get(size_t size) {
+        if (pos + size > length) {
+            error = true;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (size_t i = 0; i < size; i++) {
+            value |= (uint32_t)data[pos + i] << (8 * i);
+        }
+        pos += size;
+        return value;
+    }
+
+    std::string getBytes(size_t size) {
+        if (pos + size > length) {
+            error = true;
+            return std::string();
+        }
+        std::string value((const char*)data + pos, size);
+        pos += size;
+        return value;
+    }
+
+    std::string getString() { return getBytes(get(1)); }
+};
+
+static std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// ---------- Serial ----------
+
+static speed_t baudConstant(int baud) {
+    switch (baud) {
+        case 115200: return B115200;
+        case 230400: return B230400;
+#ifdef B460800
+        case 460800: return B460800;
+#endif
+#ifdef B921600
+        case 921600: return B921600;
+#endif
+#ifdef B1500000
+        case 1500000: return B1500000;
+#endif
+#ifdef B2000000
+        case 2000000: return B2000000;
+#endif
+        default: return 0;
+    }
+}
+
+static int openSerial(const Options& options) {
+    int fd = open(options.device.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "Erro: nao foi possivel abrir %s: %s\n", options.device.c_str(), strerror(errno));
+        return -1;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) == 0) {
+        cfmakeraw(&tty);
+        tty.c_cflag |= CLOCAL | CREAD;
+        tty.c_cc[VMIN] = 0;
+        tty.c_cc[VTIME] = 0;
+
+        speed_t speed = baudConstant(options.baud);
+        if (speed == 0) {
+            fprintf(stderr, "Aviso: velocidade %d nao suportada, mantendo a atual\n", options.baud);
+        } else {
+            cfsetispeed(&tty, speed);
+            cfsetospeed(&tty, speed);
+        }
+        tcsetattr(fd, TCSANOW, &tty);
+    }
+    return fd;
+}
+
+static bool writeAll(int fd, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+static bool sendAck(int fd, uint16_t seq) {
+    std::vector<uint8_t> record;
+    record.push_back(SERIAL_RECORD_ACK);
+    record.push_back(seq & 0xFF);
+    record.push_back(seq >> 8);
+    uint16_t crc = crc16(record.data(), record.size());
+    record.push_back(crc & 0xFF);
+    record.push_back(crc >> 8);
+
+    std::vector<uint8_t> frame = cobsEncode(record);
+    frame.insert(frame.begin(), 0);
+    frame.push_back(0);
+    return writeAll(fd, frame.data(), frame.size());
+}
+
+// ---------- HTTP (keep-alive) ----------
+
+class HttpClient {
+public:
+    HttpClient(const std::string& host, int port) : _host(host), _port(port), _fd(-1) {}
+    ~HttpClient() { close(); }
+
+    // Retorna o status HTTP (0 = falha de conexao)
+    int post(const std::string& path, const std::string& body) {
+        // Conexao reaproveitada pode ter sido fechada pelo servidor: tenta de novo uma vez
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (_fd < 0 && !connect()) {
+                return 0;
+            }
+            int status = request(path, body);
+            if (status > 0) {
+                return status;
+            }
+            close();
+        }
+        return 0;
+    }
+
+private:
+    std::string _host;
+    int _port;
+    int _fd;
+    std::string _buffer;
+
+    bool connect() {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        struct addrinfo* result = nullptr;
+        std::string port = std::to_string(_port);
+        if (getaddrinfo(_host.c_str(), port.c_str(), &hints, &result) != 0) {
+            return false;
+        }
+
+        for (struct addrinfo* addr = result; addr; addr = addr->ai_next) {
+            _fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+            if (_fd < 0) {
+                continue;
+            }
+            struct timeval timeout = { HTTP_TIMEOUT_S, 0 };
+            setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            int noDelay = 1;
+            setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            if (::connect(_fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+                break;
+            }
+            ::close(_fd);
+            _fd = -1;
+        }
+        freeaddrinfo(result);
+        _buffer.clear();
+        return _fd >= 0;
+    }
+
+    void close() {
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    int request(const std::string& path, const std::string& body) {
+        std::string request = "POST " + path + " HTTP/1.1\r\n"
+                              "Host: " + _host + "\r\n"
+                              "Content-Type: application/json\r\n"
+                              "Connection: keep-alive\r\n"
+                              "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        if (!writeAll(_fd, (const uint8_t*)request.data(), request.size())) {
+            return 0;
+        }
+
+        // Cabecalhos
+        size_t headerEnd;
+        while ((headerEnd = _buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return 0;
+            }
+        }
+
+        int status = 0;
+        if (sscanf(_buffer.c_str(), "HTTP/%*s %d", &status) != 1) {
+            return 0;
+        }
+
+        size_t contentLength = 0;
+        std::string headers = _buffer.substr(0, headerEnd);
+        for (char& c : headers) {
+            c = tolower(c);
+        }
+        size_t field = headers.find("content-length:");
+        if (field != std::string::npos) {
+            contentLength = strtoul(headers.c_str() + field + 15, nullptr, 10);
+        }
+        bool keepAlive = headers.find("connection: close") == std::string::npos &&
+                         headers.find("http/1.0") != 0;
+
+        // Corpo descartado (so o status importa)
+        _buffer.erase(0, headerEnd + 4);
+        while (_buffer.size() < contentLength) {
+            if (!fill()) {
+                return 0;
+            }
+        }
+        _buffer.erase(0, contentLength);
+
+        if (!keepAlive) {
+            close();
+        }
+        return status;
+    }
+
+    bool fill() {
+        char chunk[1024];
+        ssize_t received = recv(_fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return false;
+        }
+        _buffer.append(chunk, received);
+        return true;
+    }
+};
+
+// ---------- Registros ----------
+
+class Bridge {
+public:
+    Bridge(const Options& options, int fd)
+        : _options(options), _fd(fd), _http(options.host, options.port),
+          _gatewayId(options.gatewayId), _dedupNext(0) {
+        _dedup.assign(DEDUP_SIZE, SeenReading());
+    }
+
+    void feed(const uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] != 0) {
+                if (_segment.size() < FRAME_MAX) {
+                    _segment.push_back(data[i]);
+                }
+                continue;
+            }
+            if (!_segment.empty()) {
+                handleSegment();
+                _segment.clear();
+            }
+        }
+    }
+
+    const Stats& stats() const { return _stats; }
+
+private:
+    Options _options;
+    int _fd;
+    HttpClient _http;
+    std::string _gatewayId;
+    std::vector<uint8_t> _segment;
+    std::vector<SeenReading> _dedup;
+    size_t _dedupNext;
+    Stats _stats;
+
+    void handleSegment() {
+        double receivedAt = nowUs();
+        std::vector<uint8_t> record;
+
+        if (cobsDecode(_segment, record) && record.size() >= 5 &&
+            crc16(record.data(), record.size() - 2) ==
+                (uint16_t)(record[record.size() - 2] | (record[record.size() - 1] << 8))) {
+            _stats.frames++;
+            handleRecord(record, receivedAt);
+            return;
+        }
+
+        // Texto de debug do gateway (ou quadro corrompido)
+        bool printable = true;
+        for (uint8_t c : _segment) {
+            if (c < 0x20 && c != '\r' && c != '\n' && c != '\t') {
+                printable = false;
+                break;
+            }
+        }
+        if (!printable) {
+            _stats.badFrames++;
+            return;
+        }
+
+        std::string text(_segment.begin(), _segment.end());
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+            std::string line = text.substr(start, end - start);
+            if (!line.empty() && line[line.size() - 1] == '\r') {
+                line.erase(line.size() - 1);
+            }
+            if (!line.empty()) {
+                printf("[gw] %s\n", line.c_str());
+                _stats.logLines++;
+            }
+            start = end + 1;
+        }
+    }
+
+    void handleRecord(const std::vector<uint8_t>& record, double receivedAt) {
+        uint16_t seq = record[1] | (record[2] << 8);
+        RecordReader reader(record.data() + 3, record.size() - 5);
+
+        switch (record[0]) {
+            case SERIAL_RECORD_HELLO: {
+                unsigned version = reader.get(1);
+                std::string id = reader.getString();
+                if (!reader.error) {
+                    _gatewayId = id;
+                }
+                _dedup.assign(DEDUP_SIZE, SeenReading());
+                printf("HELLO do gateway %s (versao %u)\n", _gatewayId.c_str(), version);
+                break;
+            }
+
+            case SERIAL_RECORD_READING:
+                handleReading(seq, reader, receivedAt);
+                break;
+
+            case SERIAL_RECORD_STATUS:
+                handleStatus(reader);
+                break;
+
+            default:
+                printf("Registro tipo 0x%02x ignorado\n", record[0]);
+                break;
+        }
+    }
+
+    void handleReading(uint16_t seq, RecordReader& reader, double receivedAt) {
+        uint32_t rxMs = reader.get(4);
+        uint32_t nodeSeq = reader.get(4);
+        int16_t rssi = (int16_t)reader.get(2);
+        int16_t snr = (int16_t)reader.get(2);
+        int32_t freqError = (int32_t)reader.get(4);
+        unsigned sf = reader.get(1);
+        std::string nodeId = reader.getString();
+        std::string nodeType = reader.getString();
+        std::string data = reader.getBytes(reader.get(2));
+        if (reader.error) {
+            _stats.badFrames++;
+            return;
+        }
+
+        _stats.readings++;
+
+        // ACK perdido ou atrasado (POST lento): a leitura volta; so confirma de novo
+        for (const SeenReading& seen : _dedup) {
+            if (seen.matches(seq, nodeId, nodeSeq, rxMs)) {
+                _stats.duplicates++;
+                sendAck(_fd, seq);
+                return;
+            }
+        }
+
+        char rf[96];
+        snprintf(rf, sizeof(rf), "{\"rssi\":%d,\"snr\":%.1f,\"freq_err\":%d,\"sf\":%u}",
+                 rssi, snr / 10.0, freqError, sf);
+        std::string body = "{\"gateway_id\":\"" + jsonEscape(_gatewayId) + "\"," +
+                           "\"timestamp\":" + std::to_string(rxMs / 1000) + "," +
+                           "\"node\":{\"id\":\"" + jsonEscape(nodeId) + "\"," +
+                           "\"type\":\"" + jsonEscape(nodeType) + "\"," +
+                           "\"seq\":" + std::to_string(nodeSeq) +
+                           (data.empty() ? "" : ",\"data\":" + data) + "}," +
+                           "\"rf\":" + rf + "}";
+
+        if (!forward("/api/sensor-data", body)) {
+            _stats.failed++;
+            return;
+        }
+
+        SeenReading& seen = _dedup[_dedupNext];
+        seen.seq = seq;
+        seen.nodeId = nodeId;
+        seen.nodeSeq = nodeSeq;
+        seen.rxMs = rxMs;
+        _dedupNext = (_dedupNext + 1) % DEDUP_SIZE;
+        if (sendAck(_fd, seq)) {
+            _stats.forwarded++;
+            _stats.handoffTotalUs += nowUs() - receivedAt;
+        }
+    }
+
+    void handleStatus(RecordReader& reader) {
+        std::string id = reader.getString();
+        size_t count = reader.get(1);
+        if (reader.error) {
+            _stats.badFrames++;
+            return;
+        }
+        _gatewayId = id;
+
+        std::string stats;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t value = reader.get(4);
+            if (reader.error || i >= STATUS_FIELD_COUNT) {
+                break;
+            }
+            char field[64];
+            if (i == STATUS_CHANNEL_UTIL || i == STATUS_TX_UTIL) {
+                snprintf(field, sizeof(field), "\"%s\":%.1f", STATUS_FIELDS[i], value / 10.0);
+            } else {
+                snprintf(field, sizeof(field), "\"%s\":%u", STATUS_FIELDS[i], value);
+            }
+            stats += (stats.empty() ? "" : ",") + std::string(field);
+        }
+
+        _stats.statuses++;
+        std::string body = "{\"gateway_id\":\"" + jsonEscape(_gatewayId) + "\",\"type\":\"status\"," +
+                           "\"transport\":\"serial\",\"stats\":{" + stats + "}}";
+        forward("/api/gateway-status", body);
+    }
+
+    bool forward(const char* path, const std::string& body) {
+        if (_options.dryRun) {
+            printf("%s %s\n", path, body.c_str());
+            return true;
+        }
+
+        double start = nowUs();
+        int status = _http.post(path, body);
+        _stats.postTotalMs += (nowUs() - start) / 1000.0;
+
+        if (status < 200 || status >= 300) {
+            fprintf(stderr, "Erro: POST %s retornou %d\n", path, status);
+            return false;
+        }
+        return true;
+    }
+};
+
+static void usage(const char* name) {
+    fprintf(stderr, "Uso: %s <dispositivo> [-b baud] [-s host:porta] [-g gateway] [-n]\n", name);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:s:g:n")) != -1) {
+        switch (opt) {
+            case 'b':
+                options.baud = atoi(optarg);
+                break;
+            case 's': {
+                std::string server = optarg;
+                size_t colon = server.rfind(':');
+                options.host = server.substr(0, colon);
+                if (colon != std::string::npos) {
+                    options.port = atoi(server.c_str() + colon + 1);
+                }
+                break;
+            }
+            case 'g':
+                options.gatewayId = optarg;
+                break;
+            case 'n':
+                options.dryRun = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    options.device = argv[optind];
+
+    int fd = openSerial(options);
+    if (fd < 0) {
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    printf("Lendo %s a %d baud, servidor %s\n", options.device.c_str(), options.baud,
+           options.dryRun ? "desativado (-n)" : (options.host + ":" + std::to_string(options.port)).c_str());
+
+    Bridge bridge(options, fd);
+    uint8_t buffer[4096];
+    while (running) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, 500);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (ready == 0) {
+            continue;
+        }
+
+        ssize_t received = read(fd, buffer, sizeof(buffer));
+        if (received > 0) {
+            bridge.feed(buffer, received);
+        } else if (received < 0 && errno != EAGAIN && errno != EINTR) {
+            fprintf(stderr, "Erro de leitura: %s\n", strerror(errno));
+            break;
+        }
+    }
+
+    const Stats& stats = bridge.stats();
+    printf("\nQuadros: %lu validos, %lu invalidos, %lu linhas de log\n",
+           stats.frames, stats.badFrames, stats.logLines);
+    printf("Leituras: %lu recebidas, %lu repassadas, %lu repetidas, %lu falhas\n",
+           stats.readings, stats.forwarded, stats.duplicates, stats.failed);
+    if (stats.forwarded > 0) {
+        printf("Quadro -> ACK: %.0f us em media", stats.handoffTotalUs / stats.forwarded);
+        if (!options.dryRun) {
+            printf(" (POST medio %.1f ms)", stats.postTotalMs / (stats.forwarded + stats.statuses));
+        }
+        printf("\n");
+    }
+    printf("Status: %lu\n", stats.statuses);
+
+    close(fd);
+    return 0;
+}